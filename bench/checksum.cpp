@@ -0,0 +1,219 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Cost of verifying the CRC32C checksum of received data. First measures the
+// raw throughput of the table driven implementation and of the crc32
+// instruction on a single stream and on 3 interleaved ones, then reads a large
+// payload from an in-memory stream that delivers it in chunks, either with
+// async_read followed by a checksum of the whole buffer or with
+// async_read_verified, which checksums every chunk right after it is copied.
+//
+// Usage: checksum [--size BYTES] [--chunk BYTES] [--rounds N]
+
+#include <compose/verified_read.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/read.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace compose_bench
+{
+
+using clock_type = std::chrono::steady_clock;
+
+struct options
+{
+    std::size_t size = 64 * 1024 * 1024;
+    std::size_t chunk = 64 * 1024;
+    std::size_t rounds = 10;
+};
+
+// Delivers the contents of a string at most chunk bytes at a time.
+class memory_stream
+{
+public:
+    using executor_type = boost::asio::io_context::executor_type;
+
+    memory_stream(boost::asio::io_context& ctx,
+                  std::string const& data,
+                  std::size_t chunk)
+      : ctx_{ctx}
+      , data_{data}
+      , chunk_{chunk}
+    {
+    }
+
+    executor_type get_executor()
+    {
+        return ctx_.get_executor();
+    }
+
+    void rewind()
+    {
+        offset_ = 0;
+    }
+
+    template<class MutableBufferSequence, class ReadToken>
+    auto async_read_some(MutableBufferSequence const& buffers, ReadToken&& tok)
+      -> BOOST_ASIO_INITFN_RESULT_TYPE(ReadToken,
+                                       void(boost::system::error_code,
+                                            std::size_t))
+    {
+        boost::asio::async_completion<ReadToken,
+                                      void(boost::system::error_code,
+                                           std::size_t)>
+          init{tok};
+        auto const n = boost::asio::buffer_copy(
+          buffers,
+          boost::asio::buffer(data_.data() + offset_,
+                              std::min(chunk_, data_.size() - offset_)));
+        offset_ += n;
+        boost::system::error_code ec;
+        if (n == 0 && boost::asio::buffer_size(buffers) > 0)
+            ec = boost::asio::error::eof;
+
+        auto handler = std::move(init.completion_handler);
+        boost::asio::post(
+          get_executor(),
+          [handler, ec, n]() mutable { handler(ec, n); });
+        return init.result.get();
+    }
+
+private:
+    boost::asio::io_context& ctx_;
+    std::string const& data_;
+    std::size_t chunk_;
+    std::size_t offset_ = 0;
+};
+
+void
+run_raw(options const& opts, std::string const& data)
+{
+    auto const p = reinterpret_cast<unsigned char const*>(data.data());
+    auto measure = [&](char const* name, auto crc) {
+        // Every round extends the previous checksum, so none can be skipped.
+        std::uint32_t sum = 0;
+        auto const start = clock_type::now();
+        for (std::size_t i = 0; i < opts.rounds; ++i)
+            sum = crc(sum, p, data.size());
+        std::chrono::duration<double> const seconds =
+          clock_type::now() - start;
+        std::printf("%-14s %10.2f GB/s (%08x)\n",
+                    name,
+                    opts.rounds * data.size() / seconds.count() / 1e9,
+                    sum);
+    };
+
+    measure(
+      "table", [](std::uint32_t crc, unsigned char const* p, std::size_t n) {
+          return ~compose::detail::crc32c_portable(~crc, p, n);
+      });
+#ifdef COMPOSE_CRC32C_SSE42
+    auto const level = compose::detail::crc32c_hardware();
+    if (level > 0)
+    {
+        measure(
+          "sse4.2",
+          [](std::uint32_t crc, unsigned char const* p, std::size_t n) {
+              return ~compose::detail::crc32c_sse42(~crc, p, n);
+          });
+    }
+    if (level > 1)
+    {
+        measure(
+          "sse4.2x3",
+          [](std::uint32_t crc, unsigned char const* p, std::size_t n) {
+              return ~compose::detail::crc32c_pclmul(~crc, p, n);
+          });
+    }
+#endif // COMPOSE_CRC32C_SSE42
+}
+
+void
+run_read(options const& opts, std::string const& data, bool verified)
+{
+    boost::asio::io_context ctx{1};
+    memory_stream stream{ctx, data, opts.chunk};
+    std::string received(data.size(), '\0');
+    auto const buffer = boost::asio::buffer(&received[0], received.size());
+    auto const expected = compose::crc32c(data.data(), data.size());
+
+    clock_type::duration elapsed{};
+    for (std::size_t i = 0; i < opts.rounds; ++i)
+    {
+        stream.rewind();
+        ctx.restart();
+        auto const start = clock_type::now();
+        if (verified)
+        {
+            compose::async_read_verified(
+              stream,
+              buffer,
+              expected,
+              [](boost::system::error_code ec, std::size_t) {
+                  if (ec)
+                      std::abort();
+              });
+            ctx.run();
+        }
+        else
+        {
+            boost::asio::async_read(
+              stream, buffer, [](boost::system::error_code ec, std::size_t) {
+                  if (ec)
+                      std::abort();
+              });
+            ctx.run();
+            if (compose::crc32c(received.data(), received.size()) !=
+                expected)
+                std::abort();
+        }
+        elapsed += clock_type::now() - start;
+    }
+
+    std::chrono::duration<double> const seconds = elapsed;
+    std::printf("%-14s %10.2f GB/s\n",
+                verified ? "verified_read" : "read+crc",
+                opts.rounds * data.size() / seconds.count() / 1e9);
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    compose_bench::options opts;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        auto const value = std::strtoul(argv[i + 1], nullptr, 10);
+        if (std::strcmp(argv[i], "--size") == 0)
+            opts.size = value;
+        else if (std::strcmp(argv[i], "--chunk") == 0)
+            opts.chunk = value;
+        else if (std::strcmp(argv[i], "--rounds") == 0)
+            opts.rounds = value;
+    }
+
+    std::string data(opts.size, '\0');
+    for (std::size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>(i * 2654435761u >> 13);
+
+    compose_bench::run_raw(opts, data);
+    compose_bench::run_read(opts, data, false);
+    compose_bench::run_read(opts, data, true);
+    return 0;
+}
@@ -0,0 +1,188 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Build cost of composed operations. Compiles compile_time_ops.cpp with the
+// compiler used for the build, defining N distinct composed operations of
+// each kind, and reports the CPU time and peak memory of the compiler and the
+// size of the object file. The per-operation cost is the slope between the
+// smallest and the largest N.
+//
+// Usage: compile_time [--ops N,N,...] [--kind stable|unstable|inplace|
+//                      bind_token|bind_tag] [--flags FLAGS]
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace compose_bench
+{
+
+struct kind
+{
+    char const* name;
+    int id;
+    char const* standard;
+};
+
+kind const kinds[] = {{"stable", 0, "-std=c++14"},
+                      {"unstable", 1, "-std=c++14"},
+                      {"inplace", 2, "-std=c++17"},
+                      {"bind_token", 3, "-std=c++14"},
+                      {"bind_tag", 4, "-std=c++14"}};
+
+struct result
+{
+    double cpu_seconds = 0;
+    long peak_kib = 0;
+    long object_bytes = 0;
+};
+
+std::vector<std::string>
+split(std::string const& s, char separator)
+{
+    std::vector<std::string> parts;
+    std::string::size_type begin = 0;
+    while (begin <= s.size())
+    {
+        auto end = s.find(separator, begin);
+        if (end == std::string::npos)
+            end = s.size();
+        if (end > begin)
+            parts.push_back(s.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return parts;
+}
+
+bool
+compile(kind const& k, std::size_t ops, std::string const& flags, result& r)
+{
+    std::string const object = "compile_time_ops.o";
+    std::vector<std::string> args{
+      COMPOSE_BENCH_CXX,
+      k.standard,
+      "-c",
+      COMPOSE_BENCH_SOURCE,
+      "-o",
+      object,
+      "-I" COMPOSE_BENCH_INCLUDE_DIR,
+      "-I" COMPOSE_BENCH_BOOST_INCLUDE_DIR,
+      "-DCOMPOSE_BENCH_KIND=" + std::to_string(k.id),
+      "-DCOMPOSE_BENCH_OPS=" + std::to_string(ops)};
+    for (auto& flag : split(flags, ' '))
+        args.push_back(flag);
+
+    std::vector<char*> argv;
+    for (auto& arg : args)
+        argv.push_back(&arg[0]);
+    argv.push_back(nullptr);
+
+    auto const pid = ::fork();
+    if (pid < 0)
+        return false;
+    if (pid == 0)
+    {
+        ::execvp(argv[0], argv.data());
+        std::_Exit(127);
+    }
+
+    int status = 0;
+    rusage usage{};
+    if (::wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0)
+        return false;
+
+    r.cpu_seconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                    (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    r.peak_kib = usage.ru_maxrss;
+
+    struct stat st;
+    if (::stat(object.c_str(), &st) != 0)
+        return false;
+    r.object_bytes = st.st_size;
+    ::unlink(object.c_str());
+    return true;
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    std::string ops = "1,16,64";
+    std::string only;
+    std::string flags = "-O2";
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--ops") == 0)
+            ops = argv[i + 1];
+        else if (std::strcmp(argv[i], "--kind") == 0)
+            only = argv[i + 1];
+        else if (std::strcmp(argv[i], "--flags") == 0)
+            flags = argv[i + 1];
+    }
+
+    std::vector<std::size_t> counts;
+    for (auto& n : compose_bench::split(ops, ','))
+        counts.push_back(std::strtoul(n.c_str(), nullptr, 10));
+
+    std::printf("%-11s %5s %9s %9s %11s\n",
+                "kind",
+                "ops",
+                "cpu s",
+                "peak MiB",
+                "object KiB");
+    for (auto const& k : compose_bench::kinds)
+    {
+        if (!only.empty() && only != k.name)
+            continue;
+
+        std::vector<compose_bench::result> results;
+        for (auto n : counts)
+        {
+            compose_bench::result r;
+            if (!compose_bench::compile(k, n, flags, r))
+            {
+                std::fprintf(stderr, "compilation of %s failed\n", k.name);
+                return EXIT_FAILURE;
+            }
+            std::printf("%-11s %5zu %9.2f %9.1f %11.1f\n",
+                        k.name,
+                        n,
+                        r.cpu_seconds,
+                        r.peak_kib / 1024.0,
+                        r.object_bytes / 1024.0);
+            results.push_back(r);
+        }
+
+        if (counts.size() > 1)
+        {
+            auto const dn = double(counts.back() - counts.front());
+            std::printf("%-11s %5s %9.3f %9.2f %11.2f\n",
+                        k.name,
+                        "/op",
+                        (results.back().cpu_seconds -
+                         results.front().cpu_seconds) /
+                          dn,
+                        (results.back().peak_kib - results.front().peak_kib) /
+                          1024.0 / dn,
+                        (results.back().object_bytes -
+                         results.front().object_bytes) /
+                          1024.0 / dn);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,159 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// The translation unit compiled by the compile_time benchmark. Defines and
+// initiates COMPOSE_BENCH_OPS distinct composed operations of the kind
+// selected by COMPOSE_BENCH_KIND:
+//   0 - stable_transform
+//   1 - unstable_transform
+//   2 - stable_inplace_transform (C++17)
+//   3 - bind_token with 4 tags
+//   4 - bind_tag with 4 tags
+
+#include <compose/bind_tag.hpp>
+#include <compose/bind_token.hpp>
+#include <compose/stable_transform.hpp>
+#include <compose/unstable_transform.hpp>
+#if COMPOSE_BENCH_KIND == 2
+#include <compose/stable_inplace_transform.hpp>
+#endif
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <initializer_list>
+#include <utility>
+
+#ifndef COMPOSE_BENCH_OPS
+#define COMPOSE_BENCH_OPS 1
+#endif // COMPOSE_BENCH_OPS
+
+#ifndef COMPOSE_BENCH_KIND
+#define COMPOSE_BENCH_KIND 0
+#endif // COMPOSE_BENCH_KIND
+
+namespace compose_bench
+{
+
+using timer_type = boost::asio::steady_timer;
+
+struct done_handler
+{
+    void operator()(boost::system::error_code) const
+    {
+    }
+};
+
+template<std::size_t K>
+struct tag
+{
+};
+
+using tags = compose::tag_set<tag<0>, tag<1>, tag<2>, tag<3>>;
+
+// Waits on the timer n times.
+template<std::size_t I>
+struct wait_op
+{
+    wait_op(timer_type& timer, int n)
+      : timer_{timer}
+      , n_{n}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {})
+    {
+        if (ec || n_-- == 0)
+            return yield.upcall(ec);
+
+        timer_.expires_after(std::chrono::milliseconds{1});
+        return timer_.async_wait(yield);
+    }
+
+    timer_type& timer_;
+    int n_;
+};
+
+// Waits on the timer, dispatching on a different tag every time.
+template<std::size_t I>
+struct tagged_wait_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        return (*this)(yield, tag<0>{}, {});
+    }
+
+    template<class Self, std::size_t K>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     tag<K>,
+                                     boost::system::error_code ec)
+    {
+        if (ec || n_-- == 0)
+            return yield.upcall(ec);
+
+        timer_.expires_after(std::chrono::milliseconds{1});
+#if COMPOSE_BENCH_KIND == 3
+        return timer_.async_wait(
+          compose::bind_token(yield, tag<(K + 1) % 4>{}));
+#else
+        return timer_.async_wait(
+          compose::bind_tag<tags>(yield, tag<(K + 1) % 4>{}));
+#endif
+    }
+
+    timer_type& timer_;
+    int n_;
+};
+
+template<std::size_t I>
+void
+initiate(timer_type& timer)
+{
+    done_handler handler;
+    boost::asio::async_completion<done_handler,
+                                  void(boost::system::error_code)>
+      init{handler};
+#if COMPOSE_BENCH_KIND == 0
+    compose::stable_transform<wait_op<I>>(
+      timer.get_executor(), init, std::piecewise_construct, timer, 1)
+      .run();
+#elif COMPOSE_BENCH_KIND == 1
+    compose::unstable_transform(
+      timer.get_executor(), init, wait_op<I>{timer, 1})
+      .run();
+#elif COMPOSE_BENCH_KIND == 2
+    auto op = compose::stable_inplace_transform(
+      timer.get_executor(),
+      init,
+      COMPOSE_INPLACE_FWD(wait_op<I>{timer, 1}));
+    std::move(op).run();
+#else
+    compose::stable_transform<tagged_wait_op<I>>(
+      timer.get_executor(), init, std::piecewise_construct, timer, 4)
+      .run();
+#endif
+}
+
+template<std::size_t... Is>
+void
+initiate_all(timer_type& timer, std::index_sequence<Is...>)
+{
+    (void)std::initializer_list<int>{(initiate<Is>(timer), 0)...};
+}
+
+void
+initiate_all(timer_type& timer)
+{
+    initiate_all(timer, std::make_index_sequence<COMPOSE_BENCH_OPS>{});
+}
+
+} // namespace compose_bench
@@ -0,0 +1,232 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Cost of moving a step of a composed operation to a thread_pool and back.
+// M operations run N steps each, every step hashes a small buffer. The inline
+// row runs the steps on the I/O thread. The posted row hands each step to the
+// pool with boost::asio::post and posts the result back with a lambda, the way
+// it is written by hand. The slot row uses compose::offload_slot. The
+// allocations column counts calls of operator new per step, the hand-written
+// hops rely on Asio's per-thread recycling of handler memory to avoid them.
+//
+// Usage: compute_offload [--operations M] [--steps N] [--bytes N]
+//                        [--threads N]
+
+#include <compose/coroutine.hpp>
+#include <compose/offload.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+namespace compose_bench
+{
+
+std::atomic<std::size_t> allocations{0};
+
+} // namespace compose_bench
+
+void*
+operator new(std::size_t n)
+{
+    ++compose_bench::allocations;
+    if (void* p = std::malloc(n == 0 ? 1 : n))
+        return p;
+    throw std::bad_alloc{};
+}
+
+// Not inlined, so that the compiler does not see the new expressions being
+// paired with std::free.
+__attribute__((noinline)) void
+operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+__attribute__((noinline)) void
+operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace compose_bench
+{
+
+using pool_executor = boost::asio::thread_pool::executor_type;
+
+struct options
+{
+    std::size_t operations = 64;
+    std::size_t steps = 4000;
+    std::size_t bytes = 256;
+    std::size_t threads = 1;
+};
+
+std::uint32_t
+hash(std::vector<char> const& buffer)
+{
+    std::uint32_t h = 2166136261u;
+    for (char c : buffer)
+        h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+    return h;
+}
+
+struct done_handler
+{
+    void operator()(std::uint32_t h) const
+    {
+        result_ = h;
+    }
+
+    std::uint32_t& result_;
+};
+
+template<class Mode>
+struct hash_op
+{
+    hash_op(pool_executor ex, std::size_t steps, std::size_t bytes)
+      : compute_{ex}
+      , steps_{steps}
+      , buffer_(bytes, 'x')
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     std::uint32_t h = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (; steps_ > 0; --steps_)
+            {
+                COMPOSE_YIELD Mode::step(*this, yield);
+                result_ ^= h;
+            }
+            return yield.direct_upcall(result_);
+        }
+    }
+
+    pool_executor compute_;
+    std::size_t steps_;
+    std::vector<char> buffer_;
+    std::uint32_t result_ = 0;
+    compose::offload_slot<std::uint32_t> slot_;
+    compose::coroutine coro_;
+};
+
+struct inline_mode
+{
+    template<class Op, class Self>
+    static compose::upcall_guard step(Op& op, compose::yield_token<Self> yield)
+    {
+        auto const h = hash(op.buffer_);
+        auto self = yield.release_operation();
+        auto const ex = boost::asio::get_associated_executor(self);
+        boost::asio::post(
+          ex, [self = std::move(self), h]() mutable { self(h); });
+        return {};
+    }
+};
+
+struct posted_mode
+{
+    template<class Op, class Self>
+    static compose::upcall_guard step(Op& op, compose::yield_token<Self> yield)
+    {
+        boost::asio::post(
+          op.compute_, [&op, self = yield.release_operation()]() mutable {
+              auto const h = hash(op.buffer_);
+              auto const ex = boost::asio::get_associated_executor(self);
+              boost::asio::post(
+                ex, [self = std::move(self), h]() mutable { self(h); });
+          });
+        return {};
+    }
+};
+
+struct slot_mode
+{
+    template<class Op, class Self>
+    static compose::upcall_guard step(Op& op, compose::yield_token<Self> yield)
+    {
+        return op.slot_.post(
+          op.compute_, [&op] { return hash(op.buffer_); }, yield);
+    }
+};
+
+template<class Mode>
+void
+run(char const* name, options const& opts)
+{
+    boost::asio::io_context ctx{1};
+    boost::asio::thread_pool pool{opts.threads};
+    std::uint32_t result = 0;
+    for (std::size_t i = 0; i < opts.operations; ++i)
+    {
+        done_handler handler{result};
+        boost::asio::async_completion<done_handler, void(std::uint32_t)> init{
+          handler};
+        compose::stable_transform<hash_op<Mode>>(ctx.get_executor(),
+                                                 init,
+                                                 std::piecewise_construct,
+                                                 pool.get_executor(),
+                                                 opts.steps,
+                                                 opts.bytes)
+          .run();
+    }
+
+    auto const before = allocations.load();
+    auto const start = std::chrono::steady_clock::now();
+    ctx.run();
+    std::chrono::duration<double, std::nano> const elapsed =
+      std::chrono::steady_clock::now() - start;
+    auto const allocated = allocations.load() - before;
+    pool.join();
+
+    auto const steps = static_cast<double>(opts.operations * opts.steps);
+    std::printf("%-8s %10.1f ns/step %8.2f allocations/step\n",
+                name,
+                elapsed.count() / steps,
+                allocated / steps);
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    compose_bench::options opts;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        auto const value = std::strtoul(argv[i + 1], nullptr, 10);
+        if (std::strcmp(argv[i], "--operations") == 0)
+            opts.operations = value;
+        else if (std::strcmp(argv[i], "--steps") == 0)
+            opts.steps = value;
+        else if (std::strcmp(argv[i], "--bytes") == 0)
+            opts.bytes = value;
+        else if (std::strcmp(argv[i], "--threads") == 0)
+            opts.threads = value;
+    }
+
+    compose_bench::run<compose_bench::inline_mode>("inline", opts);
+    compose_bench::run<compose_bench::posted_mode>("posted", opts);
+    compose_bench::run<compose_bench::slot_mode>("slot", opts);
+    return 0;
+}
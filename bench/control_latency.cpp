@@ -0,0 +1,225 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Latency of a control operation sharing an io_context with bulk operations.
+// Every bulk operation spins for a while, to simulate processing a chunk of
+// data, and hops through its executor, forever. The control operation waits
+// on a timer, then hops once, and measures the time from the expiry of the
+// timer to its resumption after the hop. In the fifo variant all completions
+// share the queue of the io_context, in the priority variant the operations
+// are bound to the classes of a priority_scheduler.
+//
+// Usage: control_latency [--bulk N] [--work NS] [--samples N]
+//                        [--interval US]
+
+#include <compose/coroutine.hpp>
+#include <compose/priority_scheduler.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace compose_bench
+{
+
+using clock_type = std::chrono::steady_clock;
+using scheduler_type =
+  compose::priority_scheduler<boost::asio::io_context::executor_type>;
+
+struct options
+{
+    std::size_t bulk = 64;
+    std::size_t work = 2000;
+    std::size_t samples = 2000;
+    std::size_t interval = 200;
+};
+
+void
+spin(std::chrono::nanoseconds duration)
+{
+    auto const end = clock_type::now() + duration;
+    while (clock_type::now() < end)
+    {
+    }
+}
+
+struct bulk_op
+{
+    bulk_op(options const& opts, bool const& stop, std::size_t& hops)
+      : opts_{opts}
+      , stop_{stop}
+      , hops_{hops}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            while (!stop_)
+            {
+                spin(std::chrono::nanoseconds{opts_.work});
+                ++hops_;
+                COMPOSE_YIELD boost::asio::post(yield);
+            }
+            return yield.upcall();
+        }
+    }
+
+    options const& opts_;
+    bool const& stop_;
+    std::size_t& hops_;
+    compose::coroutine coro_;
+};
+
+struct control_op
+{
+    control_op(boost::asio::io_context& ctx,
+               options const& opts,
+               std::vector<clock_type::duration>& latencies)
+      : timer_{ctx}
+      , opts_{opts}
+      , latencies_{latencies}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code = {})
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            while (latencies_.size() < opts_.samples)
+            {
+                timer_.expires_after(
+                  std::chrono::microseconds{opts_.interval});
+                COMPOSE_YIELD timer_.async_wait(yield);
+                COMPOSE_YIELD boost::asio::post(yield);
+                latencies_.push_back(clock_type::now() - timer_.expiry());
+            }
+            return yield.upcall();
+        }
+    }
+
+    boost::asio::steady_timer timer_;
+    options const& opts_;
+    std::vector<clock_type::duration>& latencies_;
+    compose::coroutine coro_;
+};
+
+template<class Body, class Handler, class... Args>
+void
+start(boost::asio::io_context& ctx, Handler&& handler, Args&&... args)
+{
+    boost::asio::async_completion<Handler, void()> init{handler};
+    compose::stable_transform<Body>(ctx.get_executor(),
+                                    init,
+                                    std::piecewise_construct,
+                                    std::forward<Args>(args)...)
+      .run();
+}
+
+void
+run(options const& opts, bool prioritized)
+{
+    boost::asio::io_context ctx{1};
+    scheduler_type scheduler{ctx.get_executor()};
+
+    bool stop = false;
+    std::size_t hops = 0;
+    for (std::size_t i = 0; i < opts.bulk; ++i)
+    {
+        auto handler = []() {};
+        if (prioritized)
+        {
+            start<bulk_op>(
+              ctx,
+              boost::asio::bind_executor(scheduler.get_executor(1), handler),
+              opts,
+              stop,
+              hops);
+        }
+        else
+            start<bulk_op>(ctx, handler, opts, stop, hops);
+    }
+
+    std::vector<clock_type::duration> latencies;
+    latencies.reserve(opts.samples);
+    auto const done = [&stop]() { stop = true; };
+    if (prioritized)
+    {
+        start<control_op>(
+          ctx,
+          boost::asio::bind_executor(scheduler.get_executor(0), done),
+          ctx,
+          opts,
+          latencies);
+    }
+    else
+        start<control_op>(ctx, done, ctx, opts, latencies);
+
+    auto const begin = clock_type::now();
+    ctx.run();
+    std::chrono::duration<double> const seconds = clock_type::now() - begin;
+
+    std::sort(latencies.begin(), latencies.end());
+    auto const percentile = [&](double p) {
+        auto const i = static_cast<std::size_t>(p * (latencies.size() - 1));
+        return std::chrono::duration<double, std::micro>{latencies[i]}
+          .count();
+    };
+    std::printf("%-9s %9.1f %9.1f %9.1f %9.1f %12.0f\n",
+                prioritized ? "priority" : "fifo",
+                percentile(0.5),
+                percentile(0.99),
+                percentile(0.999),
+                percentile(1.0),
+                hops / seconds.count());
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    compose_bench::options opts;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        auto const value = std::strtoul(argv[i + 1], nullptr, 10);
+        if (std::strcmp(argv[i], "--bulk") == 0)
+            opts.bulk = value;
+        else if (std::strcmp(argv[i], "--work") == 0)
+            opts.work = value;
+        else if (std::strcmp(argv[i], "--samples") == 0)
+            opts.samples = value;
+        else if (std::strcmp(argv[i], "--interval") == 0)
+            opts.interval = value;
+    }
+
+    std::printf("%-9s %9s %9s %9s %9s %12s\n",
+                "queue",
+                "p50 us",
+                "p99 us",
+                "p99.9 us",
+                "max us",
+                "bulk hops/s");
+    compose_bench::run(opts, false);
+    compose_bench::run(opts, true);
+    return 0;
+}
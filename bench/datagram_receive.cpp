@@ -0,0 +1,184 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Receive rate of small UDP datagrams over loopback. A burst of datagrams is
+// queued in the receiving socket, then a composed operation receives it, with
+// one async_receive_from per datagram or with a receive_batch. Only the time
+// spent receiving is measured.
+//
+// Usage: datagram_receive [--datagrams N] [--burst N] [--size BYTES]
+
+#include <compose/coroutine.hpp>
+#include <compose/receive_batch.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/udp.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace compose_bench
+{
+
+using udp = boost::asio::ip::udp;
+using clock_type = std::chrono::steady_clock;
+
+struct options
+{
+    std::size_t datagrams = 1000000;
+    std::size_t burst = 256;
+    std::size_t size = 32;
+};
+
+struct receive_op
+{
+    receive_op(udp::socket& receiver,
+               udp::socket& sender,
+               options const& opts,
+               std::size_t batch,
+               clock_type::duration& elapsed)
+      : receiver_{receiver}
+      , sender_{sender}
+      , opts_{opts}
+      , message_(opts.size, 'x')
+      , buffer_(opts.size)
+      , batch_{batch == 0 ? 1 : batch, opts.size}
+      , use_batch_{batch != 0}
+      , elapsed_{elapsed}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {},
+                                     std::size_t n = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (; total_ < opts_.datagrams; total_ += opts_.burst)
+            {
+                for (std::size_t i = 0; i < opts_.burst; ++i)
+                    sender_.send_to(boost::asio::buffer(message_),
+                                    receiver_.local_endpoint());
+
+                start_ = clock_type::now();
+                for (received_ = 0; received_ < opts_.burst; received_ += n)
+                {
+                    if (use_batch_)
+                        COMPOSE_YIELD batch_.async_receive(receiver_, yield);
+                    else
+                        COMPOSE_YIELD receiver_.async_receive_from(
+                          boost::asio::buffer(buffer_), from_, yield);
+                    if (ec)
+                        return yield.upcall(ec);
+                    if (!use_batch_)
+                        n = 1;
+                }
+                elapsed_ += clock_type::now() - start_;
+            }
+
+            return yield.upcall(ec);
+        }
+    }
+
+    udp::socket& receiver_;
+    udp::socket& sender_;
+    options const& opts_;
+    std::string message_;
+    std::vector<char> buffer_;
+    udp::endpoint from_;
+    compose::receive_batch<udp::socket> batch_;
+    bool use_batch_;
+    clock_type::duration& elapsed_;
+    clock_type::time_point start_;
+    std::size_t total_ = 0;
+    std::size_t received_ = 0;
+    compose::coroutine coro_{};
+};
+
+template<class CompletionToken>
+auto
+async_receive_all(udp::socket& receiver,
+                  udp::socket& sender,
+                  options const& opts,
+                  std::size_t batch,
+                  clock_type::duration& elapsed,
+                  CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code)>
+      init{tok};
+    compose::stable_transform<receive_op>(receiver.get_executor(),
+                                          init,
+                                          std::piecewise_construct,
+                                          receiver,
+                                          sender,
+                                          opts,
+                                          batch,
+                                          elapsed)
+      .run();
+    return init.result.get();
+}
+
+void
+run(options const& opts, std::size_t batch)
+{
+    boost::asio::io_context ctx{1};
+    udp::endpoint const loopback{boost::asio::ip::address_v4::loopback(), 0};
+    udp::socket receiver{ctx, loopback};
+    udp::socket sender{ctx, loopback};
+    receiver.set_option(udp::socket::receive_buffer_size{8 << 20});
+
+    clock_type::duration elapsed{};
+    async_receive_all(
+      receiver, sender, opts, batch, elapsed, [](boost::system::error_code ec) {
+          if (ec)
+              std::abort();
+      });
+    ctx.run();
+
+    std::chrono::duration<double> const seconds = elapsed;
+    std::printf("%-10s %6zu %14.0f %10.1f\n",
+                batch == 0 ? "loop" : "batch",
+                batch,
+                opts.datagrams / seconds.count(),
+                seconds.count() * 1e9 / opts.datagrams);
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    compose_bench::options opts;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        auto const value = std::strtoul(argv[i + 1], nullptr, 10);
+        if (std::strcmp(argv[i], "--datagrams") == 0)
+            opts.datagrams = value;
+        else if (std::strcmp(argv[i], "--burst") == 0)
+            opts.burst = value;
+        else if (std::strcmp(argv[i], "--size") == 0)
+            opts.size = value;
+    }
+
+    std::printf(
+      "%-10s %6s %14s %10s\n", "impl", "batch", "datagrams/s", "ns/dgram");
+    compose_bench::run(opts, 0);
+    for (std::size_t batch : {8, 32, 64})
+        compose_bench::run(opts, batch);
+    return 0;
+}
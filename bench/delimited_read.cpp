@@ -0,0 +1,194 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Cost of finding a delimiter at the end of a large message which arrives in
+// small chunks, with boost::asio::async_read_until and
+// compose::async_read_until. The stream is in memory and every read
+// completes through the executor, so the measured difference is the scan.
+//
+// Usage: delimited_read [--size MIB] [--chunk BYTES] [--rounds N]
+
+#include <compose/read_until.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/read_until.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+
+namespace compose_bench
+{
+
+// Serves a string in chunks of at most chunk bytes.
+class chunked_stream
+{
+public:
+    using executor_type = boost::asio::io_context::executor_type;
+
+    chunked_stream(boost::asio::io_context& ctx,
+                   std::string const& data,
+                   std::size_t chunk)
+      : ctx_{ctx}
+      , data_{data}
+      , chunk_{chunk}
+    {
+    }
+
+    executor_type get_executor() noexcept
+    {
+        return ctx_.get_executor();
+    }
+
+    void rewind() noexcept
+    {
+        offset_ = 0;
+    }
+
+    template<class MutableBufferSequence, class ReadToken>
+    auto async_read_some(MutableBufferSequence const& buffers,
+                         ReadToken&& tok)
+      -> BOOST_ASIO_INITFN_RESULT_TYPE(ReadToken,
+                                       void(boost::system::error_code,
+                                            std::size_t))
+    {
+        boost::asio::async_completion<ReadToken,
+                                      void(boost::system::error_code,
+                                           std::size_t)>
+          init{tok};
+        auto const size = std::min(chunk_, data_.size() - offset_);
+        auto const n = boost::asio::buffer_copy(
+          buffers, boost::asio::buffer(data_.data() + offset_, size));
+        offset_ += n;
+        boost::asio::post(
+          ctx_,
+          [handler = std::move(init.completion_handler), n]() mutable {
+              handler(boost::system::error_code{}, n);
+          });
+        return init.result.get();
+    }
+
+private:
+    boost::asio::io_context& ctx_;
+    std::string const& data_;
+    std::size_t chunk_;
+    std::size_t offset_ = 0;
+};
+
+struct options
+{
+    std::size_t size = 8 << 20;
+    std::size_t chunk = 1024;
+    std::size_t rounds = 10;
+};
+
+template<class ReadUntil>
+void
+run(char const* name,
+    char const* delim,
+    options const& opts,
+    ReadUntil read_until)
+{
+    auto data = std::string(opts.size, 'x');
+    data.replace(data.size() - std::strlen(delim), std::strlen(delim), delim);
+
+    boost::asio::io_context ctx{1};
+    chunked_stream stream{ctx, data, opts.chunk};
+    std::string buffer;
+    buffer.reserve(data.size());
+
+    std::chrono::steady_clock::duration elapsed{};
+    for (std::size_t i = 0; i < opts.rounds; ++i)
+    {
+        stream.rewind();
+        buffer.clear();
+        auto const start = std::chrono::steady_clock::now();
+        read_until(stream,
+                   buffer,
+                   delim,
+                   [&](boost::system::error_code ec, std::size_t n) {
+                       if (ec || n != data.size())
+                           std::abort();
+                   });
+        ctx.run();
+        ctx.restart();
+        elapsed += std::chrono::steady_clock::now() - start;
+    }
+
+    std::chrono::duration<double> const seconds = elapsed;
+    std::printf("%-8s %-10s %12.3f %12.2f\n",
+                name,
+                delim[1] == '\0' ? "\\n" : "\\r\\n\\r\\n",
+                seconds.count() * 1e3 / opts.rounds,
+                double(opts.size) * opts.rounds / seconds.count() / 1e9);
+}
+
+struct asio_read_until
+{
+    template<class Handler>
+    void operator()(chunked_stream& stream,
+                    std::string& buffer,
+                    char const* delim,
+                    Handler&& handler) const
+    {
+        boost::asio::async_read_until(stream,
+                                      boost::asio::dynamic_buffer(buffer),
+                                      delim,
+                                      std::forward<Handler>(handler));
+    }
+};
+
+struct compose_read_until
+{
+    template<class Handler>
+    void operator()(chunked_stream& stream,
+                    std::string& buffer,
+                    char const* delim,
+                    Handler&& handler) const
+    {
+        compose::async_read_until(stream,
+                                  boost::asio::dynamic_buffer(buffer),
+                                  delim,
+                                  std::forward<Handler>(handler));
+    }
+};
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    compose_bench::options opts;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        auto const value = std::strtoul(argv[i + 1], nullptr, 10);
+        if (std::strcmp(argv[i], "--size") == 0)
+            opts.size = value << 20;
+        else if (std::strcmp(argv[i], "--chunk") == 0)
+            opts.chunk = value;
+        else if (std::strcmp(argv[i], "--rounds") == 0)
+            opts.rounds = value;
+    }
+
+    std::printf("%-8s %-10s %12s %12s\n", "impl", "delimiter", "ms/message",
+                "GB/s");
+    for (auto const delim : {"\n", "\r\n\r\n"})
+    {
+        compose_bench::run(
+          "asio", delim, opts, compose_bench::asio_read_until{});
+        compose_bench::run(
+          "compose", delim, opts, compose_bench::compose_read_until{});
+    }
+    return 0;
+}
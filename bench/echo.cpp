@@ -0,0 +1,848 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Ping-pong echo benchmark over TCP loopback and socketpairs. The client and
+// server protocol logic is implemented with stable_transform, with
+// stable_transform and speculative I/O, with stable_transform over
+// uring_descriptors, with unstable_transform and bind_token tag dispatch and
+// with raw Asio handlers.
+//
+// Usage: echo [--transport tcp|unix|all]
+//             [--impl stable|speculative|uring|unstable|raw|all]
+//             [--connections N[,N...]] [--threads N] [--messages N]
+//             [--size BYTES]
+
+#include <compose/bind_token.hpp>
+#include <compose/coroutine.hpp>
+#include <compose/speculative_io.hpp>
+#include <compose/stable_transform.hpp>
+#include <compose/unstable_transform.hpp>
+#include <compose/uring_descriptor.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace compose_bench
+{
+
+using error_code = boost::system::error_code;
+
+struct options
+{
+    std::vector<std::string> transports{"tcp", "unix"};
+    std::vector<std::string> impls{
+      "stable", "speculative", "uring", "unstable", "raw"};
+    std::vector<std::size_t> connections{1, 100, 10000};
+    std::size_t threads = 1;
+    std::size_t messages = 200000;
+    std::size_t size = 64;
+};
+
+// Client: writes a message and reads the echo, rounds times.
+template<typename Stream>
+struct stable_ping_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     error_code ec = {},
+                                     std::size_t = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (; rounds_ > 0; --rounds_)
+            {
+                COMPOSE_YIELD boost::asio::async_write(
+                  stream_, boost::asio::buffer(buffer_, size_), yield);
+                if (ec)
+                    break;
+
+                COMPOSE_YIELD boost::asio::async_read(
+                  stream_, boost::asio::buffer(buffer_, size_), yield);
+                if (ec)
+                    break;
+            }
+
+            return yield.upcall(ec);
+        }
+    }
+
+    Stream& stream_;
+    char* buffer_;
+    std::size_t size_;
+    std::size_t rounds_;
+    compose::coroutine coro_{};
+};
+
+// Server: echoes everything back until the client closes the connection.
+template<typename Stream>
+struct stable_echo_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     error_code ec = {},
+                                     std::size_t n = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (;;)
+            {
+                COMPOSE_YIELD stream_.async_read_some(
+                  boost::asio::buffer(buffer_, size_), yield);
+                if (ec)
+                    break;
+
+                COMPOSE_YIELD boost::asio::async_write(
+                  stream_, boost::asio::buffer(buffer_, n), yield);
+                if (ec)
+                    break;
+            }
+
+            if (ec == boost::asio::error::eof)
+                ec = {};
+            return yield.upcall(ec);
+        }
+    }
+
+    Stream& stream_;
+    char* buffer_;
+    std::size_t size_;
+    compose::coroutine coro_{};
+};
+
+// Same protocol as stable_ping_op, but the data is transferred with
+// speculative non-blocking calls, which resume the operation inline.
+template<typename Stream>
+struct speculative_ping_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     error_code ec = {},
+                                     std::size_t n = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (; rounds_ > 0; --rounds_)
+            {
+                for (offset_ = 0; offset_ < size_; offset_ += n)
+                {
+                    COMPOSE_YIELD compose::speculative_write_some(
+                      stream_,
+                      boost::asio::buffer(buffer_ + offset_, size_ - offset_),
+                      yield);
+                    if (ec)
+                        return yield.upcall(ec);
+                }
+
+                for (offset_ = 0; offset_ < size_; offset_ += n)
+                {
+                    COMPOSE_YIELD compose::speculative_read_some(
+                      stream_,
+                      boost::asio::buffer(buffer_ + offset_, size_ - offset_),
+                      yield);
+                    if (ec)
+                        return yield.upcall(ec);
+                }
+            }
+
+            return yield.upcall(ec);
+        }
+    }
+
+    Stream& stream_;
+    char* buffer_;
+    std::size_t size_;
+    std::size_t rounds_;
+    std::size_t offset_ = 0;
+    compose::coroutine coro_{};
+};
+
+template<typename Stream>
+struct speculative_echo_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     error_code ec = {},
+                                     std::size_t n = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (;;)
+            {
+                COMPOSE_YIELD compose::speculative_read_some(
+                  stream_, boost::asio::buffer(buffer_, size_), yield);
+                if (ec)
+                    break;
+
+                for (length_ = n, offset_ = 0; offset_ < length_;
+                     offset_ += n)
+                {
+                    COMPOSE_YIELD compose::speculative_write_some(
+                      stream_,
+                      boost::asio::buffer(buffer_ + offset_, length_ - offset_),
+                      yield);
+                    if (ec)
+                        return yield.upcall(ec);
+                }
+            }
+
+            if (ec == boost::asio::error::eof)
+                ec = {};
+            return yield.upcall(ec);
+        }
+    }
+
+    Stream& stream_;
+    char* buffer_;
+    std::size_t size_;
+    std::size_t length_ = 0;
+    std::size_t offset_ = 0;
+    compose::coroutine coro_{};
+};
+
+template<typename Stream>
+struct unstable_ping_op
+{
+    struct write_tag
+    {
+    };
+
+    struct read_tag
+    {
+    };
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        if (rounds_ == 0)
+            return yield.post_upcall(error_code{});
+        return write(yield);
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     write_tag,
+                                     error_code ec,
+                                     std::size_t)
+    {
+        if (ec)
+            return yield.direct_upcall(ec);
+
+        return boost::asio::async_read(
+          stream_,
+          boost::asio::buffer(buffer_, size_),
+          compose::bind_token(yield, read_tag{}));
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     read_tag,
+                                     error_code ec,
+                                     std::size_t)
+    {
+        if (ec || --rounds_ == 0)
+            return yield.direct_upcall(ec);
+        return write(yield);
+    }
+
+    template<class Self>
+    compose::upcall_guard write(compose::yield_token<Self> yield)
+    {
+        return boost::asio::async_write(
+          stream_,
+          boost::asio::buffer(buffer_, size_),
+          compose::bind_token(yield, write_tag{}));
+    }
+
+    Stream& stream_;
+    char* buffer_;
+    std::size_t size_;
+    std::size_t rounds_;
+};
+
+template<typename Stream>
+struct unstable_echo_op
+{
+    struct write_tag
+    {
+    };
+
+    struct read_tag
+    {
+    };
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        return read(yield);
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     read_tag,
+                                     error_code ec,
+                                     std::size_t n)
+    {
+        if (ec == boost::asio::error::eof)
+            return yield.direct_upcall(error_code{});
+        if (ec)
+            return yield.direct_upcall(ec);
+
+        return boost::asio::async_write(
+          stream_,
+          boost::asio::buffer(buffer_, n),
+          compose::bind_token(yield, write_tag{}));
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     write_tag,
+                                     error_code ec,
+                                     std::size_t)
+    {
+        if (ec)
+            return yield.direct_upcall(ec);
+        return read(yield);
+    }
+
+    template<class Self>
+    compose::upcall_guard read(compose::yield_token<Self> yield)
+    {
+        return stream_.async_read_some(boost::asio::buffer(buffer_, size_),
+                                       compose::bind_token(yield, read_tag{}));
+    }
+
+    Stream& stream_;
+    char* buffer_;
+    std::size_t size_;
+};
+
+template<typename Stream>
+class raw_ping
+{
+public:
+    raw_ping(Stream& stream,
+             char* buffer,
+             std::size_t size,
+             std::size_t rounds,
+             std::atomic<std::size_t>& done)
+      : stream_{stream}
+      , buffer_{buffer}
+      , size_{size}
+      , rounds_{rounds}
+      , done_{done}
+    {
+    }
+
+    void start()
+    {
+        if (rounds_ == 0)
+            return finish();
+
+        boost::asio::async_write(
+          stream_,
+          boost::asio::buffer(buffer_, size_),
+          [this](error_code ec, std::size_t) { on_write(ec); });
+    }
+
+private:
+    void on_write(error_code ec)
+    {
+        if (ec)
+            return finish();
+
+        boost::asio::async_read(
+          stream_,
+          boost::asio::buffer(buffer_, size_),
+          [this](error_code ec, std::size_t) { on_read(ec); });
+    }
+
+    void on_read(error_code ec)
+    {
+        if (ec)
+            return finish();
+        --rounds_;
+        start();
+    }
+
+    void finish()
+    {
+        error_code ignored;
+        stream_.shutdown(Stream::shutdown_send, ignored);
+        ++done_;
+    }
+
+    Stream& stream_;
+    char* buffer_;
+    std::size_t size_;
+    std::size_t rounds_;
+    std::atomic<std::size_t>& done_;
+};
+
+template<typename Stream>
+class raw_echo
+{
+public:
+    raw_echo(Stream& stream, char* buffer, std::size_t size)
+      : stream_{stream}
+      , buffer_{buffer}
+      , size_{size}
+    {
+    }
+
+    void start()
+    {
+        stream_.async_read_some(
+          boost::asio::buffer(buffer_, size_),
+          [this](error_code ec, std::size_t n) { on_read(ec, n); });
+    }
+
+private:
+    void on_read(error_code ec, std::size_t n)
+    {
+        if (ec)
+            return;
+
+        boost::asio::async_write(
+          stream_,
+          boost::asio::buffer(buffer_, n),
+          [this](error_code ec, std::size_t) {
+              if (!ec)
+                  start();
+          });
+    }
+
+    Stream& stream_;
+    char* buffer_;
+    std::size_t size_;
+};
+
+template<typename Stream, typename CompletionToken>
+auto
+async_stable_ping(Stream& stream,
+                  char* buffer,
+                  std::size_t size,
+                  std::size_t rounds,
+                  CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(error_code))
+{
+    boost::asio::async_completion<CompletionToken, void(error_code)> init{
+      tok};
+    compose::stable_transform<stable_ping_op<Stream>>(stream.get_executor(),
+                                                      init,
+                                                      std::piecewise_construct,
+                                                      stream,
+                                                      buffer,
+                                                      size,
+                                                      rounds)
+      .run();
+    return init.result.get();
+}
+
+template<typename Stream, typename CompletionToken>
+auto
+async_stable_echo(Stream& stream,
+                  char* buffer,
+                  std::size_t size,
+                  CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(error_code))
+{
+    boost::asio::async_completion<CompletionToken, void(error_code)> init{
+      tok};
+    compose::stable_transform<stable_echo_op<Stream>>(stream.get_executor(),
+                                                      init,
+                                                      std::piecewise_construct,
+                                                      stream,
+                                                      buffer,
+                                                      size)
+      .run();
+    return init.result.get();
+}
+
+template<template<typename> class Body,
+         typename Stream,
+         typename CompletionToken,
+         typename... Args>
+auto
+async_stable_run(Stream& stream, CompletionToken&& tok, Args... args)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(error_code))
+{
+    boost::asio::async_completion<CompletionToken, void(error_code)> init{
+      tok};
+    compose::stable_transform<Body<Stream>>(
+      stream.get_executor(), init, std::piecewise_construct, stream, args...)
+      .run();
+    return init.result.get();
+}
+
+template<typename Stream, typename CompletionToken>
+auto
+async_unstable_ping(Stream& stream,
+                    char* buffer,
+                    std::size_t size,
+                    std::size_t rounds,
+                    CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(error_code))
+{
+    boost::asio::async_completion<CompletionToken, void(error_code)> init{
+      tok};
+    compose::unstable_transform<unstable_ping_op<Stream>>(
+      stream.get_executor(),
+      init,
+      std::piecewise_construct,
+      stream,
+      buffer,
+      size,
+      rounds)
+      .run();
+    return init.result.get();
+}
+
+template<typename Stream, typename CompletionToken>
+auto
+async_unstable_echo(Stream& stream,
+                    char* buffer,
+                    std::size_t size,
+                    CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(error_code))
+{
+    boost::asio::async_completion<CompletionToken, void(error_code)> init{
+      tok};
+    compose::unstable_transform<unstable_echo_op<Stream>>(
+      stream.get_executor(),
+      init,
+      std::piecewise_construct,
+      stream,
+      buffer,
+      size)
+      .run();
+    return init.result.get();
+}
+
+template<typename Stream>
+struct connection
+{
+    explicit connection(boost::asio::io_context& ctx, std::size_t size)
+      : client{ctx}
+      , server{ctx}
+      , client_buffer(size, 'x')
+      , server_buffer(size)
+    {
+    }
+
+    Stream client;
+    Stream server;
+    std::vector<char> client_buffer;
+    std::vector<char> server_buffer;
+};
+
+using tcp_connection = connection<boost::asio::ip::tcp::socket>;
+using unix_connection =
+  connection<boost::asio::local::stream_protocol::socket>;
+
+void
+connect(boost::asio::ip::tcp::acceptor& acceptor, tcp_connection& c)
+{
+    c.client.connect(acceptor.local_endpoint());
+    acceptor.accept(c.server);
+    c.client.set_option(boost::asio::ip::tcp::no_delay{true});
+    c.server.set_option(boost::asio::ip::tcp::no_delay{true});
+}
+
+void
+connect(boost::asio::ip::tcp::acceptor&, unix_connection& c)
+{
+    boost::asio::local::connect_pair(c.client, c.server);
+}
+
+// Duplicates of the descriptors of a connection, with operations performed by
+// the uring_service.
+struct uring_connection
+{
+    template<typename Connection>
+    explicit uring_connection(Connection& c)
+      : client{c.client.get_executor(), ::dup(c.client.native_handle())}
+      , server{c.server.get_executor(), ::dup(c.server.native_handle())}
+    {
+    }
+
+    compose::uring_descriptor<> client;
+    compose::uring_descriptor<> server;
+};
+
+struct cpu_clock
+{
+    static std::chrono::microseconds now()
+    {
+        rusage usage{};
+        ::getrusage(RUSAGE_SELF, &usage);
+        auto const to_us = [](timeval tv) {
+            return std::chrono::seconds{tv.tv_sec} +
+                   std::chrono::microseconds{tv.tv_usec};
+        };
+        return to_us(usage.ru_utime) + to_us(usage.ru_stime);
+    }
+};
+
+template<typename Connection>
+void
+start(std::string const& impl,
+      Connection& c,
+      std::size_t rounds,
+      std::atomic<std::size_t>& done,
+      std::vector<std::unique_ptr<void, void (*)(void*)>>& raw_sessions)
+{
+    using stream_type = decltype(c.client);
+    auto const size = c.client_buffer.size();
+    auto const on_ping = [&c, &done](error_code) {
+        error_code ignored;
+        c.client.shutdown(stream_type::shutdown_send, ignored);
+        ++done;
+    };
+
+    if (impl == "stable")
+    {
+        async_stable_echo(
+          c.server, c.server_buffer.data(), size, [](error_code) {});
+        async_stable_ping(
+          c.client, c.client_buffer.data(), size, rounds, on_ping);
+    }
+    else if (impl == "speculative")
+    {
+        async_stable_run<speculative_echo_op>(
+          c.server, [](error_code) {}, c.server_buffer.data(), size);
+        async_stable_run<speculative_ping_op>(
+          c.client, on_ping, c.client_buffer.data(), size, rounds);
+    }
+    else if (impl == "uring")
+    {
+        auto uc = new uring_connection{c};
+        raw_sessions.emplace_back(
+          uc, [](void* p) { delete static_cast<uring_connection*>(p); });
+        async_stable_echo(
+          uc->server, c.server_buffer.data(), size, [](error_code) {});
+        async_stable_ping(
+          uc->client,
+          c.client_buffer.data(),
+          size,
+          rounds,
+          [uc, &done](error_code) {
+              ::shutdown(uc->client.native_handle(), SHUT_WR);
+              ++done;
+          });
+    }
+    else if (impl == "unstable")
+    {
+        async_unstable_echo(
+          c.server, c.server_buffer.data(), size, [](error_code) {});
+        async_unstable_ping(
+          c.client, c.client_buffer.data(), size, rounds, on_ping);
+    }
+    else
+    {
+        auto echo =
+          new raw_echo<stream_type>{c.server, c.server_buffer.data(), size};
+        raw_sessions.emplace_back(echo, [](void* p) {
+            delete static_cast<raw_echo<stream_type>*>(p);
+        });
+        auto ping = new raw_ping<stream_type>{
+          c.client, c.client_buffer.data(), size, rounds, done};
+        raw_sessions.emplace_back(ping, [](void* p) {
+            delete static_cast<raw_ping<stream_type>*>(p);
+        });
+        echo->start();
+        ping->start();
+    }
+}
+
+template<typename Connection>
+void
+run(std::string const& transport,
+    std::string const& impl,
+    std::size_t connections,
+    options const& opts)
+{
+    boost::asio::io_context ctx{static_cast<int>(opts.threads)};
+    boost::asio::ip::tcp::acceptor acceptor{ctx};
+    if (transport == "tcp")
+    {
+        boost::asio::ip::tcp::endpoint const ep{
+          boost::asio::ip::address_v4::loopback(), 0};
+        acceptor.open(ep.protocol());
+        acceptor.bind(ep);
+        acceptor.listen();
+    }
+
+    std::vector<std::unique_ptr<Connection>> conns;
+    conns.reserve(connections);
+    try
+    {
+        for (std::size_t i = 0; i < connections; ++i)
+        {
+            conns.emplace_back(new Connection{ctx, opts.size});
+            connect(acceptor, *conns.back());
+        }
+    }
+    catch (boost::system::system_error const& e)
+    {
+        std::printf("%-5s %-11s %8zu  skipped: %s\n",
+                    transport.c_str(),
+                    impl.c_str(),
+                    connections,
+                    e.what());
+        return;
+    }
+
+    auto const rounds = std::max<std::size_t>(1, opts.messages / connections);
+    std::atomic<std::size_t> done{0};
+    std::vector<std::unique_ptr<void, void (*)(void*)>> raw_sessions;
+
+    auto const wall_start = std::chrono::steady_clock::now();
+    auto const cpu_start = cpu_clock::now();
+
+    for (auto& c : conns)
+        start(impl, *c, rounds, done, raw_sessions);
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < opts.threads; ++i)
+        threads.emplace_back([&ctx] { ctx.run(); });
+    ctx.run();
+    for (auto& t : threads)
+        t.join();
+
+    auto const wall = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - wall_start)
+                        .count();
+    auto const cpu = std::chrono::duration<double, std::micro>(
+                       cpu_clock::now() - cpu_start)
+                       .count();
+    auto const messages = static_cast<double>(rounds * connections);
+
+    std::printf("%-5s %-11s %8zu %8zu %14.0f %12.3f%s\n",
+                transport.c_str(),
+                impl.c_str(),
+                connections,
+                opts.threads,
+                messages / wall,
+                cpu / messages,
+                done == connections ? "" : "  (incomplete)");
+}
+
+std::vector<std::string>
+split(char const* arg)
+{
+    std::vector<std::string> parts;
+    std::string current;
+    for (; *arg != '\0'; ++arg)
+    {
+        if (*arg == ',')
+        {
+            parts.push_back(current);
+            current.clear();
+        }
+        else
+            current += *arg;
+    }
+    parts.push_back(current);
+    return parts;
+}
+
+options
+parse(int argc, char** argv)
+{
+    options opts;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string const name = argv[i];
+        auto const values = split(argv[i + 1]);
+        if (name == "--transport" && values.front() != "all")
+            opts.transports = values;
+        else if (name == "--impl" && values.front() != "all")
+            opts.impls = values;
+        else if (name == "--connections")
+        {
+            opts.connections.clear();
+            for (auto const& v : values)
+                opts.connections.push_back(std::stoul(v));
+        }
+        else if (name == "--threads")
+            opts.threads = std::max<std::size_t>(1, std::stoul(values[0]));
+        else if (name == "--messages")
+            opts.messages = std::stoul(values[0]);
+        else if (name == "--size")
+            opts.size = std::max<std::size_t>(1, std::stoul(values[0]));
+    }
+    return opts;
+}
+
+// Each connection needs two descriptors, 10k connections do not fit in the
+// usual soft limit.
+void
+raise_fd_limit()
+{
+    rlimit limit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    auto const opts = compose_bench::parse(argc, argv);
+    compose_bench::raise_fd_limit();
+
+    std::printf("%-5s %-11s %8s %8s %14s %12s\n",
+                "net",
+                "impl",
+                "conns",
+                "threads",
+                "msgs/s",
+                "cpu us/msg");
+    for (auto const& transport : opts.transports)
+    {
+        for (auto const connections : opts.connections)
+        {
+            for (auto const& impl : opts.impls)
+            {
+                if (transport == "tcp")
+                    compose_bench::run<compose_bench::tcp_connection>(
+                      transport, impl, connections, opts);
+                else
+                    compose_bench::run<compose_bench::unix_connection>(
+                      transport, impl, connections, opts);
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
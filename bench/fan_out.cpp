@@ -0,0 +1,201 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Cost of sending a message to each of N sockets from one composed operation.
+// The sequential variant resumes the body after every async_write, the batch
+// variants start all writes with a send_batch and resume once per round, with
+// non-blocking sendmsg calls or through the uring_service.
+//
+// Usage: fan_out [--rounds N] [--size BYTES]
+
+#include <compose/coroutine.hpp>
+#include <compose/send_batch.hpp>
+#include <compose/stable_transform.hpp>
+#include <compose/uring_service.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace compose_bench
+{
+
+using socket_type = boost::asio::local::stream_protocol::socket;
+
+struct peers
+{
+    peers(boost::asio::io_context& ctx, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            senders.emplace_back(new socket_type{ctx});
+            receivers.emplace_back(new socket_type{ctx});
+            boost::asio::local::connect_pair(*senders.back(),
+                                             *receivers.back());
+        }
+    }
+
+    // The receivers are drained synchronously, which costs the same for all
+    // variants.
+    void drain(std::vector<char>& scratch)
+    {
+        for (auto& r : receivers)
+            boost::asio::read(*r, boost::asio::buffer(scratch));
+    }
+
+    std::vector<std::unique_ptr<socket_type>> senders;
+    std::vector<std::unique_ptr<socket_type>> receivers;
+};
+
+struct fan_out_op
+{
+    fan_out_op(peers& p, std::size_t size, std::size_t rounds, bool batched)
+      : peers_{p}
+      , message_(size, 'x')
+      , scratch_(size)
+      , rounds_{rounds}
+      , batched_{batched}
+      , batch_{p.senders.front()->get_executor()}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {},
+                                     std::size_t = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (; rounds_ > 0; --rounds_)
+            {
+                if (batched_)
+                {
+                    batch_.clear();
+                    for (auto& s : peers_.senders)
+                        batch_.add(*s, boost::asio::buffer(message_));
+                    COMPOSE_YIELD batch_.async_send(yield);
+                    if (ec)
+                        break;
+                }
+                else
+                {
+                    for (i_ = 0; i_ < peers_.senders.size(); ++i_)
+                    {
+                        COMPOSE_YIELD boost::asio::async_write(
+                          *peers_.senders[i_],
+                          boost::asio::buffer(message_),
+                          yield);
+                        if (ec)
+                            return yield.upcall(ec);
+                    }
+                }
+                peers_.drain(scratch_);
+            }
+
+            return yield.upcall(ec);
+        }
+    }
+
+    peers& peers_;
+    std::string message_;
+    std::vector<char> scratch_;
+    std::size_t rounds_;
+    bool batched_;
+    std::size_t i_ = 0;
+    compose::send_batch<socket_type> batch_;
+    compose::coroutine coro_{};
+};
+
+template<class CompletionToken>
+auto
+async_fan_out(peers& p,
+              std::size_t size,
+              std::size_t rounds,
+              bool batched,
+              CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code)>
+      init{tok};
+    compose::stable_transform<fan_out_op>(p.senders.front()->get_executor(),
+                                          init,
+                                          std::piecewise_construct,
+                                          p,
+                                          size,
+                                          rounds,
+                                          batched)
+      .run();
+    return init.result.get();
+}
+
+void
+run(char const* variant,
+    std::size_t sockets,
+    std::size_t rounds,
+    std::size_t size)
+{
+    boost::asio::io_context ctx{1};
+    auto const batched = std::strcmp(variant, "sequential") != 0;
+    if (std::strcmp(variant, "uring") == 0)
+        (void)boost::asio::use_service<compose::uring_service>(ctx);
+
+    peers p{ctx, sockets};
+    auto const start = std::chrono::steady_clock::now();
+    async_fan_out(
+      p, size, rounds, batched, [](boost::system::error_code ec) {
+          if (ec)
+              std::abort();
+      });
+    ctx.run();
+    std::chrono::duration<double, std::micro> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    std::printf("%-10s %8zu %12.2f %12.3f\n",
+                variant,
+                sockets,
+                elapsed.count() / rounds,
+                elapsed.count() / (rounds * sockets));
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    std::size_t rounds = 20000;
+    std::size_t size = 64;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--rounds") == 0)
+            rounds = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--size") == 0)
+            size = std::strtoul(argv[i + 1], nullptr, 10);
+    }
+
+    std::printf(
+      "%-10s %8s %12s %12s\n", "variant", "sockets", "us/round", "us/send");
+    for (std::size_t sockets : {4, 64})
+    {
+        for (auto variant : {"sequential", "batch", "uring"})
+            compose_bench::run(variant, sockets, rounds / sockets * 4, size);
+    }
+    return 0;
+}
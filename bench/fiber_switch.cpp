@@ -0,0 +1,175 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Cost of stackful operation bodies. The hop rows run an operation which hops
+// through the io_context N times, written as a stackless body with
+// COMPOSE_REENTER and as a fiber with compose::fiber_transform(); the
+// difference is the cost of the two context switches per hop. The resume row
+// measures a bare resume and suspend of a fiber. The spawn rows start and
+// finish N fibers, with stacks from the per-thread pool and with a freshly
+// mapped, guard-paged stack for every fiber.
+//
+// Usage: fiber_switch [--hops N] [--fibers N]
+
+#include <compose/coroutine.hpp>
+#include <compose/fiber_transform.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/context/protected_fixedsize_stack.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace compose_bench
+{
+
+using clock_type = std::chrono::steady_clock;
+
+struct done_handler
+{
+    void operator()() const
+    {
+    }
+};
+
+struct stackless_op
+{
+    explicit stackless_op(std::size_t n)
+      : n_{n}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            while (n_-- > 0)
+                COMPOSE_YIELD boost::asio::post(yield);
+            return yield.upcall();
+        }
+    }
+
+    std::size_t n_;
+    compose::coroutine coro_;
+};
+
+void
+start_stackless(boost::asio::io_context& ctx, std::size_t n)
+{
+    done_handler handler;
+    boost::asio::async_completion<done_handler, void()> init{handler};
+    compose::stable_transform<stackless_op>(
+      ctx.get_executor(), init, std::piecewise_construct, n)
+      .run();
+}
+
+void
+start_fiber(boost::asio::io_context& ctx, std::size_t n)
+{
+    done_handler handler;
+    boost::asio::async_completion<done_handler, void()> init{handler};
+    compose::fiber_transform(ctx.get_executor(), init, [n](auto yield) {
+        for (std::size_t i = 0; i < n; ++i)
+            boost::asio::post(yield);
+    })
+      .run();
+}
+
+template<class F>
+double
+measure(std::size_t n, F&& f)
+{
+    auto const start = clock_type::now();
+    f();
+    std::chrono::duration<double, std::nano> const elapsed =
+      clock_type::now() - start;
+    return elapsed.count() / n;
+}
+
+double
+hops(std::size_t n, void (*start)(boost::asio::io_context&, std::size_t))
+{
+    boost::asio::io_context ctx{1};
+    start(ctx, n);
+    return measure(n, [&] { ctx.run(); });
+}
+
+double
+switches(std::size_t n)
+{
+    namespace ctx = boost::context;
+    ctx::fiber f{std::allocator_arg,
+                 compose::detail::pooled_fiber_stack{},
+                 [n](ctx::fiber&& caller) {
+                     for (std::size_t i = 1; i < n; ++i)
+                         caller = std::move(caller).resume();
+                     return std::move(caller);
+                 }};
+    return measure(n, [&] {
+        for (std::size_t i = 0; i < n; ++i)
+            f = std::move(f).resume();
+    });
+}
+
+template<class StackAllocator>
+double
+spawns(std::size_t n, StackAllocator salloc)
+{
+    namespace ctx = boost::context;
+    return measure(n, [&] {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            ctx::fiber f{std::allocator_arg,
+                         salloc,
+                         [](ctx::fiber&& caller) { return std::move(caller); }};
+            f = std::move(f).resume();
+        }
+    });
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    std::size_t hops = 2000000;
+    std::size_t fibers = 200000;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--hops") == 0)
+            hops = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--fibers") == 0)
+            fibers = std::strtoul(argv[i + 1], nullptr, 10);
+    }
+
+    std::printf("%-18s %8.1f ns/hop\n",
+                "stackless hop",
+                compose_bench::hops(hops, compose_bench::start_stackless));
+    std::printf("%-18s %8.1f ns/hop\n",
+                "fiber hop",
+                compose_bench::hops(hops, compose_bench::start_fiber));
+    std::printf(
+      "%-18s %8.1f ns/resume\n", "fiber resume", compose_bench::switches(hops));
+    std::printf(
+      "%-18s %8.1f ns/fiber\n",
+      "spawn pooled",
+      compose_bench::spawns(fibers, compose::detail::pooled_fiber_stack{}));
+    std::printf("%-18s %8.1f ns/fiber\n",
+                "spawn mapped",
+                compose_bench::spawns(
+                  fibers,
+                  boost::context::protected_fixedsize_stack{
+                    compose::detail::fiber_stack_pool::size()}));
+    return 0;
+}
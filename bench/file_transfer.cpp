@@ -0,0 +1,175 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Throughput and CPU cost of streaming a file to a TCP socket over loopback
+// with async_send_file. The sendfile variant passes the socket itself, the
+// copy variant wraps it in a stream which is not a socket, so the file is
+// read into a pooled buffer and written with async_write. The receiving side
+// drains the socket in the same process, which costs the same for both.
+//
+// Usage: file_transfer [--size MIB] [--rounds N]
+
+#include <compose/send_file.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace compose_bench
+{
+
+using tcp = boost::asio::ip::tcp;
+
+struct options
+{
+    std::size_t size = 64 << 20;
+    std::size_t rounds = 16;
+};
+
+// Forwards writes to a socket, hiding its type from async_send_file.
+class copying_stream
+{
+public:
+    using executor_type = tcp::socket::executor_type;
+
+    explicit copying_stream(tcp::socket& socket)
+      : socket_{socket}
+    {
+    }
+
+    executor_type get_executor()
+    {
+        return socket_.get_executor();
+    }
+
+    template<class ConstBufferSequence, class WriteHandler>
+    auto async_write_some(ConstBufferSequence const& buffers,
+                          WriteHandler&& handler)
+    {
+        return socket_.async_write_some(buffers,
+                                        std::forward<WriteHandler>(handler));
+    }
+
+private:
+    tcp::socket& socket_;
+};
+
+struct drain
+{
+    void operator()(boost::system::error_code ec = {}, std::size_t = 0)
+    {
+        if (!ec)
+            socket.async_read_some(boost::asio::buffer(buffer), *this);
+    }
+
+    tcp::socket& socket;
+    std::vector<char>& buffer;
+};
+
+template<class Stream>
+struct send_rounds
+{
+    void operator()(boost::system::error_code ec = {}, std::size_t n = 0)
+    {
+        if (ec || n != opts.size)
+            std::abort();
+        if (round++ < opts.rounds)
+            compose::async_send_file(stream, file, 0, opts.size, *this);
+        else
+            socket.shutdown(tcp::socket::shutdown_send);
+    }
+
+    Stream& stream;
+    tcp::socket& socket;
+    int file;
+    options const& opts;
+    std::size_t round;
+};
+
+double
+cpu_seconds()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+template<class Stream>
+void
+run(char const* name, int file, options const& opts)
+{
+    boost::asio::io_context ctx{1};
+    tcp::acceptor acceptor{ctx, {boost::asio::ip::address_v4::loopback(), 0}};
+    tcp::socket sender{ctx};
+    tcp::socket receiver{ctx};
+    sender.connect(acceptor.local_endpoint());
+    acceptor.accept(receiver);
+
+    Stream stream{sender};
+    std::vector<char> buffer(1 << 20);
+    drain{receiver, buffer}();
+
+    auto const cpu_start = cpu_seconds();
+    auto const start = std::chrono::steady_clock::now();
+    send_rounds<Stream>{stream, sender, file, opts, 1}({}, opts.size);
+    ctx.run();
+    std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+    auto const cpu = cpu_seconds() - cpu_start;
+
+    auto const gigabytes = double(opts.size) * opts.rounds / 1e9;
+    std::printf("%-10s %10.2f %12.3f\n",
+                name,
+                gigabytes / elapsed.count(),
+                cpu / gigabytes);
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    compose_bench::options opts;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        auto const value = std::strtoul(argv[i + 1], nullptr, 10);
+        if (std::strcmp(argv[i], "--size") == 0)
+            opts.size = value << 20;
+        else if (std::strcmp(argv[i], "--rounds") == 0)
+            opts.rounds = value;
+    }
+
+    char name[] = "/tmp/compose_bench_send_file_XXXXXX";
+    int const file = ::mkstemp(name);
+    if (file < 0)
+        return 1;
+    ::unlink(name);
+    std::vector<char> chunk(1 << 20, 'x');
+    for (std::size_t written = 0; written < opts.size; written += chunk.size())
+    {
+        if (::write(file, chunk.data(), chunk.size()) < 0)
+            return 1;
+    }
+
+    std::printf("%-10s %10s %12s\n", "impl", "GB/s", "CPU s/GB");
+    compose_bench::run<boost::asio::ip::tcp::socket&>("sendfile", file, opts);
+    compose_bench::run<compose_bench::copying_stream>("copy", file, opts);
+    ::close(file);
+    return 0;
+}
@@ -0,0 +1,230 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Cost of reading small length-prefixed frames from a UNIX stream socket. A
+// burst of frames is written to the socket, then a composed operation reads
+// it, either with an async_read for the prefix and another for the payload
+// of every frame or with a frame_reader. Only the time spent reading is
+// measured. Reads counts the async_read_some calls made on the socket.
+//
+// Usage: framing [--frames N] [--burst N] [--size BYTES]
+
+#include <compose/coroutine.hpp>
+#include <compose/frame_reader.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace compose_bench
+{
+
+using socket_type = boost::asio::local::stream_protocol::socket;
+using clock_type = std::chrono::steady_clock;
+
+struct options
+{
+    std::size_t frames = 1000000;
+    std::size_t burst = 256;
+    std::size_t size = 64;
+};
+
+// Counts the reads started on a socket.
+class counting_stream
+{
+public:
+    using executor_type = socket_type::executor_type;
+
+    explicit counting_stream(socket_type& socket)
+      : socket_{socket}
+    {
+    }
+
+    executor_type get_executor()
+    {
+        return socket_.get_executor();
+    }
+
+    template<class MutableBufferSequence, class ReadToken>
+    auto async_read_some(MutableBufferSequence const& buffers, ReadToken&& tok)
+    {
+        ++reads;
+        return socket_.async_read_some(buffers, std::forward<ReadToken>(tok));
+    }
+
+    std::size_t reads = 0;
+
+private:
+    socket_type& socket_;
+};
+
+struct read_op
+{
+    read_op(counting_stream& stream,
+            socket_type& writer,
+            options const& opts,
+            bool batched,
+            clock_type::duration& elapsed)
+      : stream_{stream}
+      , writer_{writer}
+      , opts_{opts}
+      , batched_{batched}
+      , reader_{stream, opts.size}
+      , payload_(opts.size, '\0')
+      , elapsed_{elapsed}
+    {
+        std::string frame(4, '\0');
+        frame[2] = static_cast<char>(opts.size >> 8);
+        frame[3] = static_cast<char>(opts.size & 0xff);
+        frame.append(opts.size, 'x');
+        for (std::size_t i = 0; i < opts.burst; ++i)
+            burst_ += frame;
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {},
+                                     std::size_t n = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (; total_ < opts_.frames; total_ += opts_.burst)
+            {
+                boost::asio::write(writer_, boost::asio::buffer(burst_));
+
+                start_ = clock_type::now();
+                for (received_ = 0; received_ < opts_.burst;)
+                {
+                    if (batched_)
+                    {
+                        COMPOSE_YIELD reader_.async_read_frames(yield);
+                        if (ec)
+                            return yield.upcall(ec);
+                        received_ += n;
+                    }
+                    else
+                    {
+                        COMPOSE_YIELD boost::asio::async_read(
+                          stream_, boost::asio::buffer(prefix_), yield);
+                        if (ec)
+                            return yield.upcall(ec);
+                        COMPOSE_YIELD boost::asio::async_read(
+                          stream_, boost::asio::buffer(payload_), yield);
+                        if (ec)
+                            return yield.upcall(ec);
+                        ++received_;
+                    }
+                }
+                elapsed_ += clock_type::now() - start_;
+            }
+
+            return yield.upcall(ec);
+        }
+    }
+
+    counting_stream& stream_;
+    socket_type& writer_;
+    options const& opts_;
+    bool batched_;
+    compose::frame_reader<counting_stream> reader_;
+    char prefix_[4];
+    std::string payload_;
+    std::string burst_;
+    clock_type::duration& elapsed_;
+    clock_type::time_point start_;
+    std::size_t total_ = 0;
+    std::size_t received_ = 0;
+    compose::coroutine coro_{};
+};
+
+template<class CompletionToken>
+auto
+async_read_all(counting_stream& stream,
+               socket_type& writer,
+               options const& opts,
+               bool batched,
+               clock_type::duration& elapsed,
+               CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code)>
+      init{tok};
+    compose::stable_transform<read_op>(stream.get_executor(),
+                                       init,
+                                       std::piecewise_construct,
+                                       stream,
+                                       writer,
+                                       opts,
+                                       batched,
+                                       elapsed)
+      .run();
+    return init.result.get();
+}
+
+void
+run(options const& opts, bool batched)
+{
+    boost::asio::io_context ctx{1};
+    socket_type reader{ctx};
+    socket_type writer{ctx};
+    boost::asio::local::connect_pair(reader, writer);
+    counting_stream stream{reader};
+
+    clock_type::duration elapsed{};
+    async_read_all(
+      stream, writer, opts, batched, elapsed, [](boost::system::error_code ec) {
+          if (ec)
+              std::abort();
+      });
+    ctx.run();
+
+    std::chrono::duration<double> const seconds = elapsed;
+    std::printf("%-14s %14.0f %10.1f %12.3f\n",
+                batched ? "frame_reader" : "prefix+body",
+                opts.frames / seconds.count(),
+                seconds.count() * 1e9 / opts.frames,
+                double(stream.reads) / opts.frames);
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    compose_bench::options opts;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        auto const value = std::strtoul(argv[i + 1], nullptr, 10);
+        if (std::strcmp(argv[i], "--frames") == 0)
+            opts.frames = value;
+        else if (std::strcmp(argv[i], "--burst") == 0)
+            opts.burst = value;
+        else if (std::strcmp(argv[i], "--size") == 0)
+            opts.size = value;
+    }
+
+    std::printf(
+      "%-14s %14s %10s %12s\n", "impl", "frames/s", "ns/frame", "reads/frame");
+    compose_bench::run(opts, false);
+    compose_bench::run(opts, true);
+    return 0;
+}
@@ -0,0 +1,203 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Throughput of compose::async_pipeline() serving a pipelined client over a
+// socketpair. The client keeps a window of requests in flight, the server
+// reads, processes and writes them with pipeline depths of 1 (no pipelining),
+// 2 and 4. Processing hashes every request --work times, to model a server
+// which is not only bound by I/O.
+//
+// Usage: pipelined_echo [--messages N] [--size BYTES] [--window N]
+//                       [--work N]
+
+#include <compose/pipeline.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace compose_bench
+{
+
+using error_code = boost::system::error_code;
+using socket_type = boost::asio::local::stream_protocol::socket;
+
+struct options
+{
+    std::size_t messages = 200000;
+    std::size_t size = 256;
+    std::size_t window = 16;
+    std::size_t work = 4;
+};
+
+struct echo_stages
+{
+    struct message_type
+    {
+        std::vector<char> buffer;
+    };
+
+    template<class Handler>
+    void async_read(socket_type& s, message_type& m, Handler&& h)
+    {
+        m.buffer.resize(size_);
+        boost::asio::async_read(
+          s, boost::asio::buffer(m.buffer), std::forward<Handler>(h));
+    }
+
+    void process(message_type& m)
+    {
+        // FNV-1a, stored in the first bytes of the response.
+        std::uint32_t hash = 2166136261u;
+        for (std::size_t i = 0; i < work_; ++i)
+            for (char c : m.buffer)
+                hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+        std::memcpy(m.buffer.data(), &hash, sizeof(hash));
+    }
+
+    template<class Handler>
+    void async_write(socket_type& s, message_type& m, Handler&& h)
+    {
+        boost::asio::async_write(
+          s, boost::asio::buffer(m.buffer), std::forward<Handler>(h));
+    }
+
+    std::size_t size_;
+    std::size_t work_;
+};
+
+// Keeps up to window requests in flight, writing the next one as soon as a
+// response has been read.
+class client
+{
+public:
+    client(socket_type& socket, options const& opts)
+      : socket_{socket}
+      , opts_{opts}
+      , request_(opts.size, 'x')
+      , response_(opts.size)
+    {
+    }
+
+    void start()
+    {
+        for (std::size_t i = 0; i < opts_.window && sent_ < opts_.messages; ++i)
+            send();
+        receive();
+    }
+
+private:
+    void send()
+    {
+        ++sent_;
+        ++writes_;
+        boost::asio::async_write(socket_,
+                                 boost::asio::buffer(request_),
+                                 [this](error_code ec, std::size_t) {
+                                     --writes_;
+                                     if (ec)
+                                         std::abort();
+                                     maybe_shutdown();
+                                 });
+    }
+
+    void receive()
+    {
+        boost::asio::async_read(socket_,
+                                boost::asio::buffer(response_),
+                                [this](error_code ec, std::size_t) {
+                                    if (ec)
+                                        std::abort();
+                                    if (++received_ == opts_.messages)
+                                        return;
+                                    if (sent_ < opts_.messages)
+                                        send();
+                                    receive();
+                                });
+    }
+
+    void maybe_shutdown()
+    {
+        if (sent_ == opts_.messages && writes_ == 0)
+            socket_.shutdown(socket_type::shutdown_send);
+    }
+
+    socket_type& socket_;
+    options const& opts_;
+    std::vector<char> request_;
+    std::vector<char> response_;
+    std::size_t sent_ = 0;
+    std::size_t writes_ = 0;
+    std::size_t received_ = 0;
+};
+
+template<std::size_t Depth>
+double
+run(options const& opts)
+{
+    boost::asio::io_context ctx{1};
+    socket_type server{ctx};
+    socket_type peer{ctx};
+    boost::asio::local::connect_pair(server, peer);
+
+    std::size_t served = 0;
+    compose::async_pipeline<Depth>(
+      server,
+      echo_stages{opts.size, opts.work},
+      [&](error_code ec, std::size_t n) {
+          if (ec != boost::asio::error::eof)
+              std::abort();
+          served = n;
+      });
+
+    client c{peer, opts};
+    c.start();
+
+    auto const start = std::chrono::steady_clock::now();
+    ctx.run();
+    std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+    if (served != opts.messages)
+        std::abort();
+    return served / elapsed.count();
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    compose_bench::options opts;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        auto const value = std::strtoul(argv[i + 1], nullptr, 10);
+        if (std::strcmp(argv[i], "--messages") == 0)
+            opts.messages = value;
+        else if (std::strcmp(argv[i], "--size") == 0)
+            opts.size = value;
+        else if (std::strcmp(argv[i], "--window") == 0)
+            opts.window = value;
+        else if (std::strcmp(argv[i], "--work") == 0)
+            opts.work = value;
+    }
+
+    std::printf("%-8s %12.0f msg/s\n", "depth 1", compose_bench::run<1>(opts));
+    std::printf("%-8s %12.0f msg/s\n", "depth 2", compose_bench::run<2>(opts));
+    std::printf("%-8s %12.0f msg/s\n", "depth 4", compose_bench::run<4>(opts));
+    return 0;
+}
@@ -0,0 +1,161 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// CPU cost of forwarding a TCP stream over loopback through a proxy. The
+// proxy runs on its own thread and io_context, between a sending and a
+// receiving thread which use blocking I/O. The splice variant uses
+// async_splice_proxy, the copy variant reads into a 64 KiB buffer and writes
+// it out, in both directions. Only the CPU time of the proxy thread is
+// reported.
+//
+// Usage: proxy [--size MIB]
+
+#include <compose/splice_proxy.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace compose_bench
+{
+
+using tcp = boost::asio::ip::tcp;
+
+// One direction of the copying proxy.
+struct copy_direction
+{
+    void operator()(boost::system::error_code ec = {}, std::size_t n = 0)
+    {
+        if (ec)
+        {
+            boost::system::error_code ignored;
+            destination.shutdown(tcp::socket::shutdown_send, ignored);
+            return;
+        }
+
+        // The handler is a copy of this object, made after the toggle.
+        auto const write = writing;
+        writing = !writing;
+        if (write)
+            boost::asio::async_write(
+              destination, boost::asio::buffer(buffer.data(), n), *this);
+        else
+            source.async_read_some(boost::asio::buffer(buffer), *this);
+    }
+
+    tcp::socket& source;
+    tcp::socket& destination;
+    std::vector<char>& buffer;
+    bool writing;
+};
+
+double
+thread_cpu_seconds()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+void
+run(char const* name, bool splice, std::size_t size)
+{
+    boost::asio::io_context ctx{1};
+    tcp::acceptor acceptor{ctx, {boost::asio::ip::address_v4::loopback(), 0}};
+    tcp::socket client{ctx};
+    tcp::socket a{ctx};
+    tcp::socket b{ctx};
+    tcp::socket server{ctx};
+    client.connect(acceptor.local_endpoint());
+    acceptor.accept(a);
+    b.connect(acceptor.local_endpoint());
+    acceptor.accept(server);
+
+    std::vector<char> a_to_b(65536);
+    std::vector<char> b_to_a(65536);
+    if (splice)
+    {
+        compose::async_splice_proxy(
+          a, b, [&](boost::system::error_code ec, std::size_t n, std::size_t) {
+              if (ec || n != size)
+                  std::abort();
+              b.shutdown(tcp::socket::shutdown_send);
+          });
+    }
+    else
+    {
+        copy_direction{a, b, a_to_b, false}();
+        copy_direction{b, a, b_to_a, false}();
+    }
+
+    double cpu = 0;
+    auto const start = std::chrono::steady_clock::now();
+    std::thread proxy{[&] {
+        auto const cpu_start = thread_cpu_seconds();
+        ctx.run();
+        cpu = thread_cpu_seconds() - cpu_start;
+    }};
+
+    std::thread sender{[&] {
+        std::vector<char> chunk(1 << 20, 'x');
+        for (std::size_t sent = 0; sent < size; sent += chunk.size())
+            boost::asio::write(client, boost::asio::buffer(chunk));
+        client.shutdown(tcp::socket::shutdown_send);
+    }};
+
+    std::vector<char> chunk(1 << 20);
+    boost::system::error_code ec;
+    std::size_t received = 0;
+    while (!ec)
+        received += server.read_some(boost::asio::buffer(chunk), ec);
+    if (received != size)
+        std::abort();
+    std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    sender.join();
+    // The copying proxy still waits for the server to close its side.
+    server.shutdown(tcp::socket::shutdown_send);
+    proxy.join();
+
+    auto const gigabytes = double(size) / 1e9;
+    std::printf("%-10s %10.2f %14.3f\n",
+                name,
+                gigabytes / elapsed.count(),
+                cpu / gigabytes);
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    std::size_t size = std::size_t{4096} << 20;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--size") == 0)
+            size = std::strtoul(argv[i + 1], nullptr, 10) << 20;
+    }
+
+    std::printf("%-10s %10s %14s\n", "impl", "GB/s", "proxy CPU s/GB");
+    compose_bench::run("splice", true, size);
+    compose_bench::run("copy", false, size);
+    return 0;
+}
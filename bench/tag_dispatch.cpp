@@ -0,0 +1,221 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Cost of tag dispatch in a state machine with many states. Every state reads
+// a byte from a UNIX stream socket and moves on to the next one. By default
+// the states are bound with compose::bind_tag, so all reads share a single
+// handler type, when built with COMPOSE_BENCH_STATIC_TAGS (the
+// tag_dispatch_static target) they are bound with compose::bind_token, which
+// instantiates the read operation once per state. Compare the text size of
+// both executables to see the code size of the instantiations. L1 instruction
+// cache misses are reported when the kernel exposes hardware counters.
+//
+// Usage: tag_dispatch [--reads N]
+
+#include <compose/bind_tag.hpp>
+#include <compose/bind_token.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/mp11/algorithm.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // __linux__
+
+namespace compose_bench
+{
+
+using socket_type = boost::asio::local::stream_protocol::socket;
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::size_t states = 32;
+
+template<std::size_t I>
+struct state
+{
+};
+
+template<class I>
+using state_of = state<I::value>;
+
+using tags = boost::mp11::mp_rename<
+  boost::mp11::mp_transform<state_of, boost::mp11::mp_iota_c<states>>,
+  compose::tag_set>;
+
+template<class Self, class Tag>
+auto
+bind_state(compose::yield_token<Self> yield, Tag tag)
+{
+#ifdef COMPOSE_BENCH_STATIC_TAGS
+    return compose::bind_token(yield, tag);
+#else
+    return compose::bind_tag<tags>(yield, tag);
+#endif // COMPOSE_BENCH_STATIC_TAGS
+}
+
+struct state_machine_op
+{
+    state_machine_op(socket_type& reader, socket_type& writer, std::size_t n)
+      : reader_{reader}
+      , writer_{writer}
+      , n_{n}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        return (*this)(yield, state<0>{}, {}, 0);
+    }
+
+    template<class Self, std::size_t I>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     state<I>,
+                                     boost::system::error_code ec,
+                                     std::size_t)
+    {
+        if (ec || n_ == 0)
+            return yield.upcall(ec);
+
+        // Refill the socket once per cycle through all states.
+        if (I == 0)
+        {
+            boost::asio::write(writer_, boost::asio::buffer(fill_), ec);
+            if (ec)
+                return yield.upcall(ec);
+        }
+
+        --n_;
+        return reader_.async_read_some(
+          boost::asio::buffer(&byte_, 1),
+          bind_state(yield, state<(I + 1) % states>{}));
+    }
+
+    socket_type& reader_;
+    socket_type& writer_;
+    std::size_t n_;
+    char byte_ = 0;
+    char fill_[states] = {};
+};
+
+// Counts L1 instruction cache misses of this thread in user space, if the
+// kernel allows it.
+class icache_counter
+{
+public:
+    icache_counter()
+    {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1I |
+                      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(
+          ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif // __linux__
+    }
+
+    ~icache_counter()
+    {
+#ifdef __linux__
+        if (fd_ >= 0)
+            ::close(fd_);
+#endif // __linux__
+    }
+
+    // Returns the number of misses so far or -1 if not available.
+    long long read() const
+    {
+        long long value = -1;
+#ifdef __linux__
+        if (fd_ < 0 || ::read(fd_, &value, sizeof(value)) != sizeof(value))
+            return -1;
+#endif // __linux__
+        return value;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    std::size_t reads = 2000000;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--reads") == 0)
+            reads = std::strtoul(argv[i + 1], nullptr, 10);
+    }
+
+    boost::asio::io_context ctx{1};
+    compose_bench::socket_type reader{ctx};
+    compose_bench::socket_type writer{ctx};
+    boost::asio::local::connect_pair(reader, writer);
+
+    auto handler = [](boost::system::error_code ec) {
+        if (ec)
+            std::abort();
+    };
+    boost::asio::async_completion<decltype(handler),
+                                  void(boost::system::error_code)>
+      init{handler};
+    compose::stable_transform<compose_bench::state_machine_op>(
+      ctx.get_executor(),
+      init,
+      std::piecewise_construct,
+      reader,
+      writer,
+      reads)
+      .run();
+
+    compose_bench::icache_counter counter;
+    auto const misses_before = counter.read();
+    auto const start = compose_bench::clock_type::now();
+    ctx.run();
+    std::chrono::duration<double, std::nano> const elapsed =
+      compose_bench::clock_type::now() - start;
+    auto const misses_after = counter.read();
+
+#ifdef COMPOSE_BENCH_STATIC_TAGS
+    char const* const name = "bind_token";
+#else
+    char const* const name = "bind_tag";
+#endif // COMPOSE_BENCH_STATIC_TAGS
+    std::printf("%-11s %zu states %8.1f ns/read",
+                name,
+                compose_bench::states,
+                elapsed.count() / reads);
+    if (misses_before >= 0 && misses_after >= 0)
+    {
+        std::printf(" %8.2f L1i misses/read\n",
+                    double(misses_after - misses_before) / reads);
+    }
+    else
+        std::printf("  L1i misses n/a\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+// Cost of upcalling a large result. Each operation hops through the executor
+// once and then completes with a result of SIZE bytes, with direct_upcall or
+// post_upcall. The upcall_args_bound target is built with in-place upcalls
+// disabled, for comparison.
+//
+// Usage: upcall_args [--ops N]
+
+#include <compose/coroutine.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace compose_bench
+{
+
+std::size_t moves = 0;
+
+template<std::size_t Size>
+struct result
+{
+    result() = default;
+
+    result(result&& other) noexcept
+      : data_(other.data_)
+    {
+        ++moves;
+    }
+
+    result(result const& other) = delete;
+    result& operator=(result const&) = delete;
+    result& operator=(result&&) = delete;
+
+    std::array<char, Size> data_{};
+};
+
+template<std::size_t Size>
+struct result_op
+{
+    using upcall_signature = void(result<Size>);
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            COMPOSE_YIELD boost::asio::post(ctx_, yield);
+            result_.data_[0] = 1;
+            if (direct_)
+                return yield.direct_upcall(std::move(result_));
+            else
+                return yield.post_upcall(std::move(result_));
+        }
+    }
+
+    boost::asio::io_context& ctx_;
+    bool direct_;
+    result<Size> result_{};
+    compose::coroutine coro_{};
+};
+
+template<std::size_t Size, class CompletionToken>
+auto
+async_result_op(boost::asio::io_context& ctx,
+                bool direct,
+                CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(result<Size>))
+{
+    boost::asio::async_completion<CompletionToken, void(result<Size>)> init{
+      tok};
+    compose::stable_transform<result_op<Size>>(
+      ctx.get_executor(), init, std::piecewise_construct, ctx, direct)
+      .run();
+    return init.result.get();
+}
+
+template<std::size_t Size>
+struct chain
+{
+    void operator()(result<Size> r)
+    {
+        sum_ += r.data_[0];
+        if (--remaining_ > 0)
+            async_result_op<Size>(ctx_, direct_, *this);
+    }
+
+    boost::asio::io_context& ctx_;
+    bool direct_;
+    std::size_t remaining_;
+    std::size_t& sum_;
+};
+
+template<std::size_t Size>
+void
+run(std::size_t ops, bool direct)
+{
+    boost::asio::io_context ctx{1};
+    std::size_t sum = 0;
+    moves = 0;
+
+    auto const start = std::chrono::steady_clock::now();
+    async_result_op<Size>(ctx, direct, chain<Size>{ctx, direct, ops, sum});
+    ctx.run();
+    std::chrono::duration<double, std::nano> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    std::printf("%6zu %-6s %10.1f %10.2f\n",
+                Size,
+                direct ? "direct" : "post",
+                elapsed.count() / ops,
+                static_cast<double>(moves) / ops);
+    if (sum != ops)
+        std::abort();
+}
+
+} // namespace compose_bench
+
+int
+main(int argc, char** argv)
+{
+    std::size_t ops = 1000000;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (std::strcmp(argv[i], "--ops") == 0)
+            ops = std::strtoul(argv[i + 1], nullptr, 10);
+    }
+
+    std::printf("in-place threshold: %zu bytes\n",
+                static_cast<std::size_t>(COMPOSE_INPLACE_UPCALL_THRESHOLD));
+    std::printf("%6s %-6s %10s %10s\n", "size", "upcall", "ns/op", "moves/op");
+    for (bool direct : {true, false})
+    {
+        compose_bench::run<64>(ops, direct);
+        compose_bench::run<4096>(ops, direct);
+        compose_bench::run<65536>(ops / 10, direct);
+    }
+    return 0;
+}
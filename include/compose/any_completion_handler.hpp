@@ -0,0 +1,195 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_ANY_COMPLETION_HANDLER_HPP
+#define COMPOSE_ANY_COMPLETION_HANDLER_HPP
+
+#include <compose/detail/allocator_utils.hpp>
+#include <compose/detail/any_handler_vtable.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+
+#include <cstddef>
+#include <type_traits>
+
+namespace compose
+{
+
+/**
+ * A type-erased copy of the Allocator associated with a CompletionHandler
+ * stored in an any_completion_handler. Allocators with up to 2 pointers of
+ * state are supported.
+ */
+template<typename T>
+class any_handler_allocator
+{
+public:
+    using value_type = T;
+
+    template<typename Allocator>
+    explicit any_handler_allocator(Allocator const& alloc);
+
+    any_handler_allocator(any_handler_allocator const& other) noexcept;
+
+    template<typename U>
+    any_handler_allocator(any_handler_allocator<U> const& other) noexcept;
+
+    any_handler_allocator& operator=(any_handler_allocator const&) = delete;
+
+    ~any_handler_allocator();
+
+    T* allocate(std::size_t n);
+
+    void deallocate(T* p, std::size_t n) noexcept;
+
+    template<typename U>
+    bool operator==(any_handler_allocator<U> const& other) const noexcept;
+
+    template<typename U>
+    bool operator!=(any_handler_allocator<U> const& other) const noexcept;
+
+private:
+    template<typename U>
+    friend class any_handler_allocator;
+
+    detail::allocator_vtable const* vtable_;
+    detail::allocator_storage storage_;
+};
+
+template<typename Signature,
+         std::size_t BufferSize = detail::default_handler_buffer_size>
+class any_completion_handler;
+
+/**
+ * A move-only, type-erased CompletionHandler with the given Signature, meant
+ * for ABI boundaries. Handlers which fit in BufferSize bytes (e.g. the
+ * ComposedOperation objects produced by stable_transform and bind_token) are
+ * stored inline, larger ones are allocated with their associated Allocator.
+ *
+ * The Executor and Allocator associated with the wrapped handler remain
+ * associated with the any_completion_handler, as an any_io_executor and an
+ * any_handler_allocator, respectively.
+ *
+ * @tparam BufferSize size of the inline storage in bytes.
+ */
+template<typename... Args, std::size_t BufferSize>
+class any_completion_handler<void(Args...), BufferSize>
+{
+public:
+    any_completion_handler() noexcept = default;
+
+    any_completion_handler(std::nullptr_t) noexcept
+    {
+    }
+
+    /**
+     * Stores a CompletionHandler. Does not allocate if the handler fits in the
+     * inline storage and is nothrow MoveConstructible.
+     */
+    template<typename Handler,
+             typename = typename std::enable_if<
+               !std::is_same<typename std::decay<Handler>::type,
+                             any_completion_handler>::value>::type>
+    any_completion_handler(Handler&& handler);
+
+    any_completion_handler(any_completion_handler&& other) noexcept;
+
+    any_completion_handler& operator=(any_completion_handler&& other) noexcept;
+
+    any_completion_handler(any_completion_handler const&) = delete;
+    any_completion_handler& operator=(any_completion_handler const&) = delete;
+
+    ~any_completion_handler();
+
+    explicit operator bool() const noexcept
+    {
+        return vtable_ != nullptr;
+    }
+
+    /**
+     * Invokes the stored handler. The wrapper becomes empty and any memory
+     * allocated for the handler is released before the invocation.
+     */
+    void operator()(Args... args);
+
+    template<typename H, typename E>
+    friend class boost::asio::associated_executor;
+
+    template<typename H, typename A>
+    friend class boost::asio::associated_allocator;
+
+private:
+    using vtable_type = detail::any_handler_vtable<Args...>;
+    using storage_type = typename std::aligned_storage<
+      BufferSize < sizeof(void*) ? sizeof(void*) : BufferSize,
+      alignof(void*)>::type;
+
+    template<typename Handler>
+    void construct(std::true_type, Handler&& handler);
+
+    template<typename Handler>
+    void construct(std::false_type, Handler&& handler);
+
+    vtable_type const* vtable_ = nullptr;
+    storage_type storage_;
+};
+
+} // namespace compose
+
+namespace boost
+{
+namespace asio
+{
+
+template<typename Signature, std::size_t BufferSize, typename Ex>
+class associated_executor<
+  ::compose::any_completion_handler<Signature, BufferSize>,
+  Ex>
+{
+public:
+    using type = any_io_executor;
+
+    static type get(
+      ::compose::any_completion_handler<Signature, BufferSize> const& handler,
+      Ex const& ex = Ex{})
+    {
+        // An empty handler has no associated executor of its own.
+        if (!handler)
+            return any_io_executor{ex};
+        return handler.vtable_->executor(&handler.storage_,
+                                         any_io_executor{ex});
+    }
+};
+
+template<typename Signature, std::size_t BufferSize, typename A>
+class associated_allocator<
+  ::compose::any_completion_handler<Signature, BufferSize>,
+  A>
+{
+public:
+    using type = ::compose::any_handler_allocator<void>;
+
+    static type get(
+      ::compose::any_completion_handler<Signature, BufferSize> const& handler,
+      A const& = A{})
+    {
+        if (!handler)
+            return type{::compose::detail::default_allocator{}};
+        return handler.vtable_->allocator(&handler.storage_);
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#include <compose/impl/any_completion_handler.hpp>
+
+#endif // COMPOSE_ANY_COMPLETION_HANDLER_HPP
@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_BIND_TAG_HPP
+#define COMPOSE_BIND_TAG_HPP
+
+#include <compose/detail/tagged_handler.hpp>
+
+namespace compose
+{
+template<typename ComposedOp>
+class yield_token;
+
+/**
+ * The set of tag types an OperationBody dispatches on with bind_tag().
+ */
+template<typename... Tags>
+struct tag_set
+{
+};
+
+/**
+ * Binds a tag with a yield_token, creating a CompletionHandler that invokes
+ * the overload of operator() which accepts the tag.
+ *
+ * Unlike bind_token(), the tag is stored as a small index and the type of the
+ * CompletionHandler only depends on the ComposedOp and TagSet. All child
+ * operations of a given kind initiated with bind_tag() share a single
+ * instantiation, regardless of the number of tags, which keeps the code size
+ * of large state machines in check.
+ *
+ * Usage:
+ * @code
+ * using tags = compose::tag_set<connect_tag, read_tag, timer_tag>;
+ * return timer_.async_wait(compose::bind_tag<tags>(yield, timer_tag{}));
+ * @endcode
+ *
+ * @tparam TagSet A tag_set which contains Tag. Tags must be empty, default
+ * constructible types.
+ *
+ * @param token Source object which will be used to construct the
+ * CompletionHandler. Must be in a valid state. May place the currently running
+ * operation body in a moved-from state.
+ */
+template<typename TagSet, typename ComposedOp, typename Tag>
+auto
+bind_tag(yield_token<ComposedOp> token, Tag)
+  -> detail::tagged_op<ComposedOp, TagSet>
+{
+    static_assert(boost::mp11::mp_contains<TagSet, Tag>::value,
+                  "Tag must be a member of TagSet");
+    return {token.release_operation(),
+            static_cast<detail::tag_index_t<TagSet>>(
+              boost::mp11::mp_find<TagSet, Tag>::value)};
+}
+
+} // namespace compose
+
+#endif // COMPOSE_BIND_TAG_HPP
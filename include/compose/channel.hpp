@@ -0,0 +1,292 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_CHANNEL_HPP
+#define COMPOSE_CHANNEL_HPP
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/circular_buffer.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <type_traits>
+
+namespace compose
+{
+namespace detail
+{
+
+template<typename Channel, typename Handler>
+class channel_batch_op;
+
+} // namespace detail
+
+/**
+ * A bounded, single-executor queue of values between composed operations.
+ * Senders are suspended while the buffer is full and receivers are suspended
+ * while it is empty, which bounds the memory used by a pipeline of composed
+ * operations.
+ *
+ * Suspended operations are linked into the channel through a waiter object
+ * owned by the caller, no memory is allocated by the channel to suspend an
+ * operation. The waiter is meant to be a data member of an OperationBody
+ * transformed with stable_transform(), so that it remains at the same address
+ * for as long as the operation is suspended.
+ *
+ * @tparam T The type of the transferred values. Must satisfy the constraints
+ * of DefaultConstructible and MoveAssignable.
+ *
+ * @remark Distinct objects: Safe. Shared objects: Unsafe. All member functions
+ * must be called from within the channel's executor.
+ */
+template<typename T, typename Executor = boost::asio::any_io_executor>
+class channel
+{
+public:
+    using executor_type = Executor;
+
+    /**
+     * Storage for one suspended asynchronous operation. A waiter may be used
+     * by at most one operation at a time and must not be destroyed while an
+     * operation is suspended on it.
+     *
+     * The CompletionHandler of a suspended operation is stored inside the
+     * waiter, which only has room for a handler the size of a stable
+     * ComposedOperation. Larger handlers are rejected at compile time.
+     */
+    class waiter;
+
+    /**
+     * Construct a channel.
+     *
+     * @param ex The executor used to post completions of operations that did
+     * not have to be suspended.
+     *
+     * @param capacity Maximal number of buffered values. A channel with a
+     * capacity of 0 hands values directly from senders to receivers.
+     */
+    channel(Executor const& ex, std::size_t capacity);
+
+    channel(channel const&) = delete;
+    channel(channel&&) = delete;
+    channel& operator=(channel const&) = delete;
+    channel& operator=(channel&&) = delete;
+
+    /**
+     * Destroys the channel. Suspended operations are destroyed without
+     * invoking their CompletionHandlers.
+     */
+    ~channel();
+
+    executor_type get_executor() const noexcept
+    {
+        return ex_;
+    }
+
+    std::size_t capacity() const noexcept
+    {
+        return buffer_.capacity();
+    }
+
+    /**
+     * Returns the number of buffered values.
+     */
+    std::size_t size() const noexcept
+    {
+        return buffer_.size();
+    }
+
+    bool is_open() const noexcept
+    {
+        return !closed_;
+    }
+
+    /**
+     * Closes the channel. Suspended senders complete with
+     * boost::asio::error::broken_pipe and suspended receivers complete with
+     * boost::asio::error::eof. Buffered values may still be received.
+     */
+    void close();
+
+    /**
+     * Cancels the operation suspended on a waiter. The operation completes
+     * with boost::asio::error::operation_aborted.
+     *
+     * @param w The waiter of the operation to cancel.
+     *
+     * @returns Whether an operation was suspended on the waiter.
+     */
+    bool cancel(waiter& w);
+
+    /**
+     * Sends a value. If the buffer is full, the operation is suspended on the
+     * waiter until a receiver makes room for the value.
+     *
+     * @param w Storage for the operation while it is suspended.
+     *
+     * @param value The value to send.
+     *
+     * @param tok The CompletionToken. The signature of the CompletionHandler is
+     * void(boost::system::error_code).
+     */
+    template<typename CompletionToken>
+    auto async_send(waiter& w, T value, CompletionToken&& tok)
+      -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                       void(boost::system::error_code));
+
+    /**
+     * Receives a single value. If the buffer is empty, the operation is
+     * suspended on the waiter until a sender provides a value.
+     *
+     * @param w Storage for the operation while it is suspended.
+     *
+     * @param tok The CompletionToken. The signature of the CompletionHandler is
+     * void(boost::system::error_code, T).
+     */
+    template<typename CompletionToken>
+    auto async_receive(waiter& w, CompletionToken&& tok)
+      -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                       void(boost::system::error_code, T));
+
+    /**
+     * Receives up to n values with a single completion. If the buffer is
+     * empty, the operation is suspended on the waiter until a sender provides
+     * a value. Values sent after that, until the completion of the operation
+     * is invoked, are appended to the same batch while it has room and no
+     * other receiver is suspended.
+     * Otherwise, all buffered values that fit are delivered at once.
+     *
+     * @param w Storage for the operation while it is suspended.
+     *
+     * @param items Destination of the received values. Must remain valid until
+     * the operation completes.
+     *
+     * @param n Maximal number of values to receive. Must be greater than 0.
+     *
+     * @param tok The CompletionToken. The signature of the CompletionHandler is
+     * void(boost::system::error_code, std::size_t).
+     */
+    template<typename CompletionToken>
+    auto async_receive_some(waiter& w,
+                            T* items,
+                            std::size_t n,
+                            CompletionToken&& tok)
+      -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                       void(boost::system::error_code,
+                                            std::size_t));
+
+private:
+    struct waiter_queue
+    {
+        void push_back(waiter& w) noexcept;
+        waiter* pop_front() noexcept;
+        bool remove(waiter& w) noexcept;
+
+        bool empty() const noexcept
+        {
+            return head_ == nullptr;
+        }
+
+        waiter* head_ = nullptr;
+        waiter* tail_ = nullptr;
+    };
+
+    using complete_fn = void (*)(channel&, waiter&, boost::system::error_code);
+
+    template<typename Handler>
+    static void park(waiter_queue& queue,
+                     waiter& w,
+                     Handler&& handler,
+                     complete_fn complete);
+
+    template<typename Handler>
+    static Handler take(waiter& w);
+
+    template<typename Handler>
+    static void destroy(waiter& w);
+
+    template<typename Channel, typename Handler>
+    friend class detail::channel_batch_op;
+
+    static std::size_t end_batch(waiter& w) noexcept;
+
+    template<typename Handler>
+    static void complete_send(channel& self,
+                              waiter& w,
+                              boost::system::error_code ec);
+
+    template<typename Handler>
+    static void complete_receive(channel& self,
+                                 waiter& w,
+                                 boost::system::error_code ec);
+
+    template<typename Handler>
+    static void complete_receive_some(channel& self,
+                                      waiter& w,
+                                      boost::system::error_code ec);
+
+    void deliver(waiter& receiver, T value);
+    void refill();
+
+    Executor ex_;
+    boost::circular_buffer<T> buffer_;
+    waiter_queue senders_;
+    waiter_queue receivers_;
+    // A receiver of a batch whose completion has been posted. Values sent
+    // before the completion runs are added to its batch while it has room and
+    // receivers_ is empty.
+    waiter* filling_ = nullptr;
+    bool closed_ = false;
+};
+
+template<typename T, typename Executor>
+class channel<T, Executor>::waiter
+{
+public:
+    waiter() = default;
+
+    waiter(waiter const&) = delete;
+    waiter(waiter&&) = delete;
+    waiter& operator=(waiter const&) = delete;
+    waiter& operator=(waiter&&) = delete;
+
+    ~waiter();
+
+    /**
+     * Indicates whether an operation is currently suspended on this waiter.
+     */
+    bool is_waiting() const noexcept
+    {
+        return complete_ != nullptr;
+    }
+
+private:
+    friend class channel;
+
+    using storage_type =
+      typename std::aligned_storage<2 * sizeof(void*), alignof(void*)>::type;
+
+    waiter* next_ = nullptr;
+    complete_fn complete_ = nullptr;
+    void (*destroy_)(waiter&) = nullptr;
+    T* items_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t count_ = 0;
+    channel* channel_ = nullptr;
+    boost::optional<T> value_;
+    storage_type handler_;
+};
+
+} // namespace compose
+
+#include <compose/impl/channel.hpp>
+
+#endif // COMPOSE_CHANNEL_HPP
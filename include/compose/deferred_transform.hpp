@@ -0,0 +1,126 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DEFERRED_TRANSFORM_HPP
+#define COMPOSE_DEFERRED_TRANSFORM_HPP
+
+#include <compose/detail/lean_tuple.hpp>
+#include <compose/detail/sequence_operation.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <type_traits>
+#include <utility>
+
+namespace compose
+{
+
+/**
+ * A description of an OperationBody that has not been transformed into a
+ * ComposedOperation yet. Holds the arguments that will be forwarded to the
+ * constructor of OperationBody when the operation is launched.
+ *
+ * @tparam OperationBody the type that will be transformed into a
+ * ComposedOperation.
+ *
+ * @tparam Args decayed types of the constructor arguments.
+ */
+template<typename OperationBody, typename... Args>
+class deferred_operation
+{
+public:
+    using body_type = OperationBody;
+    using args_type = detail::lean_tuple<Args...>;
+
+    template<typename... Us>
+    explicit deferred_operation(std::piecewise_construct_t, Us&&... us)
+      : args_{std::forward<Us>(us)...}
+    {
+    }
+
+    /**
+     * Releases the stored constructor arguments. The deferred_operation must
+     * not be used afterwards.
+     */
+    args_type release() &&
+    {
+        return std::move(args_);
+    }
+
+private:
+    args_type args_;
+};
+
+/**
+ * Describes an OperationBody without constructing it or launching the
+ * ComposedOperation.
+ *
+ * @tparam OperationBody the type that will be transformed into a
+ * ComposedOperation.
+ *
+ * @param args Arguments that will be forwarded to the constructor of
+ * OperationBody. They are decay-copied into the returned object.
+ *
+ * @returns deferred_operation<DEDUCED>
+ */
+template<typename OperationBody, typename... Args>
+auto
+defer(Args&&... args)
+  -> deferred_operation<OperationBody, typename std::decay<Args>::type...>;
+
+/**
+ * Fuses deferred OperationBodies into a single deferred OperationBody which
+ * runs them one after another. The arguments of the upcall performed by each
+ * OperationBody are passed to the initiation of the next one, the upcall of
+ * the last one completes the whole sequence.
+ *
+ * Once launched, all OperationBodies are stored in a single stable frame and
+ * are resumed through a single CompletionHandler, so a sequence of N
+ * operations performs one memory allocation instead of N.
+ *
+ * @param ops deferred_operation objects, which are consumed. A sequence may be
+ * used as an element of another sequence.
+ *
+ * @returns deferred_operation<DEDUCED>
+ */
+template<typename... Deferred>
+auto
+sequence(Deferred&&... ops) -> deferred_operation<
+  detail::sequence_body<typename std::decay<Deferred>::type::body_type...>,
+  typename std::decay<Deferred>::type::args_type...>;
+
+/**
+ * Performs a transformation of a deferred OperationBody into a
+ * ComposedOperation, with the same guarantees as stable_transform.
+ *
+ * @param ex The I/O executor to be used by the ComposedOperation (associated
+ * with the used I/O object).
+ *
+ * @param init Reference to an asynchronous operation initiation helper. Used to
+ * deduce the CompletionHandler and Signature types.
+ *
+ * @param op The description of the OperationBody, which is consumed.
+ *
+ * @returns transformed_operation<DEDUCED>
+ */
+template<typename Executor,
+         typename CompletionToken,
+         typename Signature,
+         typename OperationBody,
+         typename... Args>
+auto
+transform_deferred(
+  Executor const& ex,
+  boost::asio::async_completion<CompletionToken, Signature>& init,
+  deferred_operation<OperationBody, Args...>&& op);
+
+} // namespace compose
+
+#include <compose/impl/deferred_transform.hpp>
+
+#endif // COMPOSE_DEFERRED_TRANSFORM_HPP
@@ -15,6 +15,7 @@
 #ifndef COMPOSE_NO_RECYCLING_ALLOCATOR
 #include <boost/asio/detail/recycling_allocator.hpp>
 #endif // COMPOSE_NO_RECYCLING_ALLOCATOR
+#include <cstddef>
 #include <memory>
 
 namespace compose
@@ -28,18 +29,6 @@ using default_allocator = boost::asio::detail::recycling_allocator<void>;
 using default_allocator = std::allocator<void>;
 #endif
 
-template<typename T>
-struct uniform_init_wrapper
-{
-    template<typename... Args>
-    explicit uniform_init_wrapper(Args&&... args)
-      : t_{std::forward<Args>(args)...}
-    {
-    }
-
-    T t_;
-};
-
 template<typename Allocator>
 struct deleter
 {
@@ -66,6 +55,19 @@ struct deallocator
     Allocator& alloc_;
 };
 
+template<typename Allocator>
+struct deallocator_n
+{
+    using value_type = typename Allocator::value_type;
+    void operator()(value_type* p) const
+    {
+        std::allocator_traits<Allocator>::deallocate(alloc_, p, n_);
+    }
+
+    Allocator& alloc_;
+    std::size_t n_;
+};
+
 template<class Handler, class T>
 using rebound_associated_alloc_t = typename std::allocator_traits<
   boost::asio::associated_allocator_t<Handler, default_allocator>>::
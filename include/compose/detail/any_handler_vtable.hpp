@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_ANY_HANDLER_VTABLE_HPP
+#define COMPOSE_DETAIL_ANY_HANDLER_VTABLE_HPP
+
+#include <boost/asio/any_io_executor.hpp>
+
+#include <cstddef>
+#include <type_traits>
+
+namespace compose
+{
+
+template<typename T>
+class any_handler_allocator;
+
+namespace detail
+{
+
+// Fits a stable ComposedOperation bound to a few arguments, or an unstable one
+// with a small OperationBody.
+constexpr std::size_t default_handler_buffer_size = 4 * sizeof(void*);
+
+using allocator_storage =
+  typename std::aligned_storage<2 * sizeof(void*), alignof(void*)>::type;
+
+using allocation_unit =
+  typename std::aligned_storage<alignof(std::max_align_t),
+                                alignof(std::max_align_t)>::type;
+
+struct allocator_vtable
+{
+    void (*copy)(allocator_storage const& from, allocator_storage& to) noexcept;
+    void (*destroy)(allocator_storage& storage) noexcept;
+    void* (*allocate)(allocator_storage const& storage, std::size_t size);
+    void (*deallocate)(allocator_storage const& storage,
+                       void* p,
+                       std::size_t size) noexcept;
+    bool (*equal)(allocator_storage const& lhs,
+                  allocator_storage const& rhs) noexcept;
+};
+
+template<class... Args>
+struct any_handler_vtable
+{
+    void (*invoke)(void* storage, Args&&... args);
+    void (*relocate)(void* from, void* to) noexcept;
+    void (*destroy)(void* storage) noexcept;
+    boost::asio::any_io_executor (*executor)(
+      void const* storage,
+      boost::asio::any_io_executor const& ex);
+    any_handler_allocator<void> (*allocator)(void const* storage);
+};
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_ANY_HANDLER_VTABLE_HPP
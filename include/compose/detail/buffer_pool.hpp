@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_BUFFER_POOL_HPP
+#define COMPOSE_DETAIL_BUFFER_POOL_HPP
+
+#include <cstddef>
+
+// Size of the blocks handed out by the per-thread buffer pool.
+#ifndef COMPOSE_POOLED_BUFFER_SIZE
+#define COMPOSE_POOLED_BUFFER_SIZE 65536
+#endif // COMPOSE_POOLED_BUFFER_SIZE
+
+// Maximal number of free blocks cached by each thread.
+#ifndef COMPOSE_POOLED_BUFFER_CACHE
+#define COMPOSE_POOLED_BUFFER_CACHE 4
+#endif // COMPOSE_POOLED_BUFFER_CACHE
+
+namespace compose
+{
+namespace detail
+{
+
+/**
+ * A per-thread cache of fixed size blocks, used as scratch buffers by
+ * composed operations which copy through user space. A block may be released
+ * on a different thread than the one it was acquired on.
+ */
+class buffer_pool
+{
+public:
+    static constexpr std::size_t block_size = COMPOSE_POOLED_BUFFER_SIZE;
+
+    buffer_pool() = default;
+    buffer_pool(buffer_pool const&) = delete;
+    buffer_pool& operator=(buffer_pool const&) = delete;
+
+    ~buffer_pool()
+    {
+        while (size_ > 0)
+            delete[] free_[--size_];
+    }
+
+    static buffer_pool& local() noexcept
+    {
+        static thread_local buffer_pool pool;
+        return pool;
+    }
+
+    char* acquire()
+    {
+        if (size_ > 0)
+            return free_[--size_];
+        return new char[block_size];
+    }
+
+    void release(char* block) noexcept
+    {
+        if (size_ < COMPOSE_POOLED_BUFFER_CACHE)
+            free_[size_++] = block;
+        else
+            delete[] block;
+    }
+
+private:
+    char* free_[COMPOSE_POOLED_BUFFER_CACHE];
+    std::size_t size_ = 0;
+};
+
+// An owning handle to a block acquired lazily from the current thread's
+// pool.
+class pooled_buffer
+{
+public:
+    pooled_buffer() = default;
+
+    pooled_buffer(pooled_buffer&& other) noexcept
+      : data_{other.data_}
+    {
+        other.data_ = nullptr;
+    }
+
+    pooled_buffer(pooled_buffer const&) = delete;
+    pooled_buffer& operator=(pooled_buffer&&) = delete;
+    pooled_buffer& operator=(pooled_buffer const&) = delete;
+
+    ~pooled_buffer()
+    {
+        if (data_ != nullptr)
+            buffer_pool::local().release(data_);
+    }
+
+    char* data()
+    {
+        if (data_ == nullptr)
+            data_ = buffer_pool::local().acquire();
+        return data_;
+    }
+
+    static constexpr std::size_t size() noexcept
+    {
+        return buffer_pool::block_size;
+    }
+
+private:
+    char* data_ = nullptr;
+};
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_BUFFER_POOL_HPP
@@ -14,6 +14,7 @@
 #include <compose/yield_token.hpp>
 
 #include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/post.hpp>
 
 namespace compose
 {
@@ -47,6 +48,9 @@ public:
                       boost::asio::make_work_guard<IoExecutor>(ex)},
                     std::forward<BodyArgs>(args)...}
     {
+#ifdef COMPOSE_ENABLE_OPERATION_TRACKING
+        op_storage_.track(ex);
+#endif // COMPOSE_ENABLE_OPERATION_TRACKING
     }
 
     explicit composed_op(yield_token<composed_op> const& token)
@@ -57,6 +61,9 @@ public:
     template<class... Args>
     void operator()(Args&&... args)
     {
+#ifdef COMPOSE_ENABLE_OPERATION_TRACKING
+        detail::tracking_scope const scope{op_storage_.tracking(), true};
+#endif // COMPOSE_ENABLE_OPERATION_TRACKING
         (void)op_storage_.value()(yield_token<composed_op>{*this, true},
                                   std::forward<Args>(args)...);
     }
@@ -64,6 +71,9 @@ public:
     template<class... Args>
     void run(Args&&... args)
     {
+#ifdef COMPOSE_ENABLE_OPERATION_TRACKING
+        detail::tracking_scope const scope{op_storage_.tracking(), false};
+#endif // COMPOSE_ENABLE_OPERATION_TRACKING
         (void)op_storage_.value()(yield_token<composed_op>{*this, false},
                                   std::forward<Args>(args)...);
     }
@@ -73,10 +83,7 @@ public:
     {
         assert(op_storage_.has_value() &&
                "post_upcall must not be called on an invalid operation.");
-        auto const ex = boost::asio::get_associated_executor(
-          *this, op_storage_.handler().guard_.get_executor());
-        auto const alloc = boost::asio::get_associated_allocator(*this);
-        ex.post(op_storage_.release_bind(std::forward<Args>(args)...), alloc);
+        post_upcall(is_inplace_upcall<Args...>{}, std::forward<Args>(args)...);
     }
 
     template<class... Args>
@@ -84,8 +91,8 @@ public:
     {
         assert(op_storage_.has_value() &&
                "direct_upcall must not be called on an invalid operation.");
-
-        op_storage_.release_bind(std::forward<Args>(args)...)();
+        direct_upcall(is_inplace_upcall<Args...>{},
+                      std::forward<Args>(args)...);
     }
 
     template<class H, class E>
@@ -95,6 +102,47 @@ public:
     friend class boost::asio::associated_allocator;
 
 private:
+    // Resolved from the upcall alone, so that operations which only differ in
+    // the OperationBody share the instantiation.
+    boost::asio::associated_executor_t<Handler, IoExecutor>
+    upcall_executor() const
+    {
+        return boost::asio::get_associated_executor(
+          op_storage_.handler().upcall_,
+          op_storage_.handler().guard_.get_executor());
+    }
+
+    template<class... Args>
+    void post_upcall(std::false_type, Args&&... args)
+    {
+        auto const ex = upcall_executor();
+        (void)boost::asio::post(
+          ex, op_storage_.release_posted(std::forward<Args>(args)...));
+    }
+
+    // Large arguments are constructed once, in a node owned by the posted
+    // handler, instead of being moved into the bound handler and then again
+    // into the executor's operation.
+    template<class... Args>
+    void post_upcall(std::true_type, Args&&... args)
+    {
+        auto const ex = upcall_executor();
+        (void)boost::asio::post(
+          ex, op_storage_.release_node(std::forward<Args>(args)...));
+    }
+
+    template<class... Args>
+    void direct_upcall(std::false_type, Args&&... args)
+    {
+        op_storage_.release_bind(std::forward<Args>(args)...)();
+    }
+
+    template<class... Args>
+    void direct_upcall(std::true_type, Args&&... args)
+    {
+        op_storage_.invoke_inplace(std::forward<Args>(args)...);
+    }
+
     detail::
       handler_storage<upcall_op<Handler, IoExecutor>, OperationBody, stable>
         op_storage_;
@@ -109,6 +157,21 @@ namespace boost
 namespace asio
 {
 
+template<class Handler, class IoExecutor, class A>
+class associated_allocator<::compose::detail::upcall_op<Handler, IoExecutor>,
+                           A>
+{
+public:
+    using type = associated_allocator_t<Handler, A>;
+
+    static type get(
+      ::compose::detail::upcall_op<Handler, IoExecutor> const& op,
+      A const& alloc = A{})
+    {
+        return associated_allocator<Handler, A>::get(op.upcall_, alloc);
+    }
+};
+
 template<class OperationBody,
          class Handler,
          class IoExecutor,
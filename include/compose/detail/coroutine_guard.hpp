@@ -11,6 +11,11 @@
 #define COMPOSE_DETAIL_COROUTINE_HPP
 
 #include <compose/coroutine.hpp>
+
+#ifdef COMPOSE_ENABLE_OPERATION_TRACKING
+#include <compose/detail/tracked_frame.hpp>
+#endif // COMPOSE_ENABLE_OPERATION_TRACKING
+
 namespace compose
 {
 
@@ -38,6 +43,9 @@ public:
     coroutine_ref& operator=(int i)
     {
         coro_.state_ = i;
+#ifdef COMPOSE_ENABLE_OPERATION_TRACKING
+        detail::track_coroutine_state(i);
+#endif // COMPOSE_ENABLE_OPERATION_TRACKING
         return *this;
     }
 
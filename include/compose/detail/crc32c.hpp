@@ -0,0 +1,239 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_CRC32C_HPP
+#define COMPOSE_DETAIL_CRC32C_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) &&      \
+  !defined(COMPOSE_NO_SIMD)
+#define COMPOSE_CRC32C_SSE42
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+namespace compose
+{
+namespace detail
+{
+
+// Reflected Castagnoli polynomial.
+constexpr std::uint32_t crc32c_polynomial = 0x82f63b78;
+
+// Tables for slicing by 8 bytes: t[k][b] is the CRC of byte b followed by k
+// zero bytes.
+struct crc32c_tables
+{
+    constexpr crc32c_tables()
+      : t{}
+    {
+        for (std::uint32_t b = 0; b < 256; ++b)
+        {
+            std::uint32_t crc = b;
+            for (int i = 0; i < 8; ++i)
+                crc = (crc >> 1) ^ (crc32c_polynomial & (0u - (crc & 1)));
+            t[0][b] = crc;
+        }
+        for (std::uint32_t b = 0; b < 256; ++b)
+        {
+            for (int k = 1; k < 8; ++k)
+                t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xff];
+        }
+    }
+
+    std::uint32_t t[8][256];
+};
+
+inline std::uint32_t
+from_little_endian(std::uint32_t word) noexcept
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap32(word);
+#else
+    return word;
+#endif
+}
+
+// Updates a CRC register, without the initial and final inversions.
+inline std::uint32_t
+crc32c_portable(std::uint32_t crc,
+                unsigned char const* p,
+                std::size_t size) noexcept
+{
+    static constexpr crc32c_tables tables{};
+    auto const& t = tables.t;
+
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        std::uint32_t word;
+        std::memcpy(&word, p, sizeof(word));
+        std::uint32_t const lo = crc ^ from_little_endian(word);
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+              t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^ t[3][p[4]] ^
+              t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    }
+    for (; size > 0; --size, ++p)
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+    return crc;
+}
+
+// Multiplies two polynomials modulo the Castagnoli polynomial, in the
+// reflected representation of the CRC register.
+constexpr std::uint32_t
+crc32c_multiply(std::uint32_t a, std::uint32_t b) noexcept
+{
+    std::uint32_t product = 0;
+    for (std::uint32_t m = 1u << 31; m != 0; m >>= 1)
+    {
+        if (a & m)
+            product ^= b;
+        b = (b >> 1) ^ (crc32c_polynomial & (0u - (b & 1)));
+    }
+    return product;
+}
+
+// Returns x^n modulo the Castagnoli polynomial.
+constexpr std::uint32_t
+crc32c_power(std::uint64_t n) noexcept
+{
+    std::uint32_t result = 1u << 31;
+    std::uint32_t square = 1u << 30;
+    for (; n != 0; n >>= 1)
+    {
+        if (n & 1)
+            result = crc32c_multiply(result, square);
+        square = crc32c_multiply(square, square);
+    }
+    return result;
+}
+
+#ifdef COMPOSE_CRC32C_SSE42
+
+__attribute__((target("sse4.2"))) inline std::uint32_t
+crc32c_sse42(std::uint32_t crc,
+             unsigned char const* p,
+             std::size_t size) noexcept
+{
+    std::uint64_t crc64 = crc;
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<std::uint32_t>(crc64);
+    for (; size > 0; --size, ++p)
+        crc = _mm_crc32_u8(crc, *p);
+    return crc;
+}
+
+// Advances a CRC register over Lane zero bytes. The carry-less product with
+// x^(8 * Lane - 33) is reduced by the crc32 instruction, which multiplies by
+// x^32, while the product of reflected operands contributes another x.
+template<std::size_t Lane>
+__attribute__((target("sse4.2,pclmul"))) inline std::uint32_t
+crc32c_shift(std::uint32_t crc) noexcept
+{
+    static constexpr std::uint32_t k = crc32c_power(8 * Lane - 33);
+    auto const product = _mm_clmulepi64_si128(
+      _mm_cvtsi32_si128(static_cast<int>(crc)),
+      _mm_cvtsi32_si128(static_cast<int>(k)),
+      0);
+    return static_cast<std::uint32_t>(_mm_crc32_u64(
+      0, static_cast<std::uint64_t>(_mm_cvtsi128_si64(product))));
+}
+
+// The crc32 instruction has a latency of 3 cycles but a throughput of one
+// per cycle, so blocks of 3 lanes are checksummed as independent streams
+// and then combined with carry-less multiplication.
+template<std::size_t Lane>
+__attribute__((target("sse4.2,pclmul"))) inline std::uint32_t
+crc32c_interleaved(std::uint32_t crc,
+                   unsigned char const*& p,
+                   std::size_t& size) noexcept
+{
+    static_assert(Lane % 8 == 0, "Lanes must consist of whole words");
+    std::uint64_t crc0 = crc;
+    for (; size >= 3 * Lane; size -= 3 * Lane, p += 3 * Lane)
+    {
+        std::uint64_t crc1 = 0;
+        std::uint64_t crc2 = 0;
+        for (std::size_t i = 0; i < Lane; i += 8)
+        {
+            std::uint64_t word0;
+            std::uint64_t word1;
+            std::uint64_t word2;
+            std::memcpy(&word0, p + i, sizeof(word0));
+            std::memcpy(&word1, p + Lane + i, sizeof(word1));
+            std::memcpy(&word2, p + 2 * Lane + i, sizeof(word2));
+            crc0 = _mm_crc32_u64(crc0, word0);
+            crc1 = _mm_crc32_u64(crc1, word1);
+            crc2 = _mm_crc32_u64(crc2, word2);
+        }
+        auto const crc01 =
+          crc32c_shift<Lane>(static_cast<std::uint32_t>(crc0)) ^
+          static_cast<std::uint32_t>(crc1);
+        crc0 = crc32c_shift<Lane>(crc01) ^ static_cast<std::uint32_t>(crc2);
+    }
+    return static_cast<std::uint32_t>(crc0);
+}
+
+__attribute__((target("sse4.2,pclmul"))) inline std::uint32_t
+crc32c_pclmul(std::uint32_t crc,
+              unsigned char const* p,
+              std::size_t size) noexcept
+{
+    crc = crc32c_interleaved<2048>(crc, p, size);
+    crc = crc32c_interleaved<256>(crc, p, size);
+    return crc32c_sse42(crc, p, size);
+}
+
+// Returns 2 if the CPU has both crc32 and carry-less multiplication
+// instructions, 1 if it has only the former and 0 otherwise.
+inline int
+crc32c_hardware() noexcept
+{
+    static int const level = !__builtin_cpu_supports("sse4.2")
+                               ? 0
+                               : __builtin_cpu_supports("pclmul") ? 2 : 1;
+    return level;
+}
+
+#endif // COMPOSE_CRC32C_SSE42
+
+/**
+ * Extends a CRC32C checksum with more data. crc32c(b, n, crc32c(a, m)) is
+ * the checksum of a followed by b.
+ *
+ * Uses the SSE4.2 crc32 instruction on 3 interleaved streams if the CPU
+ * supports it, and tables for slicing by 8 bytes otherwise.
+ */
+inline std::uint32_t
+crc32c(void const* data, std::size_t size, std::uint32_t crc = 0) noexcept
+{
+    auto const p = static_cast<unsigned char const*>(data);
+#ifdef COMPOSE_CRC32C_SSE42
+    switch (crc32c_hardware())
+    {
+        case 2:
+            return ~crc32c_pclmul(~crc, p, size);
+        case 1:
+            return ~crc32c_sse42(~crc, p, size);
+    }
+#endif // COMPOSE_CRC32C_SSE42
+    return ~crc32c_portable(~crc, p, size);
+}
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_CRC32C_HPP
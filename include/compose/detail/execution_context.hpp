@@ -0,0 +1,39 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_EXECUTION_CONTEXT_HPP
+#define COMPOSE_DETAIL_EXECUTION_CONTEXT_HPP
+
+#include <boost/asio/execution/context.hpp>
+#include <boost/asio/query.hpp>
+
+namespace compose
+{
+namespace detail
+{
+
+template<typename Executor>
+auto
+get_execution_context(Executor const& ex, decltype(nullptr))
+  -> decltype(boost::asio::query(ex, boost::asio::execution::context))
+{
+    return boost::asio::query(ex, boost::asio::execution::context);
+}
+
+template<typename Executor>
+auto
+get_execution_context(Executor const& ex, ...) -> decltype(ex.context())
+{
+    return ex.context();
+}
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_EXECUTION_CONTEXT_HPP
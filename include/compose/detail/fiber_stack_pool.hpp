@@ -0,0 +1,165 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_FIBER_STACK_POOL_HPP
+#define COMPOSE_DETAIL_FIBER_STACK_POOL_HPP
+
+#include <boost/context/stack_context.hpp>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <new>
+
+#ifndef COMPOSE_FIBER_STACK_SIZE
+#define COMPOSE_FIBER_STACK_SIZE (256 * 1024)
+#endif // COMPOSE_FIBER_STACK_SIZE
+
+#ifndef COMPOSE_FIBER_STACK_CACHE
+#define COMPOSE_FIBER_STACK_CACHE 16
+#endif // COMPOSE_FIBER_STACK_CACHE
+
+namespace compose
+{
+namespace detail
+{
+
+/**
+ * A per-thread cache of fiber stacks. Every stack is a private anonymous
+ * mapping of COMPOSE_FIBER_STACK_SIZE bytes, the lowest page of which is a
+ * guard page, so that a stack overflow faults instead of corrupting adjacent
+ * memory. Released stacks are kept for reuse, up to COMPOSE_FIBER_STACK_CACHE
+ * stacks per thread, the rest are unmapped.
+ */
+class fiber_stack_pool
+{
+public:
+    fiber_stack_pool() = default;
+    fiber_stack_pool(fiber_stack_pool const&) = delete;
+    fiber_stack_pool& operator=(fiber_stack_pool const&) = delete;
+
+    ~fiber_stack_pool()
+    {
+        while (head_ != nullptr)
+        {
+            auto const next = head_->next_;
+            ::munmap(base_of(head_), size());
+            head_ = next;
+        }
+    }
+
+    static fiber_stack_pool& this_thread()
+    {
+        static thread_local fiber_stack_pool pool;
+        return pool;
+    }
+
+    static std::size_t size() noexcept
+    {
+        auto const page = page_size();
+        return (COMPOSE_FIBER_STACK_SIZE + page - 1) / page * page + page;
+    }
+
+    static std::size_t page_size() noexcept
+    {
+        static std::size_t const page = ::sysconf(_SC_PAGESIZE);
+        return page;
+    }
+
+    boost::context::stack_context allocate()
+    {
+        void* base = nullptr;
+        if (head_ != nullptr)
+        {
+            base = base_of(head_);
+            head_ = head_->next_;
+            --cached_;
+        }
+        else
+        {
+            base = ::mmap(nullptr,
+                          size(),
+                          PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK,
+                          -1,
+                          0);
+            if (base == MAP_FAILED)
+                throw std::bad_alloc{};
+            if (::mprotect(base, page_size(), PROT_NONE) != 0)
+            {
+                ::munmap(base, size());
+                throw std::bad_alloc{};
+            }
+        }
+
+        boost::context::stack_context sctx;
+        sctx.size = size();
+        sctx.sp = static_cast<char*>(base) + size();
+        return sctx;
+    }
+
+    void deallocate(boost::context::stack_context& sctx) noexcept
+    {
+        auto const base = static_cast<char*>(sctx.sp) - sctx.size;
+        if (cached_ == COMPOSE_FIBER_STACK_CACHE)
+        {
+            ::munmap(base, sctx.size);
+            return;
+        }
+
+        // The stack is unused while cached, so the link is stored at its
+        // lowest address, right above the guard page.
+        head_ = ::new (base + page_size()) cached_stack{head_};
+        ++cached_;
+    }
+
+    std::size_t cached() const noexcept
+    {
+        return cached_;
+    }
+
+private:
+    struct cached_stack
+    {
+        cached_stack* next_;
+    };
+
+    static void* base_of(cached_stack* link) noexcept
+    {
+        return reinterpret_cast<char*>(link) - page_size();
+    }
+
+    cached_stack* head_ = nullptr;
+    std::size_t cached_ = 0;
+};
+
+/**
+ * A StackAllocator for boost::context::fiber which takes stacks from the
+ * fiber_stack_pool of the calling thread. A stack may be released on a
+ * different thread than the one it was taken on, all stacks have the same
+ * size.
+ */
+struct pooled_fiber_stack
+{
+    boost::context::stack_context allocate()
+    {
+        return fiber_stack_pool::this_thread().allocate();
+    }
+
+    void deallocate(boost::context::stack_context& sctx) noexcept
+    {
+        fiber_stack_pool::this_thread().deallocate(sctx);
+    }
+};
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_FIBER_STACK_POOL_HPP
@@ -0,0 +1,159 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_FIND_DELIMITER_HPP
+#define COMPOSE_DETAIL_FIND_DELIMITER_HPP
+
+#include <cstddef>
+#include <cstring>
+
+#if defined(__AVX2__) && !defined(COMPOSE_NO_SIMD)
+#define COMPOSE_FIND_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) && !defined(COMPOSE_NO_SIMD)
+#define COMPOSE_FIND_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace compose
+{
+namespace detail
+{
+
+// Scalar search, also used for the tails of the vectorized ones.
+inline std::size_t
+find_delimiter_scalar(char const* data,
+                      std::size_t size,
+                      char const* delim,
+                      std::size_t delim_size) noexcept
+{
+    if (delim_size == 0 || size < delim_size)
+        return size;
+
+    auto const last = size - delim_size;
+    for (std::size_t i = 0; i <= last;)
+    {
+        auto const p = static_cast<char const*>(
+          std::memchr(data + i, delim[0], last - i + 1));
+        if (p == nullptr)
+            break;
+        i = static_cast<std::size_t>(p - data);
+        if (std::memcmp(p + 1, delim + 1, delim_size - 1) == 0)
+            return i;
+        ++i;
+    }
+    return size;
+}
+
+#if defined(COMPOSE_FIND_AVX2) || defined(COMPOSE_FIND_SSE2)
+
+#ifdef COMPOSE_FIND_AVX2
+using find_vector = __m256i;
+constexpr std::size_t find_width = 32;
+
+inline find_vector
+find_broadcast(char c) noexcept
+{
+    return _mm256_set1_epi8(c);
+}
+
+// Returns a bitmask of the positions at which the block starting at p holds
+// c.
+inline unsigned
+find_match(char const* p, find_vector c) noexcept
+{
+    auto const block =
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+    return static_cast<unsigned>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, c)));
+}
+#else
+using find_vector = __m128i;
+constexpr std::size_t find_width = 16;
+
+inline find_vector
+find_broadcast(char c) noexcept
+{
+    return _mm_set1_epi8(c);
+}
+
+inline unsigned
+find_match(char const* p, find_vector c) noexcept
+{
+    auto const block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+    return static_cast<unsigned>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(block, c)));
+}
+#endif // COMPOSE_FIND_AVX2
+
+inline std::size_t
+lowest_bit(unsigned mask) noexcept
+{
+    return static_cast<std::size_t>(__builtin_ctz(mask));
+}
+
+#endif // defined(COMPOSE_FIND_AVX2) || defined(COMPOSE_FIND_SSE2)
+
+/**
+ * Returns the position of the first occurrence of the delimiter in
+ * [data, data + size), or size if there is none.
+ *
+ * Blocks of 16 (SSE2) or 32 (AVX2) positions are tested at once. For
+ * delimiters longer than one byte, a position is a candidate if it holds the
+ * first byte of the delimiter and the matching position delim_size - 1 bytes
+ * further holds the last one. Only candidates are compared in full.
+ */
+inline std::size_t
+find_delimiter(char const* data,
+               std::size_t size,
+               char const* delim,
+               std::size_t delim_size) noexcept
+{
+#if defined(COMPOSE_FIND_AVX2) || defined(COMPOSE_FIND_SSE2)
+    if (delim_size == 0 || size < delim_size)
+        return size;
+
+    std::size_t i = 0;
+    auto const first = find_broadcast(delim[0]);
+    if (delim_size == 1)
+    {
+        for (; i + find_width <= size; i += find_width)
+        {
+            auto const mask = find_match(data + i, first);
+            if (mask != 0)
+                return i + lowest_bit(mask);
+        }
+    }
+    else
+    {
+        auto const last = find_broadcast(delim[delim_size - 1]);
+        for (; i + delim_size - 1 + find_width <= size; i += find_width)
+        {
+            auto mask = find_match(data + i, first) &
+                        find_match(data + i + delim_size - 1, last);
+            for (; mask != 0; mask &= mask - 1)
+            {
+                auto const pos = i + lowest_bit(mask);
+                if (std::memcmp(
+                      data + pos + 1, delim + 1, delim_size - 2) == 0)
+                    return pos;
+            }
+        }
+    }
+
+    return i + find_delimiter_scalar(data + i, size - i, delim, delim_size);
+#else
+    return find_delimiter_scalar(data, size, delim, delim_size);
+#endif // defined(COMPOSE_FIND_AVX2) || defined(COMPOSE_FIND_SSE2)
+}
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_FIND_DELIMITER_HPP
@@ -13,6 +13,17 @@
 #include <compose/detail/allocator_utils.hpp>
 #include <compose/detail/bind_front_handler.hpp>
 #include <compose/detail/lean_ptr.hpp>
+#include <compose/detail/recycled_upcall.hpp>
+#include <compose/detail/upcall_node.hpp>
+
+#include <boost/asio/detail/scheduler_operation.hpp>
+
+#include <cstddef>
+#include <type_traits>
+
+#ifdef COMPOSE_ENABLE_OPERATION_TRACKING
+#include <compose/operation_tracker.hpp>
+#endif // COMPOSE_ENABLE_OPERATION_TRACKING
 
 namespace compose
 {
@@ -53,41 +64,191 @@ struct handler_storage<Handler, T, false>
         return true;
     }
 
+#ifdef COMPOSE_ENABLE_OPERATION_TRACKING
+    template<typename Executor>
+    void track(Executor const&)
+    {
+    }
+
+    tracked_frame* tracking() noexcept
+    {
+        return nullptr;
+    }
+#endif // COMPOSE_ENABLE_OPERATION_TRACKING
+
     template<typename... Args>
     auto release_bind(Args&&... args)
       -> bound_front_op<Handler, typename std::decay<Args>::type...>
     {
         return {std::move(handler_), {std::forward<Args>(args)...}};
     }
+
+    template<typename... Args>
+    auto release_posted(Args&&... args)
+      -> bound_front_op<Handler, typename std::decay<Args>::type...>
+    {
+        return release_bind(std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    auto release_node(Args&&... args)
+      -> posted_upcall<Handler, typename std::decay<Args>::type...>
+    {
+        return posted_upcall<Handler, typename std::decay<Args>::type...>::
+          create(std::move(handler_), std::forward<Args>(args)...);
+    }
+
+    template<typename... Args>
+    void invoke_inplace(Args&&... args)
+    {
+        Handler h{std::move(handler_)};
+        h(std::forward<Args>(args)...);
+    }
+};
+
+template<typename... Ts>
+struct make_void
+{
+    using type = void;
+};
+
+template<class Handler, class IoExecutor>
+struct upcall_op;
+
+// Number of bytes needed to post an upcall with the Signature from the memory
+// of a frame: the scheduler's operation, which holds the posted upcall, the
+// executor which tracks its work and its allocator, and the owner bits of the
+// block. The base of the operation is taken from Asio, so that the estimate
+// follows its layout. Covered by tests/compose/recycled_upcall.cpp.
+template<typename Handler, typename Signature>
+struct posted_upcall_size;
+
+template<typename Handler, typename IoExecutor, typename... Args>
+struct posted_upcall_size<upcall_op<Handler, IoExecutor>, void(Args...)>
+{
+    using unit_allocator =
+      rebound_associated_alloc_t<upcall_op<Handler, IoExecutor>, frame_unit>;
+    using op_type = typename std::conditional<
+      is_inplace_upcall<Args...>::value,
+      posted_upcall<upcall_op<Handler, IoExecutor>,
+                    typename std::decay<Args>::type...>,
+      bound_front_op<upcall_op<Handler, IoExecutor>,
+                     typename std::decay<Args>::type...>>::type;
+
+    static constexpr std::size_t value =
+      sizeof(boost::asio::detail::scheduler_operation) +
+      sizeof(recycled_upcall<op_type, unit_allocator>) +
+      sizeof(boost::asio::associated_executor_t<Handler, IoExecutor>) +
+      sizeof(frame_block_allocator<void, unit_allocator>) + 1;
+};
+
+// The size of a frame, without a reserve, is at least the size of the
+// CompletionHandler and of the OperationBody.
+template<typename Handler, typename T, typename = void>
+struct upcall_reserve
+  : std::integral_constant<std::size_t,
+                           (sizeof(T) < COMPOSE_UPCALL_RESERVE
+                              ? COMPOSE_UPCALL_RESERVE - sizeof(T)
+                              : 0)>
+{
+};
+
+// An OperationBody which declares the signature of its posted upcalls, e.g.
+// using upcall_signature = void(boost::system::error_code, std::size_t);
+// gets a frame large enough to post them without an allocation.
+template<typename Handler, typename T>
+struct upcall_reserve<
+  Handler,
+  T,
+  typename make_void<typename T::upcall_signature>::type>
+  : std::integral_constant<
+      std::size_t,
+      (sizeof(Handler) + sizeof(T) <
+           posted_upcall_size<Handler, typename T::upcall_signature>::value
+         ? posted_upcall_size<Handler, typename T::upcall_signature>::value -
+             sizeof(Handler) - sizeof(T)
+         : 0)>
+{
+};
+
+// Room for the operation which posts the upcall, see recycled_upcall.
+template<std::size_t Size>
+struct frame_reserve
+{
+    unsigned char reserve_[Size];
+};
+
+template<>
+struct frame_reserve<0>
+{
+};
+
+template<typename Handler, typename T>
+struct stable_frame : frame_reserve<upcall_reserve<Handler, T>::value>
+{
+    template<typename H, typename... Args>
+    explicit stable_frame(H&& h, Args&&... args)
+      : handler_{std::forward<H>(h)}
+      , t_{std::forward<Args>(args)...}
+    {
+    }
+
+#ifdef COMPOSE_ENABLE_OPERATION_TRACKING
+    tracked_frame tracking_;
+#endif // COMPOSE_ENABLE_OPERATION_TRACKING
+    Handler handler_;
+    T t_;
+};
+
+// Destroys a stable frame and deallocates the units it occupies.
+template<typename Frame, typename UnitAllocator>
+struct frame_deleter
+{
+    void operator()(Frame* p) const
+    {
+        p->~Frame();
+        std::allocator_traits<UnitAllocator>::deallocate(
+          alloc_, reinterpret_cast<frame_unit*>(p), frame_units<Frame>());
+    }
+
+    UnitAllocator& alloc_;
 };
 
 template<typename Handler, typename T>
 class handler_storage<Handler, T, true>
 {
-    using wrapper = uniform_init_wrapper<T>;
-    using allocator_type = rebound_associated_alloc_t<Handler, wrapper>;
+public:
+    using frame_type = stable_frame<Handler, T>;
+
+private:
+    // Frames are allocated in units, so that the type of the Allocator, and
+    // of the recycled upcalls, does not depend on T.
+    using allocator_type = rebound_associated_alloc_t<Handler, frame_unit>;
+    using deleter_type = frame_deleter<frame_type, allocator_type>;
+
+    static_assert(alignof(frame_type) <= alignof(frame_unit),
+                  "Over-aligned operation bodies are not supported.");
 
 public:
     template<typename H, typename... Args>
     explicit handler_storage(H&& h, Args&&... args)
-      : handler_{std::forward<H>(h)}
     {
         allocator_type alloc{
           boost::asio::get_associated_allocator(h, default_allocator{})};
-        std::allocator_traits<allocator_type> traits;
 
-        detail::lean_ptr<wrapper, deallocator<allocator_type>> p{
-          traits.allocate(alloc, 1), deallocator<allocator_type>{alloc}};
-        traits.construct(alloc, p.t_, std::forward<Args>(args)...);
-        wrapper_ = p.t_;
+        detail::lean_ptr<frame_unit, deallocator_n<allocator_type>> p{
+          std::allocator_traits<allocator_type>::allocate(
+            alloc, frame_units<frame_type>()),
+          deallocator_n<allocator_type>{alloc, frame_units<frame_type>()}};
+        frame_ = ::new (static_cast<void*>(p.t_))
+          frame_type(std::forward<H>(h), std::forward<Args>(args)...);
         p.t_ = nullptr;
     }
 
     handler_storage(handler_storage&& other) noexcept
-      : handler_{std::move(other.handler_)}
+      : frame_{other.frame_}
     {
-        wrapper_ = other.wrapper_;
-        other.wrapper_ = nullptr;
+        other.frame_ = nullptr;
     }
 
     handler_storage(handler_storage const&) = delete;
@@ -99,52 +260,117 @@ public:
         if (has_value())
         {
             allocator_type alloc{boost::asio::get_associated_allocator(
-              handler_, default_allocator{})};
-            deleter<allocator_type>{alloc}(wrapper_);
+              frame_->handler_, default_allocator{})};
+            deleter_type{alloc}(frame_);
         }
     }
 
     Handler& handler()
     {
-        return handler_;
+        return frame_->handler_;
     }
 
     Handler const& handler() const
     {
-        return handler_;
+        return frame_->handler_;
     }
 
     T& value()
     {
-        return wrapper_->t_;
+        return frame_->t_;
     }
 
     T const& value() const
     {
-        return wrapper_->t_;
+        return frame_->t_;
     }
 
     bool has_value() const noexcept
     {
-        return wrapper_ != nullptr;
+        return frame_ != nullptr;
+    }
+
+#ifdef COMPOSE_ENABLE_OPERATION_TRACKING
+    template<typename Executor>
+    void track(Executor const& ex)
+    {
+        frame_->tracking_.attach(ex, typeid(T), sizeof(frame_type));
     }
 
+    tracked_frame* tracking() noexcept
+    {
+        return frame_ != nullptr ? &frame_->tracking_ : nullptr;
+    }
+#endif // COMPOSE_ENABLE_OPERATION_TRACKING
+
     template<typename... Args>
     auto release_bind(Args&&... args)
       -> bound_front_op<Handler, typename std::decay<Args>::type...>
     {
-        allocator_type alloc{
-          boost::asio::get_associated_allocator(handler_, default_allocator{})};
+        allocator_type alloc{boost::asio::get_associated_allocator(
+          frame_->handler_, default_allocator{})};
 
-        auto const del = deleter<allocator_type>{alloc};
-        detail::lean_ptr<wrapper, decltype(del)> p{wrapper_, del};
-        wrapper_ = nullptr;
-        return {std::move(handler_), {std::forward<Args>(args)...}};
+        detail::lean_ptr<frame_type, deleter_type> p{frame_,
+                                                     deleter_type{alloc}};
+        frame_ = nullptr;
+        return {std::move(p.t_->handler_), {std::forward<Args>(args)...}};
+    }
+
+    // The frame is destroyed, but its memory is kept by the returned upcall,
+    // so that the executor can reuse it for the posted operation.
+    template<typename... Args>
+    auto release_posted(Args&&... args) -> recycled_upcall<
+      bound_front_op<Handler, typename std::decay<Args>::type...>,
+      allocator_type>
+    {
+        return recycle(
+          [&](frame_type& frame) {
+              return bound_front_op<Handler,
+                                    typename std::decay<Args>::type...>{
+                std::move(frame.handler_), {std::forward<Args>(args)...}};
+          });
+    }
+
+    template<typename... Args>
+    auto release_node(Args&&... args) -> recycled_upcall<
+      posted_upcall<Handler, typename std::decay<Args>::type...>,
+      allocator_type>
+    {
+        return recycle([&](frame_type& frame) {
+            return posted_upcall<Handler, typename std::decay<Args>::type...>::
+              create(std::move(frame.handler_), std::forward<Args>(args)...);
+        });
+    }
+
+    // The arguments may refer to the frame, so they are moved out of it
+    // before it is released, see COMPOSE_INPLACE_UPCALL_THRESHOLD.
+    template<typename... Args>
+    void invoke_inplace(Args&&... args)
+    {
+        release_bind(std::forward<Args>(args)...)();
     }
 
 private:
-    Handler handler_;
-    wrapper* wrapper_;
+    template<typename F>
+    auto recycle(F&& f)
+      -> recycled_upcall<decltype(f(std::declval<frame_type&>())),
+                         allocator_type>
+    {
+        allocator_type alloc{boost::asio::get_associated_allocator(
+          frame_->handler_, default_allocator{})};
+
+        detail::lean_ptr<frame_type, deleter_type> p{frame_,
+                                                     deleter_type{alloc}};
+        frame_ = nullptr;
+        auto op = f(*p.t_);
+        p.t_->~frame_type();
+        void* const block = p.t_;
+        p.t_ = nullptr;
+        return {std::move(op),
+                frame_block<allocator_type>{block, frame_units<frame_type>()}};
+    }
+
+    frame_type* frame_;
 };
 
 } // namespace detail
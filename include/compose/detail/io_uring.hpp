@@ -0,0 +1,278 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_IO_URING_HPP
+#define COMPOSE_DETAIL_IO_URING_HPP
+
+#if defined(__linux__) && !defined(COMPOSE_NO_IO_URING) &&                    \
+  defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define COMPOSE_HAS_IO_URING
+#endif
+#endif
+
+#ifdef COMPOSE_HAS_IO_URING
+
+#include <boost/system/error_code.hpp>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace compose
+{
+namespace detail
+{
+
+/**
+ * A thin wrapper over the submission and completion rings of an io_uring
+ * instance, set up with raw system calls. Prepared submission queue entries
+ * are only made visible to the kernel by submit(), so that all entries
+ * prepared in between are submitted with a single io_uring_enter.
+ *
+ * @remark Not thread-safe.
+ */
+class io_uring_ring
+{
+public:
+    io_uring_ring(unsigned entries, boost::system::error_code& ec) noexcept
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd_ = static_cast<int>(
+          ::syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0)
+        {
+            fail(ec);
+            return;
+        }
+
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ =
+          params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+        sq_ptr_ = map(sq_size_, IORING_OFF_SQ_RING);
+        cq_ptr_ = map(cq_size_, IORING_OFF_CQ_RING);
+        auto const sqes = map(sqes_size_, IORING_OFF_SQES);
+        if (sq_ptr_ == MAP_FAILED || cq_ptr_ == MAP_FAILED ||
+            sqes == MAP_FAILED)
+        {
+            ec.assign(errno, boost::system::system_category());
+            if (sqes != MAP_FAILED)
+                ::munmap(sqes, sqes_size_);
+            close();
+            return;
+        }
+
+        auto const sq = static_cast<char*>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sq_entries_ = params.sq_entries;
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+        sqe_tail_ = *sq_tail_;
+
+        auto const cq = static_cast<char*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        ec = {};
+    }
+
+    io_uring_ring(io_uring_ring const&) = delete;
+    io_uring_ring& operator=(io_uring_ring const&) = delete;
+
+    ~io_uring_ring()
+    {
+        close();
+    }
+
+    bool is_open() const noexcept
+    {
+        return fd_ >= 0;
+    }
+
+    /**
+     * Returns a zeroed submission queue entry, or nullptr if the submission
+     * queue is full.
+     */
+    io_uring_sqe* get_sqe() noexcept
+    {
+        auto const head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sqe_tail_ - head >= sq_entries_)
+            return nullptr;
+
+        auto const index = sqe_tail_ & sq_mask_;
+        sq_array_[index] = index;
+        ++sqe_tail_;
+        auto const sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    /**
+     * Number of prepared entries, which the kernel did not consume yet.
+     */
+    unsigned prepared() const noexcept
+    {
+        return sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    }
+
+    /**
+     * Submits all prepared entries. Entries the kernel does not consume in
+     * one io_uring_enter, e.g. after a failed entry, are submitted again. If
+     * the kernel refuses to consume more entries, the rest remains prepared
+     * and may be submitted again, or dropped with discard().
+     */
+    void submit(boost::system::error_code& ec) noexcept
+    {
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+        ec = {};
+        for (auto count = prepared(); count > 0; count = prepared())
+        {
+            auto const consumed =
+              ::syscall(__NR_io_uring_enter, fd_, count, 0u, 0u, nullptr, 0u);
+            if (consumed < 0 && errno == EINTR)
+                continue;
+            if (consumed < 0)
+                return fail(ec);
+            if (consumed == 0)
+            {
+                ec.assign(EAGAIN, boost::system::system_category());
+                return;
+            }
+        }
+    }
+
+    /**
+     * Invokes f(user_data) for each prepared entry, which the kernel did not
+     * consume, and removes them from the submission queue.
+     */
+    template<typename F>
+    void discard(F&& f)
+    {
+        // Without SQPOLL, the kernel only reads the tail in io_uring_enter.
+        auto const head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        for (auto i = head; i != sqe_tail_; ++i)
+            f(sqes_[sq_array_[i & sq_mask_]].user_data);
+        sqe_tail_ = head;
+        __atomic_store_n(sq_tail_, head, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * Blocks until at least min_complete completion queue entries are
+     * available.
+     */
+    void wait(unsigned min_complete, boost::system::error_code& ec) noexcept
+    {
+        ec = {};
+        if (::syscall(__NR_io_uring_enter,
+                      fd_,
+                      0u,
+                      min_complete,
+                      IORING_ENTER_GETEVENTS,
+                      nullptr,
+                      0u) < 0)
+            fail(ec);
+    }
+
+    /**
+     * Invokes f(user_data, result) for each available completion queue entry.
+     */
+    template<typename F>
+    void reap(F&& f)
+    {
+        auto head = *cq_head_;
+        auto const tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            auto const& cqe = cqes_[head & cq_mask_];
+            f(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * Makes the kernel signal the eventfd efd whenever a completion is posted.
+     */
+    void register_eventfd(int efd, boost::system::error_code& ec) noexcept
+    {
+        ec = {};
+        if (::syscall(
+              __NR_io_uring_register, fd_, IORING_REGISTER_EVENTFD, &efd, 1) <
+            0)
+            fail(ec);
+    }
+
+private:
+    void* map(std::size_t size, off_t offset) noexcept
+    {
+        return ::mmap(nullptr,
+                      size,
+                      PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE,
+                      fd_,
+                      offset);
+    }
+
+    void fail(boost::system::error_code& ec) noexcept
+    {
+        ec.assign(errno, boost::system::system_category());
+    }
+
+    void close() noexcept
+    {
+        if (sqes_ != nullptr)
+            ::munmap(sqes_, sqes_size_);
+        if (cq_ptr_ != nullptr && cq_ptr_ != MAP_FAILED)
+            ::munmap(cq_ptr_, cq_size_);
+        if (sq_ptr_ != nullptr && sq_ptr_ != MAP_FAILED)
+            ::munmap(sq_ptr_, sq_size_);
+        if (fd_ >= 0)
+            ::close(fd_);
+        sqes_ = nullptr;
+        cq_ptr_ = nullptr;
+        sq_ptr_ = nullptr;
+        fd_ = -1;
+    }
+
+    int fd_ = -1;
+    void* sq_ptr_ = nullptr;
+    void* cq_ptr_ = nullptr;
+    std::size_t sq_size_ = 0;
+    std::size_t cq_size_ = 0;
+    std::size_t sqes_size_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sqe_tail_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_HAS_IO_URING
+
+#endif // COMPOSE_DETAIL_IO_URING_HPP
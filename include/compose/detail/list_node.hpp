@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_LIST_NODE_HPP
+#define COMPOSE_DETAIL_LIST_NODE_HPP
+
+namespace compose
+{
+namespace detail
+{
+
+/**
+ * A node of a circular, doubly-linked intrusive list. A node that is not part
+ * of a list points to itself, which allows a node to be unlinked without
+ * knowing which list it belongs to.
+ */
+struct list_node
+{
+    list_node() noexcept = default;
+
+    list_node(list_node const&) = delete;
+    list_node& operator=(list_node const&) = delete;
+
+    bool is_linked() const noexcept
+    {
+        return next_ != this;
+    }
+
+    void link_before(list_node& pos) noexcept
+    {
+        prev_ = pos.prev_;
+        next_ = &pos;
+        pos.prev_->next_ = this;
+        pos.prev_ = this;
+    }
+
+    void unlink() noexcept
+    {
+        prev_->next_ = next_;
+        next_->prev_ = prev_;
+        prev_ = this;
+        next_ = this;
+    }
+
+    /**
+     * Moves all nodes of the list headed by other to the end of the list
+     * headed by this node.
+     */
+    void splice(list_node& other) noexcept
+    {
+        if (!other.is_linked())
+            return;
+
+        other.next_->prev_ = prev_;
+        prev_->next_ = other.next_;
+        other.prev_->next_ = this;
+        prev_ = other.prev_;
+        other.prev_ = &other;
+        other.next_ = &other;
+    }
+
+    list_node* prev_ = this;
+    list_node* next_ = this;
+};
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_LIST_NODE_HPP
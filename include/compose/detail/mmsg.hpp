@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_MMSG_HPP
+#define COMPOSE_DETAIL_MMSG_HPP
+
+#include <boost/system/error_code.hpp>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <cerrno>
+#include <cstddef>
+
+namespace compose
+{
+namespace detail
+{
+
+// Maximal number of buffers or messages passed to one system call.
+constexpr std::size_t mmsg_chunk = 64;
+
+#ifdef MSG_NOSIGNAL
+constexpr int mmsg_send_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+constexpr int mmsg_send_flags = MSG_DONTWAIT;
+#endif // MSG_NOSIGNAL
+
+#ifdef __linux__
+using message_header = ::mmsghdr;
+#else
+struct message_header
+{
+    msghdr msg_hdr;
+    unsigned msg_len;
+};
+#endif // __linux__
+
+inline bool
+would_block(int error) noexcept
+{
+    return error == EAGAIN || error == EWOULDBLOCK;
+}
+
+inline boost::system::error_code
+last_error() noexcept
+{
+    return {errno, boost::system::system_category()};
+}
+
+// Sends each iovec as a separate message. Returns the number of messages
+// sent, or -1 if the first one could not be sent.
+inline int
+send_messages(int fd, iovec* iov, std::size_t count) noexcept
+{
+    message_header msgs[mmsg_chunk];
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        msgs[i] = message_header{};
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+#ifdef __linux__
+    return ::sendmmsg(fd, msgs, static_cast<unsigned>(count), mmsg_send_flags);
+#else
+    int sent = 0;
+    for (std::size_t i = 0; i < count; ++i, ++sent)
+    {
+        if (::sendmsg(fd, &msgs[i].msg_hdr, mmsg_send_flags) < 0)
+            return sent > 0 ? sent : -1;
+    }
+    return sent;
+#endif // __linux__
+}
+
+// Receives up to count messages without blocking. Returns the number of
+// messages received, or -1 if none could be received.
+inline int
+receive_messages(int fd, message_header* msgs, std::size_t count) noexcept
+{
+#ifdef __linux__
+    return ::recvmmsg(
+      fd, msgs, static_cast<unsigned>(count), MSG_DONTWAIT, nullptr);
+#else
+    int received = 0;
+    for (std::size_t i = 0; i < count; ++i, ++received)
+    {
+        auto const n = ::recvmsg(fd, &msgs[i].msg_hdr, MSG_DONTWAIT);
+        if (n < 0)
+            return received > 0 ? received : -1;
+        msgs[i].msg_len = static_cast<unsigned>(n);
+    }
+    return received;
+#endif // __linux__
+}
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_MMSG_HPP
@@ -0,0 +1,158 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_MONOTONIC_ARENA_HPP
+#define COMPOSE_DETAIL_MONOTONIC_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace compose
+{
+namespace detail
+{
+
+/**
+ * Bump allocator over a fixed buffer. Memory is reclaimed when the most
+ * recently allocated block is deallocated, which covers the common pattern of
+ * an OperationBody repeatedly initiating a single child operation.
+ *
+ * A few blocks deallocated out of order are remembered. They are reused by
+ * allocations of the same size and reclaimed once the blocks above them are.
+ * This covers a child which posts its upcall in a node allocated above its
+ * frame, see COMPOSE_INPLACE_UPCALL_THRESHOLD.
+ */
+class arena_resource
+{
+public:
+    arena_resource(unsigned char* buffer, std::size_t size) noexcept
+      : begin_{buffer}
+      , top_{buffer}
+      , end_{buffer + size}
+    {
+    }
+
+    arena_resource(arena_resource const&) = delete;
+    arena_resource& operator=(arena_resource const&) = delete;
+
+    void* allocate(std::size_t size, std::size_t alignment) noexcept
+    {
+        for (std::size_t i = 0; i < freed_count_; ++i)
+        {
+            auto const p = freed_[i].data_;
+            if (freed_[i].size_ == size &&
+                reinterpret_cast<std::uintptr_t>(p) % alignment == 0)
+            {
+                freed_[i] = freed_[--freed_count_];
+                return p;
+            }
+        }
+
+        auto const top = reinterpret_cast<std::uintptr_t>(top_);
+        auto const aligned = (top + alignment - 1) & ~(alignment - 1);
+        auto const padding = aligned - top;
+        if (padding > static_cast<std::size_t>(end_ - top_) ||
+            size > static_cast<std::size_t>(end_ - top_) - padding)
+            return nullptr;
+
+        auto const p = top_ + padding;
+        top_ = p + size;
+        return p;
+    }
+
+    /**
+     * Returns false if p was not allocated from this arena.
+     */
+    bool deallocate(void* p, std::size_t size) noexcept
+    {
+        auto const block = static_cast<unsigned char*>(p);
+        if (std::less<unsigned char*>{}(block, begin_) ||
+            !std::less<unsigned char*>{}(block, end_))
+            return false;
+
+        if (block + size != top_)
+        {
+            // Lost until reset() if too many blocks are freed out of order.
+            if (freed_count_ < max_freed)
+                freed_[freed_count_++] = freed_block{block, size};
+            return true;
+        }
+
+        top_ = block;
+        for (std::size_t i = 0; i < freed_count_;)
+        {
+            if (freed_[i].data_ + freed_[i].size_ != top_)
+            {
+                ++i;
+                continue;
+            }
+
+            top_ = freed_[i].data_;
+            freed_[i] = freed_[--freed_count_];
+            i = 0;
+        }
+        return true;
+    }
+
+    void reset() noexcept
+    {
+        top_ = begin_;
+        freed_count_ = 0;
+    }
+
+    std::size_t used() const noexcept
+    {
+        return static_cast<std::size_t>(top_ - begin_);
+    }
+
+private:
+    static constexpr std::size_t max_freed = 4;
+
+    struct freed_block
+    {
+        unsigned char* data_;
+        std::size_t size_;
+    };
+
+    unsigned char* begin_;
+    unsigned char* top_;
+    unsigned char* end_;
+    freed_block freed_[max_freed];
+    std::size_t freed_count_ = 0;
+};
+
+template<std::size_t Size>
+struct arena_buffer
+{
+    alignas(std::max_align_t) unsigned char buffer_[Size];
+};
+
+template<std::size_t Size>
+class monotonic_arena
+  : private arena_buffer<Size>
+  , public arena_resource
+{
+public:
+    monotonic_arena() noexcept
+      : arena_resource{this->buffer_, Size}
+    {
+    }
+
+    // Copies start with an empty arena, blocks are never shared.
+    monotonic_arena(monotonic_arena const&) noexcept
+      : monotonic_arena{}
+    {
+    }
+};
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_MONOTONIC_ARENA_HPP
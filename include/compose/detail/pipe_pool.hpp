@@ -0,0 +1,151 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_PIPE_POOL_HPP
+#define COMPOSE_DETAIL_PIPE_POOL_HPP
+
+#include <boost/system/error_code.hpp>
+
+#include <cerrno>
+#include <cstddef>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Maximal number of idle pipes cached by each thread.
+#ifndef COMPOSE_PIPE_POOL_CACHE
+#define COMPOSE_PIPE_POOL_CACHE 8
+#endif // COMPOSE_PIPE_POOL_CACHE
+
+namespace compose
+{
+namespace detail
+{
+
+struct pipe_fds
+{
+    int read_end;
+    int write_end;
+};
+
+inline void
+close_pipe(pipe_fds fds) noexcept
+{
+    ::close(fds.read_end);
+    ::close(fds.write_end);
+}
+
+/**
+ * A per-thread cache of empty, non-blocking pipes, used by composed
+ * operations which move data between descriptors with splice.
+ */
+class pipe_pool
+{
+public:
+    pipe_pool() = default;
+    pipe_pool(pipe_pool const&) = delete;
+    pipe_pool& operator=(pipe_pool const&) = delete;
+
+    ~pipe_pool()
+    {
+        while (size_ > 0)
+            close_pipe(free_[--size_]);
+    }
+
+    static pipe_pool& local() noexcept
+    {
+        static thread_local pipe_pool pool;
+        return pool;
+    }
+
+    pipe_fds acquire(boost::system::error_code& ec) noexcept
+    {
+        if (size_ > 0)
+            return free_[--size_];
+
+        int fds[2] = {-1, -1};
+        if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0)
+            ec = {errno, boost::system::system_category()};
+        return {fds[0], fds[1]};
+    }
+
+    // The pipe must be empty.
+    void release(pipe_fds fds) noexcept
+    {
+        if (size_ < COMPOSE_PIPE_POOL_CACHE)
+            free_[size_++] = fds;
+        else
+            close_pipe(fds);
+    }
+
+private:
+    pipe_fds free_[COMPOSE_PIPE_POOL_CACHE];
+    std::size_t size_ = 0;
+};
+
+// An owning handle to a pipe from the current thread's pool, which keeps
+// track of the number of bytes buffered in it. A pipe which still holds data
+// is closed instead of being returned to the pool.
+class pooled_pipe
+{
+public:
+    pooled_pipe() = default;
+    pooled_pipe(pooled_pipe const&) = delete;
+    pooled_pipe& operator=(pooled_pipe const&) = delete;
+
+    ~pooled_pipe()
+    {
+        if (fds_.read_end < 0)
+            return;
+        if (size_ == 0)
+            pipe_pool::local().release(fds_);
+        else
+            close_pipe(fds_);
+    }
+
+    void open(boost::system::error_code& ec) noexcept
+    {
+        fds_ = pipe_pool::local().acquire(ec);
+    }
+
+    int read_end() const noexcept
+    {
+        return fds_.read_end;
+    }
+
+    int write_end() const noexcept
+    {
+        return fds_.write_end;
+    }
+
+    // Number of bytes written to the pipe and not read yet.
+    std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    void filled(std::size_t n) noexcept
+    {
+        size_ += n;
+    }
+
+    void drained(std::size_t n) noexcept
+    {
+        size_ -= n;
+    }
+
+private:
+    pipe_fds fds_{-1, -1};
+    std::size_t size_ = 0;
+};
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_PIPE_POOL_HPP
@@ -0,0 +1,293 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_RECYCLED_UPCALL_HPP
+#define COMPOSE_DETAIL_RECYCLED_UPCALL_HPP
+
+#include <compose/detail/allocator_utils.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Minimum number of bytes, besides the CompletionHandler, in the frame of a
+// stable operation whose OperationBody does not declare an upcall_signature. A
+// posted upcall reuses the memory of the frame when the executor's operation
+// fits, a reserve leaves room for the upcall arguments and the bookkeeping of
+// the executor. By default frames are not enlarged.
+#ifndef COMPOSE_UPCALL_RESERVE
+#define COMPOSE_UPCALL_RESERVE 0
+#endif // COMPOSE_UPCALL_RESERVE
+
+namespace compose
+{
+namespace detail
+{
+
+/**
+ * The unit in which stable frames are allocated. Allocating a frame as an
+ * array of units, instead of as an object of its own type, keeps the
+ * Allocator, and therefore the type of the posted upcall, independent of the
+ * OperationBody, so that operations with the same CompletionHandler share the
+ * instantiations of the executor's machinery.
+ */
+struct alignas(alignof(std::max_align_t)) frame_unit
+{
+    unsigned char data_[alignof(std::max_align_t)];
+};
+
+template<class T>
+constexpr std::size_t
+frame_units() noexcept
+{
+    return (sizeof(T) + sizeof(frame_unit) - 1) / sizeof(frame_unit);
+}
+
+/**
+ * The memory block of a destroyed stable frame, shared by the posted upcall
+ * and at most one allocation served from it. The last byte of the block holds
+ * the owner bits, the block is deallocated with UnitAllocator once both
+ * owners release it.
+ */
+template<class UnitAllocator>
+struct frame_block
+{
+    static constexpr unsigned char upcall_owner = 1;
+    static constexpr unsigned char allocation_owner = 2;
+
+    std::size_t capacity() const noexcept
+    {
+        return units_ * sizeof(frame_unit) - 1;
+    }
+
+    unsigned char& owners() const noexcept
+    {
+        return static_cast<unsigned char*>(data_)[capacity()];
+    }
+
+    template<class T>
+    bool fits(std::size_t n) const noexcept
+    {
+        return data_ != nullptr && alignof(T) <= alignof(frame_unit) &&
+               n <= capacity() / sizeof(T) && owners() == upcall_owner;
+    }
+
+    void release(unsigned char owner, UnitAllocator alloc) const noexcept
+    {
+        if ((owners() &= ~owner) == 0)
+            std::allocator_traits<UnitAllocator>::deallocate(
+              alloc, static_cast<frame_unit*>(data_), units_);
+    }
+
+    void* data_;
+    std::size_t units_;
+};
+
+/**
+ * The Allocator associated with a recycled_upcall. Serves one allocation from
+ * the frame block, if it fits and the block is still owned by the upcall, and
+ * forwards the rest to the Allocator of the frame.
+ */
+template<class T, class UnitAllocator>
+class frame_block_allocator
+{
+    using block_type = frame_block<UnitAllocator>;
+
+    template<class U>
+    using upstream_t = typename std::allocator_traits<
+      UnitAllocator>::template rebind_alloc<U>;
+
+public:
+    using value_type = T;
+
+    frame_block_allocator(block_type block,
+                          UnitAllocator const& upstream) noexcept
+      : block_{block}
+      , upstream_{upstream}
+    {
+    }
+
+    template<class U>
+    frame_block_allocator(
+      frame_block_allocator<U, UnitAllocator> const& other) noexcept
+      : block_{other.block()}
+      , upstream_{other.upstream()}
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        if (block_.template fits<T>(n))
+        {
+            block_.owners() |= block_type::allocation_owner;
+            return static_cast<T*>(block_.data_);
+        }
+
+        upstream_t<T> alloc{upstream_};
+        return std::allocator_traits<upstream_t<T>>::allocate(alloc, n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        if (p == block_.data_)
+            return block_.release(block_type::allocation_owner, upstream_);
+
+        upstream_t<T> alloc{upstream_};
+        std::allocator_traits<upstream_t<T>>::deallocate(alloc, p, n);
+    }
+
+    block_type block() const noexcept
+    {
+        return block_;
+    }
+
+    UnitAllocator const& upstream() const noexcept
+    {
+        return upstream_;
+    }
+
+private:
+    block_type block_;
+    UnitAllocator upstream_;
+};
+
+template<class T, class U, class UnitAllocator>
+bool
+operator==(frame_block_allocator<T, UnitAllocator> const& lhs,
+           frame_block_allocator<U, UnitAllocator> const& rhs) noexcept
+{
+    return lhs.block().data_ == rhs.block().data_;
+}
+
+template<class T, class U, class UnitAllocator>
+bool
+operator!=(frame_block_allocator<T, UnitAllocator> const& lhs,
+           frame_block_allocator<U, UnitAllocator> const& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+/**
+ * A posted upcall which owns the memory of the frame it was released from.
+ * The executor may allocate its operation in that memory through the
+ * associated Allocator. The block is released before the wrapped upcall is
+ * invoked, so that the memory can be reused by the CompletionHandler.
+ */
+template<class Op, class UnitAllocator>
+class recycled_upcall
+{
+    using block_type = frame_block<UnitAllocator>;
+
+public:
+    recycled_upcall(Op&& op, block_type block) noexcept
+      : op_{std::move(op)}
+      , block_{block}
+    {
+        block_.owners() = block_type::upcall_owner;
+    }
+
+    recycled_upcall(recycled_upcall&& other) noexcept
+      : op_{std::move(other.op_)}
+      , block_{other.block_}
+    {
+        other.block_.data_ = nullptr;
+    }
+
+    recycled_upcall(recycled_upcall const&) = delete;
+    recycled_upcall& operator=(recycled_upcall&&) = delete;
+    recycled_upcall& operator=(recycled_upcall const&) = delete;
+
+    ~recycled_upcall()
+    {
+        release();
+    }
+
+    void operator()()
+    {
+        release();
+        op_();
+    }
+
+    Op const& operation() const noexcept
+    {
+        return op_;
+    }
+
+    block_type block() const noexcept
+    {
+        return block_;
+    }
+
+private:
+    void release() noexcept
+    {
+        if (block_.data_ != nullptr)
+        {
+            block_.release(block_type::upcall_owner,
+                           UnitAllocator{boost::asio::get_associated_allocator(
+                             op_, default_allocator{})});
+            block_.data_ = nullptr;
+        }
+    }
+
+    Op op_;
+    block_type block_;
+};
+
+} // namespace detail
+} // namespace compose
+
+namespace boost
+{
+namespace asio
+{
+
+template<class Op, class UnitAllocator, class Ex>
+class associated_executor<
+  ::compose::detail::recycled_upcall<Op, UnitAllocator>,
+  Ex>
+{
+public:
+    using type = associated_executor_t<Op, Ex>;
+
+    static type get(
+      ::compose::detail::recycled_upcall<Op, UnitAllocator> const& upcall,
+      Ex const& ex = Ex{})
+    {
+        return associated_executor<Op, Ex>::get(upcall.operation(), ex);
+    }
+};
+
+template<class Op, class UnitAllocator, class A>
+class associated_allocator<
+  ::compose::detail::recycled_upcall<Op, UnitAllocator>,
+  A>
+{
+public:
+    using type =
+      ::compose::detail::frame_block_allocator<void, UnitAllocator>;
+
+    static type get(
+      ::compose::detail::recycled_upcall<Op, UnitAllocator> const& upcall,
+      A const& = A{})
+    {
+        using ::compose::detail::default_allocator;
+        return type{upcall.block(),
+                    UnitAllocator{get_associated_allocator(
+                      upcall.operation(), default_allocator{})}};
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#endif // COMPOSE_DETAIL_RECYCLED_UPCALL_HPP
@@ -0,0 +1,211 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_SEQUENCE_OPERATION_HPP
+#define COMPOSE_DETAIL_SEQUENCE_OPERATION_HPP
+
+#include <compose/detail/lean_tuple.hpp>
+#include <compose/yield_token.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+
+#include <type_traits>
+#include <utility>
+
+namespace compose
+{
+namespace detail
+{
+
+template<std::size_t I>
+struct sequence_index
+{
+};
+
+/**
+ * The ComposedOperation seen by the I-th OperationBody of a sequence. Resumes
+ * that body directly and turns its upcall into the start of the next body.
+ */
+template<class ComposedOp, std::size_t I, std::size_t N>
+class sequence_step
+{
+public:
+    explicit sequence_step(ComposedOp&& op)
+      : op_{std::move(op)}
+    {
+    }
+
+    explicit sequence_step(yield_token<sequence_step> const& token)
+      : sequence_step{token.release_operation()}
+    {
+    }
+
+    template<class... Args>
+    void operator()(Args&&... args)
+    {
+        op_(sequence_index<I>{}, std::forward<Args>(args)...);
+    }
+
+    template<class... Args>
+    void run(Args&&... args)
+    {
+        op_.run(sequence_index<I>{}, std::forward<Args>(args)...);
+    }
+
+    template<class... Args>
+    void post_upcall(Args&&... args)
+    {
+        post_upcall(std::integral_constant<bool, I + 1 == N>{},
+                    std::forward<Args>(args)...);
+    }
+
+    template<class... Args>
+    void direct_upcall(Args&&... args)
+    {
+        direct_upcall(std::integral_constant<bool, I + 1 == N>{},
+                      std::forward<Args>(args)...);
+    }
+
+    template<class H, class E>
+    friend class boost::asio::associated_executor;
+
+    template<class H, class A>
+    friend class boost::asio::associated_allocator;
+
+private:
+    template<class... Args>
+    void post_upcall(std::true_type, Args&&... args)
+    {
+        op_.post_upcall(std::forward<Args>(args)...);
+    }
+
+    template<class... Args>
+    void post_upcall(std::false_type, Args&&... args)
+    {
+        op_.run(sequence_index<I + 1>{}, std::forward<Args>(args)...);
+    }
+
+    template<class... Args>
+    void direct_upcall(std::true_type, Args&&... args)
+    {
+        op_.direct_upcall(std::forward<Args>(args)...);
+    }
+
+    template<class... Args>
+    void direct_upcall(std::false_type, Args&&... args)
+    {
+        op_(sequence_index<I + 1>{}, std::forward<Args>(args)...);
+    }
+
+    ComposedOp op_;
+};
+
+template<class OperationBody>
+struct sequence_element
+{
+    template<class... Args>
+    sequence_element(lean_tuple<Args...>&& args)
+      : sequence_element{std::move(args),
+                         boost::mp11::index_sequence_for<Args...>{}}
+    {
+    }
+
+    template<class... Args, std::size_t... Is>
+    sequence_element(lean_tuple<Args...>&& args,
+                     boost::mp11::index_sequence<Is...>)
+      : body_{detail::get<Is>(std::move(args))...}
+    {
+    }
+
+    OperationBody body_;
+};
+
+/**
+ * An OperationBody which runs a sequence of OperationBodies, stored in a single
+ * frame, one after another. The arguments of the upcall performed by each body
+ * are passed to the initiation of the next one. The upcall of the last body
+ * is the upcall of the whole sequence.
+ */
+template<class... OperationBodies>
+class sequence_body
+{
+    static constexpr std::size_t size = sizeof...(OperationBodies);
+
+public:
+    template<class... Tuples>
+    explicit sequence_body(Tuples&&... tuples)
+      : elements_{std::forward<Tuples>(tuples)...}
+    {
+    }
+
+    template<class Self, class... Args>
+    upcall_guard operator()(yield_token<Self> yield, Args&&... args)
+    {
+        return (*this)(yield, sequence_index<0>{}, std::forward<Args>(args)...);
+    }
+
+    template<class Self, std::size_t I, class... Args>
+    upcall_guard operator()(yield_token<Self> yield,
+                            sequence_index<I>,
+                            Args&&... args)
+    {
+        sequence_step<Self, I, size> step{yield.release_operation()};
+        return detail::get<I>(elements_).body_(
+          yield_token<sequence_step<Self, I, size>>{step,
+                                                    yield.is_continuation()},
+          std::forward<Args>(args)...);
+    }
+
+private:
+    lean_tuple<sequence_element<OperationBodies>...> elements_;
+};
+
+} // namespace detail
+} // namespace compose
+
+namespace boost
+{
+namespace asio
+{
+
+template<class ComposedOp, std::size_t I, std::size_t N, class Ex>
+class associated_executor<::compose::detail::sequence_step<ComposedOp, I, N>,
+                          Ex>
+{
+public:
+    using type = associated_executor_t<ComposedOp, Ex>;
+
+    static type get(
+      ::compose::detail::sequence_step<ComposedOp, I, N> const& step,
+      Ex const& ex = Ex{})
+    {
+        return associated_executor<ComposedOp, Ex>::get(step.op_, ex);
+    }
+};
+
+template<class ComposedOp, std::size_t I, std::size_t N, class A>
+class associated_allocator<::compose::detail::sequence_step<ComposedOp, I, N>,
+                           A>
+{
+public:
+    using type = associated_allocator_t<ComposedOp, A>;
+
+    static type get(
+      ::compose::detail::sequence_step<ComposedOp, I, N> const& step,
+      A const& alloc = A{})
+    {
+        return associated_allocator<ComposedOp, A>::get(step.op_, alloc);
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#endif // COMPOSE_DETAIL_SEQUENCE_OPERATION_HPP
@@ -0,0 +1,201 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_SLOT_BLOCK_HPP
+#define COMPOSE_DETAIL_SLOT_BLOCK_HPP
+
+#include <compose/detail/allocator_utils.hpp>
+#include <compose/detail/lean_ptr.hpp>
+#include <compose/detail/monotonic_arena.hpp>
+
+#include <memory>
+#include <new>
+
+namespace compose
+{
+namespace detail
+{
+
+/**
+ * A fixed array of arenas, one per concurrently running child operation. The
+ * block is reference counted by its owner and by every allocation made from
+ * it, so it outlives memory that the execution context deallocates after
+ * destroying the last child handler.
+ */
+template<class Upstream, std::size_t SlotSize>
+class slot_block
+{
+public:
+    using arena_type = monotonic_arena<SlotSize>;
+
+    static slot_block* create(Upstream const& upstream, std::size_t count)
+    {
+        using block_alloc_t = typename std::allocator_traits<
+          Upstream>::template rebind_alloc<slot_block>;
+        using arena_alloc_t = typename std::allocator_traits<
+          Upstream>::template rebind_alloc<arena_type>;
+
+        block_alloc_t block_alloc{upstream};
+        detail::lean_ptr<slot_block, deallocator<block_alloc_t>> p{
+          std::allocator_traits<block_alloc_t>::allocate(block_alloc, 1),
+          deallocator<block_alloc_t>{block_alloc}};
+
+        arena_alloc_t arena_alloc{upstream};
+        auto const slots =
+          std::allocator_traits<arena_alloc_t>::allocate(arena_alloc, count);
+        for (std::size_t i = 0; i < count; ++i)
+            ::new (static_cast<void*>(slots + i)) arena_type{};
+
+        ::new (static_cast<void*>(p.t_)) slot_block{upstream, slots, count};
+        auto const block = p.t_;
+        p.t_ = nullptr;
+        return block;
+    }
+
+    slot_block(slot_block const&) = delete;
+    slot_block& operator=(slot_block const&) = delete;
+
+    arena_type& slot(std::size_t i) noexcept
+    {
+        return slots_[i];
+    }
+
+    Upstream const& upstream() const noexcept
+    {
+        return upstream_;
+    }
+
+    void add_ref() noexcept
+    {
+        ++refs_;
+    }
+
+    void release() noexcept
+    {
+        if (--refs_ == 0)
+            destroy();
+    }
+
+private:
+    slot_block(Upstream const& upstream,
+               arena_type* slots,
+               std::size_t count) noexcept
+      : upstream_{upstream}
+      , slots_{slots}
+      , count_{count}
+    {
+    }
+
+    void destroy() noexcept
+    {
+        using block_alloc_t = typename std::allocator_traits<
+          Upstream>::template rebind_alloc<slot_block>;
+        using arena_alloc_t = typename std::allocator_traits<
+          Upstream>::template rebind_alloc<arena_type>;
+
+        block_alloc_t block_alloc{upstream_};
+        arena_alloc_t arena_alloc{upstream_};
+        auto const slots = slots_;
+        auto const count = count_;
+        this->~slot_block();
+        std::allocator_traits<arena_alloc_t>::deallocate(
+          arena_alloc, slots, count);
+        std::allocator_traits<block_alloc_t>::deallocate(
+          block_alloc, this, 1);
+    }
+
+    Upstream upstream_;
+    arena_type* slots_;
+    std::size_t count_;
+    std::size_t refs_ = 1;
+};
+
+/**
+ * Allocates from a single slot of a slot_block, falling back to the block's
+ * upstream Allocator once the slot is exhausted.
+ */
+template<class T, class Upstream, std::size_t SlotSize>
+class slot_allocator
+{
+public:
+    using value_type = T;
+    using block_type = slot_block<Upstream, SlotSize>;
+
+    template<class U>
+    struct rebind
+    {
+        using other = slot_allocator<U, Upstream, SlotSize>;
+    };
+
+    slot_allocator(block_type& block, std::size_t index) noexcept
+      : block_{&block}
+      , index_{index}
+    {
+    }
+
+    template<class U>
+    slot_allocator(slot_allocator<U, Upstream, SlotSize> const& other) noexcept
+      : block_{other.block_}
+      , index_{other.index_}
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        if (n <= static_cast<std::size_t>(-1) / sizeof(T))
+        {
+            auto const p =
+              block_->slot(index_).allocate(n * sizeof(T), alignof(T));
+            if (p != nullptr)
+            {
+                block_->add_ref();
+                return static_cast<T*>(p);
+            }
+        }
+
+        upstream_alloc_t upstream{block_->upstream()};
+        return std::allocator_traits<upstream_alloc_t>::allocate(upstream, n);
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        if (block_->slot(index_).deallocate(p, n * sizeof(T)))
+            return block_->release();
+
+        upstream_alloc_t upstream{block_->upstream()};
+        std::allocator_traits<upstream_alloc_t>::deallocate(upstream, p, n);
+    }
+
+    friend bool operator==(slot_allocator const& lhs,
+                           slot_allocator const& rhs) noexcept
+    {
+        return lhs.block_ == rhs.block_ && lhs.index_ == rhs.index_;
+    }
+
+    friend bool operator!=(slot_allocator const& lhs,
+                           slot_allocator const& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    template<class U, class UUpstream, std::size_t USlotSize>
+    friend class slot_allocator;
+
+    using upstream_alloc_t =
+      typename std::allocator_traits<Upstream>::template rebind_alloc<T>;
+
+    block_type* block_;
+    std::size_t index_;
+};
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_SLOT_BLOCK_HPP
@@ -0,0 +1,163 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_TAGGED_HANDLER_HPP
+#define COMPOSE_DETAIL_TAGGED_HANDLER_HPP
+
+#include <compose/upcall_guard.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/mp11/algorithm.hpp>
+#include <boost/mp11/list.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+namespace compose
+{
+
+template<typename... Tags>
+struct tag_set;
+
+template<typename ComposedOp>
+class yield_token;
+
+namespace detail
+{
+
+template<class OperationBody, class Handler, class IoExecutor, bool stable>
+class composed_op;
+
+template<class ComposedOp>
+struct operation_body;
+
+template<class OperationBody, class Handler, class IoExecutor, bool stable>
+struct operation_body<
+  composed_op<OperationBody, Handler, IoExecutor, stable>>
+{
+    using type = OperationBody;
+};
+
+template<class Body, class ComposedOp, class Tag, class... Ts>
+using tag_overload_t = decltype(std::declval<Body&>()(
+  std::declval<yield_token<ComposedOp>>(), Tag{}, std::declval<Ts>()...));
+
+template<class TagSet>
+using tag_index_t = typename std::conditional<
+  (boost::mp11::mp_size<TagSet>::value <= 256),
+  std::uint8_t,
+  std::uint16_t>::type;
+
+/**
+ * A CompletionHandler which invokes Handler with a tag of TagSet, selected at
+ * run time, in front of the completion arguments. The type of the tag does
+ * not affect the type of the handler.
+ *
+ * Only the tags whose overload of the OperationBody accepts the completion
+ * arguments are dispatched to, other tags are never bound to an operation
+ * with this completion signature.
+ */
+template<class Handler, class TagSet>
+struct tagged_op
+{
+    template<class... Ts>
+    void operator()(Ts&&... ts)
+    {
+        boost::mp11::mp_with_index<boost::mp11::mp_size<TagSet>::value>(
+          index_, [&](auto i) {
+              using tag = boost::mp11::mp_at_c<TagSet, decltype(i)::value>;
+              this->template invoke<tag>(
+                boost::mp11::mp_valid<tag_overload_t,
+                                      typename operation_body<Handler>::type,
+                                      Handler,
+                                      tag,
+                                      Ts&&...>{},
+                std::forward<Ts>(ts)...);
+          });
+    }
+
+    Handler handler_;
+    tag_index_t<TagSet> index_;
+
+private:
+    template<class Tag, class... Ts>
+    void invoke(std::true_type, Ts&&... ts)
+    {
+        handler_(Tag{}, std::forward<Ts>(ts)...);
+    }
+
+    template<class Tag, class... Ts>
+    void invoke(std::false_type, Ts&&...)
+    {
+        assert(false && "Tag bound to an operation whose completion "
+                        "arguments its overload does not accept.");
+        std::terminate();
+    }
+};
+
+} // namespace detail
+} // namespace compose
+
+namespace boost
+{
+namespace asio
+{
+
+template<class Handler, class TagSet, class Signature>
+class async_result<compose::detail::tagged_op<Handler, TagSet>, Signature>
+{
+public:
+    using return_type = compose::upcall_guard;
+    using completion_handler_type = compose::detail::tagged_op<Handler, TagSet>;
+
+    explicit async_result(completion_handler_type&)
+    {
+    }
+
+    return_type get()
+    {
+        return {};
+    }
+};
+
+template<class Handler, class TagSet, class Ex>
+class associated_executor<::compose::detail::tagged_op<Handler, TagSet>, Ex>
+{
+public:
+    using type = associated_executor_t<Handler, Ex>;
+
+    static type get(::compose::detail::tagged_op<Handler, TagSet> const& op,
+                    Ex const& ex = Ex{})
+    {
+        return asio::get_associated_executor(op.handler_, ex);
+    }
+};
+
+template<class Handler, class TagSet, class A>
+class associated_allocator<::compose::detail::tagged_op<Handler, TagSet>, A>
+{
+public:
+    using type = associated_allocator_t<Handler, A>;
+
+    static type get(::compose::detail::tagged_op<Handler, TagSet> const& op,
+                    A const& alloc = A{})
+    {
+        return asio::get_associated_allocator(op.handler_, alloc);
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#endif // COMPOSE_DETAIL_TAGGED_HANDLER_HPP
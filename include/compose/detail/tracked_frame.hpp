@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_TRACKED_FRAME_HPP
+#define COMPOSE_DETAIL_TRACKED_FRAME_HPP
+
+#include <compose/detail/list_node.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <typeinfo>
+
+namespace compose
+{
+
+class operation_tracker;
+
+namespace detail
+{
+
+/**
+ * Diagnostic state of a single stable frame, linked into the
+ * operation_tracker of the I/O executor's execution context. The atomic
+ * members are written by the thread running the operation and may be read
+ * concurrently by the thread performing a dump.
+ */
+struct tracked_frame : list_node
+{
+    tracked_frame() noexcept = default;
+
+    ~tracked_frame();
+
+    template<typename Executor>
+    void attach(Executor const& ex,
+                std::type_info const& type,
+                std::size_t frame_size);
+
+    void hop(bool is_continuation) noexcept
+    {
+        if (is_continuation)
+            hops_.fetch_add(1, std::memory_order_relaxed);
+        last_hop_.store(
+          std::chrono::steady_clock::now().time_since_epoch().count(),
+          std::memory_order_relaxed);
+    }
+
+    static tracked_frame*& current() noexcept
+    {
+        static thread_local tracked_frame* frame = nullptr;
+        return frame;
+    }
+
+    operation_tracker* tracker_ = nullptr;
+    std::type_info const* type_ = nullptr;
+    std::size_t frame_size_ = 0;
+    std::atomic<int> coroutine_state_{0};
+    std::atomic<std::uint64_t> hops_{0};
+    std::atomic<std::chrono::steady_clock::rep> last_hop_{0};
+};
+
+/**
+ * Marks the frame as the one whose OperationBody is currently running on this
+ * thread, for the duration of the scope.
+ */
+class tracking_scope
+{
+public:
+    tracking_scope(tracked_frame* frame, bool is_continuation) noexcept
+      : previous_{tracked_frame::current()}
+    {
+        if (frame != nullptr)
+            frame->hop(is_continuation);
+        tracked_frame::current() = frame;
+    }
+
+    tracking_scope(tracking_scope const&) = delete;
+    tracking_scope& operator=(tracking_scope const&) = delete;
+
+    ~tracking_scope()
+    {
+        tracked_frame::current() = previous_;
+    }
+
+private:
+    tracked_frame* previous_;
+};
+
+inline void
+track_coroutine_state(int state) noexcept
+{
+    auto const frame = tracked_frame::current();
+    if (frame != nullptr)
+        frame->coroutine_state_.store(state, std::memory_order_relaxed);
+}
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_TRACKED_FRAME_HPP
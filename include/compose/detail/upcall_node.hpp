@@ -0,0 +1,188 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_UPCALL_NODE_HPP
+#define COMPOSE_DETAIL_UPCALL_NODE_HPP
+
+#include <compose/detail/allocator_utils.hpp>
+#include <compose/detail/bind_front_handler.hpp>
+#include <compose/detail/lean_ptr.hpp>
+#include <compose/detail/lean_tuple.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+
+#include <type_traits>
+#include <utility>
+
+// Upcall arguments larger than this (in bytes) are not moved around on upcall.
+// post_upcall constructs them once, in the node that is posted. Like any other
+// upcall, the frame, or the node, holding the arguments is deallocated before
+// the CompletionHandler is invoked, because an operation it initiates may
+// reuse that memory and because the CompletionHandler may destroy the memory
+// resource, e.g. the arena of with_arena. A stable direct_upcall and the
+// posted node therefore move the arguments out once more. The node is
+// allocated while the frame is alive and freed after it, out of order, which
+// the arena of with_arena tolerates.
+#ifndef COMPOSE_INPLACE_UPCALL_THRESHOLD
+#define COMPOSE_INPLACE_UPCALL_THRESHOLD 256
+#endif // COMPOSE_INPLACE_UPCALL_THRESHOLD
+
+namespace compose
+{
+namespace detail
+{
+
+template<class... Args>
+using is_inplace_upcall = std::integral_constant<
+  bool,
+  (sizeof(lean_tuple<typename std::decay<Args>::type...>) >
+   COMPOSE_INPLACE_UPCALL_THRESHOLD)>;
+
+template<class Handler, class... Args>
+struct upcall_node
+{
+    template<class H, class... Us>
+    explicit upcall_node(H&& h, Us&&... us)
+      : handler_{std::forward<H>(h)}
+      , args_{std::forward<Us>(us)...}
+    {
+    }
+
+    Handler handler_;
+    lean_tuple<Args...> args_;
+};
+
+/**
+ * A pointer-sized, nullary CompletionHandler which owns an upcall_node. The
+ * arguments are moved out of the node, which is deallocated before the
+ * invocation, see COMPOSE_INPLACE_UPCALL_THRESHOLD.
+ */
+template<class Handler, class... Args>
+class posted_upcall
+{
+public:
+    using node_type = upcall_node<Handler, Args...>;
+    using allocator_type = rebound_associated_alloc_t<Handler, node_type>;
+
+    template<class H, class... Us>
+    static posted_upcall create(H&& h, Us&&... us)
+    {
+        allocator_type alloc{
+          boost::asio::get_associated_allocator(h, default_allocator{})};
+        std::allocator_traits<allocator_type> traits;
+
+        detail::lean_ptr<node_type, deallocator<allocator_type>> p{
+          traits.allocate(alloc, 1), deallocator<allocator_type>{alloc}};
+        traits.construct(
+          alloc, p.t_, std::forward<H>(h), std::forward<Us>(us)...);
+        posted_upcall upcall{p.t_};
+        p.t_ = nullptr;
+        return upcall;
+    }
+
+    posted_upcall(posted_upcall&& other) noexcept
+      : node_{other.node_}
+    {
+        other.node_ = nullptr;
+    }
+
+    posted_upcall(posted_upcall const&) = delete;
+    posted_upcall& operator=(posted_upcall&&) = delete;
+    posted_upcall& operator=(posted_upcall const&) = delete;
+
+    ~posted_upcall()
+    {
+        if (node_ != nullptr)
+            destroy(node_);
+    }
+
+    void operator()()
+    {
+        auto const node = node_;
+        node_ = nullptr;
+        release(node, boost::mp11::index_sequence_for<Args...>{})();
+    }
+
+    Handler const& handler() const noexcept
+    {
+        return node_->handler_;
+    }
+
+private:
+    explicit posted_upcall(node_type* node) noexcept
+      : node_{node}
+    {
+    }
+
+    static void destroy(node_type* node) noexcept
+    {
+        allocator_type alloc{boost::asio::get_associated_allocator(
+          node->handler_, default_allocator{})};
+        deleter<allocator_type>{alloc}(node);
+    }
+
+    template<std::size_t... Is>
+    static bound_front_op<Handler, Args...> release(
+      node_type* node,
+      boost::mp11::index_sequence<Is...>)
+    {
+        allocator_type alloc{boost::asio::get_associated_allocator(
+          node->handler_, default_allocator{})};
+        auto const del = deleter<allocator_type>{alloc};
+        detail::lean_ptr<node_type, decltype(del)> p{node, del};
+        return {std::move(node->handler_),
+                {detail::get<Is>(std::move(node->args_))...}};
+    }
+
+    node_type* node_;
+};
+
+} // namespace detail
+} // namespace compose
+
+namespace boost
+{
+namespace asio
+{
+
+template<class Handler, class... Args, class Ex>
+class associated_executor<::compose::detail::posted_upcall<Handler, Args...>,
+                          Ex>
+{
+public:
+    using type = associated_executor_t<Handler, Ex>;
+
+    static type get(
+      ::compose::detail::posted_upcall<Handler, Args...> const& upcall,
+      Ex const& ex = Ex{})
+    {
+        return associated_executor<Handler, Ex>::get(upcall.handler(), ex);
+    }
+};
+
+template<class Handler, class... Args, class A>
+class associated_allocator<::compose::detail::posted_upcall<Handler, Args...>,
+                           A>
+{
+public:
+    using type = associated_allocator_t<Handler, A>;
+
+    static type get(
+      ::compose::detail::posted_upcall<Handler, Args...> const& upcall,
+      A const& alloc = A{})
+    {
+        return associated_allocator<Handler, A>::get(upcall.handler(), alloc);
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#endif // COMPOSE_DETAIL_UPCALL_NODE_HPP
@@ -0,0 +1,204 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_DETAIL_URING_OP_HPP
+#define COMPOSE_DETAIL_URING_OP_HPP
+
+#include <compose/detail/allocator_utils.hpp>
+#include <compose/detail/bind_front_handler.hpp>
+#include <compose/detail/io_uring.hpp>
+#include <compose/detail/lean_ptr.hpp>
+#include <compose/detail/list_node.hpp>
+
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+
+#include <sys/uio.h>
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace compose
+{
+namespace detail
+{
+
+// Buffers beyond this count are ignored, as allowed for *_some operations.
+constexpr std::size_t uring_max_buffers = 8;
+
+// Offset of operations which use and update the position of the descriptor.
+constexpr std::uint64_t uring_current_position =
+  std::numeric_limits<std::uint64_t>::max();
+
+#ifdef COMPOSE_HAS_IO_URING
+constexpr std::uint8_t uring_readv = IORING_OP_READV;
+constexpr std::uint8_t uring_writev = IORING_OP_WRITEV;
+#else
+constexpr std::uint8_t uring_readv = 0;
+constexpr std::uint8_t uring_writev = 0;
+#endif // COMPOSE_HAS_IO_URING
+
+/**
+ * An operation submitted to an io_uring instance. Linked into the list of
+ * outstanding operations of the uring_service until its completion is reaped.
+ */
+struct uring_op : list_node
+{
+    using func_type = void (*)(uring_op*, bool invoke);
+
+    explicit uring_op(func_type func) noexcept
+      : func_{func}
+    {
+    }
+
+    template<typename Buffer, typename BufferSequence>
+    void prepare(std::uint8_t opcode,
+                 int fd,
+                 std::uint64_t offset,
+                 BufferSequence const& buffers) noexcept
+    {
+        prepare<Buffer>(opcode,
+                        fd,
+                        offset,
+                        boost::asio::buffer_sequence_begin(buffers),
+                        boost::asio::buffer_sequence_end(buffers));
+    }
+
+    template<typename Buffer, typename Iterator>
+    void prepare(std::uint8_t opcode,
+                 int fd,
+                 std::uint64_t offset,
+                 Iterator it,
+                 Iterator end) noexcept
+    {
+        opcode_ = opcode;
+        fd_ = fd;
+        offset_ = offset;
+        is_read_ = std::is_same<Buffer, boost::asio::mutable_buffer>::value;
+        for (; it != end && iov_count_ < uring_max_buffers; ++it)
+        {
+            Buffer const buffer{*it};
+            iov_[iov_count_].iov_base = const_cast<void*>(
+              static_cast<void const*>(buffer.data()));
+            iov_[iov_count_].iov_len = buffer.size();
+            requested_ += buffer.size();
+            ++iov_count_;
+        }
+    }
+
+    void complete() noexcept
+    {
+        func_(this, true);
+    }
+
+    void destroy() noexcept
+    {
+        func_(this, false);
+    }
+
+    boost::system::error_code error() const noexcept
+    {
+        if (res_ < 0)
+            return {-res_, boost::system::system_category()};
+        if (res_ == 0 && is_read_ && requested_ > 0)
+            return boost::asio::error::eof;
+        return {};
+    }
+
+    std::size_t bytes_transferred() const noexcept
+    {
+        return res_ > 0 ? static_cast<std::size_t>(res_) : 0;
+    }
+
+    func_type func_;
+    // The object which started the operation, used to find the operations
+    // to cancel. File descriptors may be reused once closed.
+    void const* owner_ = nullptr;
+    int fd_ = -1;
+    int res_ = 0;
+    std::uint8_t opcode_ = 0;
+    bool is_read_ = false;
+    bool cancel_requested_ = false;
+    bool cancel_submitted_ = false;
+    std::uint64_t offset_ = 0;
+    std::size_t requested_ = 0;
+    unsigned iov_count_ = 0;
+    iovec iov_[uring_max_buffers];
+};
+
+template<typename Handler, typename IoExecutor>
+class uring_handler_op : public uring_op
+{
+    using work_type = boost::asio::executor_work_guard<
+      boost::asio::associated_executor_t<Handler, IoExecutor>>;
+    using allocator_type =
+      rebound_associated_alloc_t<Handler, uring_handler_op>;
+
+public:
+    template<typename H>
+    uring_handler_op(H&& h, IoExecutor const& ex)
+      : uring_op{&uring_handler_op::do_complete}
+      , handler_{std::forward<H>(h)}
+      , work_{boost::asio::get_associated_executor(handler_, ex)}
+    {
+    }
+
+    template<typename H>
+    static uring_handler_op* create(H&& h, IoExecutor const& ex)
+    {
+        allocator_type alloc{
+          boost::asio::get_associated_allocator(h, default_allocator{})};
+        std::allocator_traits<allocator_type> traits;
+
+        detail::lean_ptr<uring_handler_op, deallocator<allocator_type>> p{
+          traits.allocate(alloc, 1), deallocator<allocator_type>{alloc}};
+        traits.construct(alloc, p.t_, std::forward<H>(h), ex);
+        auto const op = p.t_;
+        p.t_ = nullptr;
+        return op;
+    }
+
+private:
+    using bound_type =
+      bound_front_op<Handler, boost::system::error_code, std::size_t>;
+
+    static void do_complete(uring_op* base, bool invoke)
+    {
+        auto const op = static_cast<uring_handler_op*>(base);
+        work_type work{std::move(op->work_)};
+        auto bound = release(op);
+        if (invoke)
+            (void)boost::asio::dispatch(work.get_executor(), std::move(bound));
+    }
+
+    // The handler is moved out and the operation deallocated before the
+    // invocation, so that the memory can be reused by the operations it
+    // starts.
+    static bound_type release(uring_handler_op* op)
+    {
+        allocator_type alloc{boost::asio::get_associated_allocator(
+          op->handler_, default_allocator{})};
+        auto const del = deleter<allocator_type>{alloc};
+        detail::lean_ptr<uring_handler_op, decltype(del)> p{op, del};
+        return {std::move(op->handler_),
+                {op->error(), op->bytes_transferred()}};
+    }
+
+    Handler handler_;
+    work_type work_;
+};
+
+} // namespace detail
+} // namespace compose
+
+#endif // COMPOSE_DETAIL_URING_OP_HPP
@@ -0,0 +1,56 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_ERROR_HPP
+#define COMPOSE_ERROR_HPP
+
+#include <boost/system/error_code.hpp>
+
+#include <type_traits>
+
+namespace compose
+{
+
+/**
+ * Errors reported by the operations of this library, in addition to the ones
+ * of the underlying I/O objects.
+ */
+enum class error
+{
+    /// The data received does not match its checksum.
+    checksum_mismatch = 1
+};
+
+/**
+ * Returns the error_category of compose::error.
+ */
+inline boost::system::error_category const&
+error_category() noexcept;
+
+inline boost::system::error_code
+make_error_code(error e) noexcept;
+
+} // namespace compose
+
+namespace boost
+{
+namespace system
+{
+
+template<>
+struct is_error_code_enum<::compose::error> : std::true_type
+{
+};
+
+} // namespace system
+} // namespace boost
+
+#include <compose/impl/error.hpp>
+
+#endif // COMPOSE_ERROR_HPP
@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_FIBER_TRANSFORM_HPP
+#define COMPOSE_FIBER_TRANSFORM_HPP
+
+#include <compose/detail/fiber_stack_pool.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/context/fiber.hpp>
+
+namespace compose
+{
+
+namespace detail
+{
+
+class fiber_body_base;
+
+} // namespace detail
+
+/**
+ * A CompletionToken which suspends the fiber of the currently running
+ * stackful operation until the initiated operation completes. The initiating
+ * function returns the completion arguments:
+ *   - void() - returns void,
+ *   - void(T) - returns T,
+ *   - void(Ts...) - returns std::tuple<Ts...>.
+ *
+ * The token refers to the fiber it was passed to and may only be used on that
+ * fiber.
+ */
+template<typename ComposedOp>
+class fiber_yield
+{
+public:
+    explicit fiber_yield(detail::fiber_body_base& body) noexcept
+      : body_{&body}
+    {
+    }
+
+    /**
+     * Releases ownership of the composed operation, see
+     * yield_token::release_operation().
+     */
+    ComposedOp release_operation() const;
+
+    /**
+     * Suspends the fiber until the composed operation is resumed.
+     */
+    void suspend() const;
+
+private:
+    detail::fiber_body_base* body_;
+};
+
+/**
+ * Transforms a Function into a stackful ComposedOperation. The Function is
+ * invoked, on a fiber of its own, with a fiber_yield and may be written as a
+ * sequence of blocking-looking calls to initiating functions, from any depth
+ * of nested function calls. The value returned by the Function is passed to
+ * the CompletionHandler: void results in an upcall without arguments, a
+ * std::tuple is expanded into the arguments, any other value is passed as
+ * the only argument. Exceptions thrown by the Function propagate out of the
+ * invocation of the composed operation which resumed the fiber.
+ *
+ * Usage:
+ * @code
+ * compose::fiber_transform(ex, init, [&](auto yield) {
+ *     boost::system::error_code ec;
+ *     std::size_t n = 0;
+ *     std::tie(ec, n) = socket.async_read_some(buffer, yield);
+ *     return std::make_tuple(ec, n);
+ * }).run();
+ * @endcode
+ *
+ * The Function lives in a stable frame, like an OperationBody transformed
+ * with stable_transform(). The fiber's stack is taken from a per-thread pool
+ * of guard-paged stacks of COMPOSE_FIBER_STACK_SIZE bytes and returned to it
+ * when the Function returns. Destroying a suspended operation unwinds the
+ * fiber's stack. Requires linking with Boost.Context.
+ *
+ * The operation may be run by a multi-threaded executor. An operation
+ * initiated on the fiber may complete on another thread before the fiber is
+ * suspended, in which case the resumption waits until it is. The Function
+ * then continues on that thread, so state it shares with other handlers
+ * still needs a strand.
+ *
+ * @param ex The I/O executor to be used by the ComposedOperation (associated
+ * with the used I/O object).
+ *
+ * @param init Reference to an asynchronous operation initiation helper. Used to
+ * deduce the CompletionHandler and Signature types.
+ *
+ * @param f The function which will be run on the fiber.
+ *
+ * @returns transformed_operation<DEDUCED>
+ */
+template<typename Executor,
+         typename CompletionToken,
+         typename Signature,
+         typename Function>
+auto
+fiber_transform(Executor const& ex,
+                boost::asio::async_completion<CompletionToken, Signature>& init,
+                Function&& f);
+
+} // namespace compose
+
+#include <compose/impl/fiber_transform.hpp>
+
+#endif // COMPOSE_FIBER_TRANSFORM_HPP
@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_FOR_EACH_BOUNDED_HPP
+#define COMPOSE_FOR_EACH_BOUNDED_HPP
+
+#include <boost/asio/async_result.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+
+namespace compose
+{
+
+/**
+ * Starts an asynchronous operation for each element of a range, keeping at
+ * most limit of them in flight at the same time. Whenever a child operation
+ * completes, the next element is started in its place.
+ *
+ * The operation performs a constant number of memory allocations, regardless
+ * of the size of the range: the frame of the ComposedOperation and a block of
+ * limit slots of SlotSize bytes. The Allocator associated with each child's
+ * CompletionHandler allocates from the slot of that child, falling back to
+ * the Allocator associated with the CompletionHandler of the whole operation.
+ *
+ * @tparam SlotSize the number of bytes reserved for the allocations of each
+ * child operation.
+ *
+ * @param ex The I/O executor to be used by the ComposedOperation.
+ *
+ * @param range A ForwardRange, which must remain valid until the operation
+ * completes.
+ *
+ * @param limit Maximum number of child operations in flight. Must not be 0.
+ *
+ * @param factory Invoked as factory(element, handler) to start the child
+ * operation for an element. The handler must be passed as the
+ * CompletionToken of exactly one asynchronous operation whose completion
+ * signature is void(boost::system::error_code, Ts...). The child operation
+ * must not complete before the factory returns.
+ *
+ * @param tok The CompletionToken used to produce the CompletionHandler with
+ * the signature void(boost::system::error_code, std::size_t). The handler is
+ * invoked with the first error reported by a child operation and the number
+ * of child operations that failed, once all of them completed.
+ *
+ * @remark If the I/O executor and the CompletionHandler's executor may run on
+ * multiple threads, the CompletionHandler must be associated with a strand.
+ */
+template<std::size_t SlotSize = 256,
+         typename Executor,
+         typename Range,
+         typename OperationFactory,
+         typename CompletionToken>
+auto
+async_for_each_bounded(Executor const& ex,
+                       Range const& range,
+                       std::size_t limit,
+                       OperationFactory&& factory,
+                       CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t));
+
+} // namespace compose
+
+#include <compose/impl/for_each_bounded.hpp>
+
+#endif // COMPOSE_FOR_EACH_BOUNDED_HPP
@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_FRAME_READER_HPP
+#define COMPOSE_FRAME_READER_HPP
+
+#include <compose/detail/buffer_pool.hpp>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace compose
+{
+
+/**
+ * Reads length-prefixed frames from a stream, many frames per read.
+ *
+ * Each frame consists of a big-endian, unsigned length prefix of
+ * prefix_size() bytes followed by that many bytes of payload.
+ * async_read_frames() decodes all complete frames already buffered and
+ * delivers them as a batch. Only if there are none, the stream is read, in
+ * chunks as large as the free space in the buffer, until at least one frame
+ * is complete. The payloads are exposed as views into the buffer, without
+ * being copied.
+ *
+ * The buffer is allocated once. If it is not larger than
+ * COMPOSE_POOLED_BUFFER_SIZE, it is taken from a per-thread pool.
+ *
+ * The reader is meant to be a data member of an OperationBody transformed
+ * with stable_transform(), so that the frames may be processed in place.
+ *
+ * Usage:
+ * @code
+ * COMPOSE_YIELD reader_.async_read_frames(yield);
+ * for (std::size_t i = 0; i < reader_.size(); ++i)
+ *     process(reader_.frame(i));
+ * @endcode
+ *
+ * @remark Distinct objects: Safe. Shared objects: Unsafe.
+ */
+template<typename AsyncReadStream>
+class frame_reader
+{
+public:
+    /**
+     * Construct a frame_reader.
+     *
+     * @param stream The stream to read from. Must outlive the reader.
+     *
+     * @param max_frame_size Largest payload accepted.
+     *
+     * @param prefix_size Size of the length prefix, between 1 and 8 bytes.
+     */
+    frame_reader(AsyncReadStream& stream,
+                 std::size_t max_frame_size,
+                 std::size_t prefix_size = 4);
+
+    frame_reader(frame_reader const&) = delete;
+    frame_reader& operator=(frame_reader const&) = delete;
+
+    std::size_t prefix_size() const noexcept
+    {
+        return prefix_size_;
+    }
+
+    std::size_t max_frame_size() const noexcept
+    {
+        return max_frame_size_;
+    }
+
+    /**
+     * Returns the number of frames decoded by the last batch.
+     */
+    std::size_t size() const noexcept
+    {
+        return frames_.size();
+    }
+
+    /**
+     * Returns the payload of the i-th frame of the last batch. Remains valid
+     * until the next batch is started.
+     */
+    boost::asio::const_buffer frame(std::size_t i) const noexcept
+    {
+        return frames_[i];
+    }
+
+    /**
+     * Delivers the next batch of frames, reading from the stream only if no
+     * complete frame is buffered.
+     *
+     * Signature of the CompletionHandler:
+     * @code
+     * void(boost::system::error_code ec, std::size_t count)
+     * @endcode
+     * Where count is the number of frames in the batch, also returned by
+     * size(). A frame whose length exceeds max_frame_size() fails the
+     * operation with boost::asio::error::message_size. If the stream ends,
+     * boost::asio::error::eof is reported, even if a partial frame was
+     * buffered.
+     */
+    template<typename CompletionToken>
+    auto async_read_frames(CompletionToken&& tok)
+      -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                       void(boost::system::error_code,
+                                            std::size_t));
+
+private:
+    class read_op;
+
+    void decode(boost::system::error_code& ec);
+    void compact() noexcept;
+
+    AsyncReadStream& stream_;
+    std::size_t max_frame_size_;
+    std::size_t prefix_size_;
+    std::size_t capacity_;
+    detail::pooled_buffer pooled_;
+    std::vector<char> owned_;
+    char* data_;
+    std::size_t begin_ = 0;
+    std::size_t end_ = 0;
+    std::vector<boost::asio::const_buffer> frames_;
+};
+
+} // namespace compose
+
+#include <compose/impl/frame_reader.hpp>
+
+#endif // COMPOSE_FRAME_READER_HPP
@@ -0,0 +1,396 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_ANY_COMPLETION_HANDLER_HPP
+#define COMPOSE_IMPL_ANY_COMPLETION_HANDLER_HPP
+
+#include <compose/any_completion_handler.hpp>
+#include <compose/detail/allocator_utils.hpp>
+#include <compose/detail/lean_ptr.hpp>
+
+#include <cassert>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace compose
+{
+namespace detail
+{
+
+template<class Allocator>
+struct allocator_ops
+{
+    using unit_allocator = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<allocation_unit>;
+
+    static_assert(sizeof(Allocator) <= sizeof(allocator_storage) &&
+                    alignof(Allocator) <= alignof(allocator_storage),
+                  "The associated Allocator is too large to be erased.");
+
+    static Allocator const& get(allocator_storage const& storage) noexcept
+    {
+        return *static_cast<Allocator const*>(
+          static_cast<void const*>(&storage));
+    }
+
+    static std::size_t units(std::size_t size) noexcept
+    {
+        return (size + sizeof(allocation_unit) - 1) / sizeof(allocation_unit);
+    }
+
+    static void copy(allocator_storage const& from,
+                     allocator_storage& to) noexcept
+    {
+        ::new (static_cast<void*>(&to)) Allocator(get(from));
+    }
+
+    static void destroy(allocator_storage& storage) noexcept
+    {
+        get(storage).~Allocator();
+    }
+
+    static void* allocate(allocator_storage const& storage, std::size_t size)
+    {
+        unit_allocator alloc{get(storage)};
+        return std::allocator_traits<unit_allocator>::allocate(alloc,
+                                                                units(size));
+    }
+
+    static void deallocate(allocator_storage const& storage,
+                           void* p,
+                           std::size_t size) noexcept
+    {
+        unit_allocator alloc{get(storage)};
+        std::allocator_traits<unit_allocator>::deallocate(
+          alloc, static_cast<allocation_unit*>(p), units(size));
+    }
+
+    template<class A>
+    static auto equal(A const& lhs, A const& rhs, decltype(nullptr)) noexcept
+      -> decltype(lhs == rhs)
+    {
+        return lhs == rhs;
+    }
+
+    // E.g. the recycling allocator, which is stateless but not comparable.
+    template<class A>
+    static bool equal(A const&, A const&, ...) noexcept
+    {
+        return std::is_empty<A>::value;
+    }
+
+    static bool equal(allocator_storage const& lhs,
+                      allocator_storage const& rhs) noexcept
+    {
+        return equal(get(lhs), get(rhs), nullptr);
+    }
+
+    static allocator_vtable const* vtable() noexcept
+    {
+        static constexpr allocator_vtable table{
+          &copy, &destroy, &allocate, &deallocate, &equal};
+        return &table;
+    }
+};
+
+template<class Handler>
+using erased_allocator_t =
+  boost::asio::associated_allocator_t<Handler, default_allocator>;
+
+// Operations on a handler stored in the inline buffer.
+template<class Handler, class... Args>
+struct inline_handler_ops
+{
+    static Handler& get(void* storage) noexcept
+    {
+        return *static_cast<Handler*>(storage);
+    }
+
+    static Handler const& get(void const* storage) noexcept
+    {
+        return *static_cast<Handler const*>(storage);
+    }
+
+    static void invoke(void* storage, Args&&... args)
+    {
+        Handler handler{std::move(get(storage))};
+        get(storage).~Handler();
+        handler(std::forward<Args>(args)...);
+    }
+
+    static void relocate(void* from, void* to) noexcept
+    {
+        ::new (to) Handler(std::move(get(from)));
+        get(from).~Handler();
+    }
+
+    static void destroy(void* storage) noexcept
+    {
+        get(storage).~Handler();
+    }
+
+    static boost::asio::any_io_executor executor(
+      void const* storage,
+      boost::asio::any_io_executor const& ex)
+    {
+        return boost::asio::get_associated_executor(get(storage), ex);
+    }
+
+    static any_handler_allocator<void> allocator(void const* storage)
+    {
+        return any_handler_allocator<void>{
+          boost::asio::get_associated_allocator(get(storage),
+                                                default_allocator{})};
+    }
+
+    static any_handler_vtable<Args...> const* vtable() noexcept
+    {
+        static constexpr any_handler_vtable<Args...> table{
+          &invoke, &relocate, &destroy, &executor, &allocator};
+        return &table;
+    }
+};
+
+// Operations on a handler allocated with its associated Allocator, the inline
+// buffer holds a pointer to it.
+template<class Handler, class... Args>
+struct allocated_handler_ops
+{
+    using allocator_type = rebound_associated_alloc_t<Handler, Handler>;
+
+    static Handler*& get(void* storage) noexcept
+    {
+        return *static_cast<Handler**>(storage);
+    }
+
+    static Handler const& get(void const* storage) noexcept
+    {
+        return **static_cast<Handler* const*>(storage);
+    }
+
+    template<class H>
+    static void create(void* storage, H&& h)
+    {
+        allocator_type alloc{
+          boost::asio::get_associated_allocator(h, default_allocator{})};
+        std::allocator_traits<allocator_type> traits;
+        detail::lean_ptr<Handler, deallocator<allocator_type>> p{
+          traits.allocate(alloc, 1), deallocator<allocator_type>{alloc}};
+        traits.construct(alloc, p.t_, std::forward<H>(h));
+        get(storage) = p.t_;
+        p.t_ = nullptr;
+    }
+
+    static void invoke(void* storage, Args&&... args)
+    {
+        auto const p = get(storage);
+        allocator_type alloc{
+          boost::asio::get_associated_allocator(*p, default_allocator{})};
+        Handler handler{std::move(*p)};
+        deleter<allocator_type>{alloc}(p);
+        handler(std::forward<Args>(args)...);
+    }
+
+    static void relocate(void* from, void* to) noexcept
+    {
+        get(to) = get(from);
+    }
+
+    static void destroy(void* storage) noexcept
+    {
+        auto const p = get(storage);
+        allocator_type alloc{
+          boost::asio::get_associated_allocator(*p, default_allocator{})};
+        deleter<allocator_type>{alloc}(p);
+    }
+
+    static boost::asio::any_io_executor executor(
+      void const* storage,
+      boost::asio::any_io_executor const& ex)
+    {
+        return boost::asio::get_associated_executor(get(storage), ex);
+    }
+
+    static any_handler_allocator<void> allocator(void const* storage)
+    {
+        return any_handler_allocator<void>{
+          boost::asio::get_associated_allocator(get(storage),
+                                                default_allocator{})};
+    }
+
+    static any_handler_vtable<Args...> const* vtable() noexcept
+    {
+        static constexpr any_handler_vtable<Args...> table{
+          &invoke, &relocate, &destroy, &executor, &allocator};
+        return &table;
+    }
+};
+
+} // namespace detail
+
+template<typename T>
+template<typename Allocator>
+any_handler_allocator<T>::any_handler_allocator(Allocator const& alloc)
+  : vtable_{detail::allocator_ops<Allocator>::vtable()}
+{
+    ::new (static_cast<void*>(&storage_)) Allocator(alloc);
+}
+
+template<typename T>
+any_handler_allocator<T>::any_handler_allocator(
+  any_handler_allocator const& other) noexcept
+  : vtable_{other.vtable_}
+{
+    vtable_->copy(other.storage_, storage_);
+}
+
+template<typename T>
+template<typename U>
+any_handler_allocator<T>::any_handler_allocator(
+  any_handler_allocator<U> const& other) noexcept
+  : vtable_{other.vtable_}
+{
+    vtable_->copy(other.storage_, storage_);
+}
+
+template<typename T>
+any_handler_allocator<T>::~any_handler_allocator()
+{
+    vtable_->destroy(storage_);
+}
+
+template<typename T>
+T*
+any_handler_allocator<T>::allocate(std::size_t n)
+{
+    static_assert(alignof(T) <= alignof(detail::allocation_unit),
+                  "Over-aligned types are not supported.");
+    if (n > static_cast<std::size_t>(-1) / sizeof(T))
+        throw std::bad_alloc{};
+    return static_cast<T*>(vtable_->allocate(storage_, n * sizeof(T)));
+}
+
+template<typename T>
+void
+any_handler_allocator<T>::deallocate(T* p, std::size_t n) noexcept
+{
+    vtable_->deallocate(storage_, p, n * sizeof(T));
+}
+
+template<typename T>
+template<typename U>
+bool
+any_handler_allocator<T>::operator==(
+  any_handler_allocator<U> const& other) const noexcept
+{
+    return vtable_ == other.vtable_ && vtable_->equal(storage_, other.storage_);
+}
+
+template<typename T>
+template<typename U>
+bool
+any_handler_allocator<T>::operator!=(
+  any_handler_allocator<U> const& other) const noexcept
+{
+    return !(*this == other);
+}
+
+template<typename... Args, std::size_t BufferSize>
+template<typename Handler, typename>
+any_completion_handler<void(Args...), BufferSize>::any_completion_handler(
+  Handler&& handler)
+{
+    using handler_type = typename std::decay<Handler>::type;
+    using is_inline = std::integral_constant<
+      bool,
+      sizeof(handler_type) <= sizeof(storage_type) &&
+        alignof(handler_type) <= alignof(storage_type) &&
+        std::is_nothrow_move_constructible<handler_type>::value>;
+
+    construct(is_inline{}, std::forward<Handler>(handler));
+}
+
+template<typename... Args, std::size_t BufferSize>
+template<typename Handler>
+void
+any_completion_handler<void(Args...), BufferSize>::construct(
+  std::true_type,
+  Handler&& handler)
+{
+    using handler_type = typename std::decay<Handler>::type;
+    ::new (static_cast<void*>(&storage_))
+      handler_type(std::forward<Handler>(handler));
+    vtable_ = detail::inline_handler_ops<handler_type, Args...>::vtable();
+}
+
+template<typename... Args, std::size_t BufferSize>
+template<typename Handler>
+void
+any_completion_handler<void(Args...), BufferSize>::construct(
+  std::false_type,
+  Handler&& handler)
+{
+    using handler_type = typename std::decay<Handler>::type;
+    detail::allocated_handler_ops<handler_type, Args...>::create(
+      &storage_, std::forward<Handler>(handler));
+    vtable_ = detail::allocated_handler_ops<handler_type, Args...>::vtable();
+}
+
+template<typename... Args, std::size_t BufferSize>
+any_completion_handler<void(Args...), BufferSize>::any_completion_handler(
+  any_completion_handler&& other) noexcept
+  : vtable_{other.vtable_}
+{
+    if (vtable_ != nullptr)
+    {
+        vtable_->relocate(&other.storage_, &storage_);
+        other.vtable_ = nullptr;
+    }
+}
+
+template<typename... Args, std::size_t BufferSize>
+auto
+any_completion_handler<void(Args...), BufferSize>::operator=(
+  any_completion_handler&& other) noexcept -> any_completion_handler&
+{
+    if (this != &other)
+    {
+        if (vtable_ != nullptr)
+            vtable_->destroy(&storage_);
+        vtable_ = other.vtable_;
+        if (vtable_ != nullptr)
+        {
+            vtable_->relocate(&other.storage_, &storage_);
+            other.vtable_ = nullptr;
+        }
+    }
+    return *this;
+}
+
+template<typename... Args, std::size_t BufferSize>
+any_completion_handler<void(Args...), BufferSize>::~any_completion_handler()
+{
+    if (vtable_ != nullptr)
+        vtable_->destroy(&storage_);
+}
+
+template<typename... Args, std::size_t BufferSize>
+void
+any_completion_handler<void(Args...), BufferSize>::operator()(Args... args)
+{
+    assert(vtable_ != nullptr && "Invoking an empty any_completion_handler.");
+    auto const vtable = vtable_;
+    vtable_ = nullptr;
+    vtable->invoke(&storage_, std::forward<Args>(args)...);
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_ANY_COMPLETION_HANDLER_HPP
@@ -0,0 +1,527 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_CHANNEL_HPP
+#define COMPOSE_IMPL_CHANNEL_HPP
+
+#include <compose/channel.hpp>
+#include <compose/detail/bind_front_handler.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+
+#include <cassert>
+#include <new>
+#include <utility>
+
+namespace compose
+{
+namespace detail
+{
+
+// Completes an async_receive_some() with the values appended to its batch
+// until it is invoked.
+template<typename Channel, typename Handler>
+class channel_batch_op
+{
+public:
+    using waiter = typename Channel::waiter;
+
+    channel_batch_op(Handler&& handler, waiter& w)
+      : handler_{std::move(handler)}
+      , waiter_{&w}
+    {
+    }
+
+    channel_batch_op(channel_batch_op&& other)
+      : handler_{std::move(other.handler_)}
+      , waiter_{std::exchange(other.waiter_, nullptr)}
+    {
+    }
+
+    ~channel_batch_op()
+    {
+        // The waiter is owned by the handler, which is still alive here.
+        if (waiter_ != nullptr)
+            Channel::end_batch(*waiter_);
+    }
+
+    void operator()()
+    {
+        auto const count = Channel::end_batch(*std::exchange(waiter_, nullptr));
+        handler_(boost::system::error_code{}, count);
+    }
+
+    Handler handler_;
+
+private:
+    waiter* waiter_;
+};
+
+} // namespace detail
+
+template<typename T, typename Executor>
+channel<T, Executor>::waiter::~waiter()
+{
+    assert(!is_waiting() &&
+           "A waiter must not be destroyed while an operation is suspended.");
+}
+
+template<typename T, typename Executor>
+void
+channel<T, Executor>::waiter_queue::push_back(waiter& w) noexcept
+{
+    w.next_ = nullptr;
+    if (tail_ != nullptr)
+        tail_->next_ = &w;
+    else
+        head_ = &w;
+    tail_ = &w;
+}
+
+template<typename T, typename Executor>
+auto
+channel<T, Executor>::waiter_queue::pop_front() noexcept -> waiter*
+{
+    auto const w = head_;
+    head_ = w->next_;
+    if (head_ == nullptr)
+        tail_ = nullptr;
+    w->next_ = nullptr;
+    return w;
+}
+
+template<typename T, typename Executor>
+bool
+channel<T, Executor>::waiter_queue::remove(waiter& w) noexcept
+{
+    waiter* prev = nullptr;
+    for (auto it = head_; it != nullptr; prev = it, it = it->next_)
+    {
+        if (it != &w)
+            continue;
+
+        if (prev != nullptr)
+            prev->next_ = w.next_;
+        else
+            head_ = w.next_;
+        if (tail_ == &w)
+            tail_ = prev;
+        w.next_ = nullptr;
+        return true;
+    }
+
+    return false;
+}
+
+template<typename T, typename Executor>
+channel<T, Executor>::channel(Executor const& ex, std::size_t capacity)
+  : ex_{ex}
+  , buffer_{capacity}
+{
+}
+
+template<typename T, typename Executor>
+channel<T, Executor>::~channel()
+{
+    if (filling_ != nullptr)
+        filling_->channel_ = nullptr;
+
+    while (!senders_.empty())
+    {
+        auto& w = *senders_.pop_front();
+        w.destroy_(w);
+    }
+
+    while (!receivers_.empty())
+    {
+        auto& w = *receivers_.pop_front();
+        w.destroy_(w);
+    }
+}
+
+template<typename T, typename Executor>
+void
+channel<T, Executor>::close()
+{
+    closed_ = true;
+
+    while (!senders_.empty())
+    {
+        auto& w = *senders_.pop_front();
+        w.complete_(*this, w, boost::asio::error::broken_pipe);
+    }
+
+    while (!receivers_.empty())
+    {
+        auto& w = *receivers_.pop_front();
+        w.complete_(*this, w, boost::asio::error::eof);
+    }
+}
+
+template<typename T, typename Executor>
+bool
+channel<T, Executor>::cancel(waiter& w)
+{
+    if (!senders_.remove(w) && !receivers_.remove(w))
+        return false;
+
+    w.complete_(*this, w, boost::asio::error::operation_aborted);
+    return true;
+}
+
+template<typename T, typename Executor>
+template<typename CompletionToken>
+auto
+channel<T, Executor>::async_send(waiter& w, T value, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code)>
+      init{tok};
+    using handler_type = BOOST_ASIO_HANDLER_TYPE(
+      CompletionToken, void(boost::system::error_code));
+
+    boost::system::error_code ec;
+    if (closed_)
+    {
+        ec = boost::asio::error::broken_pipe;
+    }
+    else if (!receivers_.empty())
+    {
+        assert(buffer_.empty());
+        // A receiver suspended while a batch was filling is served first, so
+        // the batch is closed.
+        if (filling_ != nullptr)
+            std::exchange(filling_, nullptr)->channel_ = nullptr;
+        deliver(*receivers_.pop_front(), std::move(value));
+    }
+    else if (filling_ != nullptr)
+    {
+        auto& receiver = *filling_;
+        receiver.items_[receiver.count_++] = std::move(value);
+        if (receiver.count_ == receiver.size_)
+        {
+            receiver.channel_ = nullptr;
+            filling_ = nullptr;
+        }
+    }
+    else if (!buffer_.full())
+    {
+        buffer_.push_back(std::move(value));
+    }
+    else
+    {
+        w.value_.emplace(std::move(value));
+        park(senders_,
+             w,
+             std::move(init.completion_handler),
+             &channel::complete_send<handler_type>);
+        return init.result.get();
+    }
+
+    (void)boost::asio::post(
+      ex_, detail::bind_front_handler(std::move(init.completion_handler), ec));
+    return init.result.get();
+}
+
+template<typename T, typename Executor>
+template<typename CompletionToken>
+auto
+channel<T, Executor>::async_receive(waiter& w, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code, T))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code, T)>
+      init{tok};
+    using handler_type = BOOST_ASIO_HANDLER_TYPE(
+      CompletionToken, void(boost::system::error_code, T));
+
+    if (buffer_.empty() && senders_.empty() && !closed_)
+    {
+        w.items_ = nullptr;
+        park(receivers_,
+             w,
+             std::move(init.completion_handler),
+             &channel::complete_receive<handler_type>);
+        return init.result.get();
+    }
+
+    boost::system::error_code ec;
+    T value{};
+    if (!buffer_.empty())
+    {
+        value = std::move(buffer_.front());
+        buffer_.pop_front();
+        refill();
+    }
+    else if (!senders_.empty())
+    {
+        auto& sender = *senders_.pop_front();
+        value = std::move(*sender.value_);
+        sender.complete_(*this, sender, {});
+    }
+    else
+    {
+        ec = boost::asio::error::eof;
+    }
+
+    (void)boost::asio::post(
+      ex_,
+      detail::bind_front_handler(
+        std::move(init.completion_handler), ec, std::move(value)));
+    return init.result.get();
+}
+
+template<typename T, typename Executor>
+template<typename CompletionToken>
+auto
+channel<T, Executor>::async_receive_some(waiter& w,
+                                         T* items,
+                                         std::size_t n,
+                                         CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    assert(n > 0 && "At least one value must be requested.");
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code, std::size_t)>
+      init{tok};
+    using handler_type = BOOST_ASIO_HANDLER_TYPE(
+      CompletionToken, void(boost::system::error_code, std::size_t));
+
+    if (buffer_.empty() && senders_.empty() && !closed_)
+    {
+        w.items_ = items;
+        w.size_ = n;
+        park(receivers_,
+             w,
+             std::move(init.completion_handler),
+             &channel::complete_receive_some<handler_type>);
+        return init.result.get();
+    }
+
+    boost::system::error_code ec;
+    std::size_t count = 0;
+    while (count < n && !buffer_.empty())
+    {
+        items[count++] = std::move(buffer_.front());
+        buffer_.pop_front();
+        refill();
+    }
+
+    // Only reachable with an unbuffered channel, otherwise refill() would have
+    // moved the values of suspended senders into the buffer.
+    while (count < n && !senders_.empty())
+    {
+        auto& sender = *senders_.pop_front();
+        items[count++] = std::move(*sender.value_);
+        sender.complete_(*this, sender, {});
+    }
+
+    if (count == 0)
+        ec = boost::asio::error::eof;
+
+    (void)boost::asio::post(
+      ex_,
+      detail::bind_front_handler(
+        std::move(init.completion_handler), ec, count));
+    return init.result.get();
+}
+
+template<typename T, typename Executor>
+template<typename Handler>
+void
+channel<T, Executor>::park(waiter_queue& queue,
+                           waiter& w,
+                           Handler&& handler,
+                           complete_fn complete)
+{
+    using handler_type = typename std::decay<Handler>::type;
+    static_assert(sizeof(handler_type) <= sizeof(typename waiter::storage_type),
+                  "The CompletionHandler does not fit in a waiter. Only stable "
+                  "composed operations may be suspended on a channel.");
+    static_assert(alignof(handler_type) <=
+                    alignof(typename waiter::storage_type),
+                  "The CompletionHandler is overaligned.");
+    assert(!w.is_waiting() && "A waiter may only suspend one operation.");
+
+    ::new (static_cast<void*>(&w.handler_))
+      handler_type{std::forward<Handler>(handler)};
+    w.complete_ = complete;
+    w.destroy_ = &channel::destroy<handler_type>;
+    queue.push_back(w);
+}
+
+template<typename T, typename Executor>
+template<typename Handler>
+Handler
+channel<T, Executor>::take(waiter& w)
+{
+    auto& stored = *static_cast<Handler*>(static_cast<void*>(&w.handler_));
+    Handler handler{std::move(stored)};
+    stored.~Handler();
+    w.complete_ = nullptr;
+    w.destroy_ = nullptr;
+    return handler;
+}
+
+template<typename T, typename Executor>
+template<typename Handler>
+void
+channel<T, Executor>::destroy(waiter& w)
+{
+    // The waiter may be owned by the handler, so it must not be accessed
+    // after the handler is destroyed.
+    w.value_ = boost::none;
+    auto const handler = take<Handler>(w);
+    (void)handler;
+}
+
+template<typename T, typename Executor>
+template<typename Handler>
+void
+channel<T, Executor>::complete_send(channel& self,
+                                    waiter& w,
+                                    boost::system::error_code ec)
+{
+    w.value_ = boost::none;
+    (void)boost::asio::post(
+      self.ex_, detail::bind_front_handler(take<Handler>(w), ec));
+}
+
+template<typename T, typename Executor>
+template<typename Handler>
+void
+channel<T, Executor>::complete_receive(channel& self,
+                                       waiter& w,
+                                       boost::system::error_code ec)
+{
+    T value{};
+    if (!ec)
+        value = std::move(*w.value_);
+    w.value_ = boost::none;
+    (void)boost::asio::post(
+      self.ex_,
+      detail::bind_front_handler(take<Handler>(w), ec, std::move(value)));
+}
+
+template<typename T, typename Executor>
+template<typename Handler>
+void
+channel<T, Executor>::complete_receive_some(channel& self,
+                                            waiter& w,
+                                            boost::system::error_code ec)
+{
+    if (ec)
+    {
+        (void)boost::asio::post(
+          self.ex_,
+          detail::bind_front_handler(take<Handler>(w), ec, std::size_t{0}));
+        return;
+    }
+
+    (void)boost::asio::post(
+      self.ex_,
+      detail::channel_batch_op<channel, Handler>{take<Handler>(w), w});
+}
+
+template<typename T, typename Executor>
+std::size_t
+channel<T, Executor>::end_batch(waiter& w) noexcept
+{
+    if (w.channel_ != nullptr)
+    {
+        assert(w.channel_->filling_ == &w);
+        w.channel_->filling_ = nullptr;
+        w.channel_ = nullptr;
+    }
+    return w.count_;
+}
+
+template<typename T, typename Executor>
+void
+channel<T, Executor>::deliver(waiter& receiver, T value)
+{
+    if (receiver.items_ != nullptr)
+    {
+        receiver.items_[0] = std::move(value);
+        receiver.count_ = 1;
+        if (receiver.count_ < receiver.size_)
+        {
+            receiver.channel_ = this;
+            filling_ = &receiver;
+        }
+    }
+    else
+    {
+        receiver.value_.emplace(std::move(value));
+    }
+    receiver.complete_(*this, receiver, {});
+}
+
+template<typename T, typename Executor>
+void
+channel<T, Executor>::refill()
+{
+    while (!buffer_.full() && !senders_.empty())
+    {
+        auto& sender = *senders_.pop_front();
+        buffer_.push_back(std::move(*sender.value_));
+        sender.complete_(*this, sender, {});
+    }
+}
+
+} // namespace compose
+
+namespace boost
+{
+namespace asio
+{
+
+template<class Channel, class Handler, class Ex>
+class associated_executor<::compose::detail::channel_batch_op<Channel, Handler>,
+                          Ex>
+{
+public:
+    using type = associated_executor_t<Handler, Ex>;
+
+    static type get(
+      ::compose::detail::channel_batch_op<Channel, Handler> const& op,
+      Ex const& ex = Ex{})
+    {
+        return asio::get_associated_executor(op.handler_, ex);
+    }
+};
+
+template<class Channel, class Handler, class A>
+class associated_allocator<
+  ::compose::detail::channel_batch_op<Channel, Handler>,
+  A>
+{
+public:
+    using type = associated_allocator_t<Handler, A>;
+
+    static type get(
+      ::compose::detail::channel_batch_op<Channel, Handler> const& op,
+      A const& alloc = A{})
+    {
+        return asio::get_associated_allocator(op.handler_, alloc);
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#endif // COMPOSE_IMPL_CHANNEL_HPP
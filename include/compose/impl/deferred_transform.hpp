@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_DEFERRED_TRANSFORM_HPP
+#define COMPOSE_IMPL_DEFERRED_TRANSFORM_HPP
+
+#include <compose/deferred_transform.hpp>
+
+namespace compose
+{
+
+namespace detail
+{
+
+template<typename Signature,
+         typename OperationBody,
+         typename Executor,
+         typename CompletionToken,
+         typename... Args,
+         std::size_t... Is>
+auto
+transform_deferred(
+  Executor const& ex,
+  boost::asio::async_completion<CompletionToken, Signature>& init,
+  lean_tuple<Args...>&& args,
+  boost::mp11::index_sequence<Is...>)
+{
+    return detail::stable_transform<Signature, OperationBody>(
+      ex, init, detail::get<Is>(std::move(args))...);
+}
+
+} // namespace detail
+
+template<typename OperationBody, typename... Args>
+auto
+defer(Args&&... args)
+  -> deferred_operation<OperationBody, typename std::decay<Args>::type...>
+{
+    return deferred_operation<OperationBody,
+                              typename std::decay<Args>::type...>{
+      std::piecewise_construct, std::forward<Args>(args)...};
+}
+
+template<typename... Deferred>
+auto
+sequence(Deferred&&... ops) -> deferred_operation<
+  detail::sequence_body<typename std::decay<Deferred>::type::body_type...>,
+  typename std::decay<Deferred>::type::args_type...>
+{
+    static_assert(sizeof...(Deferred) > 0, "A sequence must not be empty");
+    return deferred_operation<
+      detail::sequence_body<typename std::decay<Deferred>::type::body_type...>,
+      typename std::decay<Deferred>::type::args_type...>{
+      std::piecewise_construct, std::move(ops).release()...};
+}
+
+template<typename Executor,
+         typename CompletionToken,
+         typename Signature,
+         typename OperationBody,
+         typename... Args>
+auto
+transform_deferred(
+  Executor const& ex,
+  boost::asio::async_completion<CompletionToken, Signature>& init,
+  deferred_operation<OperationBody, Args...>&& op)
+{
+    return detail::transform_deferred<Signature, OperationBody>(
+      ex,
+      init,
+      std::move(op).release(),
+      boost::mp11::index_sequence_for<Args...>{});
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_DEFERRED_TRANSFORM_HPP
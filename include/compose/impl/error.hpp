@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_ERROR_HPP
+#define COMPOSE_IMPL_ERROR_HPP
+
+#include <compose/error.hpp>
+
+#include <string>
+
+namespace compose
+{
+namespace detail
+{
+
+class compose_error_category : public boost::system::error_category
+{
+public:
+    char const* name() const noexcept override
+    {
+        return "compose";
+    }
+
+    std::string message(int ev) const override
+    {
+        switch (static_cast<error>(ev))
+        {
+            case error::checksum_mismatch:
+                return "Checksum mismatch";
+        }
+        return "Unknown compose error";
+    }
+};
+
+} // namespace detail
+
+inline boost::system::error_category const&
+error_category() noexcept
+{
+    static detail::compose_error_category const category;
+    return category;
+}
+
+inline boost::system::error_code
+make_error_code(error e) noexcept
+{
+    return {static_cast<int>(e), error_category()};
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_ERROR_HPP
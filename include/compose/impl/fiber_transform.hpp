@@ -0,0 +1,379 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_FIBER_TRANSFORM_HPP
+#define COMPOSE_IMPL_FIBER_TRANSFORM_HPP
+
+#include <compose/fiber_transform.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/optional.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace compose
+{
+namespace detail
+{
+
+// The part of a fiber_body which does not depend on the Function.
+class fiber_body_base
+{
+public:
+    fiber_body_base() = default;
+    fiber_body_base(fiber_body_base&&) = delete;
+    fiber_body_base(fiber_body_base const&) = delete;
+    fiber_body_base& operator=(fiber_body_base&&) = delete;
+    fiber_body_base& operator=(fiber_body_base const&) = delete;
+
+    // Switches from the fiber back to the composed operation which resumed
+    // it, until the operation is resumed again.
+    void suspend()
+    {
+        assert(caller_ && "suspend must be called on the operation's fiber.");
+        caller_ = std::move(caller_).resume();
+    }
+
+    template<class ComposedOp>
+    yield_token<ComposedOp>& token() noexcept
+    {
+        assert(token_ != nullptr);
+        return *static_cast<yield_token<ComposedOp>*>(token_);
+    }
+
+protected:
+    // An operation initiated on the fiber may complete on another thread
+    // before the fiber is suspended. Its handler waits in acquire() until the
+    // invocation which resumed the fiber is done with it.
+    void acquire() noexcept
+    {
+        while (active_.exchange(true, std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+
+    void release() noexcept
+    {
+        active_.store(false, std::memory_order_release);
+    }
+
+    // Set while the fiber runs, the yield_token and the fiber_result live on
+    // the stack of the invocation of the composed operation.
+    void* token_ = nullptr;
+    void* result_ = nullptr;
+    std::exception_ptr exception_;
+    boost::context::fiber caller_;
+    boost::context::fiber fiber_;
+    std::atomic<bool> active_{false};
+};
+
+template<class Self, class Tuple, std::size_t... Is>
+upcall_guard
+fiber_upcall(yield_token<Self>& yield, Tuple&& t, std::index_sequence<Is...>)
+{
+    return yield.upcall(std::get<Is>(std::move(t))...);
+}
+
+template<class Self, class... Ts>
+upcall_guard
+fiber_upcall(yield_token<Self>& yield, std::tuple<Ts...>&& t)
+{
+    return fiber_upcall(yield, std::move(t), std::index_sequence_for<Ts...>{});
+}
+
+template<class Self, class T>
+upcall_guard
+fiber_upcall(yield_token<Self>& yield, T&& t)
+{
+    return yield.upcall(std::move(t));
+}
+
+// The value returned by the Function, kept until the upcall.
+template<class R>
+struct fiber_result
+{
+    template<class F, class Yield>
+    static void run(F& f, Yield yield, void* const& slot)
+    {
+        R r = f(yield);
+        // The fiber may have been resumed by a different invocation than the
+        // one which started it, the slot is read only after f returns.
+        static_cast<fiber_result*>(slot)->value_.emplace(std::move(r));
+    }
+
+    template<class Self>
+    upcall_guard upcall(yield_token<Self>& yield)
+    {
+        return fiber_upcall(yield, std::move(*value_));
+    }
+
+    boost::optional<R> value_;
+};
+
+template<>
+struct fiber_result<void>
+{
+    template<class F, class Yield>
+    static void run(F& f, Yield yield, void* const&)
+    {
+        f(yield);
+    }
+
+    template<class Self>
+    upcall_guard upcall(yield_token<Self>& yield)
+    {
+        return yield.upcall();
+    }
+};
+
+template<class Function>
+class fiber_body : public fiber_body_base
+{
+public:
+    template<class F>
+    explicit fiber_body(F&& f)
+      : f_{std::forward<F>(f)}
+    {
+    }
+
+    template<class Self>
+    upcall_guard operator()(yield_token<Self> yield)
+    {
+        using result_type = typename std::decay<decltype(
+          std::declval<Function&>()(std::declval<fiber_yield<Self>>()))>::type;
+
+        acquire();
+        fiber_result<result_type> result;
+        token_ = &yield;
+        result_ = &result;
+        if (!fiber_)
+        {
+            fiber_ = boost::context::fiber{
+              std::allocator_arg,
+              pooled_fiber_stack{},
+              [this](boost::context::fiber&& caller) {
+                  caller_ = std::move(caller);
+                  run<Self, result_type>();
+                  return std::move(caller_);
+              }};
+        }
+
+        fiber_ = std::move(fiber_).resume();
+        token_ = nullptr;
+        result_ = nullptr;
+        // A suspended fiber has released the operation into the handler of
+        // an initiated operation, which may already be waiting to resume it.
+        auto const suspended = static_cast<bool>(fiber_);
+        release();
+        if (suspended)
+            return {};
+
+        if (exception_)
+        {
+            auto e = std::move(exception_);
+            exception_ = nullptr;
+            std::rethrow_exception(e);
+        }
+        return result.upcall(yield);
+    }
+
+private:
+    template<class Self, class R>
+    void run()
+    {
+        try
+        {
+            fiber_result<R>::run(f_, fiber_yield<Self>{*this}, result_);
+        }
+        catch (boost::context::detail::forced_unwind const&)
+        {
+            throw;
+        }
+        catch (...)
+        {
+            exception_ = std::current_exception();
+        }
+    }
+
+    Function f_;
+};
+
+// The completion arguments of an operation initiated with a fiber_yield.
+template<class... Ts>
+struct fiber_results
+{
+    using type = std::tuple<Ts...>;
+
+    type get()
+    {
+        return std::move(*value_);
+    }
+
+    boost::optional<std::tuple<Ts...>> value_;
+};
+
+template<class T>
+struct fiber_results<T>
+{
+    using type = T;
+
+    type get()
+    {
+        return std::move(*value_);
+    }
+
+    boost::optional<T> value_;
+};
+
+template<>
+struct fiber_results<>
+{
+    using type = void;
+
+    void get()
+    {
+    }
+
+    boost::optional<std::tuple<>> value_;
+};
+
+/**
+ * The CompletionHandler created from a fiber_yield. Stores the completion
+ * arguments in the suspended initiating function's frame and resumes the
+ * composed operation.
+ */
+template<class ComposedOp, class... Ts>
+struct fiber_handler
+{
+    explicit fiber_handler(fiber_yield<ComposedOp> const& yield)
+      : op_{yield.release_operation()}
+      , yield_{yield}
+    {
+    }
+
+    template<class... Args>
+    void operator()(Args&&... args)
+    {
+        results_->value_.emplace(std::forward<Args>(args)...);
+        op_();
+    }
+
+    ComposedOp op_;
+    fiber_yield<ComposedOp> yield_;
+    fiber_results<Ts...>* results_ = nullptr;
+};
+
+} // namespace detail
+
+template<typename ComposedOp>
+ComposedOp
+fiber_yield<ComposedOp>::release_operation() const
+{
+    return body_->template token<ComposedOp>().release_operation();
+}
+
+template<typename ComposedOp>
+void
+fiber_yield<ComposedOp>::suspend() const
+{
+    body_->suspend();
+}
+
+template<typename Executor,
+         typename CompletionToken,
+         typename Signature,
+         typename Function>
+auto
+fiber_transform(Executor const& ex,
+                boost::asio::async_completion<CompletionToken, Signature>& init,
+                Function&& f)
+{
+    return detail::stable_transform<
+      Signature,
+      detail::fiber_body<typename std::decay<Function>::type>>(
+      ex, init, std::forward<Function>(f));
+}
+
+} // namespace compose
+
+namespace boost
+{
+namespace asio
+{
+
+template<class ComposedOp, class R, class... Ts>
+class async_result<compose::fiber_yield<ComposedOp>, R(Ts...)>
+{
+public:
+    using completion_handler_type =
+      compose::detail::fiber_handler<ComposedOp,
+                                     typename std::decay<Ts>::type...>;
+    using return_type = typename compose::detail::fiber_results<
+      typename std::decay<Ts>::type...>::type;
+
+    explicit async_result(completion_handler_type& handler)
+      : yield_{handler.yield_}
+    {
+        handler.results_ = &results_;
+    }
+
+    return_type get()
+    {
+        yield_.suspend();
+        assert(results_.value_ && "Resumed before the operation completed.");
+        return results_.get();
+    }
+
+private:
+    compose::fiber_yield<ComposedOp> yield_;
+    compose::detail::fiber_results<typename std::decay<Ts>::type...> results_;
+};
+
+template<class ComposedOp, class... Ts, class Ex>
+class associated_executor<compose::detail::fiber_handler<ComposedOp, Ts...>,
+                          Ex>
+{
+public:
+    using type = associated_executor_t<ComposedOp, Ex>;
+
+    static type get(
+      compose::detail::fiber_handler<ComposedOp, Ts...> const& handler,
+      Ex const& ex = Ex{})
+    {
+        return asio::get_associated_executor(handler.op_, ex);
+    }
+};
+
+template<class ComposedOp, class... Ts, class A>
+class associated_allocator<compose::detail::fiber_handler<ComposedOp, Ts...>,
+                           A>
+{
+public:
+    using type = associated_allocator_t<ComposedOp, A>;
+
+    static type get(
+      compose::detail::fiber_handler<ComposedOp, Ts...> const& handler,
+      A const& alloc = A{})
+    {
+        return asio::get_associated_allocator(handler.op_, alloc);
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#endif // COMPOSE_IMPL_FIBER_TRANSFORM_HPP
@@ -0,0 +1,290 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_FOR_EACH_BOUNDED_HPP
+#define COMPOSE_IMPL_FOR_EACH_BOUNDED_HPP
+
+#include <compose/detail/allocator_utils.hpp>
+#include <compose/detail/slot_block.hpp>
+#include <compose/for_each_bounded.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+
+#include <cassert>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace compose
+{
+namespace detail
+{
+
+template<class Self, std::size_t SlotSize>
+using for_each_block_t = slot_block<
+  boost::asio::associated_allocator_t<Self, default_allocator>,
+  SlotSize>;
+
+template<class Body, class Self>
+class for_each_handler
+{
+public:
+    using block_type = for_each_block_t<Self, Body::slot_size>;
+
+    for_each_handler(Body& body, block_type& block, std::size_t slot) noexcept
+      : body_{&body}
+      , block_{&block}
+      , slot_{slot}
+    {
+    }
+
+    for_each_handler(for_each_handler&& other) noexcept
+      : body_{other.body_}
+      , block_{other.block_}
+      , slot_{other.slot_}
+    {
+        other.body_ = nullptr;
+    }
+
+    for_each_handler(for_each_handler const&) = delete;
+    for_each_handler& operator=(for_each_handler&&) = delete;
+    for_each_handler& operator=(for_each_handler const&) = delete;
+
+    ~for_each_handler()
+    {
+        if (body_ != nullptr)
+            body_->template abandon<Self>();
+    }
+
+    template<class... Args>
+    void operator()(boost::system::error_code ec, Args&&...)
+    {
+        auto const body = body_;
+        body_ = nullptr;
+        body->template complete<Self>(slot_, ec);
+    }
+
+    template<class H, class E>
+    friend class boost::asio::associated_executor;
+
+    template<class H, class A>
+    friend class boost::asio::associated_allocator;
+
+private:
+    Body* body_;
+    block_type* block_;
+    std::size_t slot_;
+};
+
+template<class Iterator, class Factory, std::size_t SlotSize>
+class for_each_bounded_op
+{
+public:
+    static constexpr std::size_t slot_size = SlotSize;
+
+    template<class F>
+    for_each_bounded_op(Iterator first,
+                        Iterator last,
+                        std::size_t limit,
+                        F&& factory)
+      : next_{first}
+      , last_{last}
+      , limit_{limit}
+      , factory_{std::forward<F>(factory)}
+    {
+        assert(limit_ > 0 && "At least one child operation must be allowed.");
+    }
+
+    for_each_bounded_op(for_each_bounded_op const&) = delete;
+    for_each_bounded_op& operator=(for_each_bounded_op const&) = delete;
+
+    template<class Self>
+    upcall_guard operator()(yield_token<Self> yield)
+    {
+        static_assert(sizeof(Self) <= sizeof(owner_) &&
+                        alignof(Self) <= alignof(decltype(owner_)),
+                      "The ComposedOperation must be stable.");
+
+        if (next_ == last_)
+            return yield.post_upcall(boost::system::error_code{},
+                                     std::size_t{0});
+
+        auto& owner =
+          *::new (static_cast<void*>(&owner_)) Self{yield.release_operation()};
+        auto& block = *for_each_block_t<Self, SlotSize>::create(
+          boost::asio::get_associated_allocator(owner, default_allocator{}),
+          limit_);
+        block_ = &block;
+
+        for (std::size_t slot = 0; slot < limit_ && next_ != last_; ++slot)
+            start<Self>(block, slot);
+        return {};
+    }
+
+    template<class Self>
+    Self& owner() noexcept
+    {
+        return *static_cast<Self*>(static_cast<void*>(&owner_));
+    }
+
+    template<class Self>
+    void complete(std::size_t slot, boost::system::error_code ec)
+    {
+        --in_flight_;
+        if (ec && failures_++ == 0)
+            first_error_ = ec;
+
+        auto& block = *static_cast<for_each_block_t<Self, SlotSize>*>(block_);
+        block.slot(slot).reset();
+        if (next_ != last_)
+            return start<Self>(block, slot);
+
+        if (in_flight_ == 0)
+        {
+            auto const first_error = first_error_;
+            auto const failures = failures_;
+            auto op = release_owner<Self>();
+            (void)yield_token<Self>{op, true}.direct_upcall(first_error,
+                                                             failures);
+        }
+    }
+
+    template<class Self>
+    void abandon() noexcept
+    {
+        // The child operation was destroyed without being invoked, e.g.
+        // because the execution context is being shut down.
+        if (--in_flight_ == 0)
+            (void)release_owner<Self>();
+    }
+
+private:
+    template<class Self>
+    void start(for_each_block_t<Self, SlotSize>& block, std::size_t slot)
+    {
+        auto const it = next_;
+        ++next_;
+        ++in_flight_;
+        factory_(*it,
+                 for_each_handler<for_each_bounded_op, Self>{
+                   *this, block, slot});
+    }
+
+    template<class Self>
+    Self release_owner() noexcept
+    {
+        static_cast<for_each_block_t<Self, SlotSize>*>(block_)->release();
+        block_ = nullptr;
+        auto& owner = this->owner<Self>();
+        Self op{std::move(owner)};
+        owner.~Self();
+        return op;
+    }
+
+    Iterator next_;
+    Iterator last_;
+    std::size_t limit_;
+    Factory factory_;
+    std::size_t in_flight_ = 0;
+    std::size_t failures_ = 0;
+    boost::system::error_code first_error_;
+    void* block_ = nullptr;
+    typename std::aligned_storage<2 * sizeof(void*)>::type owner_;
+};
+
+template<class Iterator, class Factory, std::size_t SlotSize>
+constexpr std::size_t
+  for_each_bounded_op<Iterator, Factory, SlotSize>::slot_size;
+
+} // namespace detail
+
+template<std::size_t SlotSize,
+         typename Executor,
+         typename Range,
+         typename OperationFactory,
+         typename CompletionToken>
+auto
+async_for_each_bounded(Executor const& ex,
+                       Range const& range,
+                       std::size_t limit,
+                       OperationFactory&& factory,
+                       CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    using std::begin;
+    using std::end;
+    using iterator_type = decltype(begin(range));
+
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    compose::stable_transform<detail::for_each_bounded_op<
+      iterator_type,
+      typename std::decay<OperationFactory>::type,
+      SlotSize>>(ex,
+                 init,
+                 std::piecewise_construct,
+                 begin(range),
+                 end(range),
+                 limit,
+                 std::forward<OperationFactory>(factory))
+      .run();
+    return init.result.get();
+}
+
+} // namespace compose
+
+namespace boost
+{
+namespace asio
+{
+
+template<class Body, class Self, class Ex>
+class associated_executor<::compose::detail::for_each_handler<Body, Self>, Ex>
+{
+public:
+    using type = associated_executor_t<Self, Ex>;
+
+    static type get(
+      ::compose::detail::for_each_handler<Body, Self> const& handler,
+      Ex const& ex = Ex{})
+    {
+        return associated_executor<Self, Ex>::get(
+          handler.body_->template owner<Self>(), ex);
+    }
+};
+
+template<class Body, class Self, class A>
+class associated_allocator<::compose::detail::for_each_handler<Body, Self>, A>
+{
+public:
+    using type = ::compose::detail::slot_allocator<
+      void,
+      associated_allocator_t<Self, ::compose::detail::default_allocator>,
+      Body::slot_size>;
+
+    // Only uses the slot block, which outlives the body if the handler is
+    // destroyed before its memory is deallocated.
+    static type get(
+      ::compose::detail::for_each_handler<Body, Self> const& handler,
+      A const& = A{})
+    {
+        return type{*handler.block_, handler.slot_};
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#endif // COMPOSE_IMPL_FOR_EACH_BOUNDED_HPP
@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_FRAME_READER_HPP
+#define COMPOSE_IMPL_FRAME_READER_HPP
+
+#include <compose/frame_reader.hpp>
+
+#include <compose/unstable_transform.hpp>
+
+#include <boost/asio/error.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace compose
+{
+
+template<typename AsyncReadStream>
+class frame_reader<AsyncReadStream>::read_op
+{
+public:
+    explicit read_op(frame_reader& reader) noexcept
+      : reader_{&reader}
+    {
+    }
+
+    template<typename Self>
+    upcall_guard operator()(yield_token<Self> yield,
+                            boost::system::error_code ec = {},
+                            std::size_t n = 0)
+    {
+        auto& r = *reader_;
+        r.end_ += n;
+        if (!ec)
+            r.decode(ec);
+        if (!ec && r.frames_.empty())
+        {
+            r.compact();
+            return r.stream_.async_read_some(
+              boost::asio::buffer(r.data_ + r.end_, r.capacity_ - r.end_),
+              yield);
+        }
+        return yield.upcall(ec, r.frames_.size());
+    }
+
+private:
+    frame_reader* reader_;
+};
+
+template<typename AsyncReadStream>
+frame_reader<AsyncReadStream>::frame_reader(AsyncReadStream& stream,
+                                            std::size_t max_frame_size,
+                                            std::size_t prefix_size)
+  : stream_{stream}
+  , max_frame_size_{max_frame_size}
+  , prefix_size_{prefix_size}
+  , capacity_{std::max(detail::pooled_buffer::size(),
+                       max_frame_size + prefix_size)}
+{
+    assert(prefix_size_ >= 1 && prefix_size_ <= 8 &&
+           "The length prefix must be between 1 and 8 bytes long.");
+    if (capacity_ == detail::pooled_buffer::size())
+        data_ = pooled_.data();
+    else
+    {
+        owned_.resize(capacity_);
+        data_ = owned_.data();
+    }
+}
+
+template<typename AsyncReadStream>
+template<typename CompletionToken>
+auto
+frame_reader<AsyncReadStream>::async_read_frames(CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    unstable_transform(stream_.get_executor(), init, read_op{*this}).run();
+    return init.result.get();
+}
+
+// Replaces the previous batch with the complete frames that follow it.
+template<typename AsyncReadStream>
+void
+frame_reader<AsyncReadStream>::decode(boost::system::error_code& ec)
+{
+    frames_.clear();
+    while (end_ - begin_ >= prefix_size_)
+    {
+        auto const p =
+          reinterpret_cast<unsigned char const*>(data_ + begin_);
+        std::uint64_t length = 0;
+        for (std::size_t i = 0; i < prefix_size_; ++i)
+            length = (length << 8) | p[i];
+
+        if (length > max_frame_size_)
+        {
+            // The frames before it are delivered first.
+            if (frames_.empty())
+                ec = boost::asio::error::message_size;
+            return;
+        }
+
+        auto const size = static_cast<std::size_t>(length);
+        if (end_ - begin_ - prefix_size_ < size)
+            return;
+        frames_.emplace_back(data_ + begin_ + prefix_size_, size);
+        begin_ += prefix_size_ + size;
+    }
+}
+
+// Moves the partial frame which ends the buffer to its front.
+template<typename AsyncReadStream>
+void
+frame_reader<AsyncReadStream>::compact() noexcept
+{
+    if (begin_ == 0)
+        return;
+    std::memmove(data_, data_ + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_FRAME_READER_HPP
@@ -0,0 +1,285 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_OFFLOAD_HPP
+#define COMPOSE_IMPL_OFFLOAD_HPP
+
+#include <compose/detail/allocator_utils.hpp>
+#include <compose/offload.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/optional.hpp>
+
+#include <cassert>
+#include <exception>
+#include <memory>
+#include <utility>
+
+namespace compose
+{
+namespace detail
+{
+
+/**
+ * The Allocator associated with the handlers of an offloaded step. Serves one
+ * allocation at a time from the memory of the offload_slot and forwards the
+ * rest to the Allocator associated with the composed operation.
+ */
+template<class T, class Upstream>
+class offload_allocator
+{
+    template<class U>
+    using upstream_t =
+      typename std::allocator_traits<Upstream>::template rebind_alloc<U>;
+
+public:
+    using value_type = T;
+
+    offload_allocator(offload_block& block, Upstream const& upstream) noexcept
+      : block_{&block}
+      , upstream_{upstream}
+    {
+    }
+
+    template<class U>
+    offload_allocator(offload_allocator<U, Upstream> const& other) noexcept
+      : block_{other.block()}
+      , upstream_{other.upstream()}
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        if (!block_->in_use_ && alignof(T) <= alignof(std::max_align_t) &&
+            n <= block_->capacity_ / sizeof(T))
+        {
+            block_->in_use_ = true;
+            return static_cast<T*>(block_->data_);
+        }
+
+        upstream_t<T> alloc{upstream_};
+        return std::allocator_traits<upstream_t<T>>::allocate(alloc, n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        if (p == block_->data_)
+        {
+            block_->in_use_ = false;
+            return;
+        }
+
+        upstream_t<T> alloc{upstream_};
+        std::allocator_traits<upstream_t<T>>::deallocate(alloc, p, n);
+    }
+
+    offload_block* block() const noexcept
+    {
+        return block_;
+    }
+
+    Upstream const& upstream() const noexcept
+    {
+        return upstream_;
+    }
+
+private:
+    offload_block* block_;
+    Upstream upstream_;
+};
+
+template<class T, class U, class Upstream>
+bool
+operator==(offload_allocator<T, Upstream> const& lhs,
+           offload_allocator<U, Upstream> const& rhs) noexcept
+{
+    return lhs.block() == rhs.block();
+}
+
+template<class T, class U, class Upstream>
+bool
+operator!=(offload_allocator<T, Upstream> const& lhs,
+           offload_allocator<U, Upstream> const& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+template<class ComposedOp>
+using offload_allocator_t = offload_allocator<
+  void,
+  boost::asio::associated_allocator_t<ComposedOp, default_allocator>>;
+
+template<class ComposedOp>
+offload_allocator_t<ComposedOp>
+make_offload_allocator(offload_block& block, ComposedOp const& op) noexcept
+{
+    return {block,
+            boost::asio::get_associated_allocator(op, default_allocator{})};
+}
+
+// The value returned by the Function, kept until the composed operation is
+// resumed.
+template<typename Result>
+struct offload_result
+{
+    template<typename Function>
+    void run(Function& f)
+    {
+        try
+        {
+            value_.emplace(f());
+        }
+        catch (...)
+        {
+            exception_ = std::current_exception();
+        }
+    }
+
+    template<typename ComposedOp>
+    void resume(ComposedOp& op)
+    {
+        if (exception_)
+            std::rethrow_exception(std::exchange(exception_, nullptr));
+
+        // The slot is destroyed with the frame if the operation completes.
+        Result r{std::move(*value_)};
+        value_ = boost::none;
+        op(std::move(r));
+    }
+
+    boost::optional<Result> value_;
+    std::exception_ptr exception_;
+};
+
+template<>
+struct offload_result<void>
+{
+    template<typename Function>
+    void run(Function& f)
+    {
+        try
+        {
+            f();
+        }
+        catch (...)
+        {
+            exception_ = std::current_exception();
+        }
+    }
+
+    template<typename ComposedOp>
+    void resume(ComposedOp& op)
+    {
+        if (exception_)
+            std::rethrow_exception(std::exchange(exception_, nullptr));
+
+        op();
+    }
+
+    std::exception_ptr exception_;
+};
+
+// Resumes the composed operation with the result of the offloaded step.
+template<typename Slot, typename ComposedOp>
+class offload_resume
+{
+public:
+    using allocator_type = offload_allocator_t<ComposedOp>;
+
+    offload_resume(ComposedOp&& op, Slot& slot) noexcept
+      : op_{std::move(op)}
+      , slot_{&slot}
+    {
+    }
+
+    offload_resume(offload_resume&&) = default;
+
+    void operator()()
+    {
+        slot_->pending_ = false;
+        slot_->result_.resume(op_);
+    }
+
+    allocator_type get_allocator() const noexcept
+    {
+        return make_offload_allocator(slot_->block_, op_);
+    }
+
+private:
+    ComposedOp op_;
+    Slot* slot_;
+};
+
+// Runs the offloaded step on the compute executor.
+template<typename Slot, typename ComposedOp, typename Function>
+class offload_work
+{
+public:
+    using allocator_type = offload_allocator_t<ComposedOp>;
+
+    template<typename F>
+    offload_work(ComposedOp&& op, Slot& slot, F&& f)
+      : op_{std::move(op)}
+      , slot_{&slot}
+      , f_{std::forward<F>(f)}
+    {
+    }
+
+    offload_work(offload_work&&) = default;
+
+    void operator()()
+    {
+        {
+            // Destroyed before the composed operation may be resumed on
+            // another thread.
+            Function f{std::move(f_)};
+            slot_->result_.run(f);
+        }
+
+        auto const ex = boost::asio::get_associated_executor(op_);
+        boost::asio::post(
+          ex, offload_resume<Slot, ComposedOp>{std::move(op_), *slot_});
+    }
+
+    allocator_type get_allocator() const noexcept
+    {
+        return make_offload_allocator(slot_->block_, op_);
+    }
+
+private:
+    ComposedOp op_;
+    Slot* slot_;
+    Function f_;
+};
+
+} // namespace detail
+
+template<typename Result, std::size_t Reserve>
+template<typename Executor, typename Function, typename ComposedOp>
+upcall_guard
+offload_slot<Result, Reserve>::post(Executor const& ex,
+                                    Function&& f,
+                                    yield_token<ComposedOp> yield)
+{
+    assert(!pending_ && "Only one step may be in flight per offload_slot.");
+    pending_ = true;
+    boost::asio::post(
+      ex,
+      detail::offload_work<offload_slot,
+                           ComposedOp,
+                           typename std::decay<Function>::type>{
+        yield.release_operation(), *this, std::forward<Function>(f)});
+    return {};
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_OFFLOAD_HPP
@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_OPERATION_REGISTRY_HPP
+#define COMPOSE_IMPL_OPERATION_REGISTRY_HPP
+
+#include <compose/operation_registry.hpp>
+
+#include <cassert>
+
+namespace compose
+{
+
+inline registry_hook::~registry_hook()
+{
+    unlink();
+}
+
+template<typename Cancellable>
+void
+registry_hook::link(operation_registry& registry, Cancellable& target) noexcept
+{
+    assert(!is_linked() && "The hook is already linked.");
+    link_before(registry.hooks_);
+    registry_ = &registry;
+    cancel_ = &registry_hook::cancel_target<Cancellable>;
+    target_ = &target;
+    ++registry.size_;
+}
+
+inline void
+registry_hook::unlink() noexcept
+{
+    if (!is_linked())
+        return;
+
+    detail::list_node::unlink();
+    --registry_->size_;
+    registry_ = nullptr;
+    cancel_ = nullptr;
+    target_ = nullptr;
+}
+
+template<typename Cancellable>
+void
+registry_hook::cancel_target(void* target)
+{
+    static_cast<Cancellable*>(target)->cancel();
+}
+
+inline operation_registry::operation_registry() noexcept = default;
+
+inline operation_registry::~operation_registry()
+{
+    while (hooks_.is_linked())
+        static_cast<registry_hook*>(hooks_.next_)->unlink();
+}
+
+inline std::size_t
+operation_registry::cancel_all()
+{
+    // Hooks are moved to a local list and linked back one at a time, so that
+    // cancel() functions may freely link and unlink hooks, including the
+    // ones which have not been visited yet.
+    detail::list_node pending;
+    pending.splice(hooks_);
+
+    std::size_t n = 0;
+    while (pending.is_linked())
+    {
+        auto& hook = *static_cast<registry_hook*>(pending.next_);
+        hook.detail::list_node::unlink();
+        hook.link_before(hooks_);
+        hook.cancel_(hook.target_);
+        ++n;
+    }
+
+    return n;
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_OPERATION_REGISTRY_HPP
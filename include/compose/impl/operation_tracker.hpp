@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_OPERATION_TRACKER_HPP
+#define COMPOSE_IMPL_OPERATION_TRACKER_HPP
+
+#include <compose/detail/execution_context.hpp>
+#include <compose/operation_tracker.hpp>
+
+#include <boost/core/demangle.hpp>
+
+namespace compose
+{
+
+namespace detail
+{
+
+inline tracked_frame::~tracked_frame()
+{
+    if (tracker_ != nullptr)
+        tracker_->remove(*this);
+}
+
+template<typename Executor>
+void
+tracked_frame::attach(Executor const& ex,
+                      std::type_info const& type,
+                      std::size_t frame_size)
+{
+    type_ = &type;
+    frame_size_ = frame_size;
+    hop(false);
+    auto& tracker = boost::asio::use_service<operation_tracker>(
+      detail::get_execution_context(ex, nullptr));
+    tracker.add(*this);
+    tracker_ = &tracker;
+}
+
+} // namespace detail
+
+inline operation_tracker::operation_tracker(boost::asio::execution_context& ctx)
+  : boost::asio::detail::execution_context_service_base<operation_tracker>{ctx}
+{
+}
+
+template<typename F>
+void
+operation_tracker::for_each(F&& f) const
+{
+    auto const now = std::chrono::steady_clock::now().time_since_epoch();
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (auto node = frames_.next_; node != &frames_; node = node->next_)
+    {
+        auto const& frame = *static_cast<detail::tracked_frame const*>(node);
+        auto const last_hop = std::chrono::steady_clock::duration{
+          frame.last_hop_.load(std::memory_order_relaxed)};
+        f(operation_info{
+          boost::core::demangle(frame.type_->name()),
+          frame.coroutine_state_.load(std::memory_order_relaxed),
+          frame.hops_.load(std::memory_order_relaxed),
+          now - last_hop,
+          frame.frame_size_});
+    }
+}
+
+inline std::vector<operation_info>
+operation_tracker::snapshot() const
+{
+    std::vector<operation_info> infos;
+    for_each(
+      [&infos](operation_info info) { infos.push_back(std::move(info)); });
+    return infos;
+}
+
+inline std::size_t
+operation_tracker::size() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return size_;
+}
+
+inline void
+operation_tracker::shutdown()
+{
+    // Frames which are not owned by the execution context (e.g. operations
+    // suspended on a channel) may outlive this service.
+    std::lock_guard<std::mutex> lock{mutex_};
+    while (frames_.is_linked())
+    {
+        auto& frame = *static_cast<detail::tracked_frame*>(frames_.next_);
+        frame.unlink();
+        frame.tracker_ = nullptr;
+    }
+    size_ = 0;
+}
+
+inline void
+operation_tracker::add(detail::tracked_frame& frame)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    frame.link_before(frames_);
+    ++size_;
+}
+
+inline void
+operation_tracker::remove(detail::tracked_frame& frame)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    frame.unlink();
+    --size_;
+}
+
+template<typename Executor>
+std::vector<operation_info>
+tracked_operations(Executor const& ex)
+{
+    return boost::asio::use_service<operation_tracker>(
+             detail::get_execution_context(ex, nullptr))
+      .snapshot();
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_OPERATION_TRACKER_HPP
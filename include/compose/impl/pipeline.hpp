@@ -0,0 +1,314 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_PIPELINE_HPP
+#define COMPOSE_IMPL_PIPELINE_HPP
+
+#include <compose/detail/allocator_utils.hpp>
+#include <compose/pipeline.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+#include <boost/asio/associated_executor.hpp>
+
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
+namespace compose
+{
+namespace detail
+{
+
+/**
+ * The CompletionHandler of a read (Write = false) or write (Write = true)
+ * stage of a pipeline. Refers to the frame of the pipeline, which owns the
+ * ComposedOperation while stages are in flight.
+ */
+template<class Body, class Self, bool Write>
+class pipeline_handler
+{
+public:
+    using allocator_type =
+      boost::asio::associated_allocator_t<Self, default_allocator>;
+
+    explicit pipeline_handler(Body& body) noexcept
+      : body_{&body}
+      , alloc_{boost::asio::get_associated_allocator(
+          body.template owner<Self>(), default_allocator{})}
+    {
+    }
+
+    pipeline_handler(pipeline_handler&& other) noexcept
+      : body_{other.body_}
+      , alloc_{other.alloc_}
+    {
+        other.body_ = nullptr;
+    }
+
+    pipeline_handler(pipeline_handler const&) = delete;
+    pipeline_handler& operator=(pipeline_handler&&) = delete;
+    pipeline_handler& operator=(pipeline_handler const&) = delete;
+
+    ~pipeline_handler()
+    {
+        if (body_ != nullptr)
+            body_->template abandon<Self, Write>();
+    }
+
+    template<class... Args>
+    void operator()(boost::system::error_code ec, Args&&...)
+    {
+        auto const body = body_;
+        body_ = nullptr;
+        body->template complete<Self, Write>(ec);
+    }
+
+    template<class H, class E>
+    friend class boost::asio::associated_executor;
+
+    template<class H, class A>
+    friend class boost::asio::associated_allocator;
+
+private:
+    Body* body_;
+    // The execution context may deallocate the memory of the stage after
+    // the handler, and with it the frame, has been destroyed.
+    allocator_type alloc_;
+};
+
+template<class AsyncStream, class Stages, std::size_t Depth>
+class pipeline_op
+{
+    static_assert(Depth > 0, "The pipeline must hold at least one message.");
+
+public:
+    using message_type = typename Stages::message_type;
+
+    template<class S>
+    pipeline_op(AsyncStream& stream, S&& stages)
+      : stream_{stream}
+      , stages_{std::forward<S>(stages)}
+    {
+    }
+
+    pipeline_op(pipeline_op const&) = delete;
+    pipeline_op& operator=(pipeline_op const&) = delete;
+
+    template<class Self>
+    upcall_guard operator()(yield_token<Self> yield)
+    {
+        static_assert(sizeof(Self) <= sizeof(owner_) &&
+                        alignof(Self) <= alignof(decltype(owner_)),
+                      "The ComposedOperation must be stable.");
+
+        ::new (static_cast<void*>(&owner_)) Self{yield.release_operation()};
+        start_read<Self>();
+        return {};
+    }
+
+    template<class Self>
+    Self& owner() noexcept
+    {
+        return *static_cast<Self*>(static_cast<void*>(&owner_));
+    }
+
+    template<class Self, bool Write>
+    void complete(boost::system::error_code ec)
+    {
+        if (Write)
+            written<Self>(ec);
+        else
+            read<Self>(ec);
+
+        if (reading_ || writing_)
+            return;
+
+        // Reading has stopped and no message can be written anymore.
+        assert(stopped_);
+        auto const error = write_error_ ? write_error_ : read_error_;
+        auto const n = written_;
+        auto op = release_owner<Self>();
+        (void)yield_token<Self>{op, true}.direct_upcall(error, n);
+    }
+
+    template<class Self, bool Write>
+    void abandon() noexcept
+    {
+        // The stage was destroyed without being invoked, e.g. because the
+        // execution context is being shut down.
+        (Write ? writing_ : reading_) = false;
+        stopped_ = true;
+        if (!reading_ && !writing_)
+            (void)release_owner<Self>();
+    }
+
+private:
+    template<class Self>
+    void read(boost::system::error_code ec)
+    {
+        reading_ = false;
+        if (ec)
+        {
+            stopped_ = true;
+            read_error_ = ec;
+            return;
+        }
+
+        // A failed write has stopped the pipeline. The message is dropped
+        // instead of writing the failed one again.
+        if (write_error_)
+            return;
+
+        stages_.process(slots_[(front_ + queued_) % Depth]);
+        ++queued_;
+        if (!writing_)
+            start_write<Self>();
+        start_read<Self>();
+    }
+
+    template<class Self>
+    void written(boost::system::error_code ec)
+    {
+        writing_ = false;
+        if (ec)
+        {
+            stopped_ = true;
+            write_error_ = ec;
+            return;
+        }
+
+        ++written_;
+        front_ = (front_ + 1) % Depth;
+        --queued_;
+        if (queued_ > 0)
+            start_write<Self>();
+        // The reader may have been waiting for a free slot.
+        if (!reading_)
+            start_read<Self>();
+    }
+
+    template<class Self>
+    void start_read()
+    {
+        if (stopped_ || queued_ == Depth)
+            return;
+
+        reading_ = true;
+        stages_.async_read(
+          stream_,
+          slots_[(front_ + queued_) % Depth],
+          pipeline_handler<pipeline_op, Self, false>{*this});
+    }
+
+    template<class Self>
+    void start_write()
+    {
+        writing_ = true;
+        stages_.async_write(stream_,
+                            slots_[front_],
+                            pipeline_handler<pipeline_op, Self, true>{*this});
+    }
+
+    template<class Self>
+    Self release_owner() noexcept
+    {
+        auto& owner = this->owner<Self>();
+        Self op{std::move(owner)};
+        owner.~Self();
+        return op;
+    }
+
+    AsyncStream& stream_;
+    Stages stages_;
+    message_type slots_[Depth];
+    std::size_t front_ = 0;
+    std::size_t queued_ = 0;
+    std::size_t written_ = 0;
+    bool reading_ = false;
+    bool writing_ = false;
+    bool stopped_ = false;
+    boost::system::error_code read_error_;
+    boost::system::error_code write_error_;
+    typename std::aligned_storage<2 * sizeof(void*)>::type owner_;
+};
+
+} // namespace detail
+
+template<std::size_t Depth,
+         typename AsyncStream,
+         typename Stages,
+         typename CompletionToken>
+auto
+async_pipeline(AsyncStream& stream, Stages&& stages, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    compose::stable_transform<
+      detail::pipeline_op<AsyncStream,
+                          typename std::decay<Stages>::type,
+                          Depth>>(stream.get_executor(),
+                                  init,
+                                  std::piecewise_construct,
+                                  stream,
+                                  std::forward<Stages>(stages))
+      .run();
+    return init.result.get();
+}
+
+} // namespace compose
+
+namespace boost
+{
+namespace asio
+{
+
+template<class Body, class Self, bool Write, class Ex>
+class associated_executor<
+  ::compose::detail::pipeline_handler<Body, Self, Write>,
+  Ex>
+{
+public:
+    using type = associated_executor_t<Self, Ex>;
+
+    static type get(
+      ::compose::detail::pipeline_handler<Body, Self, Write> const& handler,
+      Ex const& ex = Ex{})
+    {
+        return associated_executor<Self, Ex>::get(
+          handler.body_->template owner<Self>(), ex);
+    }
+};
+
+template<class Body, class Self, bool Write, class A>
+class associated_allocator<
+  ::compose::detail::pipeline_handler<Body, Self, Write>,
+  A>
+{
+public:
+    using type = typename ::compose::detail::
+      pipeline_handler<Body, Self, Write>::allocator_type;
+
+    static type get(
+      ::compose::detail::pipeline_handler<Body, Self, Write> const& handler,
+      A const& = A{})
+    {
+        return handler.alloc_;
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#endif // COMPOSE_IMPL_PIPELINE_HPP
@@ -0,0 +1,273 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_PRIORITY_SCHEDULER_HPP
+#define COMPOSE_IMPL_PRIORITY_SCHEDULER_HPP
+
+#include <compose/detail/allocator_utils.hpp>
+#include <compose/detail/lean_ptr.hpp>
+#include <compose/priority_scheduler.hpp>
+
+#include <boost/asio/post.hpp>
+
+#include <cassert>
+#include <memory>
+#include <type_traits>
+
+namespace compose
+{
+namespace detail
+{
+
+// A scheduler whose handlers are being run on this thread. Drains of distinct
+// schedulers may nest, e.g. when a handler runs an execution context.
+struct drain_scope
+{
+    explicit drain_scope(void const* scheduler) noexcept
+      : scheduler_{scheduler}
+      , next_{top()}
+    {
+        top() = this;
+    }
+
+    drain_scope(drain_scope const&) = delete;
+    drain_scope& operator=(drain_scope const&) = delete;
+
+    ~drain_scope()
+    {
+        top() = next_;
+    }
+
+    static bool contains(void const* scheduler) noexcept
+    {
+        for (auto scope = top(); scope != nullptr; scope = scope->next_)
+        {
+            if (scope->scheduler_ == scheduler)
+                return true;
+        }
+        return false;
+    }
+
+    static drain_scope*& top() noexcept
+    {
+        static thread_local drain_scope* scope = nullptr;
+        return scope;
+    }
+
+    void const* scheduler_;
+    drain_scope* next_;
+};
+
+} // namespace detail
+
+template<typename Executor>
+template<typename Function, typename Allocator>
+struct priority_scheduler<Executor>::function_item : item
+{
+    using allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<function_item>;
+
+    template<typename F>
+    function_item(F&& f, Allocator const& a)
+      : function_{std::forward<F>(f)}
+      , alloc_{a}
+    {
+        this->complete_ = &complete;
+    }
+
+    // The function is moved out and the item deallocated before the
+    // invocation, so that the memory can be reused by the operations the
+    // function initiates.
+    static void complete(item* base, bool invoke)
+    {
+        auto const self = static_cast<function_item*>(base);
+        allocator_type alloc{self->alloc_};
+        Function function{std::move(self->function_)};
+        detail::deleter<allocator_type>{alloc}(self);
+        if (invoke)
+            function();
+    }
+
+    Function function_;
+    Allocator alloc_;
+};
+
+template<typename Executor>
+struct priority_scheduler<Executor>::drainer
+{
+    void operator()() const
+    {
+        scheduler_->drain();
+    }
+
+    priority_scheduler* scheduler_;
+};
+
+template<typename Executor>
+priority_scheduler<Executor>::priority_scheduler(
+  Executor const& ex,
+  std::size_t classes,
+  std::size_t starvation_limit)
+  : inner_{ex}
+  , starvation_limit_{starvation_limit}
+  , queues_(classes)
+{
+    assert(classes > 0 && "A priority_scheduler needs at least one class");
+}
+
+template<typename Executor>
+priority_scheduler<Executor>::~priority_scheduler()
+{
+    for (auto& q : queues_)
+    {
+        while (q.items_.is_linked())
+        {
+            auto const i = static_cast<item*>(q.items_.next_);
+            i->unlink();
+            i->complete_(i, false);
+        }
+    }
+}
+
+template<typename Executor>
+priority_executor<Executor>
+priority_scheduler<Executor>::get_executor(std::size_t priority) noexcept
+{
+    assert(priority < queues_.size() && "Invalid priority class");
+    return {*this, priority};
+}
+
+template<typename Executor>
+bool
+priority_scheduler<Executor>::running_in_this_thread() const noexcept
+{
+    return detail::drain_scope::contains(this);
+}
+
+template<typename Executor>
+template<typename Function, typename Allocator>
+void
+priority_scheduler<Executor>::enqueue(std::size_t priority,
+                                      Function&& f,
+                                      Allocator const& a)
+{
+    using item_type =
+      function_item<typename std::decay<Function>::type, Allocator>;
+    using allocator_type = typename item_type::allocator_type;
+
+    allocator_type alloc{a};
+    std::allocator_traits<allocator_type> traits;
+    detail::lean_ptr<item_type, detail::deallocator<allocator_type>> p{
+      traits.allocate(alloc, 1), detail::deallocator<allocator_type>{alloc}};
+    traits.construct(alloc, p.t_, std::forward<Function>(f), a);
+    item* const i = p.t_;
+    p.t_ = nullptr;
+
+    bool start = false;
+    {
+        std::lock_guard<std::mutex> const lock{mutex_};
+        i->link_before(queues_[priority].items_);
+        start = !draining_;
+        draining_ = true;
+    }
+
+    if (start)
+        boost::asio::post(inner_, drainer{this});
+}
+
+template<typename Executor>
+typename priority_scheduler<Executor>::item*
+priority_scheduler<Executor>::pop()
+{
+    // The highest class that is not empty, unless a lower one was skipped
+    // too many times.
+    queue* top = nullptr;
+    queue* starved = nullptr;
+    for (auto& q : queues_)
+    {
+        if (!q.items_.is_linked())
+            continue;
+        if (top == nullptr)
+            top = &q;
+        else if (starved == nullptr && q.skipped_ >= starvation_limit_)
+            starved = &q;
+    }
+
+    auto const next = starved != nullptr ? starved : top;
+    if (next == nullptr)
+        return nullptr;
+
+    for (auto& q : queues_)
+    {
+        if (q.items_.is_linked() && &q != next)
+            ++q.skipped_;
+    }
+    next->skipped_ = 0;
+
+    auto const i = static_cast<item*>(next->items_.next_);
+    i->unlink();
+    return i;
+}
+
+template<typename Executor>
+void
+priority_scheduler<Executor>::drain()
+{
+    // Posts the next drain even if a handler throws.
+    struct guard
+    {
+        ~guard()
+        {
+            bool more = false;
+            {
+                std::lock_guard<std::mutex> const lock{self_.mutex_};
+                for (auto const& q : self_.queues_)
+                    more = more || q.items_.is_linked();
+                self_.draining_ = more;
+            }
+            if (more)
+                boost::asio::post(self_.inner_, drainer{&self_});
+        }
+
+        priority_scheduler& self_;
+    };
+
+    detail::drain_scope const scope{this};
+    guard const g{*this};
+    for (std::size_t n = 0; n < COMPOSE_PRIORITY_DRAIN_BUDGET; ++n)
+    {
+        item* i = nullptr;
+        {
+            std::lock_guard<std::mutex> const lock{mutex_};
+            i = pop();
+        }
+        if (i == nullptr)
+            break;
+        i->complete_(i, true);
+    }
+}
+
+template<typename Executor>
+template<typename Function, typename Allocator>
+void
+priority_executor<Executor>::dispatch(Function&& f, Allocator const& a) const
+{
+    if (scheduler_->running_in_this_thread())
+    {
+        typename std::decay<Function>::type function{
+          std::forward<Function>(f)};
+        function();
+        return;
+    }
+    scheduler_->enqueue(priority_, std::forward<Function>(f), a);
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_PRIORITY_SCHEDULER_HPP
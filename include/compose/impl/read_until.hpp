@@ -0,0 +1,173 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_READ_UNTIL_HPP
+#define COMPOSE_IMPL_READ_UNTIL_HPP
+
+#include <compose/detail/find_delimiter.hpp>
+#include <compose/read_until.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <string>
+#include <type_traits>
+
+namespace compose
+{
+namespace detail
+{
+
+template<typename Stream, typename DynamicBuffer>
+class read_until_op
+{
+public:
+    static_assert(boost::asio::is_dynamic_buffer_v1<DynamicBuffer>::value,
+                  "DynamicBuffer_v1 type requirements not met");
+
+    template<typename Buffer>
+    read_until_op(Stream& stream,
+                  Buffer&& buffer,
+                  boost::asio::string_view delim)
+      : stream_{stream}
+      , buffer_{std::forward<Buffer>(buffer)}
+      , delim_{delim.data(), delim.size()}
+    {
+        assert(!delim_.empty() && "The delimiter must not be empty.");
+    }
+
+    read_until_op(read_until_op const&) = delete;
+    read_until_op& operator=(read_until_op const&) = delete;
+
+    template<typename Self>
+    upcall_guard operator()(yield_token<Self> yield,
+                            boost::system::error_code ec = {},
+                            std::size_t n = 0)
+    {
+        if (reading_)
+            buffer_.commit(n);
+        if (!ec)
+        {
+            auto const found = scan();
+            if (found != npos)
+                return yield.upcall(ec, found + delim_.size());
+
+            auto const size = buffer_.size();
+            if (size == buffer_.max_size())
+                ec = boost::asio::error::not_found;
+            else
+            {
+                // The same growth policy as boost::asio::async_read_until.
+                auto const read_size = std::min<std::size_t>(
+                  std::max<std::size_t>(512, buffer_.capacity() - size),
+                  std::min<std::size_t>(65536, buffer_.max_size() - size));
+                reading_ = true;
+                return stream_.async_read_some(buffer_.prepare(read_size),
+                                               yield);
+            }
+        }
+        return yield.upcall(ec, std::size_t{0});
+    }
+
+private:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    // Scans the data which arrived since the last call.
+    std::size_t scan() noexcept
+    {
+        auto const buffers = buffer_.data();
+        auto const first = boost::asio::buffer_sequence_begin(buffers);
+        assert(std::distance(first, boost::asio::buffer_sequence_end(
+                                      buffers)) <= 1 &&
+               "The DynamicBuffer must be contiguous.");
+        auto const size = buffer_.size();
+        if (size == 0)
+            return npos;
+
+        auto const data = static_cast<char const*>(
+          boost::asio::const_buffer{*first}.data());
+        auto const found = find_delimiter(data + scanned_,
+                                          size - scanned_,
+                                          delim_.data(),
+                                          delim_.size());
+        if (found != size - scanned_)
+            return scanned_ + found;
+
+        // A delimiter may start within the last delim_.size() - 1 bytes.
+        if (size >= delim_.size())
+            scanned_ = size - delim_.size() + 1;
+        return npos;
+    }
+
+    Stream& stream_;
+    DynamicBuffer buffer_;
+    std::string delim_;
+    std::size_t scanned_ = 0;
+    bool reading_ = false;
+};
+
+template<typename Stream, typename DynamicBuffer>
+constexpr std::size_t read_until_op<Stream, DynamicBuffer>::npos;
+
+} // namespace detail
+
+template<typename AsyncReadStream,
+         typename DynamicBuffer,
+         typename CompletionToken>
+auto
+async_read_until(AsyncReadStream& stream,
+                 DynamicBuffer&& buffer,
+                 boost::asio::string_view delim,
+                 CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    stable_transform<
+      detail::read_until_op<AsyncReadStream,
+                            typename std::decay<DynamicBuffer>::type>>(
+      stream.get_executor(),
+      init,
+      std::piecewise_construct,
+      stream,
+      std::forward<DynamicBuffer>(buffer),
+      delim)
+      .run();
+    return init.result.get();
+}
+
+template<typename AsyncReadStream,
+         typename DynamicBuffer,
+         typename CompletionToken>
+auto
+async_read_until(AsyncReadStream& stream,
+                 DynamicBuffer&& buffer,
+                 char delim,
+                 CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    return compose::async_read_until(stream,
+                                     std::forward<DynamicBuffer>(buffer),
+                                     boost::asio::string_view{&delim, 1},
+                                     std::forward<CompletionToken>(tok));
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_READ_UNTIL_HPP
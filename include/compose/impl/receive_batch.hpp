@@ -0,0 +1,136 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_RECEIVE_BATCH_HPP
+#define COMPOSE_IMPL_RECEIVE_BATCH_HPP
+
+#include <compose/receive_batch.hpp>
+
+#include <compose/unstable_transform.hpp>
+
+#include <algorithm>
+
+namespace compose
+{
+
+template<typename Socket>
+class receive_batch<Socket>::receive_op
+{
+public:
+    receive_op(receive_batch& batch, Socket& socket) noexcept
+      : batch_{&batch}
+      , socket_{&socket}
+    {
+    }
+
+    template<typename Self>
+    upcall_guard operator()(yield_token<Self> yield,
+                            boost::system::error_code ec = {})
+    {
+        std::size_t n = 0;
+        if (!ec)
+            n = batch_->receive(*socket_, ec);
+        if (n == 0 && !ec)
+            return socket_->async_wait(Socket::wait_read, yield);
+        return yield.upcall(ec, n);
+    }
+
+private:
+    receive_batch* batch_;
+    Socket* socket_;
+};
+
+template<typename Socket>
+receive_batch<Socket>::receive_batch(std::size_t capacity,
+                                     std::size_t datagram_size)
+  : datagram_size_{datagram_size}
+  , buffer_(capacity * datagram_size)
+  , endpoints_(capacity)
+  , iov_(capacity)
+  , headers_(capacity)
+{
+    for (std::size_t i = 0; i < capacity; ++i)
+    {
+        iov_[i].iov_base = buffer_.data() + i * datagram_size;
+        iov_[i].iov_len = datagram_size;
+        headers_[i].msg_hdr.msg_iov = &iov_[i];
+        headers_[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+template<typename Socket>
+boost::asio::const_buffer
+receive_batch<Socket>::data(std::size_t i) const noexcept
+{
+    auto const length =
+      std::min<std::size_t>(headers_[i].msg_len, datagram_size_);
+    return {buffer_.data() + i * datagram_size_, length};
+}
+
+template<typename Socket>
+bool
+receive_batch<Socket>::truncated(std::size_t i) const noexcept
+{
+    return (headers_[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+}
+
+template<typename Socket>
+template<typename CompletionToken>
+auto
+receive_batch<Socket>::async_receive(Socket& socket, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    size_ = 0;
+    unstable_transform(socket.get_executor(), init, receive_op{*this, socket})
+      .run();
+    return init.result.get();
+}
+
+// Returns 0 without an error if no datagram is queued.
+template<typename Socket>
+std::size_t
+receive_batch<Socket>::receive(Socket& socket, boost::system::error_code& ec)
+{
+    for (std::size_t i = 0; i < headers_.size(); ++i)
+    {
+        auto& hdr = headers_[i].msg_hdr;
+        hdr.msg_name = endpoints_[i].data();
+        hdr.msg_namelen = static_cast<socklen_t>(endpoints_[i].capacity());
+        hdr.msg_flags = 0;
+    }
+
+    int n = 0;
+    do
+    {
+        n = detail::receive_messages(
+          socket.native_handle(), headers_.data(), headers_.size());
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0)
+    {
+        if (!detail::would_block(errno))
+            ec = detail::last_error();
+        return 0;
+    }
+
+    size_ = static_cast<std::size_t>(n);
+    for (std::size_t i = 0; i < size_; ++i)
+        endpoints_[i].resize(headers_[i].msg_hdr.msg_namelen);
+    return size_;
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_RECEIVE_BATCH_HPP
@@ -0,0 +1,393 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_SEND_BATCH_HPP
+#define COMPOSE_IMPL_SEND_BATCH_HPP
+
+#include <compose/send_batch.hpp>
+
+#include <compose/detail/bind_front_handler.hpp>
+#include <compose/detail/execution_context.hpp>
+#include <compose/detail/mmsg.hpp>
+#include <compose/detail/uring_op.hpp>
+#include <compose/uring_service.hpp>
+
+#include <boost/asio/basic_datagram_socket.hpp>
+#include <boost/asio/basic_seq_packet_socket.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <utility>
+
+namespace compose
+{
+namespace detail
+{
+
+// Sockets which preserve message boundaries, for which each buffer of a batch
+// is sent as a separate message.
+template<typename Socket>
+struct is_message_socket : std::false_type
+{
+};
+
+template<typename Protocol, typename Executor>
+struct is_message_socket<
+  boost::asio::basic_datagram_socket<Protocol, Executor>> : std::true_type
+{
+};
+
+template<typename Protocol, typename Executor>
+struct is_message_socket<
+  boost::asio::basic_seq_packet_socket<Protocol, Executor>> : std::true_type
+{
+};
+
+} // namespace detail
+
+template<typename Socket>
+class send_batch<Socket>::child_handler
+{
+public:
+    child_handler(send_batch* batch, std::size_t group) noexcept
+      : batch_{batch}
+      , group_{group}
+    {
+    }
+
+    child_handler(child_handler&& other) noexcept
+      : batch_{std::exchange(other.batch_, nullptr)}
+      , group_{other.group_}
+    {
+    }
+
+    child_handler& operator=(child_handler&&) = delete;
+
+    // A child destroyed without being invoked, e.g. by the shutdown of the
+    // execution context, gives up its share of the batch's handler.
+    ~child_handler()
+    {
+        if (batch_ != nullptr)
+            batch_->abandon();
+    }
+
+    void operator()(boost::system::error_code ec)
+    {
+        std::exchange(batch_, nullptr)->on_wait(group_, ec);
+    }
+
+    void operator()(boost::system::error_code ec, std::size_t n)
+    {
+        std::exchange(batch_, nullptr)->on_submit(group_, ec, n);
+    }
+
+private:
+    send_batch* batch_;
+    std::size_t group_;
+};
+
+template<typename Socket>
+send_batch<Socket>::send_batch(executor_type const& ex)
+  : ex_{ex}
+{
+}
+
+template<typename Socket>
+void
+send_batch<Socket>::add(Socket& socket, boost::asio::const_buffer buffer)
+{
+    entries_.push_back(entry{&socket, buffer, 0, {}});
+}
+
+template<typename Socket>
+void
+send_batch<Socket>::clear() noexcept
+{
+    entries_.clear();
+    order_.clear();
+    groups_.clear();
+}
+
+template<typename Socket>
+template<typename CompletionToken>
+auto
+send_batch<Socket>::async_send(CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    handler_ = std::move(init.completion_handler);
+    start();
+    return init.result.get();
+}
+
+template<typename Socket>
+void
+send_batch<Socket>::start()
+{
+    // Writes of each socket become adjacent, in the order they were added.
+    order_.resize(entries_.size());
+    for (std::size_t i = 0; i < order_.size(); ++i)
+    {
+        order_[i] = i;
+        entries_[i].transferred = 0;
+        entries_[i].ec = {};
+    }
+    std::stable_sort(
+      order_.begin(), order_.end(), [this](std::size_t a, std::size_t b) {
+          return std::less<Socket*>{}(entries_[a].socket, entries_[b].socket);
+      });
+
+    groups_.clear();
+    for (std::size_t i = 0; i < order_.size(); ++i)
+    {
+        auto const socket = entries_[order_[i]].socket;
+        if (groups_.empty() || groups_.back().socket != socket)
+            groups_.push_back(group{socket, i, i});
+        ++groups_.back().end;
+    }
+
+#ifdef COMPOSE_HAS_IO_URING
+    auto& ctx = detail::get_execution_context(ex_, nullptr);
+    use_uring_ = !detail::is_message_socket<Socket>::value &&
+                 boost::asio::has_service<uring_service>(ctx) &&
+                 boost::asio::use_service<uring_service>(ctx).is_enabled();
+#endif // COMPOSE_HAS_IO_URING
+
+    // Keeps the batch from completing while the writes are being started.
+    ++pending_;
+    for (std::size_t g = 0; g < groups_.size(); ++g)
+    {
+        if (use_uring_)
+            submit_group(g);
+        else if (!send_group(g))
+            wait_group(g);
+    }
+
+    if (--pending_ == 0)
+        complete(false);
+}
+
+// Returns false if the socket is not ready for writing.
+template<typename Socket>
+bool
+send_batch<Socket>::send_group(std::size_t g)
+{
+    auto& grp = groups_[g];
+    if (!detail::is_message_socket<Socket>::value)
+        advance(grp, 0);
+    auto const fd = grp.socket->native_handle();
+    while (grp.next != grp.end)
+    {
+        iovec iov[detail::mmsg_chunk];
+        std::size_t count = 0;
+        for (auto i = grp.next;
+             i != grp.end && count < detail::mmsg_chunk;
+             ++i, ++count)
+        {
+            auto const& e = entries_[order_[i]];
+            iov[count].iov_base = const_cast<char*>(
+              static_cast<char const*>(e.buffer.data()) + e.transferred);
+            iov[count].iov_len = e.buffer.size() - e.transferred;
+        }
+
+        if (detail::is_message_socket<Socket>::value)
+        {
+            auto const sent = detail::send_messages(fd, iov, count);
+            if (sent < 0 && errno == EINTR)
+                continue;
+            if (sent < 0 && detail::would_block(errno))
+                return false;
+            if (sent < 0)
+            {
+                // Only the first message failed, the rest is still sent.
+                entries_[order_[grp.next]].ec = detail::last_error();
+                ++grp.next;
+                continue;
+            }
+
+            for (int i = 0; i < sent; ++i, ++grp.next)
+            {
+                auto& e = entries_[order_[grp.next]];
+                e.transferred = iov[i].iov_len;
+            }
+            continue;
+        }
+
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        auto const sent = ::sendmsg(fd, &msg, detail::mmsg_send_flags);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent == 0 || (sent < 0 && detail::would_block(errno)))
+            return false;
+        if (sent < 0)
+        {
+            fail(grp, detail::last_error());
+            return true;
+        }
+
+        advance(grp, static_cast<std::size_t>(sent));
+    }
+
+    return true;
+}
+
+template<typename Socket>
+void
+send_batch<Socket>::wait_group(std::size_t g)
+{
+    ++pending_;
+    groups_[g].socket->async_wait(Socket::wait_write, child_handler{this, g});
+}
+
+template<typename Socket>
+void
+send_batch<Socket>::submit_group(std::size_t g)
+{
+    auto& grp = groups_[g];
+    advance(grp, 0);
+    if (grp.next == grp.end)
+        return;
+
+    std::array<boost::asio::const_buffer, detail::uring_max_buffers> buffers;
+    std::size_t count = 0;
+    for (auto i = grp.next; i != grp.end && count < buffers.size();
+         ++i, ++count)
+    {
+        auto const& e = entries_[order_[i]];
+        buffers[count] = e.buffer + e.transferred;
+    }
+
+    using op_type = detail::uring_handler_op<child_handler, executor_type>;
+    auto const op = op_type::create(child_handler{this, g}, ex_);
+    ++pending_;
+    op->template prepare<boost::asio::const_buffer>(
+      detail::uring_writev,
+      grp.socket->native_handle(),
+      detail::uring_current_position,
+      buffers.begin(),
+      buffers.begin() + count);
+    auto& ctx = detail::get_execution_context(ex_, nullptr);
+    boost::asio::use_service<uring_service>(ctx).start(*op, this, ex_);
+}
+
+template<typename Socket>
+void
+send_batch<Socket>::on_wait(std::size_t g, boost::system::error_code ec)
+{
+    if (ec)
+        fail(groups_[g], ec);
+    else if (!send_group(g))
+        wait_group(g);
+
+    if (--pending_ == 0)
+        complete(true);
+}
+
+template<typename Socket>
+void
+send_batch<Socket>::on_submit(std::size_t g,
+                              boost::system::error_code ec,
+                              std::size_t n)
+{
+    auto& grp = groups_[g];
+    if (ec == boost::asio::error::would_block)
+    {
+        // The socket is in non-blocking mode, retry through the reactor.
+        wait_group(g);
+    }
+    else if (ec)
+    {
+        fail(grp, ec);
+    }
+    else
+    {
+        advance(grp, n);
+        submit_group(g);
+    }
+
+    if (--pending_ == 0)
+        complete(true);
+}
+
+template<typename Socket>
+void
+send_batch<Socket>::advance(group& grp, std::size_t n) noexcept
+{
+    for (; grp.next != grp.end; ++grp.next)
+    {
+        auto& e = entries_[order_[grp.next]];
+        auto const remaining = e.buffer.size() - e.transferred;
+        if (remaining > n)
+        {
+            e.transferred += n;
+            return;
+        }
+        e.transferred += remaining;
+        n -= remaining;
+    }
+}
+
+template<typename Socket>
+void
+send_batch<Socket>::fail(group& grp, boost::system::error_code ec) noexcept
+{
+    for (; grp.next != grp.end; ++grp.next)
+        entries_[order_[grp.next]].ec = ec;
+}
+
+template<typename Socket>
+void
+send_batch<Socket>::complete(bool is_continuation)
+{
+    boost::system::error_code ec;
+    std::size_t failed = 0;
+    for (auto const& e : entries_)
+    {
+        if (!e.ec)
+            continue;
+        if (failed++ == 0)
+            ec = e.ec;
+    }
+
+    // The handler may own the batch, which must not be accessed afterwards.
+    auto handler = std::move(handler_);
+    auto const ex = boost::asio::get_associated_executor(handler, ex_);
+    if (is_continuation)
+        (void)boost::asio::dispatch(
+          ex, detail::bind_front_handler(std::move(handler), ec, failed));
+    else
+        (void)boost::asio::post(
+          ex, detail::bind_front_handler(std::move(handler), ec, failed));
+}
+
+template<typename Socket>
+void
+send_batch<Socket>::abandon() noexcept
+{
+    if (--pending_ == 0)
+    {
+        // Breaks the cycle between the batch and the handler which owns it.
+        auto const handler = std::move(handler_);
+    }
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_SEND_BATCH_HPP
@@ -0,0 +1,214 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_SEND_FILE_HPP
+#define COMPOSE_IMPL_SEND_FILE_HPP
+
+#if defined(__linux__) && !defined(COMPOSE_NO_SENDFILE)
+#define COMPOSE_HAS_SENDFILE
+#endif
+
+#include <compose/detail/buffer_pool.hpp>
+#include <compose/detail/mmsg.hpp>
+#include <compose/send_file.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/basic_stream_socket.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/write.hpp>
+
+#include <algorithm>
+#include <type_traits>
+
+#include <unistd.h>
+#ifdef COMPOSE_HAS_SENDFILE
+#include <sys/sendfile.h>
+#endif // COMPOSE_HAS_SENDFILE
+
+namespace compose
+{
+namespace detail
+{
+
+template<typename Stream>
+struct is_stream_socket : std::false_type
+{
+};
+
+template<typename Protocol, typename Executor>
+struct is_stream_socket<boost::asio::basic_stream_socket<Protocol, Executor>>
+  : std::true_type
+{
+};
+
+// Largest transfer performed by a single sendfile call on Linux.
+constexpr std::size_t sendfile_chunk = 0x7ffff000;
+
+template<typename Stream>
+class send_file_op
+{
+public:
+    send_file_op(Stream& stream,
+                 int file,
+                 std::uint64_t offset,
+                 std::size_t count) noexcept
+      : stream_{stream}
+      , file_{file}
+      , offset_{offset}
+      , remaining_{count}
+    {
+    }
+
+    send_file_op(send_file_op const&) = delete;
+    send_file_op& operator=(send_file_op const&) = delete;
+
+    template<typename Self>
+    upcall_guard operator()(yield_token<Self> yield,
+                            boost::system::error_code ec = {},
+                            std::size_t n = 0)
+    {
+        if (!ec && zero_copy_)
+            return send(yield, is_stream_socket<Stream>{});
+        return copy(yield, ec, n);
+    }
+
+private:
+    template<typename Self>
+    upcall_guard send(yield_token<Self> yield, std::true_type)
+    {
+#ifdef COMPOSE_HAS_SENDFILE
+        boost::system::error_code ec;
+        if (!stream_.native_non_blocking())
+            stream_.native_non_blocking(true, ec);
+
+        while (!ec && remaining_ > 0)
+        {
+            auto off = static_cast<off_t>(offset_);
+            auto const result =
+              ::sendfile(stream_.native_handle(),
+                         file_,
+                         &off,
+                         std::min(remaining_, sendfile_chunk));
+            if (result > 0)
+                advance(static_cast<std::size_t>(result));
+            else if (result == 0)
+                ec = boost::asio::error::eof;
+            else if (errno == EINTR)
+                continue;
+            else if (would_block(errno))
+                return stream_.async_wait(Stream::wait_write, yield);
+            else if ((errno == EINVAL || errno == ENOSYS) && total_ == 0)
+                return fall_back(yield);
+            else
+                ec = last_error();
+        }
+        return yield.upcall(ec, total_);
+#else
+        return fall_back(yield);
+#endif // COMPOSE_HAS_SENDFILE
+    }
+
+    template<typename Self>
+    upcall_guard send(yield_token<Self> yield, std::false_type)
+    {
+        return fall_back(yield);
+    }
+
+    template<typename Self>
+    upcall_guard fall_back(yield_token<Self> yield)
+    {
+        zero_copy_ = false;
+        return copy(yield, {}, 0);
+    }
+
+    // Continues after the previous chunk, of n bytes, was written.
+    template<typename Self>
+    upcall_guard copy(yield_token<Self> yield,
+                      boost::system::error_code ec,
+                      std::size_t n)
+    {
+        advance(n);
+        if (!ec && remaining_ > 0)
+        {
+            auto const size = read(ec);
+            if (!ec)
+                return boost::asio::async_write(
+                  stream_, boost::asio::buffer(buffer_.data(), size), yield);
+        }
+        return yield.upcall(ec, total_);
+    }
+
+    std::size_t read(boost::system::error_code& ec)
+    {
+        auto const size = std::min(remaining_, buffer_.size());
+        for (;;)
+        {
+            auto const result = ::pread(file_,
+                                        buffer_.data(),
+                                        size,
+                                        static_cast<off_t>(offset_));
+            if (result > 0)
+                return static_cast<std::size_t>(result);
+            if (result == 0)
+                ec = boost::asio::error::eof;
+            else if (errno != EINTR)
+                ec = last_error();
+            if (ec)
+                return 0;
+        }
+    }
+
+    void advance(std::size_t n) noexcept
+    {
+        total_ += n;
+        offset_ += n;
+        remaining_ -= n;
+    }
+
+    Stream& stream_;
+    int file_;
+    std::uint64_t offset_;
+    std::size_t remaining_;
+    std::size_t total_ = 0;
+    bool zero_copy_ = true;
+    pooled_buffer buffer_;
+};
+
+} // namespace detail
+
+template<typename AsyncWriteStream, typename CompletionToken>
+auto
+async_send_file(AsyncWriteStream& stream,
+                int file,
+                std::uint64_t offset,
+                std::size_t count,
+                CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    stable_transform<detail::send_file_op<AsyncWriteStream>>(
+      stream.get_executor(),
+      init,
+      std::piecewise_construct,
+      stream,
+      file,
+      offset,
+      count)
+      .run();
+    return init.result.get();
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_SEND_FILE_HPP
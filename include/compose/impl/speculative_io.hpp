@@ -0,0 +1,170 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_SPECULATIVE_IO_HPP
+#define COMPOSE_IMPL_SPECULATIVE_IO_HPP
+
+#include <compose/speculative_io.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/detail/buffer_sequence_adapter.hpp>
+#include <boost/asio/detail/socket_ops.hpp>
+#include <boost/asio/error.hpp>
+
+#include <utility>
+
+namespace compose
+{
+namespace detail
+{
+
+inline std::size_t&
+speculative_depth() noexcept
+{
+    static thread_local std::size_t depth = 0;
+    return depth;
+}
+
+class speculative_scope
+{
+public:
+    speculative_scope() noexcept
+    {
+        ++speculative_depth();
+    }
+
+    speculative_scope(speculative_scope const&) = delete;
+    speculative_scope& operator=(speculative_scope const&) = delete;
+
+    ~speculative_scope()
+    {
+        --speculative_depth();
+    }
+};
+
+template<typename ComposedOp>
+bool
+can_speculate(yield_token<ComposedOp> const& yield) noexcept
+{
+#if defined(MSG_DONTWAIT)
+    // Resuming the operation during its initiation could invoke the
+    // CompletionHandler before the initiating function returns.
+    return yield.is_continuation() &&
+           speculative_depth() < COMPOSE_SPECULATIVE_BUDGET;
+#else
+    (void)yield;
+    return false;
+#endif // defined(MSG_DONTWAIT)
+}
+
+// Returns true if the result is final and the operation may be resumed
+// inline.
+inline bool
+speculative_result(boost::asio::detail::signed_size_type result,
+                   bool reading,
+                   boost::system::error_code& ec,
+                   std::size_t& n) noexcept
+{
+    if (result > 0)
+    {
+        ec = {};
+        n = static_cast<std::size_t>(result);
+        return true;
+    }
+
+    if (result == 0 && !ec && reading)
+    {
+        ec = boost::asio::error::eof;
+        return true;
+    }
+
+    return false;
+}
+
+template<typename ComposedOp>
+upcall_guard
+resume_inline(yield_token<ComposedOp> yield,
+              boost::system::error_code ec,
+              std::size_t n)
+{
+    detail::speculative_scope const scope;
+    ComposedOp op{yield.release_operation()};
+    op(ec, n);
+    return {};
+}
+
+} // namespace detail
+
+template<typename Socket, typename MutableBufferSequence, typename ComposedOp>
+upcall_guard
+speculative_read_some(Socket& socket,
+                      MutableBufferSequence const& buffers,
+                      yield_token<ComposedOp> yield)
+{
+#if defined(MSG_DONTWAIT)
+    if (detail::can_speculate(yield))
+    {
+        namespace asio_detail = boost::asio::detail;
+        asio_detail::buffer_sequence_adapter<boost::asio::mutable_buffer,
+                                             MutableBufferSequence>
+          bufs{buffers};
+        if (bufs.all_empty())
+            return detail::resume_inline(yield, {}, 0);
+
+        boost::system::error_code ec;
+        std::size_t n = 0;
+        auto const result = asio_detail::socket_ops::recv(
+          socket.native_handle(),
+          bufs.buffers(),
+          bufs.count(),
+          MSG_DONTWAIT,
+          ec);
+        if (detail::speculative_result(result, true, ec, n))
+            return detail::resume_inline(yield, ec, n);
+    }
+#endif // defined(MSG_DONTWAIT)
+
+    return socket.async_read_some(buffers, yield);
+}
+
+template<typename Socket, typename ConstBufferSequence, typename ComposedOp>
+upcall_guard
+speculative_write_some(Socket& socket,
+                       ConstBufferSequence const& buffers,
+                       yield_token<ComposedOp> yield)
+{
+#if defined(MSG_DONTWAIT)
+    if (detail::can_speculate(yield))
+    {
+        namespace asio_detail = boost::asio::detail;
+        asio_detail::buffer_sequence_adapter<boost::asio::const_buffer,
+                                             ConstBufferSequence>
+          bufs{buffers};
+        if (bufs.all_empty())
+            return detail::resume_inline(yield, {}, 0);
+
+        boost::system::error_code ec;
+        std::size_t n = 0;
+        auto const result = asio_detail::socket_ops::send(
+          socket.native_handle(),
+          bufs.buffers(),
+          bufs.count(),
+          MSG_DONTWAIT,
+          ec);
+        if (detail::speculative_result(result, false, ec, n))
+            return detail::resume_inline(yield, ec, n);
+    }
+#endif // defined(MSG_DONTWAIT)
+
+    return socket.async_write_some(buffers, yield);
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_SPECULATIVE_IO_HPP
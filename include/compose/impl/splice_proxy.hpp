@@ -0,0 +1,318 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_SPLICE_PROXY_HPP
+#define COMPOSE_IMPL_SPLICE_PROXY_HPP
+
+#include <compose/detail/mmsg.hpp>
+#include <compose/detail/pipe_pool.hpp>
+#include <compose/splice_proxy.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/error.hpp>
+
+#include <type_traits>
+
+#include <fcntl.h>
+
+// Maximal number of chunks moved by one direction before it lets the other
+// direction and other handlers run.
+#ifndef COMPOSE_SPLICE_BUDGET
+#define COMPOSE_SPLICE_BUDGET 16
+#endif // COMPOSE_SPLICE_BUDGET
+
+namespace compose
+{
+namespace detail
+{
+
+// Largest chunk moved into a pipe at once, the default capacity of a pipe.
+constexpr std::size_t splice_chunk = 65536;
+
+template<class Body, class Self>
+class proxy_handler
+{
+public:
+    proxy_handler(Body& body, std::size_t direction) noexcept
+      : body_{&body}
+      , direction_{direction}
+    {
+    }
+
+    proxy_handler(proxy_handler&& other) noexcept
+      : body_{other.body_}
+      , direction_{other.direction_}
+    {
+        other.body_ = nullptr;
+    }
+
+    proxy_handler(proxy_handler const&) = delete;
+    proxy_handler& operator=(proxy_handler&&) = delete;
+    proxy_handler& operator=(proxy_handler const&) = delete;
+
+    ~proxy_handler()
+    {
+        if (body_ != nullptr)
+            body_->template abandon<Self>();
+    }
+
+    void operator()(boost::system::error_code ec)
+    {
+        auto const body = body_;
+        body_ = nullptr;
+        body->template complete<Self>(direction_, ec);
+    }
+
+    template<class H, class E>
+    friend class boost::asio::associated_executor;
+
+private:
+    Body* body_;
+    std::size_t direction_;
+};
+
+template<class Socket>
+class splice_proxy_op
+{
+public:
+    splice_proxy_op(Socket& a, Socket& b) noexcept
+      : sockets_{&a, &b}
+    {
+    }
+
+    splice_proxy_op(splice_proxy_op const&) = delete;
+    splice_proxy_op& operator=(splice_proxy_op const&) = delete;
+
+    template<class Self>
+    upcall_guard operator()(yield_token<Self> yield)
+    {
+        static_assert(sizeof(Self) <= sizeof(owner_) &&
+                        alignof(Self) <= alignof(decltype(owner_)),
+                      "The ComposedOperation must be stable.");
+
+        boost::system::error_code ec;
+        for (std::size_t d = 0; d < 2 && !ec; ++d)
+        {
+            if (!sockets_[d]->native_non_blocking())
+                sockets_[d]->native_non_blocking(true, ec);
+            if (!ec)
+                pipes_[d].open(ec);
+        }
+        if (ec)
+            return yield.post_upcall(ec, std::size_t{0}, std::size_t{0});
+
+        ::new (static_cast<void*>(&owner_)) Self{yield.release_operation()};
+
+        // Keeps the operation from completing while both directions are
+        // being started.
+        ++pending_;
+        pump<Self>(0);
+        if (!done_)
+            pump<Self>(1);
+        --pending_;
+        finish<Self>(false);
+        return {};
+    }
+
+    template<class Self>
+    Self& owner() noexcept
+    {
+        return *static_cast<Self*>(static_cast<void*>(&owner_));
+    }
+
+    template<class Self>
+    void complete(std::size_t direction, boost::system::error_code ec)
+    {
+        --pending_;
+        if (ec)
+            close(ec);
+        else if (!done_)
+            pump<Self>(direction);
+        finish<Self>(true);
+    }
+
+    template<class Self>
+    void abandon() noexcept
+    {
+        // The wait was destroyed without being invoked, e.g. because the
+        // execution context is being shut down.
+        if (--pending_ == 0)
+            (void)release_owner<Self>();
+    }
+
+private:
+    // Moves data from the source of a direction to its destination until
+    // either would block.
+    template<class Self>
+    void pump(std::size_t direction)
+    {
+        auto& pipe = pipes_[direction];
+        auto& source = *sockets_[direction];
+        auto& destination = *sockets_[1 - direction];
+        boost::system::error_code ec;
+        std::size_t budget = COMPOSE_SPLICE_BUDGET;
+
+        while (!done_)
+        {
+            if (pipe.size() > 0)
+            {
+                auto const n = ::splice(pipe.read_end(),
+                                        nullptr,
+                                        destination.native_handle(),
+                                        nullptr,
+                                        pipe.size(),
+                                        SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (n > 0)
+                {
+                    pipe.drained(static_cast<std::size_t>(n));
+                    bytes_[direction] += static_cast<std::size_t>(n);
+                    continue;
+                }
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0 && would_block(errno))
+                    return wait<Self>(
+                      direction, destination, Socket::wait_write);
+                ec = n < 0 ? last_error() : boost::asio::error::broken_pipe;
+                break;
+            }
+
+            if (eof_[direction])
+                break;
+
+            if (budget-- == 0)
+                return wait<Self>(direction, source, Socket::wait_read);
+
+            auto const n = ::splice(source.native_handle(),
+                                    nullptr,
+                                    pipe.write_end(),
+                                    nullptr,
+                                    splice_chunk,
+                                    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0)
+                pipe.filled(static_cast<std::size_t>(n));
+            else if (n == 0)
+                eof_[direction] = true;
+            else if (errno == EINTR)
+                continue;
+            else if (would_block(errno))
+                return wait<Self>(direction, source, Socket::wait_read);
+            else
+            {
+                ec = last_error();
+                break;
+            }
+        }
+
+        close(ec);
+    }
+
+    template<class Self>
+    void wait(std::size_t direction,
+              Socket& socket,
+              typename Socket::wait_type type)
+    {
+        ++pending_;
+        socket.async_wait(type, proxy_handler<splice_proxy_op, Self>{
+                                  *this, direction});
+    }
+
+    void close(boost::system::error_code ec)
+    {
+        if (done_)
+            return;
+        done_ = true;
+        error_ = ec;
+
+        boost::system::error_code ignored;
+        sockets_[0]->cancel(ignored);
+        sockets_[1]->cancel(ignored);
+    }
+
+    template<class Self>
+    void finish(bool is_continuation)
+    {
+        if (pending_ > 0 || !done_)
+            return;
+
+        auto const ec = error_;
+        auto const a_to_b = bytes_[0];
+        auto const b_to_a = bytes_[1];
+        auto op = release_owner<Self>();
+        (void)yield_token<Self>{op, is_continuation}.upcall(
+          ec, a_to_b, b_to_a);
+    }
+
+    template<class Self>
+    Self release_owner() noexcept
+    {
+        auto& owner = this->owner<Self>();
+        Self op{std::move(owner)};
+        owner.~Self();
+        return op;
+    }
+
+    Socket* sockets_[2];
+    pooled_pipe pipes_[2];
+    std::size_t bytes_[2] = {0, 0};
+    bool eof_[2] = {false, false};
+    bool done_ = false;
+    std::size_t pending_ = 0;
+    boost::system::error_code error_;
+    typename std::aligned_storage<2 * sizeof(void*)>::type owner_;
+};
+
+} // namespace detail
+
+template<typename Socket, typename CompletionToken>
+auto
+async_splice_proxy(Socket& a, Socket& b, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t,
+                                       std::size_t)>
+      init{tok};
+    stable_transform<detail::splice_proxy_op<Socket>>(
+      a.get_executor(), init, std::piecewise_construct, a, b)
+      .run();
+    return init.result.get();
+}
+
+} // namespace compose
+
+namespace boost
+{
+namespace asio
+{
+
+template<class Body, class Self, class Ex>
+class associated_executor<::compose::detail::proxy_handler<Body, Self>, Ex>
+{
+public:
+    using type = associated_executor_t<Self, Ex>;
+
+    static type get(
+      ::compose::detail::proxy_handler<Body, Self> const& handler,
+      Ex const& ex = Ex{})
+    {
+        return associated_executor<Self, Ex>::get(
+          handler.body_->template owner<Self>(), ex);
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#endif // COMPOSE_IMPL_SPLICE_PROXY_HPP
@@ -0,0 +1,220 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_URING_DESCRIPTOR_HPP
+#define COMPOSE_IMPL_URING_DESCRIPTOR_HPP
+
+#include <compose/uring_descriptor.hpp>
+
+#include <compose/detail/bind_front_handler.hpp>
+#include <compose/detail/execution_context.hpp>
+#include <compose/detail/uring_op.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/detail/buffer_sequence_adapter.hpp>
+#include <boost/asio/post.hpp>
+
+#include <sys/uio.h>
+
+#include <cerrno>
+
+namespace compose
+{
+
+template<typename Executor>
+uring_descriptor<Executor>::uring_descriptor(Executor const& ex, int fd)
+  : service_{boost::asio::use_service<uring_service>(
+      detail::get_execution_context(ex, nullptr))}
+  , descriptor_{ex, fd}
+{
+}
+
+template<typename Executor>
+uring_descriptor<Executor>::~uring_descriptor()
+{
+    if (service_.is_enabled())
+        service_.cancel(this);
+}
+
+template<typename Executor>
+void
+uring_descriptor<Executor>::close()
+{
+    cancel();
+    descriptor_.close();
+}
+
+template<typename Executor>
+void
+uring_descriptor<Executor>::cancel()
+{
+    if (service_.is_enabled())
+        service_.cancel(this);
+    descriptor_.cancel();
+}
+
+template<typename Executor>
+template<typename MutableBufferSequence, typename CompletionToken>
+auto
+uring_descriptor<Executor>::async_read_some(
+  MutableBufferSequence const& buffers,
+  CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    if (!service_.is_enabled())
+        return descriptor_.async_read_some(
+          buffers, std::forward<CompletionToken>(tok));
+
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    start<boost::asio::mutable_buffer>(detail::uring_readv,
+                                       detail::uring_current_position,
+                                       buffers,
+                                       std::move(init.completion_handler));
+    return init.result.get();
+}
+
+template<typename Executor>
+template<typename ConstBufferSequence, typename CompletionToken>
+auto
+uring_descriptor<Executor>::async_write_some(
+  ConstBufferSequence const& buffers,
+  CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    if (!service_.is_enabled())
+        return descriptor_.async_write_some(
+          buffers, std::forward<CompletionToken>(tok));
+
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    start<boost::asio::const_buffer>(detail::uring_writev,
+                                     detail::uring_current_position,
+                                     buffers,
+                                     std::move(init.completion_handler));
+    return init.result.get();
+}
+
+template<typename Executor>
+template<typename MutableBufferSequence, typename CompletionToken>
+auto
+uring_descriptor<Executor>::async_read_some_at(
+  std::uint64_t offset,
+  MutableBufferSequence const& buffers,
+  CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    if (service_.is_enabled())
+        start<boost::asio::mutable_buffer>(
+          detail::uring_readv,
+          offset,
+          buffers,
+          std::move(init.completion_handler));
+    else
+        perform_at<boost::asio::mutable_buffer>(
+          offset, buffers, std::move(init.completion_handler));
+    return init.result.get();
+}
+
+template<typename Executor>
+template<typename ConstBufferSequence, typename CompletionToken>
+auto
+uring_descriptor<Executor>::async_write_some_at(
+  std::uint64_t offset,
+  ConstBufferSequence const& buffers,
+  CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    if (service_.is_enabled())
+        start<boost::asio::const_buffer>(detail::uring_writev,
+                                         offset,
+                                         buffers,
+                                         std::move(init.completion_handler));
+    else
+        perform_at<boost::asio::const_buffer>(
+          offset, buffers, std::move(init.completion_handler));
+    return init.result.get();
+}
+
+template<typename Executor>
+template<typename Buffer, typename BufferSequence, typename Handler>
+void
+uring_descriptor<Executor>::start(std::uint8_t opcode,
+                                  std::uint64_t offset,
+                                  BufferSequence const& buffers,
+                                  Handler&& handler)
+{
+    using op_type = detail::uring_handler_op<typename std::decay<Handler>::type,
+                                             executor_type>;
+    auto const op =
+      op_type::create(std::forward<Handler>(handler), get_executor());
+    op->template prepare<Buffer>(
+      opcode, descriptor_.native_handle(), offset, buffers);
+    service_.start(*op, this, get_executor());
+}
+
+template<typename Executor>
+template<typename Buffer, typename BufferSequence, typename Handler>
+void
+uring_descriptor<Executor>::perform_at(std::uint64_t offset,
+                                       BufferSequence const& buffers,
+                                       Handler&& handler)
+{
+    boost::asio::detail::buffer_sequence_adapter<Buffer, BufferSequence> bufs{
+      buffers};
+    auto const is_read = std::is_same<Buffer, boost::asio::mutable_buffer>{};
+    auto const fd = descriptor_.native_handle();
+    auto const off = static_cast<off_t>(offset);
+
+    boost::system::error_code ec;
+    std::size_t n = 0;
+    ssize_t result = 0;
+    if (bufs.all_empty())
+        result = 0;
+    else if (is_read)
+        result = ::preadv(fd, bufs.buffers(), bufs.count(), off);
+    else
+        result = ::pwritev(fd, bufs.buffers(), bufs.count(), off);
+
+    if (result < 0)
+        ec.assign(errno, boost::system::system_category());
+    else if (result == 0 && is_read && !bufs.all_empty())
+        ec = boost::asio::error::eof;
+    else
+        n = static_cast<std::size_t>(result);
+
+    auto const ex =
+      boost::asio::get_associated_executor(handler, get_executor());
+    (void)boost::asio::post(
+      ex, detail::bind_front_handler(std::forward<Handler>(handler), ec, n));
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_URING_DESCRIPTOR_HPP
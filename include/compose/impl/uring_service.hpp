@@ -0,0 +1,420 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_URING_SERVICE_HPP
+#define COMPOSE_IMPL_URING_SERVICE_HPP
+
+#include <compose/uring_service.hpp>
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+
+#ifdef COMPOSE_HAS_IO_URING
+#include <sys/eventfd.h>
+#endif // COMPOSE_HAS_IO_URING
+
+#include <cstdint>
+
+namespace compose
+{
+namespace detail
+{
+
+// The kernel did not consume all entries, they can be submitted again once
+// completions are reaped.
+inline bool
+is_uring_busy(boost::system::error_code const& ec) noexcept
+{
+    return ec == boost::asio::error::try_again ||
+           ec == boost::system::errc::device_or_resource_busy;
+}
+
+} // namespace detail
+
+inline uring_service::uring_service(boost::asio::execution_context& ctx)
+  : boost::asio::detail::execution_context_service_base<uring_service>{ctx}
+#ifdef COMPOSE_HAS_IO_URING
+  , ring_{COMPOSE_URING_ENTRIES, setup_error_}
+#endif // COMPOSE_HAS_IO_URING
+{
+#ifdef COMPOSE_HAS_IO_URING
+    if (!ring_.is_open())
+        return;
+
+    eventfd_handle_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventfd_handle_ < 0)
+    {
+        setup_error_.assign(errno, boost::system::system_category());
+        return;
+    }
+
+    ring_.register_eventfd(eventfd_handle_, setup_error_);
+    enabled_ = !setup_error_;
+#else
+    setup_error_ = boost::asio::error::operation_not_supported;
+#endif // COMPOSE_HAS_IO_URING
+}
+
+inline uring_service::~uring_service()
+{
+#ifdef COMPOSE_HAS_IO_URING
+    // Ownership of the eventfd is passed to eventfd_ on first use.
+    if (eventfd_handle_ >= 0)
+        ::close(eventfd_handle_);
+#endif // COMPOSE_HAS_IO_URING
+}
+
+inline bool
+uring_service::is_enabled() const noexcept
+{
+    return enabled_;
+}
+
+inline boost::system::error_code
+uring_service::setup_error() const noexcept
+{
+    return setup_error_;
+}
+
+inline void
+uring_service::shutdown()
+{
+    detail::list_node destroyed;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        shut_down_ = true;
+#ifdef COMPOSE_HAS_IO_URING
+        // The kernel may still read or write the frames and buffers of the
+        // operations, so they are cancelled and reaped before the operations
+        // are destroyed.
+        for (auto node = ops_.next_; node != &ops_; node = node->next_)
+            static_cast<detail::uring_op*>(node)->cancel_requested_ = true;
+
+        while (outstanding_ > 0)
+        {
+            // Cancels which do not fit are prepared once completions are
+            // reaped. Operations which fail to submit are not in the kernel.
+            (void)prepare_cancels(destroyed);
+            (void)submit(destroyed);
+            if (outstanding_ == 0)
+                break;
+
+            boost::system::error_code ec;
+            ring_.wait(1, ec);
+            if (ec && ec != boost::asio::error::interrupted)
+                break;
+
+            ring_.reap([this, &destroyed](std::uint64_t user_data, int) {
+                if (user_data == 0)
+                    return;
+                auto& op = *reinterpret_cast<detail::uring_op*>(user_data);
+                op.unlink();
+                op.link_before(destroyed);
+                --outstanding_;
+            });
+        }
+#endif // COMPOSE_HAS_IO_URING
+
+        // Only left if the ring failed, the kernel cancels them once it is
+        // closed, in the destructor.
+        while (ops_.is_linked())
+        {
+            auto& op = *static_cast<detail::uring_op*>(ops_.next_);
+            op.unlink();
+            op.link_before(destroyed);
+        }
+        outstanding_ = 0;
+        eventfd_ = boost::none;
+        ex_ = boost::none;
+    }
+
+    // The operations are destroyed without invoking their handlers. A handler
+    // may own a uring_descriptor, which cancels its operations when destroyed.
+    while (destroyed.is_linked())
+    {
+        auto& op = *static_cast<detail::uring_op*>(destroyed.next_);
+        op.unlink();
+        op.destroy();
+    }
+}
+
+inline void
+uring_service::start(detail::uring_op& op,
+                     void const* owner,
+                     executor_type const& ex)
+{
+#ifdef COMPOSE_HAS_IO_URING
+    op.owner_ = owner;
+    std::unique_lock<std::mutex> lock{mutex_};
+    if (shut_down_)
+    {
+        lock.unlock();
+        return op.destroy();
+    }
+
+    if (!ex_)
+    {
+        ex_.emplace(ex);
+        eventfd_.emplace(ex, eventfd_handle_);
+        eventfd_handle_ = -1;
+    }
+
+    auto sqe = ring_.get_sqe();
+    if (sqe == nullptr)
+    {
+        // The submission queue is full, submit the batch early.
+        detail::list_node failed;
+        submit(failed);
+        while (failed.is_linked())
+        {
+            auto& failed_op = *static_cast<detail::uring_op*>(failed.next_);
+            failed_op.unlink();
+            boost::asio::post(*ex_, [&failed_op] { failed_op.complete(); });
+        }
+        sqe = ring_.get_sqe();
+    }
+
+    op.link_before(ops_);
+    ++outstanding_;
+    if (sqe != nullptr)
+    {
+        sqe->opcode = op.opcode_;
+        sqe->fd = op.fd_;
+        sqe->off = op.offset_;
+        sqe->addr = reinterpret_cast<std::uintptr_t>(op.iov_);
+        sqe->len = op.iov_count_;
+        sqe->user_data = reinterpret_cast<std::uintptr_t>(&op);
+    }
+    else
+    {
+        // The kernel did not consume the submitted entries, complete the
+        // operation from the context.
+        op.res_ = -EBUSY;
+        op.unlink();
+        --outstanding_;
+        boost::asio::post(*ex_, [&op] { op.complete(); });
+        return;
+    }
+
+    if (!flush_pending_)
+    {
+        flush_pending_ = true;
+        boost::asio::post(*ex_, [this] { flush(); });
+    }
+
+    if (!armed_)
+    {
+        armed_ = true;
+        arm();
+    }
+#else
+    (void)owner;
+    (void)ex;
+    op.destroy();
+#endif // COMPOSE_HAS_IO_URING
+}
+
+inline void
+uring_service::cancel(void const* owner)
+{
+#ifdef COMPOSE_HAS_IO_URING
+    detail::list_node failed;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (shut_down_)
+            return;
+
+        bool requested = false;
+        for (auto node = ops_.next_; node != &ops_; node = node->next_)
+        {
+            auto& op = *static_cast<detail::uring_op*>(node);
+            if (op.owner_ != owner || op.cancel_requested_)
+                continue;
+            op.cancel_requested_ = true;
+            requested = true;
+        }
+
+        if (!requested)
+            return;
+
+        // Submitted before returning, so that the requests reach the kernel
+        // before the descriptor is closed or destroyed.
+        auto const prepared = prepare_cancels(failed);
+        auto const ec = submit(failed);
+        if ((!prepared || detail::is_uring_busy(ec)) && !flush_pending_)
+        {
+            flush_pending_ = true;
+            boost::asio::post(*ex_, [this] { flush(); });
+        }
+
+        // Not invoked from within cancel().
+        while (failed.is_linked())
+        {
+            auto& op = *static_cast<detail::uring_op*>(failed.next_);
+            op.unlink();
+            boost::asio::post(*ex_, [&op] { op.complete(); });
+        }
+    }
+#else
+    (void)owner;
+#endif // COMPOSE_HAS_IO_URING
+}
+
+// Prepares a cancel request for each operation whose cancellation was
+// requested. Returns false if the submission queue could not fit them all,
+// the rest is prepared by the next flush.
+inline bool
+uring_service::prepare_cancels(detail::list_node& failed)
+{
+#ifdef COMPOSE_HAS_IO_URING
+    bool submitted = false;
+    for (auto node = ops_.next_; node != &ops_; node = node->next_)
+    {
+        auto& op = *static_cast<detail::uring_op*>(node);
+        if (!op.cancel_requested_ || op.cancel_submitted_)
+            continue;
+
+        auto const sqe = ring_.get_sqe();
+        if (sqe == nullptr)
+        {
+            if (submitted)
+                return false;
+
+            // The submission queue is full, submit it to make room. Failed
+            // operations are unlinked, so the list is walked again.
+            submitted = true;
+            submit(failed);
+            node = &ops_;
+            continue;
+        }
+
+        // Completions of cancel requests carry no operation.
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<std::uintptr_t>(&op);
+        sqe->user_data = 0;
+        op.cancel_submitted_ = true;
+    }
+#else
+    (void)failed;
+#endif // COMPOSE_HAS_IO_URING
+    return true;
+}
+
+inline boost::system::error_code
+uring_service::submit(detail::list_node& failed)
+{
+    boost::system::error_code ec;
+#ifdef COMPOSE_HAS_IO_URING
+    ring_.submit(ec);
+    if (!ec || detail::is_uring_busy(ec))
+        return ec;
+
+    // The kernel will never consume the remaining entries, their operations
+    // fail with the error of the submission.
+    ring_.discard([this, &failed, &ec](std::uint64_t user_data) {
+        if (user_data == 0)
+            return;
+        auto& op = *reinterpret_cast<detail::uring_op*>(user_data);
+        op.res_ = -ec.value();
+        op.unlink();
+        op.link_before(failed);
+        --outstanding_;
+    });
+#else
+    (void)failed;
+#endif // COMPOSE_HAS_IO_URING
+    return ec;
+}
+
+inline void
+uring_service::flush()
+{
+#ifdef COMPOSE_HAS_IO_URING
+    detail::list_node failed;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        flush_pending_ = false;
+        if (shut_down_)
+            return;
+
+        auto const prepared = prepare_cancels(failed);
+        auto const ec = submit(failed);
+        if (!prepared || detail::is_uring_busy(ec))
+        {
+            // The queues are full, retry after reaping.
+            flush_pending_ = true;
+            boost::asio::post(*ex_, [this] { flush(); });
+        }
+    }
+
+    while (failed.is_linked())
+    {
+        auto& op = *static_cast<detail::uring_op*>(failed.next_);
+        op.unlink();
+        op.complete();
+    }
+#endif // COMPOSE_HAS_IO_URING
+}
+
+inline void
+uring_service::arm()
+{
+    eventfd_->async_wait(
+      boost::asio::posix::descriptor_base::wait_read,
+      [this](boost::system::error_code ec) { on_ready(ec); });
+}
+
+inline void
+uring_service::on_ready(boost::system::error_code ec)
+{
+#ifdef COMPOSE_HAS_IO_URING
+    if (ec)
+        return;
+
+    detail::list_node ready;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        armed_ = false;
+        if (shut_down_)
+            return;
+
+        std::uint64_t count = 0;
+        (void)::read(eventfd_->native_handle(), &count, sizeof(count));
+        ring_.reap([this, &ready](std::uint64_t user_data, int res) {
+            if (user_data == 0)
+                return;
+            auto& op = *reinterpret_cast<detail::uring_op*>(user_data);
+            op.res_ = res;
+            op.unlink();
+            op.link_before(ready);
+            --outstanding_;
+        });
+
+        if (outstanding_ > 0)
+        {
+            armed_ = true;
+            arm();
+        }
+    }
+
+    while (ready.is_linked())
+    {
+        auto& op = *static_cast<detail::uring_op*>(ready.next_);
+        op.unlink();
+        op.complete();
+    }
+#else
+    (void)ec;
+#endif // COMPOSE_HAS_IO_URING
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_URING_SERVICE_HPP
@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_VERIFIED_READ_HPP
+#define COMPOSE_IMPL_VERIFIED_READ_HPP
+
+#include <compose/detail/crc32c.hpp>
+#include <compose/unstable_transform.hpp>
+#include <compose/verified_read.hpp>
+
+namespace compose
+{
+namespace detail
+{
+
+// Largest chunk read at once, small enough to still be cached when it is
+// checksummed.
+constexpr std::size_t verified_read_chunk = 65536;
+
+template<typename Stream>
+class verified_read_op
+{
+public:
+    verified_read_op(Stream& stream,
+                     boost::asio::mutable_buffer buffer,
+                     std::uint32_t checksum) noexcept
+      : stream_{&stream}
+      , buffer_{buffer}
+      , checksum_{checksum}
+    {
+    }
+
+    template<typename Self>
+    upcall_guard operator()(yield_token<Self> yield,
+                            boost::system::error_code ec = {},
+                            std::size_t n = 0)
+    {
+        if (n > 0)
+        {
+            crc_ = detail::crc32c(
+              static_cast<char const*>(buffer_.data()) + transferred_,
+              n,
+              crc_);
+            transferred_ += n;
+        }
+
+        if (!ec && transferred_ < buffer_.size())
+        {
+            return stream_->async_read_some(
+              boost::asio::buffer(buffer_ + transferred_,
+                                  verified_read_chunk),
+              yield);
+        }
+
+        if (!ec && crc_ != checksum_)
+            ec = error::checksum_mismatch;
+        return yield.upcall(ec, transferred_);
+    }
+
+private:
+    Stream* stream_;
+    boost::asio::mutable_buffer buffer_;
+    std::size_t transferred_ = 0;
+    std::uint32_t checksum_;
+    std::uint32_t crc_ = 0;
+};
+
+} // namespace detail
+
+inline std::uint32_t
+crc32c(void const* data, std::size_t size, std::uint32_t crc) noexcept
+{
+    return detail::crc32c(data, size, crc);
+}
+
+template<typename AsyncReadStream, typename CompletionToken>
+auto
+async_read_verified(AsyncReadStream& stream,
+                    boost::asio::mutable_buffer buffer,
+                    std::uint32_t checksum,
+                    CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    unstable_transform(
+      stream.get_executor(),
+      init,
+      detail::verified_read_op<AsyncReadStream>{stream, buffer, checksum})
+      .run();
+    return init.result.get();
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_VERIFIED_READ_HPP
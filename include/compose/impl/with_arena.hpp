@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_IMPL_WITH_ARENA_HPP
+#define COMPOSE_IMPL_WITH_ARENA_HPP
+
+#include <compose/with_arena.hpp>
+
+#include <new>
+
+namespace compose
+{
+
+template<typename T, typename Upstream>
+arena_allocator<T, Upstream>::arena_allocator(
+  detail::arena_resource& arena,
+  Upstream const& upstream) noexcept
+  : arena_{&arena}
+  , upstream_{upstream}
+{
+}
+
+template<typename T, typename Upstream>
+template<typename U, typename UUpstream>
+arena_allocator<T, Upstream>::arena_allocator(
+  arena_allocator<U, UUpstream> const& other) noexcept
+  : arena_{&other.arena()}
+  , upstream_{other.upstream()}
+{
+}
+
+template<typename T, typename Upstream>
+T*
+arena_allocator<T, Upstream>::allocate(std::size_t n)
+{
+    if (n <= static_cast<std::size_t>(-1) / sizeof(T))
+    {
+        auto const p = arena_->allocate(n * sizeof(T), alignof(T));
+        if (p != nullptr)
+            return static_cast<T*>(p);
+    }
+
+    typename std::allocator_traits<Upstream>::template rebind_alloc<T>
+      upstream{upstream_};
+    return std::allocator_traits<decltype(upstream)>::allocate(upstream, n);
+}
+
+template<typename T, typename Upstream>
+void
+arena_allocator<T, Upstream>::deallocate(T* p, std::size_t n)
+{
+    if (arena_->deallocate(p, n * sizeof(T)))
+        return;
+
+    typename std::allocator_traits<Upstream>::template rebind_alloc<T>
+      upstream{upstream_};
+    std::allocator_traits<decltype(upstream)>::deallocate(upstream, p, n);
+}
+
+template<typename T, typename U, typename Upstream>
+bool
+operator==(arena_allocator<T, Upstream> const& lhs,
+           arena_allocator<U, Upstream> const& rhs) noexcept
+{
+    return &lhs.arena() == &rhs.arena() && lhs.upstream() == rhs.upstream();
+}
+
+template<typename T, typename U, typename Upstream>
+bool
+operator!=(arena_allocator<T, Upstream> const& lhs,
+           arena_allocator<U, Upstream> const& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+} // namespace compose
+
+#endif // COMPOSE_IMPL_WITH_ARENA_HPP
@@ -0,0 +1,129 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_OFFLOAD_HPP
+#define COMPOSE_OFFLOAD_HPP
+
+#include <compose/upcall_guard.hpp>
+#include <compose/yield_token.hpp>
+
+#include <cstddef>
+#include <type_traits>
+
+// Default number of bytes an offload_slot reserves for the operations of the
+// compute executor and of the executor the composed operation resumes on.
+#ifndef COMPOSE_OFFLOAD_RESERVE
+#define COMPOSE_OFFLOAD_RESERVE 128
+#endif // COMPOSE_OFFLOAD_RESERVE
+
+namespace compose
+{
+namespace detail
+{
+
+// The memory of an offload_slot, which holds at most one operation of an
+// executor at a time.
+struct offload_block
+{
+    void* data_;
+    std::size_t capacity_;
+    bool in_use_;
+};
+
+template<typename Result>
+struct offload_result;
+
+template<typename Slot, typename ComposedOp, typename Function>
+class offload_work;
+
+template<typename Slot, typename ComposedOp>
+class offload_resume;
+
+} // namespace detail
+
+/**
+ * Runs CPU-bound steps of a stable composed operation, e.g. decompression or
+ * signature verification, on a compute Executor (e.g. of a
+ * boost::asio::thread_pool), so that they do not block the threads running
+ * the I/O executor.
+ *
+ * An offload_slot is a data member of the OperationBody, so it lives in the
+ * frame of the operation. The operations which the compute Executor and the
+ * executor of the composed operation allocate for the offloaded step are
+ * allocated in the slot, the offload performs no other allocations. An
+ * operation which does not fit in Reserve bytes, or which is allocated while
+ * the slot's memory is in use, is allocated with the Allocator associated
+ * with the composed operation.
+ *
+ * @tparam Result the type returned by the offloaded Function, may be void.
+ *
+ * @tparam Reserve the number of bytes reserved for the operations.
+ *
+ * @remark Only one step may be in flight per slot.
+ */
+template<typename Result, std::size_t Reserve = COMPOSE_OFFLOAD_RESERVE>
+class offload_slot
+{
+public:
+    offload_slot() noexcept = default;
+
+    offload_slot(offload_slot const&) = delete;
+    offload_slot& operator=(offload_slot const&) = delete;
+
+    /**
+     * Posts the Function to the compute Executor. Once it returns, the
+     * composed operation is resumed on its associated executor (the IoExecutor
+     * unless its CompletionHandler has an associated executor), with the
+     * result as the argument, or with no arguments if Result is void.
+     *
+     * If the Function throws, the exception is rethrown from the resumption,
+     * on the thread running the composed operation's executor, and the
+     * operation is destroyed without an upcall.
+     *
+     * @param ex The Executor the Function is run on.
+     *
+     * @param f The Function, with the signature Result(), moved or copied into
+     * the posted operation. It must not use data members of the OperationBody
+     * which are also used by other handlers of the composed operation.
+     *
+     * @param yield The yield_token of the composed operation, the ownership of
+     * the operation is released.
+     */
+    template<typename Executor, typename Function, typename ComposedOp>
+    upcall_guard post(Executor const& ex,
+                      Function&& f,
+                      yield_token<ComposedOp> yield);
+
+    /**
+     * Returns true if a step is in flight.
+     */
+    bool pending() const noexcept
+    {
+        return pending_;
+    }
+
+private:
+    template<typename Slot, typename ComposedOp, typename Function>
+    friend class detail::offload_work;
+
+    template<typename Slot, typename ComposedOp>
+    friend class detail::offload_resume;
+
+    detail::offload_result<Result> result_;
+    bool pending_ = false;
+    typename std::aligned_storage<Reserve, alignof(std::max_align_t)>::type
+      storage_;
+    detail::offload_block block_{&storage_, Reserve, false};
+};
+
+} // namespace compose
+
+#include <compose/impl/offload.hpp>
+
+#endif // COMPOSE_OFFLOAD_HPP
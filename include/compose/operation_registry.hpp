@@ -0,0 +1,132 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_OPERATION_REGISTRY_HPP
+#define COMPOSE_OPERATION_REGISTRY_HPP
+
+#include <compose/detail/list_node.hpp>
+
+#include <cstddef>
+
+namespace compose
+{
+
+class operation_registry;
+
+/**
+ * An intrusive hook which links an in-flight composed operation into an
+ * operation_registry. The hook is meant to be a data member of an
+ * OperationBody transformed with stable_transform(), so that linking it does
+ * not allocate and it is unlinked automatically when the operation's frame is
+ * destroyed (after upcall or when the operation is discarded).
+ */
+class registry_hook : private detail::list_node
+{
+public:
+    registry_hook() noexcept = default;
+
+    registry_hook(registry_hook const&) = delete;
+    registry_hook(registry_hook&&) = delete;
+    registry_hook& operator=(registry_hook const&) = delete;
+    registry_hook& operator=(registry_hook&&) = delete;
+
+    ~registry_hook();
+
+    /**
+     * Links the hook into a registry. The hook must not be linked.
+     *
+     * @param registry The registry to link into. Must outlive the hook or
+     * the hook must be unlinked before the registry is destroyed.
+     *
+     * @param target The object whose cancel() member function will be invoked
+     * by operation_registry::cancel_all(), typically the OperationBody which
+     * owns the hook. Must remain valid while the hook is linked.
+     */
+    template<typename Cancellable>
+    void link(operation_registry& registry, Cancellable& target) noexcept;
+
+    /**
+     * Unlinks the hook from the registry it is linked into, if any.
+     */
+    void unlink() noexcept;
+
+    bool is_linked() const noexcept
+    {
+        return registry_ != nullptr;
+    }
+
+private:
+    friend class operation_registry;
+
+    template<typename Cancellable>
+    static void cancel_target(void* target);
+
+    operation_registry* registry_ = nullptr;
+    void (*cancel_)(void*) = nullptr;
+    void* target_ = nullptr;
+};
+
+/**
+ * A registry of in-flight composed operations, e.g. all operations running on
+ * a single connection. Linking and unlinking an operation takes constant time
+ * and does not allocate.
+ *
+ * @remark Distinct objects: Safe. Shared objects: Unsafe.
+ */
+class operation_registry
+{
+public:
+    operation_registry() noexcept;
+
+    operation_registry(operation_registry const&) = delete;
+    operation_registry(operation_registry&&) = delete;
+    operation_registry& operator=(operation_registry const&) = delete;
+    operation_registry& operator=(operation_registry&&) = delete;
+
+    /**
+     * Unlinks all hooks that are still linked. Does not cancel the associated
+     * operations.
+     */
+    ~operation_registry();
+
+    /**
+     * Returns the number of linked operations.
+     */
+    std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    /**
+     * Requests cancellation of every linked operation by invoking the cancel()
+     * member function of the target of each hook. Hooks remain linked until
+     * their operations complete. Hooks linked or unlinked by the invoked
+     * cancel() functions are handled correctly.
+     *
+     * @returns The number of operations that were cancelled.
+     */
+    std::size_t cancel_all();
+
+private:
+    friend class registry_hook;
+
+    detail::list_node hooks_;
+    std::size_t size_ = 0;
+};
+
+} // namespace compose
+
+#include <compose/impl/operation_registry.hpp>
+
+#endif // COMPOSE_OPERATION_REGISTRY_HPP
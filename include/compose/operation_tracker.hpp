@@ -0,0 +1,108 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_OPERATION_TRACKER_HPP
+#define COMPOSE_OPERATION_TRACKER_HPP
+
+#include <compose/detail/tracked_frame.hpp>
+
+#include <boost/asio/detail/service_registry.hpp>
+#include <boost/asio/execution_context.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace compose
+{
+
+/**
+ * A snapshot of the state of a single in-flight composed operation.
+ */
+struct operation_info
+{
+    /// Demangled name of the OperationBody type.
+    std::string body_type;
+
+    /// Label of the last COMPOSE_YIELD executed by the OperationBody, or 0 if
+    /// the body did not yield through a coroutine.
+    int coroutine_state;
+
+    /// Number of times the operation was resumed as a continuation.
+    std::uint64_t hops;
+
+    /// Time elapsed since the OperationBody last ran.
+    std::chrono::steady_clock::duration since_last_hop;
+
+    /// Size of the frame holding the OperationBody and the CompletionHandler.
+    std::size_t frame_size;
+};
+
+/**
+ * An execution context service which keeps track of all stable composed
+ * operations whose I/O executor belongs to the context.
+ *
+ * Operations are only tracked if COMPOSE_ENABLE_OPERATION_TRACKING is defined
+ * (consistently in all translation units). Otherwise, the tracker is always
+ * empty and composed operations do not pay for tracking.
+ *
+ * @remark All member functions are thread-safe and may be called from a
+ * thread that does not run the execution context, e.g. an administrative
+ * thread. They are not async-signal-safe.
+ */
+class operation_tracker
+  : public boost::asio::detail::execution_context_service_base<
+      operation_tracker>
+{
+public:
+    explicit operation_tracker(boost::asio::execution_context& ctx);
+
+    /**
+     * Invokes f with an operation_info for each tracked operation. Operations
+     * cannot complete while f is running.
+     */
+    template<typename F>
+    void for_each(F&& f) const;
+
+    /**
+     * Returns the state of all tracked operations.
+     */
+    std::vector<operation_info> snapshot() const;
+
+    std::size_t size() const;
+
+private:
+    friend struct detail::tracked_frame;
+
+    void shutdown() override;
+
+    void add(detail::tracked_frame& frame);
+    void remove(detail::tracked_frame& frame);
+
+    mutable std::mutex mutex_;
+    detail::list_node frames_;
+    std::size_t size_ = 0;
+};
+
+/**
+ * Returns the state of all tracked operations whose I/O executor belongs to
+ * the execution context of ex.
+ */
+template<typename Executor>
+std::vector<operation_info>
+tracked_operations(Executor const& ex);
+
+} // namespace compose
+
+#include <compose/impl/operation_tracker.hpp>
+
+#endif // COMPOSE_OPERATION_TRACKER_HPP
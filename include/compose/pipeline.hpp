@@ -0,0 +1,76 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_PIPELINE_HPP
+#define COMPOSE_PIPELINE_HPP
+
+#include <boost/asio/async_result.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+
+namespace compose
+{
+
+/**
+ * Serves a stream of messages in three stages: read, process and write. Up to
+ * Depth messages are in the pipeline at the same time, so that the next
+ * message is read while the previous ones are still being written. Responses
+ * are written in the order in which the messages were read.
+ *
+ * The Stages object must provide:
+ *   - message_type: a DefaultConstructible type, which holds the buffers of
+ *     all stages for a single message,
+ *   - async_read(stream, message, handler): reads the next message, the
+ *     handler has the signature void(boost::system::error_code, Ts...),
+ *   - process(message): prepares the response, runs on the I/O executor,
+ *   - async_write(stream, message, handler): writes the response, the handler
+ *     has the signature void(boost::system::error_code, Ts...).
+ * A message_type object is reused for later messages and is not reset in
+ * between.
+ *
+ * At most one read and one write are in flight at any time. The Stages object
+ * and Depth message slots live in the frame of the ComposedOperation, the
+ * operation performs no other allocations of its own.
+ *
+ * @tparam Depth the maximum number of messages which have been read, but not
+ * yet written. 1 disables pipelining, 2 double buffers.
+ *
+ * @param stream The AsyncStream, which must outlive the operation.
+ *
+ * @param stages The Stages object, moved or copied into the operation.
+ *
+ * @param tok The CompletionToken used to produce the CompletionHandler with
+ * the signature void(boost::system::error_code, std::size_t). The handler is
+ * invoked with the number of responses written, once reading has stopped and
+ * all read messages have been written or a write failed. The error is the
+ * error of the failed write, or else the error which stopped reading, e.g.
+ * boost::asio::error::eof.
+ *
+ * @remark A failed write stops reading, but does not interrupt a read that is
+ * in flight. Close the stream to complete the operation sooner.
+ *
+ * @remark If the I/O executor and the CompletionHandler's executor may run on
+ * multiple threads, the CompletionHandler must be associated with a strand.
+ */
+template<std::size_t Depth = 2,
+         typename AsyncStream,
+         typename Stages,
+         typename CompletionToken>
+auto
+async_pipeline(AsyncStream& stream, Stages&& stages, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t));
+
+} // namespace compose
+
+#include <compose/impl/pipeline.hpp>
+
+#endif // COMPOSE_PIPELINE_HPP
@@ -0,0 +1,234 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_PRIORITY_SCHEDULER_HPP
+#define COMPOSE_PRIORITY_SCHEDULER_HPP
+
+#include <compose/detail/list_node.hpp>
+
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Maximum number of handlers run by a single drain of a priority_scheduler,
+// before it is posted again to the underlying executor. A small budget lets
+// completions that are ready in the execution context enter the queues (and
+// overtake the queued handlers of lower priority) sooner.
+#ifndef COMPOSE_PRIORITY_DRAIN_BUDGET
+#define COMPOSE_PRIORITY_DRAIN_BUDGET 4
+#endif // COMPOSE_PRIORITY_DRAIN_BUDGET
+
+// Default maximum number of handlers of higher priority that may run while a
+// handler of lower priority is queued.
+#ifndef COMPOSE_PRIORITY_STARVATION_LIMIT
+#define COMPOSE_PRIORITY_STARVATION_LIMIT 16
+#endif // COMPOSE_PRIORITY_STARVATION_LIMIT
+
+namespace compose
+{
+
+template<typename Executor>
+class priority_executor;
+
+/**
+ * Queues handlers by priority class in front of an Executor. Handlers
+ * submitted through a priority_executor are queued in the class of that
+ * executor and run by a drain posted to the underlying Executor, which always
+ * runs the oldest handler of the highest priority class that is not empty.
+ *
+ * Binding a priority_executor to the CompletionHandler of a composed operation
+ * (e.g. with boost::asio::bind_executor) makes its posted upcalls, and the
+ * completions of the child operations initiated with its yield_token (hops),
+ * queue in the chosen class instead of in the FIFO of the execution context.
+ *
+ * Starvation protection: a class that has a queued handler is not skipped
+ * more than starvation_limit times in a row, its oldest handler is run
+ * instead of the one of the higher priority class.
+ *
+ * Like a strand, the scheduler runs one handler at a time.
+ *
+ * @remark Distinct objects: Safe. Shared objects: Safe.
+ */
+template<typename Executor>
+class priority_scheduler
+{
+public:
+    /**
+     * @param ex The Executor the handlers are run on.
+     *
+     * @param classes Number of priority classes. Class 0 has the highest
+     * priority.
+     *
+     * @param starvation_limit Maximum number of handlers of higher classes
+     * run while a handler of a lower class is queued.
+     */
+    explicit priority_scheduler(
+      Executor const& ex,
+      std::size_t classes = 2,
+      std::size_t starvation_limit = COMPOSE_PRIORITY_STARVATION_LIMIT);
+
+    priority_scheduler(priority_scheduler const&) = delete;
+    priority_scheduler(priority_scheduler&&) = delete;
+    priority_scheduler& operator=(priority_scheduler const&) = delete;
+    priority_scheduler& operator=(priority_scheduler&&) = delete;
+
+    /**
+     * Destroys the queued handlers without invoking them. Must not be called
+     * while a drain is posted to the underlying Executor, i.e. the execution
+     * context must be stopped and its handlers destroyed or run to
+     * completion first.
+     */
+    ~priority_scheduler();
+
+    /**
+     * Returns an Executor which queues handlers in the given class.
+     *
+     * @param priority The priority class, lower than classes().
+     */
+    priority_executor<Executor> get_executor(std::size_t priority) noexcept;
+
+    std::size_t classes() const noexcept
+    {
+        return queues_.size();
+    }
+
+    Executor const& get_inner_executor() const noexcept
+    {
+        return inner_;
+    }
+
+    /**
+     * Returns true if the calling thread is running a handler queued in this
+     * scheduler.
+     */
+    bool running_in_this_thread() const noexcept;
+
+private:
+    template<typename E>
+    friend class priority_executor;
+
+    struct item : detail::list_node
+    {
+        void (*complete_)(item*, bool invoke);
+    };
+
+    template<typename Function, typename Allocator>
+    struct function_item;
+
+    struct queue
+    {
+        detail::list_node items_;
+        std::size_t skipped_ = 0;
+    };
+
+    struct drainer;
+
+    template<typename Function, typename Allocator>
+    void enqueue(std::size_t priority, Function&& f, Allocator const& a);
+
+    item* pop();
+
+    void drain();
+
+    Executor inner_;
+    std::size_t starvation_limit_;
+    std::mutex mutex_;
+    std::vector<queue> queues_;
+    bool draining_ = false;
+};
+
+/**
+ * An Executor which queues handlers in a priority class of a
+ * priority_scheduler. Outstanding work is counted on the underlying Executor.
+ */
+template<typename Executor>
+class priority_executor
+{
+public:
+    priority_executor(priority_scheduler<Executor>& scheduler,
+                      std::size_t priority) noexcept
+      : scheduler_{&scheduler}
+      , priority_{priority}
+    {
+    }
+
+    auto context() const noexcept -> decltype(std::declval<Executor const&>()
+                                                .context())
+    {
+        return scheduler_->inner_.context();
+    }
+
+    void on_work_started() const noexcept
+    {
+        scheduler_->inner_.on_work_started();
+    }
+
+    void on_work_finished() const noexcept
+    {
+        scheduler_->inner_.on_work_finished();
+    }
+
+    /**
+     * Invokes the function in place if the calling thread is running a
+     * handler of the scheduler, queues it otherwise.
+     */
+    template<typename Function, typename Allocator>
+    void dispatch(Function&& f, Allocator const& a) const;
+
+    template<typename Function, typename Allocator>
+    void post(Function&& f, Allocator const& a) const
+    {
+        scheduler_->enqueue(priority_, std::forward<Function>(f), a);
+    }
+
+    template<typename Function, typename Allocator>
+    void defer(Function&& f, Allocator const& a) const
+    {
+        scheduler_->enqueue(priority_, std::forward<Function>(f), a);
+    }
+
+    bool running_in_this_thread() const noexcept
+    {
+        return scheduler_->running_in_this_thread();
+    }
+
+    std::size_t priority() const noexcept
+    {
+        return priority_;
+    }
+
+    priority_scheduler<Executor>& scheduler() const noexcept
+    {
+        return *scheduler_;
+    }
+
+    friend bool operator==(priority_executor const& lhs,
+                           priority_executor const& rhs) noexcept
+    {
+        return lhs.scheduler_ == rhs.scheduler_ &&
+               lhs.priority_ == rhs.priority_;
+    }
+
+    friend bool operator!=(priority_executor const& lhs,
+                           priority_executor const& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    priority_scheduler<Executor>* scheduler_;
+    std::size_t priority_;
+};
+
+} // namespace compose
+
+#include <compose/impl/priority_scheduler.hpp>
+
+#endif // COMPOSE_PRIORITY_SCHEDULER_HPP
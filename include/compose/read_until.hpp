@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_READ_UNTIL_HPP
+#define COMPOSE_READ_UNTIL_HPP
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/detail/string_view.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+
+namespace compose
+{
+
+/**
+ * Reads data into a dynamic buffer until it contains the specified
+ * delimiter.
+ *
+ * A drop-in replacement for boost::asio::async_read_until. The position up
+ * to which the buffered data is known not to contain the delimiter is kept in
+ * the stable state of the composed operation, so every byte is scanned once,
+ * when it arrives. The scan is vectorized with SSE2 or AVX2, if the
+ * translation unit is compiled with support for them, and falls back to
+ * std::memchr otherwise. Defining COMPOSE_NO_SIMD disables the vectorized
+ * scan.
+ *
+ * If the buffer already contains the delimiter, the operation completes
+ * without reading from the stream.
+ *
+ * Signature of the CompletionHandler:
+ * @code
+ * void(boost::system::error_code ec, std::size_t n)
+ * @endcode
+ * Where n is the number of bytes in the buffer up to and including the
+ * delimiter, or 0 if an error occurred. If the buffer reaches its maximal
+ * size without containing the delimiter, boost::asio::error::not_found is
+ * reported.
+ *
+ * @param stream The AsyncReadStream to read from. Must remain valid until the
+ * operation completes.
+ *
+ * @param buffer A DynamicBuffer_v1 whose data() is a single contiguous
+ * buffer, e.g. the result of boost::asio::dynamic_buffer().
+ *
+ * @param delim The delimiter, must not be empty. It is copied, so it need not
+ * outlive the call.
+ */
+template<typename AsyncReadStream,
+         typename DynamicBuffer,
+         typename CompletionToken>
+auto
+async_read_until(AsyncReadStream& stream,
+                 DynamicBuffer&& buffer,
+                 boost::asio::string_view delim,
+                 CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t));
+
+/**
+ * Reads data into a dynamic buffer until it contains the specified
+ * character.
+ *
+ * Equivalent to async_read_until(stream, buffer, string_view{&delim, 1},
+ * tok).
+ */
+template<typename AsyncReadStream,
+         typename DynamicBuffer,
+         typename CompletionToken>
+auto
+async_read_until(AsyncReadStream& stream,
+                 DynamicBuffer&& buffer,
+                 char delim,
+                 CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t));
+
+} // namespace compose
+
+#include <compose/impl/read_until.hpp>
+
+#endif // COMPOSE_READ_UNTIL_HPP
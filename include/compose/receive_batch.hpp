@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_RECEIVE_BATCH_HPP
+#define COMPOSE_RECEIVE_BATCH_HPP
+
+#include <compose/detail/mmsg.hpp>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace compose
+{
+
+/**
+ * A set of pooled buffers which receives up to capacity() datagrams from a
+ * socket at once.
+ *
+ * async_receive() waits until the socket is readable and then drains as many
+ * queued datagrams as fit in the batch with a single recvmmsg call, so an
+ * OperationBody is resumed once per batch instead of once per datagram. The
+ * buffers are allocated once, by the constructor, and are reused by
+ * subsequent batches.
+ *
+ * The batch is meant to be a data member of an OperationBody transformed with
+ * stable_transform(), so that the received data may be processed in place.
+ *
+ * Usage:
+ * @code
+ * COMPOSE_YIELD batch_.async_receive(socket_, yield);
+ * for (std::size_t i = 0; i < batch_.size(); ++i)
+ *     process(batch_.data(i), batch_.endpoint(i));
+ * @endcode
+ *
+ * @tparam Socket A datagram socket type, e.g. boost::asio::ip::udp::socket.
+ *
+ * @remark Distinct objects: Safe. Shared objects: Unsafe.
+ */
+template<typename Socket>
+class receive_batch
+{
+public:
+    using endpoint_type = typename Socket::endpoint_type;
+
+    /**
+     * Construct a receive_batch.
+     *
+     * @param capacity Maximal number of datagrams received at once.
+     *
+     * @param datagram_size Size of the buffer of each datagram. Longer
+     * datagrams are truncated.
+     */
+    receive_batch(std::size_t capacity, std::size_t datagram_size);
+
+    receive_batch(receive_batch const&) = delete;
+    receive_batch& operator=(receive_batch const&) = delete;
+
+    std::size_t capacity() const noexcept
+    {
+        return headers_.size();
+    }
+
+    std::size_t datagram_size() const noexcept
+    {
+        return datagram_size_;
+    }
+
+    /**
+     * Returns the number of datagrams received by the last batch.
+     */
+    std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    /**
+     * Returns the contents of the i-th datagram of the last batch. Remains
+     * valid until the next batch is started.
+     */
+    boost::asio::const_buffer data(std::size_t i) const noexcept;
+
+    /**
+     * Returns the sender of the i-th datagram of the last batch.
+     */
+    endpoint_type const& endpoint(std::size_t i) const noexcept
+    {
+        return endpoints_[i];
+    }
+
+    /**
+     * Returns true if the i-th datagram of the last batch did not fit in its
+     * buffer.
+     */
+    bool truncated(std::size_t i) const noexcept;
+
+    /**
+     * Receives the datagrams queued in a socket, waiting for at least one to
+     * arrive.
+     *
+     * Signature of the CompletionHandler:
+     * @code
+     * void(boost::system::error_code ec, std::size_t count)
+     * @endcode
+     * Where count is the number of received datagrams, also returned by
+     * size().
+     *
+     * @param socket The socket to receive from. Must remain valid until the
+     * operation completes.
+     */
+    template<typename CompletionToken>
+    auto async_receive(Socket& socket, CompletionToken&& tok)
+      -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                       void(boost::system::error_code,
+                                            std::size_t));
+
+private:
+    class receive_op;
+
+    std::size_t receive(Socket& socket, boost::system::error_code& ec);
+
+    std::size_t datagram_size_;
+    std::size_t size_ = 0;
+    std::vector<char> buffer_;
+    std::vector<endpoint_type> endpoints_;
+    std::vector<iovec> iov_;
+    std::vector<detail::message_header> headers_;
+};
+
+} // namespace compose
+
+#include <compose/impl/receive_batch.hpp>
+
+#endif // COMPOSE_RECEIVE_BATCH_HPP
@@ -0,0 +1,193 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_SEND_BATCH_HPP
+#define COMPOSE_SEND_BATCH_HPP
+
+#include <compose/any_completion_handler.hpp>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace compose
+{
+
+/**
+ * A batch of writes to several sockets, which is started by a single step of
+ * an OperationBody and resumes it once, after every write completed.
+ *
+ * Writes queued for the same socket are written in the order they were added,
+ * with a single system call where possible: a gathering sendmsg for stream
+ * sockets and sendmmsg for datagram and seq_packet sockets, for which each
+ * buffer is sent as one message. Writes that would block wait in the reactor
+ * for the socket to become writable, independently of each other.
+ *
+ * If the uring_service of the sockets' execution context is in use, writes to
+ * stream sockets are submitted to the io_uring instead, so that the whole
+ * batch is submitted with a single io_uring_enter.
+ *
+ * The batch is meant to be a data member of an OperationBody transformed with
+ * stable_transform(), so that it remains at the same address while the writes
+ * are in progress. The memory used by the batch is retained by clear(), so a
+ * batch reused for subsequent steps does not allocate once it has grown to
+ * the batch size.
+ *
+ * Usage:
+ * @code
+ * for (auto& peer : peers_)
+ *     batch_.add(peer.socket, boost::asio::buffer(message_));
+ * COMPOSE_YIELD batch_.async_send(yield);
+ * @endcode
+ *
+ * @tparam Socket A socket type with native_handle(), get_executor() and
+ * async_wait(), e.g. boost::asio::ip::tcp::socket.
+ *
+ * @remark Distinct objects: Safe. Shared objects: Unsafe. All sockets of a
+ * batch must be used from within the same implicit or explicit strand.
+ */
+template<typename Socket>
+class send_batch
+{
+public:
+    using executor_type = typename Socket::executor_type;
+
+    /**
+     * Construct an empty send_batch.
+     *
+     * @param ex The executor used to complete batches which do not have to
+     * wait for any socket.
+     */
+    explicit send_batch(executor_type const& ex);
+
+    send_batch(send_batch const&) = delete;
+    send_batch& operator=(send_batch const&) = delete;
+
+    executor_type get_executor() const noexcept
+    {
+        return ex_;
+    }
+
+    /**
+     * Returns the number of queued writes.
+     */
+    std::size_t size() const noexcept
+    {
+        return entries_.size();
+    }
+
+    bool empty() const noexcept
+    {
+        return entries_.empty();
+    }
+
+    /**
+     * Queues a write of a buffer to a socket. The socket and the data must
+     * remain valid until the batch completes. Must not be called while the
+     * batch is in progress.
+     */
+    void add(Socket& socket, boost::asio::const_buffer buffer);
+
+    /**
+     * Removes all writes and their results. Must not be called while the
+     * batch is in progress.
+     */
+    void clear() noexcept;
+
+    /**
+     * Returns the result of the i-th queued write, once the batch completed.
+     */
+    boost::system::error_code error(std::size_t i) const noexcept
+    {
+        return entries_[i].ec;
+    }
+
+    /**
+     * Returns the number of bytes written by the i-th queued write, once the
+     * batch completed.
+     */
+    std::size_t bytes_transferred(std::size_t i) const noexcept
+    {
+        return entries_[i].transferred;
+    }
+
+    /**
+     * Starts all queued writes. Each buffer is written completely, unless an
+     * error occurs.
+     *
+     * Signature of the CompletionHandler:
+     * @code
+     * void(boost::system::error_code ec, std::size_t failed)
+     * @endcode
+     * Where ec is the first error reported by a write and failed is the
+     * number of writes that failed. The results of individual writes are
+     * available through error() and bytes_transferred().
+     *
+     * @remark The CompletionHandler is stored in the batch. If the execution
+     * context is destroyed while writes are in progress, the handler is
+     * destroyed without being invoked.
+     */
+    template<typename CompletionToken>
+    auto async_send(CompletionToken&& tok)
+      -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                       void(boost::system::error_code,
+                                            std::size_t));
+
+private:
+    struct entry
+    {
+        Socket* socket;
+        boost::asio::const_buffer buffer;
+        std::size_t transferred;
+        boost::system::error_code ec;
+    };
+
+    // A run of the writes of one socket in order_, of which [next, end) are
+    // not complete yet.
+    struct group
+    {
+        Socket* socket;
+        std::size_t next;
+        std::size_t end;
+    };
+
+    class child_handler;
+
+    void start();
+    bool send_group(std::size_t g);
+    void wait_group(std::size_t g);
+    void submit_group(std::size_t g);
+    void on_wait(std::size_t g, boost::system::error_code ec);
+    void on_submit(std::size_t g,
+                   boost::system::error_code ec,
+                   std::size_t n);
+    void advance(group& grp, std::size_t n) noexcept;
+    void fail(group& grp, boost::system::error_code ec) noexcept;
+    void finish(group& grp);
+    void complete(bool is_continuation);
+    void abandon() noexcept;
+
+    executor_type ex_;
+    std::vector<entry> entries_;
+    std::vector<std::size_t> order_;
+    std::vector<group> groups_;
+    any_completion_handler<void(boost::system::error_code, std::size_t)>
+      handler_;
+    std::size_t pending_ = 0;
+    bool use_uring_ = false;
+};
+
+} // namespace compose
+
+#include <compose/impl/send_batch.hpp>
+
+#endif // COMPOSE_SEND_BATCH_HPP
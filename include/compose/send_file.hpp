@@ -0,0 +1,66 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_SEND_FILE_HPP
+#define COMPOSE_SEND_FILE_HPP
+
+#include <boost/asio/async_result.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace compose
+{
+
+/**
+ * Writes a range of a file to a stream.
+ *
+ * If the stream is a boost::asio::basic_stream_socket, the data is
+ * transferred by the kernel with sendfile, without being copied through user
+ * space. The socket is put in non-blocking mode and the operation waits for
+ * writability whenever the socket's send buffer is full. If the file does not
+ * support sendfile, or the stream is not a socket, the data is copied with
+ * pread and async_write through a buffer taken from a per-thread pool.
+ *
+ * The operation completes when count bytes were written, an error occurs or
+ * the end of the file is reached before count bytes were read from it, in
+ * which case boost::asio::error::eof is reported.
+ *
+ * Signature of the CompletionHandler:
+ * @code
+ * void(boost::system::error_code ec, std::size_t bytes_transferred)
+ * @endcode
+ *
+ * @param stream The AsyncWriteStream the data is written to. Must remain valid
+ * until the operation completes.
+ *
+ * @param file A native handle of a seekable file. Its file position is not
+ * changed. Must remain open until the operation completes.
+ *
+ * @param offset Position in the file the range starts at.
+ *
+ * @param count Number of bytes to write.
+ */
+template<typename AsyncWriteStream, typename CompletionToken>
+auto
+async_send_file(AsyncWriteStream& stream,
+                int file,
+                std::uint64_t offset,
+                std::size_t count,
+                CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t));
+
+} // namespace compose
+
+#include <compose/impl/send_file.hpp>
+
+#endif // COMPOSE_SEND_FILE_HPP
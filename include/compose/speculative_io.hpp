@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_SPECULATIVE_IO_HPP
+#define COMPOSE_SPECULATIVE_IO_HPP
+
+#include <compose/upcall_guard.hpp>
+#include <compose/yield_token.hpp>
+
+#include <cstddef>
+
+// Maximal number of speculative operations completed inline, one inside
+// another, before an operation is sent through the reactor.
+#ifndef COMPOSE_SPECULATIVE_BUDGET
+#define COMPOSE_SPECULATIVE_BUDGET 16
+#endif // COMPOSE_SPECULATIVE_BUDGET
+
+namespace compose
+{
+
+/**
+ * Reads data from a stream socket, resuming the composed operation inline if
+ * data is already available.
+ *
+ * If the running operation is a continuation, a non-blocking receive is
+ * attempted first. If it transfers data or detects the end of the stream, the
+ * composed operation is resumed right away, from within this call, with the
+ * (error_code, std::size_t) arguments of async_read_some. Otherwise the
+ * operation is started with socket.async_read_some(buffers, yield).
+ *
+ * Usage:
+ * @code
+ * COMPOSE_YIELD compose::speculative_read_some(socket_, buffer, yield);
+ * @endcode
+ *
+ * @param socket A stream socket with a native_handle().
+ *
+ * @param buffers The buffers the data is read into. Must remain valid until
+ * the operation is resumed.
+ *
+ * @param yield The yield_token of the running operation. Ownership of the
+ * composed operation is released.
+ *
+ * @returns An upcall_guard, meant to be returned from the OperationBody.
+ *
+ * @remark Inline completions do not go through the executor, so other
+ * handlers do not run in the meantime. At most COMPOSE_SPECULATIVE_BUDGET
+ * operations are completed inline within one handler invocation, after that
+ * the next operation is sent through the reactor, which bounds both the
+ * recursion depth and the time other handlers are starved for.
+ *
+ * @remark Errors other than "would block" are not reported inline, the
+ * asynchronous operation is started to report them.
+ */
+template<typename Socket, typename MutableBufferSequence, typename ComposedOp>
+upcall_guard
+speculative_read_some(Socket& socket,
+                      MutableBufferSequence const& buffers,
+                      yield_token<ComposedOp> yield);
+
+/**
+ * Writes data to a stream socket, resuming the composed operation inline if
+ * the data fits in the socket's send buffer.
+ *
+ * Behaves like speculative_read_some(), but attempts a non-blocking send and
+ * falls back to socket.async_write_some(buffers, yield).
+ *
+ * @param socket A stream socket with a native_handle().
+ *
+ * @param buffers The data to be written. Must remain valid until the
+ * operation is resumed.
+ *
+ * @param yield The yield_token of the running operation. Ownership of the
+ * composed operation is released.
+ *
+ * @returns An upcall_guard, meant to be returned from the OperationBody.
+ */
+template<typename Socket, typename ConstBufferSequence, typename ComposedOp>
+upcall_guard
+speculative_write_some(Socket& socket,
+                       ConstBufferSequence const& buffers,
+                       yield_token<ComposedOp> yield);
+
+} // namespace compose
+
+#include <compose/impl/speculative_io.hpp>
+
+#endif // COMPOSE_SPECULATIVE_IO_HPP
@@ -0,0 +1,74 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_SPLICE_PROXY_HPP
+#define COMPOSE_SPLICE_PROXY_HPP
+
+#if defined(__linux__) && !defined(COMPOSE_NO_SPLICE)
+#define COMPOSE_HAS_SPLICE
+#endif
+
+#ifdef COMPOSE_HAS_SPLICE
+
+#include <boost/asio/async_result.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+
+namespace compose
+{
+
+/**
+ * Forwards data in both directions between two stream sockets, until either
+ * of them is closed.
+ *
+ * The data does not pass through user space. Each direction moves data from
+ * its source socket into a pipe and from the pipe into its destination socket
+ * with splice. The two pipes are taken from a per-thread pool. Both sockets
+ * are put in non-blocking mode, and a direction waits for its source to
+ * become readable or its destination to become writable whenever a splice
+ * would block. Both directions share the state of one stable composed
+ * operation.
+ *
+ * The operation completes when the end of the stream is reached in either
+ * direction, after the data read before it was forwarded, or when either
+ * direction fails. Outstanding operations on both sockets are cancelled at
+ * that point and data buffered in the pipe of the other direction is
+ * discarded.
+ *
+ * Signature of the CompletionHandler:
+ * @code
+ * void(boost::system::error_code ec, std::size_t a_to_b, std::size_t b_to_a)
+ * @endcode
+ * Where a_to_b and b_to_a are the numbers of bytes forwarded in each
+ * direction. ec is empty if the operation completed because of the end of
+ * a stream.
+ *
+ * @param a, b Stream sockets with a native_handle(). Must remain valid until
+ * the operation completes.
+ *
+ * @remark Both directions may resume concurrently. If the sockets' execution
+ * context is run by multiple threads, the CompletionHandler must be bound to
+ * a strand.
+ */
+template<typename Socket, typename CompletionToken>
+auto
+async_splice_proxy(Socket& a, Socket& b, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t,
+                                        std::size_t));
+
+} // namespace compose
+
+#include <compose/impl/splice_proxy.hpp>
+
+#endif // COMPOSE_HAS_SPLICE
+
+#endif // COMPOSE_SPLICE_PROXY_HPP
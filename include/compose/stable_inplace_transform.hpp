@@ -43,12 +43,13 @@ stable_inplace_transform(
   boost::asio::async_completion<CompletionToken, Signature>& init,
   converter<F> conv)
 {
-    return detail::stable_transform<typename converter<F>::result_type>(
+    return detail::stable_transform<Signature,
+                                    typename converter<F>::result_type>(
       ex, init, conv);
 }
 
 #define COMPOSE_INPLACE_FWD(...)                                               \
-    converter                                                                  \
+    ::compose::converter                                                       \
     {                                                                          \
         [&]() { return (__VA_ARGS__); }                                        \
     }
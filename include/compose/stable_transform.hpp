@@ -25,7 +25,16 @@ namespace compose
  *
  * Performs one additional memory allocation, using the Allocator associated
  * with the deduced CompletionHandler. The memory persists until upcall or the
- * operation is discarded.
+ * operation is discarded. A post_upcall reuses it for the executor's operation
+ * if it fits. An OperationBody which declares the signature of its upcall, e.g.
+ * @code
+ * using upcall_signature = void(boost::system::error_code, std::size_t);
+ * @endcode
+ * gets a frame large enough for it, so that a post_upcall through the
+ * executor of an io_context, also when it is type-erased, does not allocate.
+ * Other frames only get COMPOSE_UPCALL_RESERVE bytes, 0 by default, so their
+ * post_upcall usually deallocates the frame and the executor allocates its
+ * operation.
  *
  * @tparam OperationBody the type that will transformed into a
  * ComposedOperation.
@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_URING_DESCRIPTOR_HPP
+#define COMPOSE_URING_DESCRIPTOR_HPP
+
+#include <compose/uring_service.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstdint>
+
+namespace compose
+{
+
+/**
+ * A file descriptor whose reads and writes are performed by the uring_service
+ * of its execution context. Models AsyncReadStream and AsyncWriteStream, so
+ * it can replace a socket or a stream_descriptor in a composed operation.
+ *
+ * Operations started by all uring_descriptors of a context, while the
+ * context runs one batch of handlers, are submitted to the kernel with a
+ * single system call. Completions are reaped in batches as well.
+ *
+ * If the uring_service is disabled, stream operations are performed through
+ * the reactor and positional operations are performed synchronously, with
+ * their completions posted to the executor.
+ *
+ * At most 8 buffers of a buffer sequence are used by one operation.
+ *
+ * @remark Distinct objects: Safe. Shared objects: Unsafe.
+ */
+template<typename Executor = boost::asio::any_io_executor>
+class uring_descriptor
+{
+public:
+    using executor_type = Executor;
+
+    /**
+     * Construct a uring_descriptor, which takes ownership of a file
+     * descriptor.
+     *
+     * @param ex The executor used to invoke CompletionHandlers which do not
+     * have an associated executor.
+     *
+     * @param fd An open file descriptor. Closed by the uring_descriptor.
+     */
+    uring_descriptor(Executor const& ex, int fd);
+
+    /**
+     * Cancels outstanding operations and closes the descriptor. The
+     * CompletionHandlers of the operations are invoked with
+     * boost::asio::error::operation_aborted, unless the kernel already
+     * completed them.
+     */
+    ~uring_descriptor();
+
+    uring_descriptor(uring_descriptor const&) = delete;
+    uring_descriptor& operator=(uring_descriptor const&) = delete;
+
+    executor_type get_executor() noexcept
+    {
+        return descriptor_.get_executor();
+    }
+
+    int native_handle() noexcept
+    {
+        return descriptor_.native_handle();
+    }
+
+    bool is_open() const noexcept
+    {
+        return descriptor_.is_open();
+    }
+
+    /**
+     * Cancels outstanding operations and closes the descriptor.
+     */
+    void close();
+
+    /**
+     * Cancels outstanding operations. Cancelled operations complete with
+     * boost::asio::error::operation_aborted, operations which the kernel
+     * already completed complete normally.
+     */
+    void cancel();
+
+    /**
+     * Reads data from the current position of the descriptor.
+     *
+     * Signature of the CompletionHandler:
+     * @code
+     * void(boost::system::error_code, std::size_t)
+     * @endcode
+     */
+    template<typename MutableBufferSequence, typename CompletionToken>
+    auto async_read_some(MutableBufferSequence const& buffers,
+                         CompletionToken&& tok)
+      -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                       void(boost::system::error_code,
+                                            std::size_t));
+
+    /**
+     * Writes data at the current position of the descriptor.
+     *
+     * Signature of the CompletionHandler:
+     * @code
+     * void(boost::system::error_code, std::size_t)
+     * @endcode
+     */
+    template<typename ConstBufferSequence, typename CompletionToken>
+    auto async_write_some(ConstBufferSequence const& buffers,
+                          CompletionToken&& tok)
+      -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                       void(boost::system::error_code,
+                                            std::size_t));
+
+    /**
+     * Reads data at an offset of a seekable descriptor, without changing its
+     * position.
+     *
+     * Signature of the CompletionHandler:
+     * @code
+     * void(boost::system::error_code, std::size_t)
+     * @endcode
+     */
+    template<typename MutableBufferSequence, typename CompletionToken>
+    auto async_read_some_at(std::uint64_t offset,
+                            MutableBufferSequence const& buffers,
+                            CompletionToken&& tok)
+      -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                       void(boost::system::error_code,
+                                            std::size_t));
+
+    /**
+     * Writes data at an offset of a seekable descriptor, without changing its
+     * position.
+     *
+     * Signature of the CompletionHandler:
+     * @code
+     * void(boost::system::error_code, std::size_t)
+     * @endcode
+     */
+    template<typename ConstBufferSequence, typename CompletionToken>
+    auto async_write_some_at(std::uint64_t offset,
+                             ConstBufferSequence const& buffers,
+                             CompletionToken&& tok)
+      -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                       void(boost::system::error_code,
+                                            std::size_t));
+
+private:
+    template<typename Buffer, typename BufferSequence, typename Handler>
+    void start(std::uint8_t opcode,
+               std::uint64_t offset,
+               BufferSequence const& buffers,
+               Handler&& handler);
+
+    template<typename Buffer, typename BufferSequence, typename Handler>
+    void perform_at(std::uint64_t offset,
+                    BufferSequence const& buffers,
+                    Handler&& handler);
+
+    uring_service& service_;
+    boost::asio::posix::basic_stream_descriptor<Executor> descriptor_;
+};
+
+} // namespace compose
+
+#include <compose/impl/uring_descriptor.hpp>
+
+#endif // COMPOSE_URING_DESCRIPTOR_HPP
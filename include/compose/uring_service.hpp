@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_URING_SERVICE_HPP
+#define COMPOSE_URING_SERVICE_HPP
+
+#include <compose/detail/io_uring.hpp>
+#include <compose/detail/list_node.hpp>
+#include <compose/detail/uring_op.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/detail/service_registry.hpp>
+#include <boost/asio/execution_context.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/optional.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <mutex>
+
+// Number of submission queue entries of the io_uring instance of a
+// uring_service.
+#ifndef COMPOSE_URING_ENTRIES
+#define COMPOSE_URING_ENTRIES 256
+#endif // COMPOSE_URING_ENTRIES
+
+namespace compose
+{
+
+template<typename Executor>
+class uring_descriptor;
+
+template<typename Socket>
+class send_batch;
+
+/**
+ * An execution context service which owns an io_uring instance shared by all
+ * uring_descriptors of the context.
+ *
+ * Operations started during one run of the context's handlers are submitted
+ * together, with a single io_uring_enter performed by a handler posted to the
+ * context. The kernel signals completions through an eventfd, which is waited
+ * on by the context's reactor. All available completions are reaped at once.
+ *
+ * If io_uring is not available, either because COMPOSE_NO_IO_URING is defined,
+ * the target is not Linux or the kernel refuses to set up an instance, the
+ * service is disabled and uring_descriptors use the reactor instead.
+ *
+ * @remark All member functions are thread-safe.
+ */
+class uring_service
+  : public boost::asio::detail::execution_context_service_base<uring_service>
+{
+public:
+    explicit uring_service(boost::asio::execution_context& ctx);
+
+    ~uring_service();
+
+    /**
+     * Returns true if operations are performed with io_uring.
+     */
+    bool is_enabled() const noexcept;
+
+    /**
+     * Returns the reason io_uring is not used, if the service is disabled.
+     */
+    boost::system::error_code setup_error() const noexcept;
+
+private:
+    template<typename Executor>
+    friend class uring_descriptor;
+
+    template<typename Socket>
+    friend class send_batch;
+
+    using executor_type = boost::asio::any_io_executor;
+
+    void shutdown() override;
+
+    void start(detail::uring_op& op,
+               void const* owner,
+               executor_type const& ex);
+    void cancel(void const* owner);
+
+    bool prepare_cancels(detail::list_node& failed);
+    boost::system::error_code submit(detail::list_node& failed);
+    void flush();
+    void arm();
+    void on_ready(boost::system::error_code ec);
+
+    std::mutex mutex_;
+    boost::system::error_code setup_error_;
+#ifdef COMPOSE_HAS_IO_URING
+    detail::io_uring_ring ring_;
+#endif // COMPOSE_HAS_IO_URING
+    int eventfd_handle_ = -1;
+    bool enabled_ = false;
+    boost::optional<executor_type> ex_;
+    boost::optional<boost::asio::posix::basic_stream_descriptor<executor_type>>
+      eventfd_;
+    detail::list_node ops_;
+    std::size_t outstanding_ = 0;
+    bool flush_pending_ = false;
+    bool armed_ = false;
+    bool shut_down_ = false;
+};
+
+} // namespace compose
+
+#include <compose/impl/uring_service.hpp>
+
+#endif // COMPOSE_URING_SERVICE_HPP
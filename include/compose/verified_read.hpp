@@ -0,0 +1,74 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_VERIFIED_READ_HPP
+#define COMPOSE_VERIFIED_READ_HPP
+
+#include <compose/error.hpp>
+
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace compose
+{
+
+/**
+ * Computes the CRC32C (Castagnoli) checksum of a range of bytes, extending
+ * the checksum of the data that precedes it.
+ *
+ * Uses the SSE4.2 crc32 instruction if the CPU supports it and a table driven
+ * implementation otherwise.
+ *
+ * @param crc The checksum of the preceding data, 0 if there is none.
+ */
+inline std::uint32_t
+crc32c(void const* data, std::size_t size, std::uint32_t crc = 0) noexcept;
+
+/**
+ * Fills a buffer with data read from a stream and verifies its CRC32C
+ * checksum.
+ *
+ * Behaves like boost::asio::async_read, but the checksum is updated with
+ * every chunk of data right after it is read, while it is still in the
+ * cache, instead of in a separate pass over the whole buffer.
+ *
+ * Signature of the CompletionHandler:
+ * @code
+ * void(boost::system::error_code ec, std::size_t bytes_transferred)
+ * @endcode
+ * If the buffer was filled but its checksum differs from the expected one,
+ * compose::error::checksum_mismatch is reported.
+ *
+ * @param stream The AsyncReadStream to read from. Must remain valid until the
+ * operation completes.
+ *
+ * @param buffer The buffer to fill. Must remain valid until the operation
+ * completes.
+ *
+ * @param checksum The expected CRC32C checksum of the whole buffer.
+ */
+template<typename AsyncReadStream, typename CompletionToken>
+auto
+async_read_verified(AsyncReadStream& stream,
+                    boost::asio::mutable_buffer buffer,
+                    std::uint32_t checksum,
+                    CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t));
+
+} // namespace compose
+
+#include <compose/impl/verified_read.hpp>
+
+#endif // COMPOSE_VERIFIED_READ_HPP
@@ -0,0 +1,174 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#ifndef COMPOSE_WITH_ARENA_HPP
+#define COMPOSE_WITH_ARENA_HPP
+
+#include <compose/detail/composed_operation.hpp>
+#include <compose/detail/monotonic_arena.hpp>
+#include <compose/yield_token.hpp>
+
+#include <boost/asio/associated_allocator.hpp>
+
+#include <memory>
+#include <utility>
+
+namespace compose
+{
+
+/**
+ * An Allocator which allocates from the arena of a with_arena frame and falls
+ * back to the Upstream allocator once the arena is exhausted.
+ *
+ * @remark Not thread-safe. All descendants of an operation which uses an arena
+ * must allocate from a single implicit or explicit strand.
+ */
+template<typename T, typename Upstream>
+class arena_allocator
+{
+public:
+    using value_type = T;
+
+    arena_allocator(detail::arena_resource& arena,
+                    Upstream const& upstream) noexcept;
+
+    template<typename U, typename UUpstream>
+    arena_allocator(arena_allocator<U, UUpstream> const& other) noexcept;
+
+    T* allocate(std::size_t n);
+
+    void deallocate(T* p, std::size_t n);
+
+    Upstream const& upstream() const noexcept
+    {
+        return upstream_;
+    }
+
+    detail::arena_resource& arena() const noexcept
+    {
+        return *arena_;
+    }
+
+private:
+    detail::arena_resource* arena_;
+    Upstream upstream_;
+};
+
+template<typename T, typename U, typename Upstream>
+bool
+operator==(arena_allocator<T, Upstream> const& lhs,
+           arena_allocator<U, Upstream> const& rhs) noexcept;
+
+template<typename T, typename U, typename Upstream>
+bool
+operator!=(arena_allocator<T, Upstream> const& lhs,
+           arena_allocator<U, Upstream> const& rhs) noexcept;
+
+/**
+ * An OperationBody adaptor which embeds a monotonic arena of ArenaSize bytes in
+ * the frame of a stable ComposedOperation. The Allocator associated with the
+ * ComposedOperation, and therefore with every child operation and timer wait
+ * initiated with its yield_token, allocates from the arena. The whole arena is
+ * released together with the frame, on upcall.
+ *
+ * Usage:
+ * @code
+ * compose::stable_transform<compose::with_arena<request_op, 4096>>(
+ *   ex, init, std::piecewise_construct, args...).run();
+ * @endcode
+ *
+ * @tparam OperationBody the wrapped OperationBody.
+ *
+ * @tparam ArenaSize size of the arena in bytes. Allocations which do not fit
+ * are served by the Allocator associated with the CompletionHandler.
+ *
+ * @remark The wrapper forwards its constructor arguments to OperationBody, so
+ * it is meant to be constructed in place (std::piecewise_construct or
+ * compose::defer).
+ *
+ * @remark The arena lives in the frame, so the operation must not be
+ * destroyed while child operations that allocated from it are pending (e.g.
+ * by destroying the execution context before the operation completes).
+ *
+ * @remark The arena is only used with stable_transform, an unstable
+ * ComposedOperation keeps using the Allocator associated with the
+ * CompletionHandler.
+ */
+template<typename OperationBody, std::size_t ArenaSize>
+class with_arena
+{
+public:
+    template<typename... Args>
+    explicit with_arena(Args&&... args)
+      : body_{std::forward<Args>(args)...}
+    {
+    }
+
+    template<typename Self, typename... Args>
+    auto operator()(yield_token<Self> yield, Args&&... args)
+      -> decltype(std::declval<OperationBody&>()(yield,
+                                                 std::forward<Args>(args)...))
+    {
+        return body_(yield, std::forward<Args>(args)...);
+    }
+
+    detail::arena_resource& arena() const noexcept
+    {
+        return arena_;
+    }
+
+private:
+    mutable detail::monotonic_arena<ArenaSize> arena_;
+    OperationBody body_;
+};
+
+} // namespace compose
+
+namespace boost
+{
+namespace asio
+{
+
+template<class OperationBody,
+         std::size_t ArenaSize,
+         class Handler,
+         class IoExecutor,
+         class A>
+class associated_allocator<
+  ::compose::detail::composed_op<
+    ::compose::with_arena<OperationBody, ArenaSize>,
+    Handler,
+    IoExecutor,
+    true>,
+  A>
+{
+public:
+    using type =
+      ::compose::arena_allocator<void, associated_allocator_t<Handler, A>>;
+
+    static type get(
+      ::compose::detail::composed_op<
+        ::compose::with_arena<OperationBody, ArenaSize>,
+        Handler,
+        IoExecutor,
+        true> const& op,
+      A const& alloc = A{})
+    {
+        return type{op.op_storage_.value().arena(),
+                    associated_allocator<Handler, A>::get(
+                      op.op_storage_.handler().upcall_, alloc)};
+    }
+};
+
+} // namespace asio
+} // namespace boost
+
+#include <compose/impl/with_arena.hpp>
+
+#endif // COMPOSE_WITH_ARENA_HPP
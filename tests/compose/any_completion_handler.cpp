@@ -0,0 +1,246 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/any_completion_handler.hpp>
+
+#include <compose/bind_token.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <array>
+
+namespace compose_tests
+{
+
+using wait_handler = compose::any_completion_handler<void(
+  boost::system::error_code)>;
+
+int allocations = 0;
+int deallocations = 0;
+
+template<typename T>
+struct counting_allocator : std::allocator<T>
+{
+    template<typename U>
+    struct rebind
+    {
+        using other = counting_allocator<U>;
+    };
+
+    counting_allocator() = default;
+
+    template<typename U>
+    counting_allocator(counting_allocator<U> const&)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        ++allocations;
+        return std::allocator<T>::allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        ++deallocations;
+        std::allocator<T>::deallocate(p, n);
+    }
+};
+
+template<std::size_t Padding>
+struct counting_handler
+{
+    using allocator_type = counting_allocator<char>;
+
+    allocator_type get_allocator() const
+    {
+        return {};
+    }
+
+    void operator()(boost::system::error_code ec)
+    {
+        ec_ = ec;
+        ++invoked_;
+    }
+
+    boost::system::error_code& ec_;
+    int& invoked_;
+    std::array<char, Padding> padding_{};
+};
+
+// Stands in for a function exported by a plugin.
+void
+plugin_wait(boost::asio::steady_timer& timer, wait_handler handler)
+{
+    timer.expires_after(std::chrono::milliseconds{1});
+    timer.async_wait(std::move(handler));
+}
+
+struct plugin_op
+{
+    struct timer_tag_t
+    {
+    };
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        using bound_t = decltype(compose::bind_token(yield, timer_tag_t{}));
+        static_assert(sizeof(Self) <= 4 * sizeof(void*) &&
+                        sizeof(typename boost::asio::async_result<
+                               bound_t,
+                               void(boost::system::error_code)>::
+                                 completion_handler_type) <= 4 * sizeof(void*),
+                      "Composed operations must be stored inline.");
+
+        plugin_wait(timer_, yield.release_operation());
+        return {};
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec)
+    {
+        return yield.direct_upcall(ec);
+    }
+
+    boost::asio::steady_timer& timer_;
+};
+
+void
+test_inline()
+{
+    boost::system::error_code ec = boost::asio::error::eof;
+    int invoked = 0;
+
+    allocations = deallocations = 0;
+    wait_handler handler{counting_handler<0>{ec, invoked}};
+    BOOST_TEST(static_cast<bool>(handler));
+    BOOST_TEST(allocations == 0);
+
+    wait_handler moved{std::move(handler)};
+    BOOST_TEST(!handler);
+    moved(boost::system::error_code{});
+    BOOST_TEST(!moved);
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(!ec);
+    BOOST_TEST(allocations == 0);
+}
+
+void
+test_allocated()
+{
+    boost::system::error_code ec;
+    int invoked = 0;
+
+    allocations = deallocations = 0;
+    wait_handler handler{counting_handler<128>{ec, invoked}};
+    BOOST_TEST(allocations == 1);
+
+    wait_handler moved;
+    moved = std::move(handler);
+    BOOST_TEST(allocations == 1);
+    moved(boost::asio::error::eof);
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(ec == boost::asio::error::eof);
+    BOOST_TEST(deallocations == 1);
+
+    {
+        wait_handler discarded{counting_handler<128>{ec, invoked}};
+    }
+    BOOST_TEST(allocations == 2);
+    BOOST_TEST(deallocations == 2);
+}
+
+void
+test_executor()
+{
+    boost::asio::io_context ctx;
+    auto const strand = boost::asio::make_strand(ctx);
+    wait_handler bound{boost::asio::bind_executor(
+      strand, [](boost::system::error_code) {})};
+    BOOST_TEST(boost::asio::get_associated_executor(bound) ==
+               boost::asio::any_io_executor{strand});
+
+    wait_handler unbound{[](boost::system::error_code) {}};
+    BOOST_TEST(boost::asio::get_associated_executor(
+                 unbound, ctx.get_executor()) ==
+               boost::asio::any_io_executor{ctx.get_executor()});
+
+    // Empty and moved-from handlers fall back to the defaults.
+    wait_handler empty;
+    BOOST_TEST(
+      boost::asio::get_associated_executor(empty, ctx.get_executor()) ==
+      boost::asio::any_io_executor{ctx.get_executor()});
+    wait_handler moved{std::move(bound)};
+    BOOST_TEST(
+      boost::asio::get_associated_executor(bound, ctx.get_executor()) ==
+      boost::asio::any_io_executor{ctx.get_executor()});
+    compose::any_handler_allocator<char> alloc{
+      boost::asio::get_associated_allocator(empty)};
+    alloc.deallocate(alloc.allocate(16), 16);
+}
+
+void
+test_allocator()
+{
+    boost::asio::io_context ctx;
+    boost::asio::steady_timer timer{ctx};
+    boost::system::error_code ec = boost::asio::error::eof;
+    int invoked = 0;
+
+    allocations = deallocations = 0;
+    plugin_wait(timer, counting_handler<0>{ec, invoked});
+    BOOST_TEST(allocations == 1);
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(!ec);
+    BOOST_TEST(deallocations == 1);
+}
+
+void
+test_composed_operation()
+{
+    boost::asio::io_context ctx;
+    boost::asio::steady_timer timer{ctx};
+    boost::system::error_code ec = boost::asio::error::eof;
+    int invoked = 0;
+
+    allocations = deallocations = 0;
+    counting_handler<0> handler{ec, invoked};
+    boost::asio::async_completion<counting_handler<0>,
+                                  void(boost::system::error_code)>
+      init{handler};
+    compose::stable_transform<plugin_op>(
+      ctx.get_executor(), init, std::piecewise_construct, timer)
+      .run();
+    // The frame of the composed operation and the timer's operation.
+    BOOST_TEST(allocations == 2);
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(!ec);
+    BOOST_TEST(deallocations == allocations);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_inline();
+    compose_tests::test_allocated();
+    compose_tests::test_executor();
+    compose_tests::test_allocator();
+    compose_tests::test_composed_operation();
+    return boost::report_errors();
+}
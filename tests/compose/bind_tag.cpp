@@ -0,0 +1,213 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/bind_tag.hpp>
+
+#include <compose/stable_transform.hpp>
+#include <compose/unstable_transform.hpp>
+#include <compose/with_arena.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <string>
+
+namespace compose_tests
+{
+
+struct wait_tag
+{
+};
+
+struct hop_tag
+{
+};
+
+struct done_tag
+{
+};
+
+using tags = compose::tag_set<wait_tag, hop_tag, done_tag>;
+
+// Alternates between a timer wait and a hop, all with the same handler type.
+struct tagged_op
+{
+    tagged_op(boost::asio::steady_timer& timer, std::string& trace, int n)
+      : timer_{timer}
+      , trace_{trace}
+      , n_{n}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        using wait_handler =
+          decltype(compose::bind_tag<tags>(yield, wait_tag{}));
+        using hop_handler =
+          decltype(compose::bind_tag<tags>(yield, hop_tag{}));
+        static_assert(std::is_same<wait_handler, hop_handler>::value,
+                      "The tag must not change the handler type");
+        static_assert(sizeof(wait_handler) <= sizeof(Self) + sizeof(void*),
+                      "The tag must be stored compactly");
+
+        timer_.expires_after(std::chrono::milliseconds{1});
+        return timer_.async_wait(compose::bind_tag<tags>(yield, wait_tag{}));
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     wait_tag,
+                                     boost::system::error_code ec)
+    {
+        trace_ += 'w';
+        if (ec)
+            return yield.upcall(ec);
+        return boost::asio::post(compose::bind_tag<tags>(yield, hop_tag{}));
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     hop_tag)
+    {
+        trace_ += 'h';
+        if (--n_ > 0)
+        {
+            timer_.expires_after(std::chrono::milliseconds{1});
+            return timer_.async_wait(
+              compose::bind_tag<tags>(yield, wait_tag{}));
+        }
+        return boost::asio::post(compose::bind_tag<tags>(yield, done_tag{}));
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     done_tag)
+    {
+        trace_ += 'd';
+        return yield.direct_upcall(boost::system::error_code{});
+    }
+
+    boost::asio::steady_timer& timer_;
+    std::string& trace_;
+    int n_;
+};
+
+template<bool Stable, class CompletionToken>
+auto
+async_tagged(boost::asio::steady_timer& timer,
+             std::string& trace,
+             int n,
+             CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code)>
+      init{tok};
+    if (Stable)
+    {
+        compose::stable_transform<tagged_op>(timer.get_executor(),
+                                             init,
+                                             std::piecewise_construct,
+                                             timer,
+                                             trace,
+                                             n)
+          .run();
+    }
+    else
+    {
+        compose::unstable_transform(
+          timer.get_executor(), init, tagged_op{timer, trace, n})
+          .run();
+    }
+    return init.result.get();
+}
+
+template<bool Stable>
+void
+test_dispatch()
+{
+    boost::asio::io_context ctx;
+    boost::asio::steady_timer timer{ctx};
+    std::string trace;
+    int invoked = 0;
+
+    async_tagged<Stable>(
+      timer, trace, 3, [&](boost::system::error_code ec) {
+          BOOST_TEST(!ec);
+          ++invoked;
+      });
+
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(trace == "whwhwhd");
+}
+
+void
+test_with_arena()
+{
+    boost::asio::io_context ctx;
+    boost::asio::steady_timer timer{ctx};
+    std::string trace;
+    int invoked = 0;
+
+    auto handler = [&](boost::system::error_code ec) {
+        BOOST_TEST(!ec);
+        ++invoked;
+    };
+    boost::asio::async_completion<decltype(handler),
+                                  void(boost::system::error_code)>
+      init{handler};
+    compose::stable_transform<compose::with_arena<tagged_op, 256>>(
+      timer.get_executor(),
+      init,
+      std::piecewise_construct,
+      timer,
+      trace,
+      2)
+      .run();
+
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(trace == "whwhd");
+}
+
+void
+test_cancel()
+{
+    boost::asio::io_context ctx;
+    boost::asio::steady_timer timer{ctx};
+    std::string trace;
+    int invoked = 0;
+
+    async_tagged<true>(timer, trace, 3, [&](boost::system::error_code ec) {
+        BOOST_TEST(ec == boost::asio::error::operation_aborted);
+        ++invoked;
+    });
+    timer.cancel();
+
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(trace == "w");
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_dispatch<true>();
+    compose_tests::test_dispatch<false>();
+    compose_tests::test_with_arena();
+    compose_tests::test_cancel();
+    return boost::report_errors();
+}
@@ -0,0 +1,294 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/channel.hpp>
+#include <compose/coroutine.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <array>
+#include <vector>
+
+namespace compose_tests
+{
+
+using channel_type = compose::channel<int>;
+
+struct producer_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {})
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (i_ = 0; i_ < n_; ++i_)
+            {
+                COMPOSE_YIELD chan_.async_send(waiter_, i_, yield);
+                if (ec)
+                    return yield.direct_upcall(ec);
+            }
+            chan_.close();
+            return yield.upcall(ec);
+        }
+    }
+
+    channel_type& chan_;
+    int n_;
+    int i_ = 0;
+    channel_type::waiter waiter_{};
+    compose::coroutine coro_{};
+};
+
+struct consumer_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {},
+                                     std::size_t n = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (;;)
+            {
+                COMPOSE_YIELD chan_.async_receive_some(
+                  waiter_, items_.data(), items_.size(), yield);
+                if (ec)
+                    break;
+                received_.insert(
+                  received_.end(), items_.begin(), items_.begin() + n);
+            }
+
+            if (ec == boost::asio::error::eof)
+                ec = {};
+            return yield.direct_upcall(ec);
+        }
+    }
+
+    channel_type& chan_;
+    std::vector<int>& received_;
+    std::array<int, 4> items_{};
+    channel_type::waiter waiter_{};
+    compose::coroutine coro_{};
+};
+
+template<class Body, class CompletionToken, class... Args>
+auto
+async_run(boost::asio::io_context& ctx, CompletionToken&& tok, Args&&... args)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code)>
+      init{tok};
+    compose::stable_transform<Body>(ctx.get_executor(),
+                                    init,
+                                    std::piecewise_construct,
+                                    std::forward<Args>(args)...)
+      .run();
+    return init.result.get();
+}
+
+void
+test_pipeline()
+{
+    boost::asio::io_context ctx;
+    channel_type chan{ctx.get_executor(), 2};
+    std::vector<int> received;
+    int completions = 0;
+    auto const on_done = [&completions](boost::system::error_code ec) {
+        BOOST_TEST(!ec);
+        ++completions;
+    };
+
+    async_run<consumer_op>(ctx, on_done, chan, received);
+    async_run<producer_op>(ctx, on_done, chan, 100);
+    ctx.run();
+
+    BOOST_TEST(completions == 2);
+    BOOST_TEST(received.size() == 100u);
+    for (std::size_t i = 0; i < received.size(); ++i)
+        BOOST_TEST(received[i] == static_cast<int>(i));
+}
+
+void
+test_backpressure()
+{
+    boost::asio::io_context ctx;
+    channel_type chan{ctx.get_executor(), 1};
+    channel_type::waiter senders[3];
+    int sent = 0;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        chan.async_send(senders[i], i, [&sent](boost::system::error_code ec) {
+            BOOST_TEST(!ec);
+            ++sent;
+        });
+    }
+    ctx.poll();
+
+    BOOST_TEST(sent == 1);
+    BOOST_TEST(chan.size() == 1u);
+    BOOST_TEST(senders[1].is_waiting());
+    BOOST_TEST(senders[2].is_waiting());
+
+    channel_type::waiter receiver;
+    std::array<int, 4> items{};
+    std::size_t received = 0;
+    chan.async_receive_some(
+      receiver,
+      items.data(),
+      items.size(),
+      [&received](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          received = n;
+      });
+    ctx.restart();
+    ctx.poll();
+
+    BOOST_TEST(received == 3u);
+    BOOST_TEST(sent == 3);
+    BOOST_TEST(items[0] == 0 && items[1] == 1 && items[2] == 2);
+    BOOST_TEST(!senders[1].is_waiting());
+}
+
+void
+test_batch()
+{
+    boost::asio::io_context ctx;
+    channel_type chan{ctx.get_executor(), 1};
+    channel_type::waiter receiver;
+    std::array<int, 3> items{};
+    std::size_t received = 0;
+    int completions = 0;
+
+    chan.async_receive_some(
+      receiver,
+      items.data(),
+      items.size(),
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          received = n;
+          ++completions;
+      });
+    ctx.poll();
+    BOOST_TEST(receiver.is_waiting());
+
+    // All values sent before the completion runs end up in one batch, until
+    // it is full.
+    channel_type::waiter senders[5];
+    int sent = 0;
+    for (int i = 0; i < 5; ++i)
+    {
+        chan.async_send(senders[i], i, [&sent](boost::system::error_code ec) {
+            if (!ec)
+                ++sent;
+        });
+    }
+    ctx.restart();
+    ctx.poll();
+
+    BOOST_TEST(completions == 1);
+    BOOST_TEST(received == 3u);
+    BOOST_TEST(items[0] == 0 && items[1] == 1 && items[2] == 2);
+    BOOST_TEST(chan.size() == 1u);
+    BOOST_TEST(sent == 4);
+    BOOST_TEST(senders[4].is_waiting());
+    chan.close();
+    ctx.restart();
+    ctx.poll();
+    BOOST_TEST(sent == 4);
+}
+
+void
+test_batch_then_receive()
+{
+    boost::asio::io_context ctx;
+    channel_type chan{ctx.get_executor(), 1};
+    channel_type::waiter batch_receiver;
+    channel_type::waiter receiver;
+    channel_type::waiter senders[2];
+    std::array<int, 4> items{};
+    std::size_t received = 0;
+    int value = 0;
+
+    chan.async_receive_some(
+      batch_receiver,
+      items.data(),
+      items.size(),
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          received = n;
+      });
+    chan.async_send(senders[0], 1, [](boost::system::error_code ec) {
+        BOOST_TEST(!ec);
+    });
+
+    // Suspended while the batch is filling, receives the next value.
+    chan.async_receive(receiver, [&](boost::system::error_code ec, int v) {
+        BOOST_TEST(!ec);
+        value = v;
+    });
+    BOOST_TEST(receiver.is_waiting());
+    chan.async_send(senders[1], 2, [](boost::system::error_code ec) {
+        BOOST_TEST(!ec);
+    });
+    ctx.poll();
+
+    BOOST_TEST(received == 1u);
+    BOOST_TEST(items[0] == 1);
+    BOOST_TEST(value == 2);
+    BOOST_TEST(chan.size() == 0u);
+}
+
+void
+test_close()
+{
+    boost::asio::io_context ctx;
+    channel_type chan{ctx.get_executor(), 0};
+    channel_type::waiter receiver;
+    boost::system::error_code result;
+
+    chan.async_receive(receiver,
+                       [&result](boost::system::error_code ec, int) {
+                           result = ec;
+                       });
+    ctx.poll();
+    BOOST_TEST(receiver.is_waiting());
+
+    chan.close();
+    ctx.restart();
+    ctx.poll();
+    BOOST_TEST(result == boost::asio::error::eof);
+
+    channel_type::waiter sender;
+    chan.async_send(sender, 42, [&result](boost::system::error_code ec) {
+        result = ec;
+    });
+    ctx.restart();
+    ctx.poll();
+    BOOST_TEST(result == boost::asio::error::broken_pipe);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_pipeline();
+    compose_tests::test_backpressure();
+    compose_tests::test_batch();
+    compose_tests::test_batch_then_receive();
+    compose_tests::test_close();
+
+    return boost::report_errors();
+}
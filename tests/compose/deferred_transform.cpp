@@ -0,0 +1,262 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/deferred_transform.hpp>
+
+#include <compose/bind_token.hpp>
+#include <compose/coroutine.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <memory>
+
+namespace compose_tests
+{
+
+int allocations = 0;
+
+template<typename T>
+struct counting_allocator : std::allocator<T>
+{
+    template<typename U>
+    struct rebind
+    {
+        using other = counting_allocator<U>;
+    };
+
+    counting_allocator() = default;
+
+    template<typename U>
+    counting_allocator(counting_allocator<U> const&)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        ++allocations;
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+struct result_handler
+{
+    using allocator_type = counting_allocator<char>;
+
+    allocator_type get_allocator() const
+    {
+        return {};
+    }
+
+    void operator()(boost::system::error_code ec, int n)
+    {
+        ec_ = ec;
+        result_ = n;
+    }
+
+    boost::system::error_code& ec_;
+    int& result_;
+};
+
+// Waits for the timer and passes 1 on to the next step.
+struct wait_step
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {})
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            timer_.expires_after(std::chrono::milliseconds{1});
+            COMPOSE_YIELD timer_.async_wait(yield);
+            return yield.upcall(ec, 1);
+        }
+    }
+
+    boost::asio::steady_timer& timer_;
+    compose::coroutine coro_{};
+};
+
+// Waits for the timer again and increments the result of the previous step.
+struct increment_step
+{
+    struct timer_tag_t
+    {
+    };
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec,
+                                     int n)
+    {
+        if (ec)
+            return yield.upcall(ec, n);
+
+        n_ = n;
+        timer_.expires_after(std::chrono::milliseconds{1});
+        return timer_.async_wait(compose::bind_token(yield, timer_tag_t{}));
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     timer_tag_t,
+                                     boost::system::error_code ec)
+    {
+        return yield.upcall(ec, n_ + increment_);
+    }
+
+    boost::asio::steady_timer& timer_;
+    int increment_;
+    int n_ = 0;
+};
+
+// Completes synchronously, multiplying the result of the previous step.
+struct multiply_step
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {},
+                                     int n = 1)
+    {
+        return yield.upcall(ec, n * factor_);
+    }
+
+    int factor_;
+};
+
+template<typename Deferred, typename CompletionToken>
+auto
+async_launch(boost::asio::io_context& ctx,
+             Deferred&& deferred,
+             CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code, int))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code, int)>
+      init{tok};
+    compose::transform_deferred(
+      ctx.get_executor(), init, std::forward<Deferred>(deferred))
+      .run();
+    return init.result.get();
+}
+
+void
+test_single()
+{
+    boost::asio::io_context ctx;
+    boost::system::error_code ec = boost::asio::error::eof;
+    int result = 0;
+
+    async_launch(ctx,
+                 compose::defer<multiply_step>(3),
+                 result_handler{ec, result});
+    BOOST_TEST(result == 0);
+
+    ctx.run();
+    BOOST_TEST(!ec);
+    BOOST_TEST(result == 3);
+}
+
+void
+test_sequence()
+{
+    boost::asio::io_context ctx;
+    boost::asio::steady_timer timer{ctx};
+    boost::system::error_code ec = boost::asio::error::eof;
+    int result = 0;
+
+    auto request = compose::sequence(compose::defer<wait_step>(std::ref(timer)),
+                                     compose::defer<increment_step>(
+                                       std::ref(timer), 1),
+                                     compose::defer<multiply_step>(10));
+    async_launch(ctx, std::move(request), result_handler{ec, result});
+    ctx.run();
+    BOOST_TEST(!ec);
+    BOOST_TEST(result == 20);
+}
+
+void
+test_nested_sequence()
+{
+    boost::asio::io_context ctx;
+    boost::asio::steady_timer timer{ctx};
+    boost::system::error_code ec = boost::asio::error::eof;
+    int result = 0;
+
+    async_launch(
+      ctx,
+      compose::sequence(
+        compose::sequence(compose::defer<multiply_step>(2),
+                          compose::defer<increment_step>(std::ref(timer), 3)),
+        compose::defer<multiply_step>(5)),
+      result_handler{ec, result});
+    ctx.run();
+    BOOST_TEST(!ec);
+    BOOST_TEST(result == 25);
+}
+
+void
+test_error_propagation()
+{
+    boost::asio::io_context ctx;
+    boost::asio::steady_timer timer{ctx};
+    boost::system::error_code ec;
+    int result = 0;
+
+    async_launch(
+      ctx,
+      compose::sequence(compose::defer<wait_step>(std::ref(timer)),
+                        compose::defer<increment_step>(std::ref(timer), 1)),
+      result_handler{ec, result});
+    ctx.poll();
+    timer.cancel();
+    ctx.run();
+    BOOST_TEST(ec == boost::asio::error::operation_aborted);
+    BOOST_TEST(result == 1);
+}
+
+void
+test_single_frame()
+{
+    boost::asio::io_context ctx;
+    boost::system::error_code ec;
+    int result = 0;
+
+    allocations = 0;
+    async_launch(ctx,
+                 compose::sequence(compose::defer<multiply_step>(2),
+                                   compose::defer<multiply_step>(3),
+                                   compose::defer<multiply_step>(4)),
+                 result_handler{ec, result});
+    int const sequence_allocations = allocations;
+    ctx.run();
+    BOOST_TEST(result == 24);
+
+    allocations = 0;
+    async_launch(
+      ctx, compose::defer<multiply_step>(24), result_handler{ec, result});
+    BOOST_TEST(sequence_allocations == allocations);
+    ctx.restart();
+    ctx.run();
+    BOOST_TEST(result == 24);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_single();
+    compose_tests::test_sequence();
+    compose_tests::test_nested_sequence();
+    compose_tests::test_error_propagation();
+    compose_tests::test_single_frame();
+    return boost::report_errors();
+}
@@ -0,0 +1,271 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/fiber_transform.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace compose_tests
+{
+
+using socket_type = boost::asio::local::stream_protocol::socket;
+
+template<class Signature, class Function, class CompletionToken>
+auto
+async_fiber(boost::asio::io_context& ctx, Function&& f, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, Signature)
+{
+    boost::asio::async_completion<CompletionToken, Signature> init{tok};
+    compose::fiber_transform(
+      ctx.get_executor(), init, std::forward<Function>(f))
+      .run();
+    return init.result.get();
+}
+
+// Decodes a nested message, in which every level is a single byte with the
+// number of levels below it, suspending at every level.
+template<class Yield>
+int
+decode(socket_type& socket, Yield yield)
+{
+    unsigned char depth = 0;
+    boost::system::error_code ec;
+    std::size_t n = 0;
+    std::tie(ec, n) =
+      boost::asio::async_read(socket, boost::asio::buffer(&depth, 1), yield);
+    if (ec || n != 1)
+        throw boost::system::system_error{ec};
+    if (depth == 0)
+        return 1;
+    return 1 + decode(socket, yield);
+}
+
+void
+test_nested_decoding()
+{
+    boost::asio::io_context ctx;
+    socket_type reader{ctx};
+    socket_type writer{ctx};
+    boost::asio::local::connect_pair(reader, writer);
+
+    std::string message;
+    for (int i = 99; i >= 0; --i)
+        message += static_cast<char>(i);
+    boost::asio::write(writer, boost::asio::buffer(message));
+
+    int invoked = 0;
+    async_fiber<void(int)>(
+      ctx,
+      [&](auto yield) { return decode(reader, yield); },
+      [&](int levels) {
+          BOOST_TEST(levels == 100);
+          ++invoked;
+      });
+
+    BOOST_TEST(invoked == 0);
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+}
+
+void
+test_results()
+{
+    boost::asio::io_context ctx;
+    boost::asio::steady_timer timer{ctx};
+    std::string trace;
+    int invoked = 0;
+
+    async_fiber<void(boost::system::error_code, std::string)>(
+      ctx,
+      [&](auto yield) {
+          for (int i = 0; i < 3; ++i)
+          {
+              timer.expires_after(std::chrono::milliseconds{1});
+              auto const ec = timer.async_wait(yield);
+              trace += ec ? 'e' : 'w';
+              boost::asio::post(yield);
+              trace += 'p';
+          }
+          return std::make_tuple(boost::system::error_code{}, trace);
+      },
+      [&](boost::system::error_code ec, std::string const& s) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(s == "wpwpwp");
+          ++invoked;
+      });
+
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+}
+
+void
+test_void()
+{
+    boost::asio::io_context ctx;
+    int hops = 0;
+    int invoked = 0;
+
+    async_fiber<void()>(ctx,
+                        [&](auto yield) {
+                            for (; hops < 10; ++hops)
+                                boost::asio::post(yield);
+                        },
+                        [&]() { ++invoked; });
+
+    ctx.run();
+    BOOST_TEST(hops == 10);
+    BOOST_TEST(invoked == 1);
+}
+
+void
+test_exception()
+{
+    boost::asio::io_context ctx;
+    int invoked = 0;
+
+    async_fiber<void()>(ctx,
+                        [&](auto yield) {
+                            boost::asio::post(yield);
+                            throw std::runtime_error{"decoding failed"};
+                        },
+                        [&]() { ++invoked; });
+
+    BOOST_TEST_THROWS(ctx.run(), std::runtime_error);
+    BOOST_TEST(invoked == 0);
+}
+
+struct counted
+{
+    explicit counted(int& live)
+      : live_{live}
+    {
+        ++live_;
+    }
+
+    ~counted()
+    {
+        --live_;
+    }
+
+    int& live_;
+};
+
+void
+test_discard()
+{
+    int live = 0;
+    int invoked = 0;
+    {
+        boost::asio::io_context ctx;
+        boost::asio::steady_timer timer{ctx};
+
+        async_fiber<void(boost::system::error_code)>(
+          ctx,
+          [&](auto yield) {
+              counted const c{live};
+              timer.expires_after(std::chrono::hours{1});
+              return timer.async_wait(yield);
+          },
+          [&](boost::system::error_code) { ++invoked; });
+
+        ctx.poll();
+        BOOST_TEST(live == 1);
+    }
+
+    // The suspended fiber's stack was unwound.
+    BOOST_TEST(live == 0);
+    BOOST_TEST(invoked == 0);
+}
+
+void
+test_stack_reuse()
+{
+    auto& pool = compose::detail::fiber_stack_pool::this_thread();
+    boost::asio::io_context ctx;
+    int invoked = 0;
+
+    auto const run = [&] {
+        async_fiber<void()>(ctx,
+                            [&](auto yield) { boost::asio::post(yield); },
+                            [&]() { ++invoked; });
+        ctx.restart();
+        ctx.run();
+    };
+
+    run();
+    auto const cached = pool.cached();
+    BOOST_TEST(cached > 0);
+    run();
+    run();
+    BOOST_TEST(pool.cached() == cached);
+    BOOST_TEST(invoked == 3);
+}
+
+// The child operations complete on other threads, possibly before the fiber
+// which initiated them is suspended.
+void
+test_multithreaded()
+{
+    boost::asio::io_context ctx{4};
+    std::atomic<int> hops{0};
+    std::atomic<int> invoked{0};
+
+    for (int i = 0; i < 50; ++i)
+    {
+        async_fiber<void()>(ctx,
+                            [&](auto yield) {
+                                for (int j = 0; j < 200; ++j)
+                                {
+                                    boost::asio::post(yield);
+                                    ++hops;
+                                }
+                            },
+                            [&]() { ++invoked; });
+    }
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 3; ++i)
+        threads.emplace_back([&ctx] { ctx.run(); });
+    ctx.run();
+    for (auto& t : threads)
+        t.join();
+
+    BOOST_TEST(hops == 50 * 200);
+    BOOST_TEST(invoked == 50);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_nested_decoding();
+    compose_tests::test_results();
+    compose_tests::test_void();
+    compose_tests::test_exception();
+    compose_tests::test_discard();
+    compose_tests::test_stack_reuse();
+    compose_tests::test_multithreaded();
+    return boost::report_errors();
+}
@@ -0,0 +1,253 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/for_each_bounded.hpp>
+
+#include <compose/coroutine.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace compose_tests
+{
+
+int allocations = 0;
+
+template<typename T>
+struct counting_allocator : std::allocator<T>
+{
+    template<typename U>
+    struct rebind
+    {
+        using other = counting_allocator<U>;
+    };
+
+    counting_allocator() = default;
+
+    template<typename U>
+    counting_allocator(counting_allocator<U> const&)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        ++allocations;
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+struct result_handler
+{
+    using allocator_type = counting_allocator<char>;
+
+    allocator_type get_allocator() const
+    {
+        return {};
+    }
+
+    void operator()(boost::system::error_code ec, std::size_t failures)
+    {
+        ec_ = ec;
+        failures_ = failures;
+        ++invoked_;
+    }
+
+    boost::system::error_code& ec_;
+    std::size_t& failures_;
+    int& invoked_;
+};
+
+struct fetch_state
+{
+    int active = 0;
+    int max_active = 0;
+    std::vector<int> fetched;
+};
+
+// Waits for a short while, then fails for every item divisible by 10.
+struct fetch_op
+{
+    fetch_op(int item, fetch_state& state, boost::asio::io_context& ctx)
+      : item_{item}
+      , state_{state}
+      , timer_{ctx}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {})
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            timer_.expires_after(std::chrono::microseconds{item_ % 7});
+            COMPOSE_YIELD timer_.async_wait(yield);
+            --state_.active;
+            state_.fetched.push_back(item_);
+            if (!ec && item_ % 10 == 0)
+                ec = boost::asio::error::host_not_found;
+            return yield.direct_upcall(ec, item_);
+        }
+    }
+
+    int item_;
+    fetch_state& state_;
+    boost::asio::steady_timer timer_;
+    compose::coroutine coro_{};
+};
+
+template<class CompletionToken>
+auto
+async_fetch(boost::asio::io_context& ctx,
+            int item,
+            fetch_state& state,
+            CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code, int))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code, int)>
+      init{tok};
+    compose::stable_transform<fetch_op>(ctx.get_executor(),
+                                        init,
+                                        std::piecewise_construct,
+                                        item,
+                                        state,
+                                        ctx)
+      .run();
+    return init.result.get();
+}
+
+struct fetch_factory
+{
+    template<class Handler>
+    void operator()(int item, Handler&& handler) const
+    {
+        state_.max_active = std::max(state_.max_active, ++state_.active);
+        async_fetch(ctx_, item, state_, std::forward<Handler>(handler));
+    }
+
+    boost::asio::io_context& ctx_;
+    fetch_state& state_;
+};
+
+int
+run_fetch(std::size_t count, std::size_t limit, fetch_state& state)
+{
+    boost::asio::io_context ctx;
+    std::vector<int> items(count);
+    for (std::size_t i = 0; i < count; ++i)
+        items[i] = static_cast<int>(i + 1);
+
+    boost::system::error_code ec;
+    std::size_t failures = 0;
+    int invoked = 0;
+    allocations = 0;
+
+    compose::async_for_each_bounded<1024>(
+      ctx.get_executor(),
+      items,
+      limit,
+      fetch_factory{ctx, state},
+      result_handler{ec, failures, invoked});
+    BOOST_TEST(invoked == 0);
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(failures == count / 10);
+    BOOST_TEST(ec == (count >= 10 ? boost::asio::error::host_not_found
+                                  : boost::system::error_code{}));
+    BOOST_TEST(state.active == 0);
+    BOOST_TEST(state.fetched.size() == count);
+    std::sort(state.fetched.begin(), state.fetched.end());
+    BOOST_TEST(state.fetched == items);
+    return allocations;
+}
+
+void
+test_bounded()
+{
+    fetch_state state;
+    run_fetch(100, 4, state);
+    BOOST_TEST(state.max_active == 4);
+
+    fetch_state few;
+    run_fetch(3, 8, few);
+    BOOST_TEST(few.max_active == 3);
+}
+
+void
+test_constant_allocations()
+{
+    fetch_state small;
+    auto const small_allocations = run_fetch(20, 4, small);
+    fetch_state large;
+    auto const large_allocations = run_fetch(500, 4, large);
+    BOOST_TEST(small_allocations == large_allocations);
+}
+
+void
+test_empty_range()
+{
+    boost::asio::io_context ctx;
+    fetch_state state;
+    std::vector<int> items;
+    boost::system::error_code ec = boost::asio::error::eof;
+    std::size_t failures = 1;
+    int invoked = 0;
+
+    compose::async_for_each_bounded(ctx.get_executor(),
+                                    items,
+                                    4,
+                                    fetch_factory{ctx, state},
+                                    result_handler{ec, failures, invoked});
+    BOOST_TEST(invoked == 0);
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(!ec);
+    BOOST_TEST(failures == 0u);
+}
+
+void
+test_shutdown()
+{
+    fetch_state state;
+    std::vector<int> items{1, 2, 3, 4, 5, 6};
+    boost::system::error_code ec;
+    std::size_t failures = 0;
+    int invoked = 0;
+
+    {
+        boost::asio::io_context ctx;
+        compose::async_for_each_bounded(ctx.get_executor(),
+                                        items,
+                                        2,
+                                        fetch_factory{ctx, state},
+                                        result_handler{ec, failures, invoked});
+    }
+
+    BOOST_TEST(invoked == 0);
+    BOOST_TEST(state.max_active == 2);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_bounded();
+    compose_tests::test_constant_allocations();
+    compose_tests::test_empty_range();
+    compose_tests::test_shutdown();
+    return boost::report_errors();
+}
@@ -0,0 +1,248 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/frame_reader.hpp>
+
+#include <compose/coroutine.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <string>
+#include <vector>
+
+namespace compose_tests
+{
+
+using socket_type = boost::asio::local::stream_protocol::socket;
+
+std::string
+encode(std::string const& payload, std::size_t prefix_size = 4)
+{
+    std::string frame(prefix_size, '\0');
+    auto size = payload.size();
+    for (std::size_t i = prefix_size; i-- > 0; size >>= 8)
+        frame[i] = static_cast<char>(size & 0xff);
+    return frame + payload;
+}
+
+// Reads batches of frames until count of them arrived or an error occurs,
+// recording the size of each batch.
+struct collect_op
+{
+    collect_op(socket_type& socket,
+               std::size_t prefix_size,
+               std::size_t count,
+               std::vector<std::string>& frames,
+               std::vector<std::size_t>& batches)
+      : reader_{socket, 1000, prefix_size}
+      , count_{count}
+      , frames_{frames}
+      , batches_{batches}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {},
+                                     std::size_t n = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            while (frames_.size() < count_)
+            {
+                COMPOSE_YIELD reader_.async_read_frames(yield);
+                if (ec)
+                    break;
+
+                BOOST_TEST(n > 0);
+                BOOST_TEST(n == reader_.size());
+                batches_.push_back(n);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    auto const frame = reader_.frame(i);
+                    frames_.emplace_back(
+                      static_cast<char const*>(frame.data()), frame.size());
+                }
+            }
+            return yield.upcall(ec);
+        }
+    }
+
+    compose::frame_reader<socket_type> reader_;
+    std::size_t count_;
+    std::vector<std::string>& frames_;
+    std::vector<std::size_t>& batches_;
+    compose::coroutine coro_;
+};
+
+template<class CompletionToken>
+auto
+async_collect(socket_type& socket,
+              std::size_t prefix_size,
+              std::size_t count,
+              std::vector<std::string>& frames,
+              std::vector<std::size_t>& batches,
+              CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code)>
+      init{tok};
+    compose::stable_transform<collect_op>(socket.get_executor(),
+                                          init,
+                                          std::piecewise_construct,
+                                          socket,
+                                          prefix_size,
+                                          count,
+                                          frames,
+                                          batches)
+      .run();
+    return init.result.get();
+}
+
+struct connection
+{
+    connection()
+      : reader{ctx}
+      , writer{ctx}
+    {
+        boost::asio::local::connect_pair(reader, writer);
+    }
+
+    void write(std::string const& data)
+    {
+        boost::asio::write(writer, boost::asio::buffer(data));
+    }
+
+    boost::asio::io_context ctx;
+    socket_type reader;
+    socket_type writer;
+};
+
+void
+test_batch()
+{
+    connection c;
+    std::vector<std::string> const payloads{"first", "", "third", "fourth"};
+    std::string data;
+    for (auto const& payload : payloads)
+        data += encode(payload);
+    // A partial frame follows the complete ones.
+    c.write(data + encode("fifth").substr(0, 6));
+
+    std::vector<std::string> frames;
+    std::vector<std::size_t> batches;
+    int invoked = 0;
+    async_collect(
+      c.reader, 4, 5, frames, batches, [&](boost::system::error_code ec) {
+          BOOST_TEST(!ec);
+          ++invoked;
+      });
+
+    c.ctx.poll();
+    BOOST_TEST(invoked == 0);
+    BOOST_TEST(batches == (std::vector<std::size_t>{4}));
+
+    c.write(encode("fifth").substr(6));
+    c.ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(batches == (std::vector<std::size_t>{4, 1}));
+    BOOST_TEST(frames ==
+               (std::vector<std::string>{
+                 "first", "", "third", "fourth", "fifth"}));
+}
+
+void
+test_split()
+{
+    connection c;
+    std::string const payload(900, 'x');
+    auto const frame = encode(payload, 2);
+
+    std::vector<std::string> frames;
+    std::vector<std::size_t> batches;
+    int invoked = 0;
+    async_collect(
+      c.reader, 2, 2, frames, batches, [&](boost::system::error_code ec) {
+          BOOST_TEST(!ec);
+          ++invoked;
+      });
+
+    // The frames arrive a byte, then a few bytes at a time.
+    auto const data = frame + frame;
+    for (std::size_t i = 0; i < data.size(); i += 1 + i % 300)
+    {
+        c.write(data.substr(i, 1 + i % 300));
+        c.ctx.poll();
+        c.ctx.restart();
+    }
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(frames == (std::vector<std::string>{payload, payload}));
+}
+
+void
+test_errors()
+{
+    {
+        connection c;
+        c.write(encode("ok") + encode(std::string(1001, 'x')));
+
+        std::vector<std::string> frames;
+        std::vector<std::size_t> batches;
+        int invoked = 0;
+        async_collect(
+          c.reader, 4, 2, frames, batches, [&](boost::system::error_code ec) {
+              BOOST_TEST(ec == boost::asio::error::message_size);
+              ++invoked;
+          });
+        c.ctx.run();
+
+        BOOST_TEST(invoked == 1);
+        BOOST_TEST(frames == (std::vector<std::string>{"ok"}));
+    }
+
+    {
+        connection c;
+        c.write(encode("partial").substr(0, 8));
+        c.writer.close();
+
+        std::vector<std::string> frames;
+        std::vector<std::size_t> batches;
+        int invoked = 0;
+        async_collect(
+          c.reader, 4, 1, frames, batches, [&](boost::system::error_code ec) {
+              BOOST_TEST(ec == boost::asio::error::eof);
+              ++invoked;
+          });
+        c.ctx.run();
+
+        BOOST_TEST(invoked == 1);
+        BOOST_TEST(frames.empty());
+    }
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_batch();
+    compose_tests::test_split();
+    compose_tests::test_errors();
+
+    return boost::report_errors();
+}
@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/stable_transform.hpp>
+#include <compose/unstable_transform.hpp>
+
+#include <compose/coroutine.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <array>
+
+namespace compose_tests
+{
+
+struct large_result
+{
+    large_result() = default;
+
+    large_result(large_result const& other)
+      : data_{other.data_}
+    {
+        ++copies;
+    }
+
+    large_result(large_result&& other) noexcept
+      : data_{other.data_}
+    {
+        ++moves;
+    }
+
+    large_result& operator=(large_result const&) = delete;
+    large_result& operator=(large_result&&) = delete;
+
+    static int copies;
+    static int moves;
+
+    std::array<char, 1024> data_{};
+};
+
+int large_result::copies = 0;
+int large_result::moves = 0;
+
+static_assert(compose::detail::is_inplace_upcall<large_result>::value,
+              "large_result must be upcalled in place.");
+static_assert(!compose::detail::is_inplace_upcall<int, int>::value,
+              "Small arguments must be bound.");
+
+struct result_op
+{
+    explicit result_op(boost::asio::io_context& ctx, bool direct)
+      : ctx_{ctx}
+      , direct_{direct}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            COMPOSE_YIELD boost::asio::post(ctx_, yield);
+            result_.data_.back() = 42;
+            // Moves of an unstable frame don't count.
+            large_result::copies = 0;
+            large_result::moves = 0;
+            if (direct_)
+                return yield.direct_upcall(std::move(result_));
+            else
+                return yield.post_upcall(std::move(result_));
+        }
+    }
+
+    boost::asio::io_context& ctx_;
+    bool direct_;
+    large_result result_;
+    compose::coroutine coro_;
+};
+
+template<bool stable, class CompletionToken>
+auto
+async_result_op(boost::asio::io_context& ctx,
+                bool direct,
+                CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(large_result))
+{
+    boost::asio::async_completion<CompletionToken, void(large_result)> init{
+      tok};
+    auto const ex = ctx.get_executor();
+    if (stable)
+        compose::stable_transform<result_op>(
+          ex, init, std::piecewise_construct, ctx, direct)
+          .run();
+    else
+        compose::unstable_transform(ex, init, result_op{ctx, direct}).run();
+    return init.result.get();
+}
+
+template<bool stable>
+void
+test_upcall(bool direct, int expected_moves)
+{
+    boost::asio::io_context ctx;
+    int invoked = 0;
+
+    async_result_op<stable>(ctx, direct, [&invoked](large_result const& r) {
+        BOOST_TEST(r.data_.back() == 42);
+        ++invoked;
+    });
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(large_result::copies == 0);
+    BOOST_TEST(large_result::moves == expected_moves);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    // An unstable direct upcall passes the result by reference, the operation
+    // is not allocated. A stable one moves it out of the frame before the
+    // frame is freed. A posted upcall moves it into the posted node, and out
+    // of it before the node is freed.
+    compose_tests::test_upcall<true>(true, 1);
+    compose_tests::test_upcall<true>(false, 2);
+    compose_tests::test_upcall<false>(true, 0);
+    compose_tests::test_upcall<false>(false, 2);
+
+    return boost::report_errors();
+}
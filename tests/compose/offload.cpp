@@ -0,0 +1,268 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/coroutine.hpp>
+#include <compose/offload.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace compose_tests
+{
+
+std::atomic<int> allocations{0};
+std::atomic<int> deallocations{0};
+
+template<typename T>
+struct counting_allocator : std::allocator<T>
+{
+    template<typename U>
+    struct rebind
+    {
+        using other = counting_allocator<U>;
+    };
+
+    counting_allocator() = default;
+
+    template<typename U>
+    counting_allocator(counting_allocator<U> const&)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        ++allocations;
+        return std::allocator<T>::allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        ++deallocations;
+        std::allocator<T>::deallocate(p, n);
+    }
+};
+
+struct counting_handler
+{
+    using allocator_type = counting_allocator<char>;
+
+    allocator_type get_allocator() const
+    {
+        return {};
+    }
+
+    void operator()(std::size_t sum)
+    {
+        sum_ = sum;
+        ++invoked_;
+    }
+
+    std::size_t& sum_;
+    int& invoked_;
+};
+
+// Sums the numbers in steps on the compute executor, checking that every step
+// runs off the I/O thread and that the operation is resumed on it.
+template<std::size_t Reserve>
+struct sum_op
+{
+    sum_op(boost::asio::thread_pool::executor_type ex, std::size_t steps)
+      : compute_{ex}
+      , steps_{steps}
+      , numbers_(1000)
+    {
+        std::iota(numbers_.begin(), numbers_.end(), std::size_t{1});
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     std::size_t partial = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            io_thread_ = std::this_thread::get_id();
+            for (; step_ < steps_; ++step_)
+            {
+                COMPOSE_YIELD slot_.post(
+                  compute_,
+                  [this] {
+                      BOOST_TEST(std::this_thread::get_id() != io_thread_);
+                      return std::accumulate(
+                        numbers_.begin(), numbers_.end(), std::size_t{0});
+                  },
+                  yield);
+                BOOST_TEST(std::this_thread::get_id() == io_thread_);
+                BOOST_TEST(!slot_.pending());
+                sum_ += partial;
+            }
+            return yield.direct_upcall(sum_);
+        }
+    }
+
+    boost::asio::thread_pool::executor_type compute_;
+    std::size_t steps_;
+    std::size_t step_ = 0;
+    std::size_t sum_ = 0;
+    std::vector<std::size_t> numbers_;
+    std::thread::id io_thread_;
+    compose::offload_slot<std::size_t, Reserve> slot_;
+    compose::coroutine coro_;
+};
+
+template<std::size_t Reserve>
+void
+async_sum(boost::asio::io_context& ctx,
+          boost::asio::thread_pool& pool,
+          std::size_t steps,
+          counting_handler handler)
+{
+    boost::asio::async_completion<counting_handler&, void(std::size_t)> init{
+      handler};
+    compose::stable_transform<sum_op<Reserve>>(ctx.get_executor(),
+                                               init,
+                                               std::piecewise_construct,
+                                               pool.get_executor(),
+                                               steps)
+      .run();
+}
+
+template<std::size_t Reserve>
+void
+test_sum(int expected_allocations)
+{
+    allocations = 0;
+    deallocations = 0;
+    boost::asio::io_context ctx;
+    boost::asio::thread_pool pool{1};
+    std::size_t sum = 0;
+    int invoked = 0;
+
+    async_sum<Reserve>(ctx, pool, 3, counting_handler{sum, invoked});
+    ctx.run();
+    pool.join();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(sum == 3 * 500500);
+    BOOST_TEST(allocations == expected_allocations);
+    BOOST_TEST(deallocations == allocations);
+}
+
+struct void_op
+{
+    explicit void_op(boost::asio::thread_pool::executor_type ex,
+                     std::thread::id& compute_thread)
+      : compute_{ex}
+      , compute_thread_{compute_thread}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            COMPOSE_YIELD slot_.post(
+              compute_,
+              [this] { compute_thread_ = std::this_thread::get_id(); },
+              yield);
+            return yield.direct_upcall();
+        }
+    }
+
+    boost::asio::thread_pool::executor_type compute_;
+    std::thread::id& compute_thread_;
+    compose::offload_slot<void> slot_;
+    compose::coroutine coro_;
+};
+
+void
+test_void()
+{
+    boost::asio::io_context ctx;
+    boost::asio::thread_pool pool{1};
+    std::thread::id compute_thread;
+    int invoked = 0;
+
+    auto handler = [&] { ++invoked; };
+    boost::asio::async_completion<decltype(handler)&, void()> init{handler};
+    compose::stable_transform<void_op>(ctx.get_executor(),
+                                       init,
+                                       std::piecewise_construct,
+                                       pool.get_executor(),
+                                       compute_thread)
+      .run();
+
+    ctx.run();
+    pool.join();
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(compute_thread != std::thread::id{});
+    BOOST_TEST(compute_thread != std::this_thread::get_id());
+}
+
+struct throwing_op
+{
+    explicit throwing_op(boost::asio::thread_pool::executor_type ex)
+      : compute_{ex}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield, int = 0)
+    {
+        return slot_.post(
+          compute_,
+          []() -> int { throw std::runtime_error{"bad signature"}; },
+          yield);
+    }
+
+    boost::asio::thread_pool::executor_type compute_;
+    compose::offload_slot<int> slot_;
+};
+
+void
+test_exception()
+{
+    boost::asio::io_context ctx;
+    boost::asio::thread_pool pool{1};
+    int invoked = 0;
+
+    auto handler = [&](int) { ++invoked; };
+    boost::asio::async_completion<decltype(handler)&, void(int)> init{handler};
+    compose::stable_transform<throwing_op>(
+      ctx.get_executor(), init, std::piecewise_construct, pool.get_executor())
+      .run();
+
+    // Rethrown on the I/O thread, the operation is destroyed.
+    BOOST_TEST_THROWS(ctx.run(), std::runtime_error);
+    pool.join();
+    BOOST_TEST(invoked == 0);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    // Only the frame is allocated, the operations of both executors are
+    // allocated in the slot.
+    compose_tests::test_sum<COMPOSE_OFFLOAD_RESERVE>(1);
+    // Too small for the operations, each step allocates two of them.
+    compose_tests::test_sum<8>(7);
+    compose_tests::test_void();
+    compose_tests::test_exception();
+    return boost::report_errors();
+}
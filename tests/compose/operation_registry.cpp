@@ -0,0 +1,174 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/channel.hpp>
+#include <compose/coroutine.hpp>
+#include <compose/operation_registry.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+namespace compose_tests
+{
+
+struct sleeper_op
+{
+    sleeper_op(boost::asio::io_context& ctx,
+               compose::operation_registry& registry)
+      : timer_{ctx}
+    {
+        hook_.link(registry, *this);
+    }
+
+    void cancel()
+    {
+        timer_.cancel();
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {})
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            timer_.expires_after(std::chrono::hours{1});
+            COMPOSE_YIELD timer_.async_wait(yield);
+            return yield.direct_upcall(ec);
+        }
+    }
+
+    boost::asio::steady_timer timer_;
+    compose::registry_hook hook_;
+    compose::coroutine coro_;
+};
+
+struct receiver_op
+{
+    using channel_type = compose::channel<int>;
+
+    receiver_op(channel_type& chan, compose::operation_registry& registry)
+      : chan_{chan}
+    {
+        hook_.link(registry, *this);
+    }
+
+    void cancel()
+    {
+        chan_.cancel(waiter_);
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        return chan_.async_receive(waiter_, yield);
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec,
+                                     int)
+    {
+        return yield.direct_upcall(ec);
+    }
+
+    channel_type& chan_;
+    channel_type::waiter waiter_;
+    compose::registry_hook hook_;
+};
+
+template<class Body, class CompletionToken, class... Args>
+auto
+async_run(boost::asio::io_context& ctx, CompletionToken&& tok, Args&&... args)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code)>
+      init{tok};
+    compose::stable_transform<Body>(ctx.get_executor(),
+                                    init,
+                                    std::piecewise_construct,
+                                    std::forward<Args>(args)...)
+      .run();
+    return init.result.get();
+}
+
+void
+test_cancel_all()
+{
+    boost::asio::io_context ctx;
+    compose::operation_registry registry;
+    receiver_op::channel_type chan{ctx.get_executor(), 1};
+    int aborted = 0;
+    auto const on_done = [&aborted](boost::system::error_code ec) {
+        if (ec == boost::asio::error::operation_aborted)
+            ++aborted;
+    };
+
+    for (int i = 0; i < 3; ++i)
+        async_run<sleeper_op>(ctx, on_done, ctx, registry);
+    async_run<receiver_op>(ctx, on_done, chan, registry);
+
+    ctx.poll();
+    BOOST_TEST(registry.size() == 4u);
+    BOOST_TEST(aborted == 0);
+
+    BOOST_TEST(registry.cancel_all() == 4u);
+    BOOST_TEST(registry.size() == 4u);
+
+    ctx.run();
+    BOOST_TEST(aborted == 4);
+    BOOST_TEST(registry.empty());
+}
+
+struct counting_target
+{
+    void cancel()
+    {
+        ++cancelled_;
+    }
+
+    int cancelled_ = 0;
+};
+
+void
+test_unlink()
+{
+    compose::operation_registry registry;
+    counting_target target;
+    {
+        compose::registry_hook hook;
+        hook.link(registry, target);
+        BOOST_TEST(hook.is_linked());
+        BOOST_TEST(registry.size() == 1u);
+        BOOST_TEST(registry.cancel_all() == 1u);
+    }
+    BOOST_TEST(registry.empty());
+    BOOST_TEST(registry.cancel_all() == 0u);
+    BOOST_TEST(target.cancelled_ == 1);
+
+    compose::registry_hook hook;
+    {
+        compose::operation_registry scoped;
+        hook.link(scoped, target);
+    }
+    BOOST_TEST(!hook.is_linked());
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_cancel_all();
+    compose_tests::test_unlink();
+
+    return boost::report_errors();
+}
@@ -0,0 +1,103 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#define COMPOSE_ENABLE_OPERATION_TRACKING
+
+#include <compose/coroutine.hpp>
+#include <compose/operation_tracker.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+namespace compose_tests
+{
+
+// Label of the final COMPOSE_YIELD in ticker_op, recorded on the line of the
+// yield.
+int wait_label = 0;
+
+struct ticker_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {})
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (; ticks_ > 0; --ticks_)
+            {
+                timer_.expires_after(std::chrono::milliseconds{1});
+                COMPOSE_YIELD timer_.async_wait(yield);
+            }
+
+            timer_.expires_after(std::chrono::hours{1});
+            COMPOSE_YIELD(wait_label = __LINE__, timer_.async_wait(yield));
+            return yield.direct_upcall(ec);
+        }
+    }
+
+    boost::asio::steady_timer& timer_;
+    int ticks_;
+    compose::coroutine coro_{};
+};
+
+template<class CompletionToken>
+auto
+async_tick(boost::asio::steady_timer& timer, int ticks, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code)>
+      init{tok};
+    compose::stable_transform<ticker_op>(
+      timer.get_executor(), init, std::piecewise_construct, timer, ticks)
+      .run();
+    return init.result.get();
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    boost::asio::io_context ctx;
+    boost::asio::steady_timer timer{ctx};
+    int invoked = 0;
+
+    compose_tests::async_tick(
+      timer, 3, [&invoked](boost::system::error_code) { ++invoked; });
+
+    auto infos = compose::tracked_operations(ctx.get_executor());
+    BOOST_TEST(infos.size() == 1u);
+
+    while (infos.empty() || infos.front().hops < 3)
+    {
+        ctx.run_one();
+        infos = compose::tracked_operations(timer.get_executor());
+    }
+
+    BOOST_TEST(infos.size() == 1u);
+    auto const& info = infos.front();
+    BOOST_TEST(info.body_type == "compose_tests::ticker_op");
+    BOOST_TEST(info.hops == 3u);
+    BOOST_TEST(compose_tests::wait_label != 0);
+    BOOST_TEST(info.coroutine_state == compose_tests::wait_label);
+    BOOST_TEST(info.frame_size > sizeof(compose_tests::ticker_op));
+    BOOST_TEST(info.since_last_hop >= std::chrono::nanoseconds{0});
+
+    timer.cancel();
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(compose::tracked_operations(ctx.get_executor()).empty());
+
+    return boost::report_errors();
+}
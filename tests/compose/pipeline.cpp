@@ -0,0 +1,240 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/pipeline.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <string>
+
+namespace compose_tests
+{
+
+using socket_type = boost::asio::local::stream_protocol::socket;
+
+char
+upper(char c)
+{
+    return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+}
+
+struct stats
+{
+    std::string trace;
+    std::size_t in_pipeline = 0;
+    std::size_t max_in_pipeline = 0;
+    std::size_t overlapped = 0;
+    bool writing = false;
+};
+
+// Requests are 4 lowercase letters, responses are the same letters in
+// uppercase. Every response is held back for a while, like by a slow peer, so
+// that the reads can run ahead.
+struct upper_stages
+{
+    struct message_type
+    {
+        std::array<char, 4> request;
+        std::array<char, 4> response;
+    };
+
+    template<class Handler>
+    void async_read(socket_type& s, message_type& m, Handler&& h)
+    {
+        if (stats_.writing)
+            ++stats_.overlapped;
+        boost::asio::async_read(
+          s, boost::asio::buffer(m.request), std::forward<Handler>(h));
+    }
+
+    void process(message_type& m)
+    {
+        stats_.trace += 'p';
+        stats_.max_in_pipeline =
+          std::max(stats_.max_in_pipeline, ++stats_.in_pipeline);
+        std::transform(m.request.begin(),
+                       m.request.end(),
+                       m.response.begin(),
+                       [](char c) { return upper(c); });
+    }
+
+    template<class Handler>
+    void async_write(socket_type& s, message_type& m, Handler&& h)
+    {
+        stats_.writing = true;
+        timer_.expires_after(std::chrono::milliseconds{1});
+        timer_.async_wait(
+          [this, &s, &m, h = std::move(h)](boost::system::error_code) mutable {
+              boost::asio::async_write(
+                s,
+                boost::asio::buffer(m.response),
+                [this, h = std::move(h)](boost::system::error_code ec,
+                                         std::size_t n) mutable {
+                    stats_.writing = false;
+                    stats_.trace += 'w';
+                    --stats_.in_pipeline;
+                    h(ec, n);
+                });
+          });
+    }
+
+    stats& stats_;
+    boost::asio::steady_timer& timer_;
+};
+
+template<std::size_t Depth>
+void
+test_ordered()
+{
+    boost::asio::io_context ctx;
+    socket_type server{ctx};
+    socket_type client{ctx};
+    boost::asio::steady_timer timer{ctx};
+    boost::asio::local::connect_pair(server, client);
+
+    std::string requests;
+    for (char c = 'a'; c < 'a' + 16; ++c)
+        requests += std::string(4, c);
+    boost::asio::write(client, boost::asio::buffer(requests));
+    client.shutdown(socket_type::shutdown_send);
+
+    stats s;
+    int invoked = 0;
+    compose::async_pipeline<Depth>(
+      server,
+      upper_stages{s, timer},
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(ec == boost::asio::error::eof);
+          BOOST_TEST(n == 16);
+          ++invoked;
+      });
+
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(s.in_pipeline == 0);
+    BOOST_TEST(s.max_in_pipeline == Depth);
+    BOOST_TEST((s.overlapped > 0) == (Depth > 1));
+
+    std::string responses(requests.size(), '\0');
+    boost::asio::read(client, boost::asio::buffer(&responses[0], 64));
+    std::transform(requests.begin(),
+                   requests.end(),
+                   requests.begin(),
+                   [](char c) { return upper(c); });
+    BOOST_TEST(responses == requests);
+}
+
+void
+test_empty()
+{
+    boost::asio::io_context ctx;
+    socket_type server{ctx};
+    socket_type client{ctx};
+    boost::asio::steady_timer timer{ctx};
+    boost::asio::local::connect_pair(server, client);
+    client.close();
+
+    stats s;
+    int invoked = 0;
+    compose::async_pipeline(server,
+                            upper_stages{s, timer},
+                            [&](boost::system::error_code ec, std::size_t n) {
+                                BOOST_TEST(ec == boost::asio::error::eof);
+                                BOOST_TEST(n == 0);
+                                ++invoked;
+                            });
+
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(s.trace.empty());
+}
+
+void
+test_write_error()
+{
+    boost::asio::io_context ctx;
+    socket_type server{ctx};
+    socket_type client{ctx};
+    boost::asio::steady_timer timer{ctx};
+    boost::asio::local::connect_pair(server, client);
+
+    boost::asio::write(client, boost::asio::buffer("abcd", 4));
+    server.shutdown(socket_type::shutdown_send);
+
+    // The second request arrives after the first response failed, while its
+    // read is in flight.
+    boost::asio::steady_timer delay{ctx};
+    delay.expires_after(std::chrono::milliseconds{20});
+    delay.async_wait([&client](boost::system::error_code) {
+        boost::asio::write(client, boost::asio::buffer("efgh", 4));
+        client.shutdown(socket_type::shutdown_send);
+    });
+
+    stats s;
+    int invoked = 0;
+    compose::async_pipeline<2>(
+      server,
+      upper_stages{s, timer},
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(ec == boost::asio::error::broken_pipe);
+          BOOST_TEST(n == 0);
+          BOOST_TEST(delay.expiry() <= std::chrono::steady_clock::now());
+          ++invoked;
+      });
+
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(s.trace == "pw");
+}
+
+void
+test_abandon()
+{
+    stats s;
+    int invoked = 0;
+    {
+        boost::asio::io_context ctx;
+        socket_type server{ctx};
+        socket_type client{ctx};
+        boost::asio::steady_timer timer{ctx};
+        boost::asio::local::connect_pair(server, client);
+
+        compose::async_pipeline(
+          server,
+          upper_stages{s, timer},
+          [&](boost::system::error_code, std::size_t) { ++invoked; });
+        ctx.poll();
+    }
+
+    BOOST_TEST(invoked == 0);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_ordered<1>();
+    compose_tests::test_ordered<2>();
+    compose_tests::test_ordered<4>();
+    compose_tests::test_empty();
+    compose_tests::test_write_error();
+    compose_tests::test_abandon();
+    return boost::report_errors();
+}
@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/priority_scheduler.hpp>
+
+#include <compose/coroutine.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <memory>
+#include <string>
+
+namespace compose_tests
+{
+
+using scheduler_type =
+  compose::priority_scheduler<boost::asio::io_context::executor_type>;
+
+void
+test_order()
+{
+    boost::asio::io_context ctx;
+    scheduler_type scheduler{ctx.get_executor(), 3};
+    BOOST_TEST(scheduler.classes() == 3);
+
+    std::string order;
+    for (char c : std::string{"2102011"})
+    {
+        boost::asio::post(scheduler.get_executor(std::size_t(c - '0')),
+                          [&order, c]() { order += c; });
+    }
+    BOOST_TEST(order.empty());
+
+    ctx.run();
+    BOOST_TEST(order == "0011122");
+}
+
+void
+test_starvation()
+{
+    boost::asio::io_context ctx;
+    scheduler_type scheduler{ctx.get_executor(), 2, 2};
+
+    std::string order;
+    boost::asio::post(scheduler.get_executor(1), [&]() { order += 'l'; });
+    for (int i = 0; i < 6; ++i)
+        boost::asio::post(scheduler.get_executor(0), [&]() { order += 'h'; });
+
+    ctx.run();
+    // The low priority handler runs once 2 high priority ones overtook it.
+    BOOST_TEST(order == "hhlhhhh");
+}
+
+void
+test_dispatch()
+{
+    boost::asio::io_context ctx;
+    scheduler_type scheduler{ctx.get_executor()};
+
+    std::string order;
+    boost::asio::dispatch(scheduler.get_executor(1), [&]() {
+        BOOST_TEST(scheduler.running_in_this_thread());
+        boost::asio::dispatch(scheduler.get_executor(1),
+                              [&]() { order += 'd'; });
+        boost::asio::post(scheduler.get_executor(0), [&]() { order += 'p'; });
+        order += 'a';
+    });
+    BOOST_TEST(!scheduler.running_in_this_thread());
+    BOOST_TEST(order.empty());
+
+    ctx.run();
+    BOOST_TEST(order == "dap");
+}
+
+// Hops once through the executor associated with its CompletionHandler,
+// then upcalls.
+struct hop_op
+{
+    explicit hop_op(std::string& order)
+      : order_{order}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            COMPOSE_YIELD boost::asio::post(yield);
+            order_ += 'h';
+            return yield.upcall();
+        }
+    }
+
+    std::string& order_;
+    compose::coroutine coro_;
+};
+
+template<class CompletionToken>
+auto
+async_hop(boost::asio::io_context& ctx,
+          std::string& order,
+          CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void())
+{
+    boost::asio::async_completion<CompletionToken, void()> init{tok};
+    compose::stable_transform<hop_op>(
+      ctx.get_executor(), init, std::piecewise_construct, order)
+      .run();
+    return init.result.get();
+}
+
+void
+test_composed()
+{
+    boost::asio::io_context ctx;
+    scheduler_type scheduler{ctx.get_executor()};
+
+    std::string order;
+    for (int i = 0; i < 3; ++i)
+        boost::asio::post(scheduler.get_executor(1), [&]() { order += 'b'; });
+
+    int invoked = 0;
+    async_hop(ctx,
+              order,
+              boost::asio::bind_executor(scheduler.get_executor(0), [&]() {
+                  BOOST_TEST(scheduler.running_in_this_thread());
+                  order += 'u';
+                  ++invoked;
+              }));
+
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+    // The hop and the upcall overtake the queued bulk handlers.
+    BOOST_TEST(order == "hubbb");
+}
+
+void
+test_destroy()
+{
+    auto const counter = std::make_shared<int>(0);
+    {
+        std::unique_ptr<boost::asio::io_context> ctx{
+          new boost::asio::io_context};
+        scheduler_type scheduler{ctx->get_executor()};
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+            boost::asio::post(scheduler.get_executor(i % 2),
+                              [counter]() { ++*counter; });
+        }
+        BOOST_TEST(counter.use_count() == 5);
+        // The posted drain must be gone before the scheduler is destroyed.
+        ctx.reset();
+    }
+    BOOST_TEST(counter.use_count() == 1);
+    BOOST_TEST(*counter == 0);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_order();
+    compose_tests::test_starvation();
+    compose_tests::test_dispatch();
+    compose_tests::test_composed();
+    compose_tests::test_destroy();
+    return boost::report_errors();
+}
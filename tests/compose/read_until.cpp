@@ -0,0 +1,188 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/read_until.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <random>
+#include <string>
+
+namespace compose_tests
+{
+
+using socket_type = boost::asio::local::stream_protocol::socket;
+
+void
+test_find_delimiter()
+{
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<int> byte{'a', 'c'};
+    std::string const delims[] = {"a",
+                                  "\n",
+                                  "ab",
+                                  "\r\n",
+                                  "abc",
+                                  "\r\n\r\n",
+                                  "abcabca",
+                                  std::string(33, 'a') + "b"};
+
+    // Sizes around the block widths, with matches at arbitrary positions.
+    for (std::size_t size = 0; size < 100; ++size)
+    {
+        for (int round = 0; round < 20; ++round)
+        {
+            std::string data(size, '\0');
+            for (auto& c : data)
+                c = static_cast<char>(byte(rng));
+            if (round % 2 == 0 && size > 0)
+                data[rng() % size] = '\n';
+
+            for (auto const& delim : delims)
+            {
+                auto const expected = data.find(delim);
+                auto const found = compose::detail::find_delimiter(
+                  data.data(), data.size(), delim.data(), delim.size());
+                BOOST_TEST(found ==
+                           (expected == std::string::npos ? size : expected));
+                BOOST_TEST(compose::detail::find_delimiter_scalar(
+                             data.data(),
+                             data.size(),
+                             delim.data(),
+                             delim.size()) == found);
+            }
+        }
+    }
+
+    // No reads past the end of the data.
+    std::string const tail(64, 'x');
+    BOOST_TEST(compose::detail::find_delimiter(tail.data(), 63, "x", 1) == 0);
+    BOOST_TEST(compose::detail::find_delimiter(tail.data() + 1, 62, "\r", 1) ==
+               62);
+}
+
+void
+test_chunks()
+{
+    boost::asio::io_context ctx;
+    socket_type reader{ctx};
+    socket_type writer{ctx};
+    boost::asio::local::connect_pair(reader, writer);
+
+    std::string buffer;
+    std::size_t result = 0;
+    int invoked = 0;
+    compose::async_read_until(
+      reader,
+      boost::asio::dynamic_buffer(buffer),
+      "\r\n\r\n",
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          result = n;
+          ++invoked;
+      });
+
+    // The delimiter is split between the chunks.
+    for (auto const chunk :
+         {"GET / HTTP/1.1\r\n", "Host: x\r", "\n\r", "\nbody"})
+    {
+        BOOST_TEST(invoked == 0);
+        boost::asio::write(writer, boost::asio::buffer(std::string{chunk}));
+        ctx.poll();
+        ctx.restart();
+    }
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(result == 27);
+    BOOST_TEST(buffer.substr(0, result) ==
+               "GET / HTTP/1.1\r\nHost: x\r\n\r\n");
+    BOOST_TEST(buffer.substr(result) == "body");
+}
+
+void
+test_buffered()
+{
+    boost::asio::io_context ctx;
+    socket_type reader{ctx};
+    socket_type writer{ctx};
+    boost::asio::local::connect_pair(reader, writer);
+
+    // The delimiter is already buffered, nothing is read from the socket.
+    std::string buffer = "first\nsecond\n";
+    int invoked = 0;
+    compose::async_read_until(
+      reader,
+      boost::asio::dynamic_buffer(buffer),
+      '\n',
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(n == 6);
+          ++invoked;
+      });
+    BOOST_TEST(invoked == 0);
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+}
+
+void
+test_errors()
+{
+    boost::asio::io_context ctx;
+    socket_type reader{ctx};
+    socket_type writer{ctx};
+    boost::asio::local::connect_pair(reader, writer);
+
+    std::string limited;
+    std::string unlimited;
+    int invoked = 0;
+    compose::async_read_until(
+      reader,
+      boost::asio::dynamic_buffer(limited, 8),
+      '\n',
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(ec == boost::asio::error::not_found);
+          BOOST_TEST(n == 0);
+          BOOST_TEST(limited == "12345678");
+          ++invoked;
+
+          compose::async_read_until(
+            reader,
+            boost::asio::dynamic_buffer(unlimited),
+            '\n',
+            [&](boost::system::error_code ec, std::size_t n) {
+                BOOST_TEST(ec == boost::asio::error::eof);
+                BOOST_TEST(n == 0);
+                ++invoked;
+            });
+      });
+
+    boost::asio::write(writer, boost::asio::buffer("1234567890", 10));
+    writer.close();
+    ctx.run();
+
+    BOOST_TEST(invoked == 2);
+    BOOST_TEST(unlimited == "90");
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_find_delimiter();
+    compose_tests::test_chunks();
+    compose_tests::test_buffered();
+    compose_tests::test_errors();
+
+    return boost::report_errors();
+}
@@ -0,0 +1,212 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/receive_batch.hpp>
+
+#include <compose/coroutine.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <string>
+#include <vector>
+
+namespace compose_tests
+{
+
+using udp = boost::asio::ip::udp;
+
+// Receives datagrams in batches until count of them arrived, recording the
+// size of each batch.
+struct collect_op
+{
+    collect_op(udp::socket& socket,
+               std::size_t count,
+               std::vector<std::string>& datagrams,
+               std::vector<std::size_t>& batches)
+      : socket_{socket}
+      , count_{count}
+      , datagrams_{datagrams}
+      , batches_{batches}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {},
+                                     std::size_t n = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            while (datagrams_.size() < count_)
+            {
+                COMPOSE_YIELD batch_.async_receive(socket_, yield);
+                if (ec)
+                    break;
+
+                BOOST_TEST(n == batch_.size());
+                batches_.push_back(n);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    auto const data = batch_.data(i);
+                    datagrams_.emplace_back(
+                      static_cast<char const*>(data.data()), data.size());
+                    BOOST_TEST(batch_.endpoint(i).port() != 0);
+                    BOOST_TEST(batch_.truncated(i) ==
+                               (data.size() == batch_.datagram_size()));
+                }
+            }
+            return yield.upcall(ec);
+        }
+    }
+
+    udp::socket& socket_;
+    std::size_t count_;
+    std::vector<std::string>& datagrams_;
+    std::vector<std::size_t>& batches_;
+    compose::receive_batch<udp::socket> batch_{4, 8};
+    compose::coroutine coro_;
+};
+
+template<class CompletionToken>
+auto
+async_collect(udp::socket& socket,
+              std::size_t count,
+              std::vector<std::string>& datagrams,
+              std::vector<std::size_t>& batches,
+              CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code)>
+      init{tok};
+    compose::stable_transform<collect_op>(socket.get_executor(),
+                                          init,
+                                          std::piecewise_construct,
+                                          socket,
+                                          count,
+                                          datagrams,
+                                          batches)
+      .run();
+    return init.result.get();
+}
+
+struct endpoints
+{
+    explicit endpoints(boost::asio::io_context& ctx)
+      : receiver{ctx, {boost::asio::ip::address_v4::loopback(), 0}}
+      , sender{ctx, {boost::asio::ip::address_v4::loopback(), 0}}
+    {
+    }
+
+    void send(std::string const& message)
+    {
+        sender.send_to(boost::asio::buffer(message), receiver.local_endpoint());
+    }
+
+    udp::socket receiver;
+    udp::socket sender;
+};
+
+void
+test_queued()
+{
+    boost::asio::io_context ctx;
+    endpoints e{ctx};
+    std::vector<std::string> const sent{
+      "a", "", "bb", "ccc", "dddd", "too long datagram"};
+    for (auto const& message : sent)
+        e.send(message);
+
+    std::vector<std::string> datagrams;
+    std::vector<std::size_t> batches;
+    int invoked = 0;
+    async_collect(e.receiver,
+                  sent.size(),
+                  datagrams,
+                  batches,
+                  [&](boost::system::error_code ec) {
+                      BOOST_TEST(!ec);
+                      ++invoked;
+                  });
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    // Queued datagrams are drained a full batch at a time.
+    BOOST_TEST(batches == (std::vector<std::size_t>{4, 2}));
+    BOOST_TEST(datagrams.size() == sent.size());
+    for (std::size_t i = 0; i + 1 < sent.size(); ++i)
+        BOOST_TEST(datagrams[i] == sent[i]);
+    BOOST_TEST(datagrams.back() == sent.back().substr(0, 8));
+}
+
+void
+test_wait()
+{
+    boost::asio::io_context ctx;
+    endpoints e{ctx};
+
+    std::vector<std::string> datagrams;
+    std::vector<std::size_t> batches;
+    int invoked = 0;
+    async_collect(
+      e.receiver, 2, datagrams, batches, [&](boost::system::error_code ec) {
+          BOOST_TEST(!ec);
+          ++invoked;
+      });
+
+    // Nothing was sent, the operation waits for readability.
+    ctx.poll();
+    BOOST_TEST(invoked == 0);
+    BOOST_TEST(batches.empty());
+
+    e.send("x");
+    e.send("y");
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(datagrams == (std::vector<std::string>{"x", "y"}));
+}
+
+void
+test_cancel()
+{
+    boost::asio::io_context ctx;
+    endpoints e{ctx};
+
+    std::vector<std::string> datagrams;
+    std::vector<std::size_t> batches;
+    int invoked = 0;
+    async_collect(
+      e.receiver, 1, datagrams, batches, [&](boost::system::error_code ec) {
+          BOOST_TEST(ec == boost::asio::error::operation_aborted);
+          ++invoked;
+      });
+    ctx.poll();
+    e.receiver.cancel();
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(datagrams.empty());
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_queued();
+    compose_tests::test_wait();
+    compose_tests::test_cancel();
+
+    return boost::report_errors();
+}
@@ -0,0 +1,154 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <array>
+
+namespace compose_tests
+{
+
+int allocations = 0;
+int deallocations = 0;
+
+template<typename T>
+struct counting_allocator : std::allocator<T>
+{
+    template<typename U>
+    struct rebind
+    {
+        using other = counting_allocator<U>;
+    };
+
+    counting_allocator() = default;
+
+    template<typename U>
+    counting_allocator(counting_allocator<U> const&)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        ++allocations;
+        return std::allocator<T>::allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        ++deallocations;
+        std::allocator<T>::deallocate(p, n);
+    }
+};
+
+template<class... Args>
+struct counting_handler
+{
+    using allocator_type = counting_allocator<char>;
+
+    allocator_type get_allocator() const
+    {
+        return {};
+    }
+
+    void operator()(Args...)
+    {
+        ++invoked_;
+    }
+
+    int& invoked_;
+};
+
+using large_result = std::array<char, 1024>;
+
+template<class... Args>
+struct post_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield)
+    {
+        return yield.post_upcall(Args{}...);
+    }
+};
+
+// Declares the signature of its upcall, so that its frame has room for it.
+template<class... Args>
+struct reserving_post_op : post_op<Args...>
+{
+    using upcall_signature = void(Args...);
+};
+
+template<class Body, class Executor, class... Args>
+void
+async_post_op(Executor const& ex, counting_handler<Args...> handler)
+{
+    boost::asio::async_completion<counting_handler<Args...>&, void(Args...)>
+      init{handler};
+    compose::stable_transform<Body>(ex, init, std::piecewise_construct).run();
+}
+
+template<template<class...> class Body, class... Args>
+void
+test_recycled(int expected_allocations, bool type_erased = false)
+{
+    for (bool run : {true, false})
+    {
+        allocations = 0;
+        deallocations = 0;
+        int invoked = 0;
+        {
+            boost::asio::io_context ctx;
+            counting_handler<Args...> handler{invoked};
+            if (type_erased)
+                async_post_op<Body<Args...>>(
+                  boost::asio::any_io_executor{ctx.get_executor()}, handler);
+            else
+                async_post_op<Body<Args...>>(ctx.get_executor(), handler);
+            if (run)
+                ctx.run();
+        }
+
+        BOOST_TEST(invoked == (run ? 1 : 0));
+        BOOST_TEST(allocations == expected_allocations);
+        BOOST_TEST(deallocations == allocations);
+    }
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    using compose_tests::post_op;
+    using compose_tests::reserving_post_op;
+
+    // The executor's operation is allocated in the memory of the frame.
+    compose_tests::test_recycled<reserving_post_op>(1);
+    compose_tests::test_recycled<reserving_post_op,
+                                 boost::system::error_code,
+                                 std::size_t>(1);
+    // The reserve follows the layout of the executor's operation, also when
+    // the I/O executor is type-erased.
+    compose_tests::test_recycled<reserving_post_op,
+                                 boost::system::error_code,
+                                 std::size_t>(1, true);
+    // In-place upcall arguments need a node, but the operation which posts it
+    // still reuses the frame.
+    compose_tests::test_recycled<reserving_post_op,
+                                 compose_tests::large_result>(2);
+    // Without a reserve, the frame of an empty body is too small.
+    compose_tests::test_recycled<post_op,
+                                 boost::system::error_code,
+                                 std::size_t>(2);
+
+    return boost::report_errors();
+}
@@ -0,0 +1,300 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/send_batch.hpp>
+
+#include <compose/coroutine.hpp>
+#include <compose/stable_transform.hpp>
+#include <compose/uring_service.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/datagram_protocol.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace compose_tests
+{
+
+using stream_socket = boost::asio::local::stream_protocol::socket;
+using datagram_socket = boost::asio::local::datagram_protocol::socket;
+
+// Sends a message to each socket, with a single step of the body, and counts
+// how many times the body was resumed.
+template<typename Socket>
+struct fan_out_op
+{
+    fan_out_op(std::vector<Socket*> sockets,
+               std::vector<std::string> const& messages,
+               int& steps)
+      : sockets_{std::move(sockets)}
+      , messages_{messages}
+      , batch_{sockets_.front()->get_executor()}
+      , steps_{steps}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {},
+                                     std::size_t failed = 0)
+    {
+        ++steps_;
+        COMPOSE_REENTER(coro_)
+        {
+            for (std::size_t i = 0; i < messages_.size(); ++i)
+                batch_.add(*sockets_[i % sockets_.size()],
+                           boost::asio::buffer(messages_[i]));
+            COMPOSE_YIELD batch_.async_send(yield);
+
+            BOOST_TEST(batch_.size() == messages_.size());
+            for (std::size_t i = 0; i < batch_.size(); ++i)
+            {
+                if (!batch_.error(i))
+                    BOOST_TEST(batch_.bytes_transferred(i) ==
+                               messages_[i].size());
+            }
+            return yield.upcall(ec, failed);
+        }
+    }
+
+    std::vector<Socket*> sockets_;
+    std::vector<std::string> const& messages_;
+    compose::send_batch<Socket> batch_;
+    int& steps_;
+    compose::coroutine coro_;
+};
+
+template<typename Socket, class CompletionToken>
+auto
+async_fan_out(std::vector<Socket*> sockets,
+              std::vector<std::string> const& messages,
+              int& steps,
+              CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    auto const ex = sockets.front()->get_executor();
+    compose::stable_transform<fan_out_op<Socket>>(ex,
+                                                  init,
+                                                  std::piecewise_construct,
+                                                  std::move(sockets),
+                                                  messages,
+                                                  steps)
+      .run();
+    return init.result.get();
+}
+
+template<typename Socket>
+struct pairs
+{
+    explicit pairs(boost::asio::io_context& ctx, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            senders.emplace_back(new Socket{ctx});
+            receivers.emplace_back(new Socket{ctx});
+            boost::asio::local::connect_pair(*senders.back(),
+                                             *receivers.back());
+        }
+    }
+
+    std::vector<Socket*> sender_ptrs() const
+    {
+        std::vector<Socket*> ptrs;
+        for (auto& s : senders)
+            ptrs.push_back(s.get());
+        return ptrs;
+    }
+
+    std::vector<std::unique_ptr<Socket>> senders;
+    std::vector<std::unique_ptr<Socket>> receivers;
+};
+
+void
+test_stream(bool uring)
+{
+    boost::asio::io_context ctx;
+    if (uring)
+        (void)boost::asio::use_service<compose::uring_service>(ctx);
+
+    // More messages per socket than fit in a single io_uring submission.
+    pairs<stream_socket> p{ctx, 3};
+    std::vector<std::string> messages;
+    for (std::size_t i = 0; i < 40; ++i)
+        messages.emplace_back(i * 100, static_cast<char>('a' + i % 26));
+
+    int steps = 0;
+    int invoked = 0;
+    async_fan_out(p.sender_ptrs(),
+                  messages,
+                  steps,
+                  [&](boost::system::error_code ec, std::size_t failed) {
+                      BOOST_TEST(!ec);
+                      BOOST_TEST(failed == 0u);
+                      ++invoked;
+                  });
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    // The body is resumed once for the whole batch.
+    BOOST_TEST(steps == 2);
+
+    for (std::size_t i = 0; i < p.receivers.size(); ++i)
+    {
+        std::string expected;
+        for (std::size_t j = i; j < messages.size(); j += p.receivers.size())
+            expected += messages[j];
+
+        std::string data(expected.size(), '\0');
+        boost::asio::read(*p.receivers[i],
+                          boost::asio::buffer(&data[0], data.size()));
+        BOOST_TEST(data == expected);
+    }
+}
+
+void
+test_would_block()
+{
+    boost::asio::io_context ctx;
+    pairs<stream_socket> p{ctx, 2};
+    std::vector<std::string> const messages{std::string(8 << 20, 'a'), "b"};
+
+    int steps = 0;
+    int invoked = 0;
+    async_fan_out(p.sender_ptrs(),
+                  messages,
+                  steps,
+                  [&](boost::system::error_code ec, std::size_t failed) {
+                      BOOST_TEST(!ec);
+                      BOOST_TEST(failed == 0u);
+                      ++invoked;
+                  });
+
+    // The first socket's buffer is full, the batch waits for it.
+    ctx.poll();
+    BOOST_TEST(invoked == 0);
+
+    std::string data(messages[0].size(), '\0');
+    std::thread reader{[&] {
+        boost::asio::read(*p.receivers[0],
+                          boost::asio::buffer(&data[0], data.size()));
+    }};
+    ctx.run();
+    reader.join();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(steps == 2);
+    BOOST_TEST(data == messages[0]);
+}
+
+void
+test_datagram()
+{
+    boost::asio::io_context ctx;
+    pairs<datagram_socket> p{ctx, 1};
+    std::vector<std::string> const messages{"a", "", "bb", "ccc"};
+
+    int steps = 0;
+    int invoked = 0;
+    async_fan_out(p.sender_ptrs(),
+                  messages,
+                  steps,
+                  [&](boost::system::error_code ec, std::size_t failed) {
+                      BOOST_TEST(!ec);
+                      BOOST_TEST(failed == 0u);
+                      ++invoked;
+                  });
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(steps == 2);
+
+    // Message boundaries are preserved.
+    for (auto const& message : messages)
+    {
+        char data[16];
+        auto const n = p.receivers[0]->receive(boost::asio::buffer(data));
+        BOOST_TEST(std::string(data, n) == message);
+    }
+}
+
+void
+test_error()
+{
+    boost::asio::io_context ctx;
+    pairs<stream_socket> p{ctx, 2};
+    p.receivers[1]->close();
+    std::vector<std::string> const messages{"ok", "broken"};
+
+    int invoked = 0;
+    int steps = 0;
+    async_fan_out(p.sender_ptrs(),
+                  messages,
+                  steps,
+                  [&](boost::system::error_code ec, std::size_t failed) {
+                      BOOST_TEST(ec == boost::asio::error::broken_pipe);
+                      BOOST_TEST(failed == 1u);
+                      ++invoked;
+                  });
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    std::string data(2, '\0');
+    boost::asio::read(*p.receivers[0], boost::asio::buffer(&data[0], 2));
+    BOOST_TEST(data == "ok");
+}
+
+void
+test_abandoned()
+{
+    std::vector<std::string> const messages{std::string(8 << 20, 'a')};
+    int invoked = 0;
+    int steps = 0;
+    {
+        boost::asio::io_context ctx;
+        pairs<stream_socket> p{ctx, 1};
+        async_fan_out(
+          p.sender_ptrs(),
+          messages,
+          steps,
+          [&](boost::system::error_code, std::size_t) { ++invoked; });
+        ctx.poll();
+    }
+
+    // The operation is destroyed with the context, without being resumed.
+    BOOST_TEST(invoked == 0);
+    BOOST_TEST(steps == 1);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_stream(false);
+    compose_tests::test_stream(true);
+    compose_tests::test_would_block();
+    compose_tests::test_datagram();
+    compose_tests::test_error();
+    compose_tests::test_abandoned();
+
+    return boost::report_errors();
+}
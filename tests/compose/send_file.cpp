@@ -0,0 +1,233 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/send_file.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <cstdlib>
+#include <string>
+
+#include <unistd.h>
+
+namespace compose_tests
+{
+
+using tcp = boost::asio::ip::tcp;
+
+// A temporary file, unlinked right after being created.
+class temp_file
+{
+public:
+    explicit temp_file(std::string const& contents)
+    {
+        char name[] = "/tmp/compose_send_file_XXXXXX";
+        fd_ = ::mkstemp(name);
+        BOOST_TEST(fd_ >= 0);
+        ::unlink(name);
+        BOOST_TEST(::write(fd_, contents.data(), contents.size()) ==
+                   static_cast<ssize_t>(contents.size()));
+    }
+
+    temp_file(temp_file const&) = delete;
+    temp_file& operator=(temp_file const&) = delete;
+
+    ~temp_file()
+    {
+        ::close(fd_);
+    }
+
+    int native_handle() const noexcept
+    {
+        return fd_;
+    }
+
+private:
+    int fd_;
+};
+
+std::string
+make_contents(std::size_t size)
+{
+    std::string contents(size, '\0');
+    for (std::size_t i = 0; i < size; ++i)
+        contents[i] = static_cast<char>('a' + i % 23);
+    return contents;
+}
+
+void
+connect_pair(boost::asio::io_context& ctx, tcp::socket& a, tcp::socket& b)
+{
+    tcp::acceptor acceptor{ctx, {boost::asio::ip::address_v4::loopback(), 0}};
+    a.connect(acceptor.local_endpoint());
+    acceptor.accept(b);
+}
+
+// Reads the rest of the stream.
+template<typename Stream>
+void
+read_all(Stream& stream, std::string& out)
+{
+    out.resize(out.size() + 4096);
+    stream.async_read_some(
+      boost::asio::buffer(&out[out.size() - 4096], 4096),
+      [&stream, &out](boost::system::error_code ec, std::size_t n) {
+          out.resize(out.size() - 4096 + n);
+          if (!ec)
+              read_all(stream, out);
+      });
+}
+
+void
+test_socket()
+{
+    boost::asio::io_context ctx;
+    tcp::socket sender{ctx};
+    tcp::socket receiver{ctx};
+    connect_pair(ctx, sender, receiver);
+
+    // Large enough to fill the socket's send buffer several times.
+    auto const contents = make_contents(8 << 20);
+    temp_file file{contents};
+
+    std::string received;
+    int invoked = 0;
+    compose::async_send_file(
+      sender,
+      file.native_handle(),
+      100,
+      contents.size() - 200,
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(n == contents.size() - 200);
+          ++invoked;
+          sender.shutdown(tcp::socket::shutdown_send);
+      });
+    BOOST_TEST(invoked == 0);
+    read_all(receiver, received);
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(received == contents.substr(100, contents.size() - 200));
+    // The file position is left alone.
+    BOOST_TEST(::lseek(file.native_handle(), 0, SEEK_CUR) ==
+               static_cast<off_t>(contents.size()));
+}
+
+void
+test_descriptor()
+{
+    boost::asio::io_context ctx;
+    int fds[2];
+    BOOST_TEST(::pipe(fds) == 0);
+    boost::asio::posix::stream_descriptor reader{ctx, fds[0]};
+    boost::asio::posix::stream_descriptor writer{ctx, fds[1]};
+
+    // Not a socket, the data is copied through a pooled buffer.
+    auto const contents = make_contents(300000);
+    temp_file file{contents};
+
+    std::string received;
+    int invoked = 0;
+    compose::async_send_file(
+      writer,
+      file.native_handle(),
+      0,
+      contents.size(),
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(n == contents.size());
+          ++invoked;
+          writer.close();
+      });
+    read_all(reader, received);
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(received == contents);
+}
+
+template<typename Stream>
+void
+check_eof(boost::asio::io_context& ctx,
+          Stream& stream,
+          int file,
+          std::size_t size)
+{
+    int invoked = 0;
+    compose::async_send_file(
+      stream,
+      file,
+      size / 2,
+      size,
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(ec == boost::asio::error::eof);
+          BOOST_TEST(n == size - size / 2);
+          ++invoked;
+      });
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+}
+
+void
+test_eof()
+{
+    auto const contents = make_contents(1000);
+    temp_file file{contents};
+
+    boost::asio::io_context ctx;
+    tcp::socket sender{ctx};
+    tcp::socket receiver{ctx};
+    connect_pair(ctx, sender, receiver);
+    check_eof(ctx, sender, file.native_handle(), contents.size());
+
+    ctx.restart();
+    int fds[2];
+    BOOST_TEST(::pipe(fds) == 0);
+    boost::asio::posix::stream_descriptor reader{ctx, fds[0]};
+    boost::asio::posix::stream_descriptor writer{ctx, fds[1]};
+    check_eof(ctx, writer, file.native_handle(), contents.size());
+}
+
+void
+test_bad_file()
+{
+    boost::asio::io_context ctx;
+    tcp::socket sender{ctx};
+    tcp::socket receiver{ctx};
+    connect_pair(ctx, sender, receiver);
+
+    int invoked = 0;
+    compose::async_send_file(
+      sender, -1, 0, 10, [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(ec == boost::asio::error::bad_descriptor);
+          BOOST_TEST(n == 0);
+          ++invoked;
+      });
+    // The error is not reported from within the initiating function.
+    BOOST_TEST(invoked == 0);
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_socket();
+    compose_tests::test_descriptor();
+    compose_tests::test_eof();
+    compose_tests::test_bad_file();
+
+    return boost::report_errors();
+}
@@ -0,0 +1,170 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/speculative_io.hpp>
+
+#include <compose/coroutine.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <algorithm>
+#include <string>
+
+namespace compose_tests
+{
+
+using socket_type = boost::asio::local::stream_protocol::socket;
+
+// Reads one byte at a time until the end of the stream, then writes back the
+// number of bytes read.
+struct count_op
+{
+    explicit count_op(socket_type& socket, std::size_t& max_depth)
+      : socket_{socket}
+      , max_depth_{max_depth}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {},
+                                     std::size_t n = 0)
+    {
+        max_depth_ =
+          std::max(max_depth_, compose::detail::speculative_depth());
+        COMPOSE_REENTER(coro_)
+        {
+            for (;;)
+            {
+                COMPOSE_YIELD compose::speculative_read_some(
+                  socket_, boost::asio::buffer(&byte_, 1), yield);
+                if (ec)
+                    break;
+                count_ += n;
+            }
+
+            if (ec != boost::asio::error::eof)
+                return yield.upcall(ec, count_);
+
+            reply_ = std::to_string(count_);
+            COMPOSE_YIELD compose::speculative_write_some(
+              socket_, boost::asio::buffer(reply_), yield);
+            return yield.upcall(ec, count_);
+        }
+    }
+
+    socket_type& socket_;
+    std::size_t& max_depth_;
+    char byte_ = 0;
+    std::size_t count_ = 0;
+    std::string reply_;
+    compose::coroutine coro_;
+};
+
+template<class CompletionToken>
+auto
+async_count(socket_type& socket, std::size_t& max_depth, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    compose::stable_transform<count_op>(socket.get_executor(),
+                                        init,
+                                        std::piecewise_construct,
+                                        socket,
+                                        max_depth)
+      .run();
+    return init.result.get();
+}
+
+void
+test_inline_reads(std::size_t size)
+{
+    boost::asio::io_context ctx;
+    socket_type client{ctx};
+    socket_type server{ctx};
+    boost::asio::local::connect_pair(client, server);
+
+    boost::asio::write(client, boost::asio::buffer(std::string(size, 'x')));
+    client.shutdown(socket_type::shutdown_send);
+
+    int invoked = 0;
+    std::size_t count = 0;
+    std::size_t max_depth = 0;
+    boost::system::error_code ec;
+    async_count(server,
+                max_depth,
+                [&](boost::system::error_code ec_arg, std::size_t n) {
+                    ec = ec_arg;
+                    count = n;
+                    ++invoked;
+                });
+    auto const handlers = ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(!ec);
+    BOOST_TEST(count == size);
+    BOOST_TEST(max_depth <= COMPOSE_SPECULATIVE_BUDGET);
+    // Only the first read of each budget goes through the reactor.
+    BOOST_TEST(handlers <= size / COMPOSE_SPECULATIVE_BUDGET + 2);
+
+    std::string reply(16, '\0');
+    reply.resize(client.read_some(boost::asio::buffer(&reply[0], 16)));
+    BOOST_TEST(reply == std::to_string(size));
+}
+
+void
+test_would_block()
+{
+    boost::asio::io_context ctx;
+    socket_type client{ctx};
+    socket_type server{ctx};
+    boost::asio::local::connect_pair(client, server);
+
+    int invoked = 0;
+    std::size_t count = 0;
+    std::size_t max_depth = 0;
+    async_count(server,
+                max_depth,
+                [&](boost::system::error_code, std::size_t n) {
+                    count = n;
+                    ++invoked;
+                });
+
+    // Nothing to read, the operation waits in the reactor.
+    ctx.poll();
+    BOOST_TEST(invoked == 0);
+
+    boost::asio::write(client, boost::asio::buffer("abc", 3));
+    client.shutdown(socket_type::shutdown_send);
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(count == 3u);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_inline_reads(1);
+    compose_tests::test_inline_reads(100);
+    compose_tests::test_would_block();
+
+    return boost::report_errors();
+}
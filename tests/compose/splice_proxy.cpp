@@ -0,0 +1,203 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/splice_proxy.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <string>
+
+namespace compose_tests
+{
+
+using tcp = boost::asio::ip::tcp;
+
+void
+connect_pair(boost::asio::io_context& ctx, tcp::socket& a, tcp::socket& b)
+{
+    tcp::acceptor acceptor{ctx, {boost::asio::ip::address_v4::loopback(), 0}};
+    a.connect(acceptor.local_endpoint());
+    acceptor.accept(b);
+}
+
+std::string
+make_contents(std::size_t size, char first)
+{
+    std::string contents(size, '\0');
+    for (std::size_t i = 0; i < size; ++i)
+        contents[i] = static_cast<char>(first + i % 23);
+    return contents;
+}
+
+// A client connected to a server through the proxy, which runs between the
+// sockets a and b.
+struct topology
+{
+    explicit topology(boost::asio::io_context& ctx)
+      : client{ctx}
+      , a{ctx}
+      , b{ctx}
+      , server{ctx}
+    {
+        connect_pair(ctx, client, a);
+        connect_pair(ctx, b, server);
+    }
+
+    tcp::socket client;
+    tcp::socket a;
+    tcp::socket b;
+    tcp::socket server;
+};
+
+void
+test_forward()
+{
+    boost::asio::io_context ctx;
+    topology t{ctx};
+    auto const request = make_contents(3 << 20, 'a');
+    auto const response = make_contents(1 << 20, 'A');
+
+    int invoked = 0;
+    compose::async_splice_proxy(
+      t.a,
+      t.b,
+      [&](boost::system::error_code ec,
+          std::size_t a_to_b,
+          std::size_t b_to_a) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(a_to_b == request.size());
+          BOOST_TEST(b_to_a == response.size());
+          ++invoked;
+      });
+    BOOST_TEST(invoked == 0);
+
+    // Both directions transfer data at the same time. The client closes its
+    // side once everything was received.
+    std::string to_server(request.size(), '\0');
+    std::string to_client(response.size(), '\0');
+    int received = 0;
+    auto on_read = [&](boost::system::error_code ec, std::size_t) {
+        BOOST_TEST(!ec);
+        if (++received == 2)
+            t.client.shutdown(tcp::socket::shutdown_send);
+    };
+    boost::asio::async_write(
+      t.client,
+      boost::asio::buffer(request),
+      [](boost::system::error_code ec, std::size_t) { BOOST_TEST(!ec); });
+    boost::asio::async_write(
+      t.server,
+      boost::asio::buffer(response),
+      [](boost::system::error_code ec, std::size_t) { BOOST_TEST(!ec); });
+    boost::asio::async_read(
+      t.server, boost::asio::buffer(&to_server[0], to_server.size()), on_read);
+    boost::asio::async_read(
+      t.client, boost::asio::buffer(&to_client[0], to_client.size()), on_read);
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(to_server == request);
+    BOOST_TEST(to_client == response);
+}
+
+void
+test_closed()
+{
+    boost::asio::io_context ctx;
+    topology t{ctx};
+    t.server.close();
+
+    // The end of the stream is detected during initiation, the handler is
+    // still not invoked from within the initiating function.
+    int invoked = 0;
+    compose::async_splice_proxy(
+      t.a,
+      t.b,
+      [&](boost::system::error_code ec,
+          std::size_t a_to_b,
+          std::size_t b_to_a) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(a_to_b == 0);
+          BOOST_TEST(b_to_a == 0);
+          ++invoked;
+      });
+    BOOST_TEST(invoked == 0);
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+}
+
+void
+test_cancel()
+{
+    boost::asio::io_context ctx;
+    topology t{ctx};
+
+    int invoked = 0;
+    compose::async_splice_proxy(
+      t.a,
+      t.b,
+      [&](boost::system::error_code ec,
+          std::size_t a_to_b,
+          std::size_t b_to_a) {
+          BOOST_TEST(ec == boost::asio::error::operation_aborted);
+          BOOST_TEST(a_to_b == 5);
+          BOOST_TEST(b_to_a == 0);
+          ++invoked;
+      });
+
+    boost::asio::write(t.client, boost::asio::buffer("hello", 5));
+    std::string forwarded(5, '\0');
+    boost::asio::async_read(
+      t.server,
+      boost::asio::buffer(&forwarded[0], forwarded.size()),
+      [&](boost::system::error_code ec, std::size_t) {
+          BOOST_TEST(!ec);
+          t.b.cancel();
+      });
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(forwarded == "hello");
+}
+
+void
+test_abandoned()
+{
+    int invoked = 0;
+    {
+        boost::asio::io_context ctx;
+        topology t{ctx};
+        compose::async_splice_proxy(
+          t.a,
+          t.b,
+          [&](boost::system::error_code, std::size_t, std::size_t) {
+              ++invoked;
+          });
+        ctx.poll();
+    }
+    // Destroying the context destroys the waits and the operation with them.
+    BOOST_TEST(invoked == 0);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_forward();
+    compose_tests::test_closed();
+    compose_tests::test_cancel();
+    compose_tests::test_abandoned();
+
+    return boost::report_errors();
+}
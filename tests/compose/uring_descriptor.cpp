@@ -0,0 +1,336 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/uring_descriptor.hpp>
+
+#include <compose/coroutine.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+namespace compose_tests
+{
+
+using descriptor_type = compose::uring_descriptor<>;
+
+// Echoes everything it reads until the end of the stream, then completes with
+// the number of bytes echoed.
+struct echo_op
+{
+    explicit echo_op(descriptor_type& descriptor)
+      : descriptor_{descriptor}
+    {
+    }
+
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {},
+                                     std::size_t n = 0)
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (;;)
+            {
+                COMPOSE_YIELD descriptor_.async_read_some(
+                  boost::asio::buffer(buffer_), yield);
+                if (ec)
+                    break;
+
+                COMPOSE_YIELD boost::asio::async_write(
+                  descriptor_, boost::asio::buffer(buffer_, n), yield);
+                if (ec)
+                    break;
+                count_ += n;
+            }
+
+            if (ec == boost::asio::error::eof)
+                ec = {};
+            return yield.upcall(ec, count_);
+        }
+    }
+
+    descriptor_type& descriptor_;
+    char buffer_[7];
+    std::size_t count_ = 0;
+    compose::coroutine coro_;
+};
+
+template<class CompletionToken>
+auto
+async_echo(descriptor_type& descriptor, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code,
+                                        std::size_t))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code,
+                                       std::size_t)>
+      init{tok};
+    compose::stable_transform<echo_op>(descriptor.get_executor(),
+                                       init,
+                                       std::piecewise_construct,
+                                       descriptor)
+      .run();
+    return init.result.get();
+}
+
+void
+make_pair(boost::asio::io_context& ctx,
+          std::unique_ptr<descriptor_type>& first,
+          std::unique_ptr<descriptor_type>& second)
+{
+    int fds[2];
+    BOOST_TEST(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == 0);
+    first.reset(new descriptor_type{ctx.get_executor(), fds[0]});
+    second.reset(new descriptor_type{ctx.get_executor(), fds[1]});
+}
+
+void
+test_echo()
+{
+    boost::asio::io_context ctx;
+    std::unique_ptr<descriptor_type> client;
+    std::unique_ptr<descriptor_type> server;
+    make_pair(ctx, client, server);
+
+    std::string const message(100, 'x');
+    std::string reply(message.size(), '\0');
+    int invoked = 0;
+    std::size_t echoed = 0;
+    boost::system::error_code echo_ec;
+    async_echo(*server, [&](boost::system::error_code ec, std::size_t n) {
+        echo_ec = ec;
+        echoed = n;
+        ++invoked;
+    });
+
+    boost::asio::async_write(
+      *client,
+      boost::asio::buffer(message),
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(n == message.size());
+          boost::asio::async_read(
+            *client,
+            boost::asio::buffer(&reply[0], reply.size()),
+            [&](boost::system::error_code ec, std::size_t) {
+                BOOST_TEST(!ec);
+                ::shutdown(client->native_handle(), SHUT_WR);
+                ++invoked;
+            });
+      });
+    ctx.run();
+
+    BOOST_TEST(invoked == 2);
+    BOOST_TEST(!echo_ec);
+    BOOST_TEST(echoed == message.size());
+    BOOST_TEST(reply == message);
+}
+
+void
+test_positional()
+{
+    char path[] = "/tmp/compose_uring_XXXXXX";
+    auto const fd = ::mkstemp(path);
+    BOOST_TEST(fd >= 0);
+    ::unlink(path);
+
+    boost::asio::io_context ctx;
+    descriptor_type file{ctx.get_executor(), fd};
+
+    std::string data(4, '\0');
+    int invoked = 0;
+    file.async_write_some_at(
+      4,
+      boost::asio::buffer("abcd", 4),
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(n == 4u);
+          file.async_read_some_at(
+            4,
+            boost::asio::buffer(&data[0], data.size()),
+            [&](boost::system::error_code ec, std::size_t n) {
+                BOOST_TEST(!ec);
+                BOOST_TEST(n == 4u);
+                ++invoked;
+            });
+          file.async_read_some_at(
+            8,
+            boost::asio::buffer(&data[0], 1),
+            [&](boost::system::error_code ec, std::size_t n) {
+                BOOST_TEST(ec == boost::asio::error::eof);
+                BOOST_TEST(n == 0u);
+                ++invoked;
+            });
+      });
+    ctx.run();
+
+    BOOST_TEST(invoked == 2);
+    BOOST_TEST(data == "abcd");
+}
+
+void
+test_cancel()
+{
+    boost::asio::io_context ctx;
+    std::unique_ptr<descriptor_type> client;
+    std::unique_ptr<descriptor_type> server;
+    make_pair(ctx, client, server);
+
+    char byte = 0;
+    int invoked = 0;
+    server->async_read_some(
+      boost::asio::buffer(&byte, 1),
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(ec == boost::asio::error::operation_aborted);
+          BOOST_TEST(n == 0u);
+          ++invoked;
+      });
+
+    // Nothing to read, the operation is pending in the kernel.
+    ctx.poll();
+    BOOST_TEST(invoked == 0);
+
+    server->cancel();
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+}
+
+void
+test_destroyed()
+{
+    boost::asio::io_context ctx;
+    std::unique_ptr<descriptor_type> client;
+    std::unique_ptr<descriptor_type> server;
+    make_pair(ctx, client, server);
+
+    std::unique_ptr<char> byte{new char{}};
+    int invoked = 0;
+    server->async_read_some(
+      boost::asio::buffer(byte.get(), 1),
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(ec == boost::asio::error::operation_aborted);
+          BOOST_TEST(n == 0u);
+          ++invoked;
+          byte.reset();
+      });
+    ctx.poll();
+
+    // The pending read of the destroyed descriptor completes, so that the
+    // context runs out of work, and a new descriptor which reuses the file
+    // descriptor is not affected by the cancellation.
+    server.reset();
+    std::unique_ptr<descriptor_type> other;
+    std::unique_ptr<descriptor_type> peer;
+    make_pair(ctx, other, peer);
+    char other_byte = 0;
+    int other_invoked = 0;
+    other->async_read_some(
+      boost::asio::buffer(&other_byte, 1),
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(n == 1u);
+          ++other_invoked;
+      });
+    ctx.poll();
+    BOOST_TEST(other_invoked == 0);
+
+    BOOST_TEST(::write(peer->native_handle(), "x", 1) == 1);
+    ctx.run();
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(other_invoked == 1);
+    BOOST_TEST(other_byte == 'x');
+}
+
+void
+test_abandoned()
+{
+    std::unique_ptr<descriptor_type> client;
+    std::unique_ptr<descriptor_type> server;
+    char byte = 0;
+    int invoked = 0;
+    {
+        boost::asio::io_context ctx;
+        make_pair(ctx, client, server);
+        server->async_read_some(
+          boost::asio::buffer(&byte, 1),
+          [&](boost::system::error_code, std::size_t) { ++invoked; });
+        ctx.poll();
+        server.reset();
+        client.reset();
+    }
+
+    // Pending operations are destroyed with the context.
+    BOOST_TEST(invoked == 0);
+}
+
+// Exposes the shutdown of the services, which the destructor performs before
+// destroying them.
+struct shutdown_context : boost::asio::io_context
+{
+    using boost::asio::io_context::shutdown;
+};
+
+void
+test_shutdown()
+{
+    shutdown_context ctx;
+    std::unique_ptr<descriptor_type> client;
+    std::unique_ptr<descriptor_type> server;
+    make_pair(ctx, client, server);
+
+    char byte = 0;
+    int invoked = 0;
+    std::shared_ptr<int> alive = std::make_shared<int>();
+    std::weak_ptr<int> handler_alive = alive;
+    server->async_read_some(
+      boost::asio::buffer(&byte, 1),
+      [&invoked, alive = std::move(alive)](boost::system::error_code,
+                                           std::size_t) { ++invoked; });
+    ctx.poll();
+    ctx.shutdown();
+    BOOST_TEST(handler_alive.expired());
+    BOOST_TEST(invoked == 0);
+
+    // The read was cancelled before its buffer was released, so the byte
+    // stays in the socket.
+    BOOST_TEST(::write(client->native_handle(), "x", 1) == 1);
+    char received = 0;
+    BOOST_TEST(::recv(server->native_handle(), &received, 1, MSG_DONTWAIT) ==
+               1);
+    BOOST_TEST(received == 'x');
+    BOOST_TEST(byte == 0);
+    server.reset();
+    client.reset();
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_echo();
+    compose_tests::test_positional();
+    compose_tests::test_cancel();
+    compose_tests::test_destroyed();
+    compose_tests::test_abandoned();
+    compose_tests::test_shutdown();
+
+    return boost::report_errors();
+}
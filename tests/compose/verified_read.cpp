@@ -0,0 +1,213 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/verified_read.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <string>
+
+namespace compose_tests
+{
+
+using socket_type = boost::asio::local::stream_protocol::socket;
+
+std::string
+make_payload(std::size_t size)
+{
+    std::string payload(size, '\0');
+    for (std::size_t i = 0; i < size; ++i)
+        payload[i] = static_cast<char>(i * 31 + i / 7);
+    return payload;
+}
+
+void
+test_crc32c()
+{
+    BOOST_TEST(compose::crc32c("", 0) == 0);
+    BOOST_TEST(compose::crc32c("123456789", 9) == 0xe3069283);
+
+    std::string const zeros(32, '\0');
+    BOOST_TEST(compose::crc32c(zeros.data(), zeros.size()) == 0x8a9136aa);
+    std::string const ones(32, '\xff');
+    BOOST_TEST(compose::crc32c(ones.data(), ones.size()) == 0x62a8ab43);
+
+    // Checksums of consecutive chunks compose into the checksum of the whole.
+    auto const payload = make_payload(1000);
+    auto const whole = compose::crc32c(payload.data(), payload.size());
+    for (std::size_t split : {0, 1, 7, 8, 9, 500, 999, 1000})
+    {
+        auto const head = compose::crc32c(payload.data(), split);
+        BOOST_TEST(compose::crc32c(payload.data() + split,
+                                   payload.size() - split,
+                                   head) == whole);
+    }
+}
+
+void
+test_implementations()
+{
+    auto const payload = make_payload(20000);
+    auto const data =
+      reinterpret_cast<unsigned char const*>(payload.data());
+    for (std::size_t offset = 0; offset < 9; ++offset)
+    {
+        for (std::size_t size = 0; size + offset <= payload.size();
+             size += 1 + size / 4)
+        {
+            auto const portable =
+              compose::detail::crc32c_portable(~0u, data + offset, size);
+            BOOST_TEST(~portable ==
+                       compose::crc32c(data + offset, size));
+#ifdef COMPOSE_CRC32C_SSE42
+            auto const level = compose::detail::crc32c_hardware();
+            if (level > 0)
+            {
+                BOOST_TEST(compose::detail::crc32c_sse42(
+                             ~0u, data + offset, size) == portable);
+            }
+            if (level > 1)
+            {
+                BOOST_TEST(compose::detail::crc32c_pclmul(
+                             ~0u, data + offset, size) == portable);
+            }
+#endif // COMPOSE_CRC32C_SSE42
+        }
+    }
+}
+
+struct connection
+{
+    connection()
+      : reader{ctx}
+      , writer{ctx}
+    {
+        boost::asio::local::connect_pair(reader, writer);
+    }
+
+    boost::asio::io_context ctx;
+    socket_type reader;
+    socket_type writer;
+};
+
+void
+test_verified()
+{
+    connection c;
+    auto const payload = make_payload(200000);
+    auto const checksum = compose::crc32c(payload.data(), payload.size());
+    std::string received(payload.size(), '\0');
+
+    int invoked = 0;
+    compose::async_read_verified(
+      c.reader,
+      boost::asio::buffer(&received[0], received.size()),
+      checksum,
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(n == payload.size());
+          ++invoked;
+      });
+    boost::asio::async_write(
+      c.writer,
+      boost::asio::buffer(payload),
+      [](boost::system::error_code ec, std::size_t) { BOOST_TEST(!ec); });
+
+    c.ctx.run();
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(received == payload);
+}
+
+void
+test_mismatch()
+{
+    connection c;
+    auto payload = make_payload(5000);
+    auto const checksum = compose::crc32c(payload.data(), payload.size());
+    payload[4321] ^= 0x10;
+    boost::asio::write(c.writer, boost::asio::buffer(payload));
+
+    std::string received(payload.size(), '\0');
+    int invoked = 0;
+    compose::async_read_verified(
+      c.reader,
+      boost::asio::buffer(&received[0], received.size()),
+      checksum,
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(ec == compose::error::checksum_mismatch);
+          BOOST_TEST(ec.category() == compose::error_category());
+          BOOST_TEST(ec.message() == "Checksum mismatch");
+          BOOST_TEST(n == payload.size());
+          ++invoked;
+      });
+
+    c.ctx.run();
+    BOOST_TEST(invoked == 1);
+}
+
+void
+test_eof()
+{
+    connection c;
+    auto const payload = make_payload(100);
+    boost::asio::write(c.writer, boost::asio::buffer(payload));
+    c.writer.close();
+
+    std::string received(payload.size() + 1, '\0');
+    int invoked = 0;
+    compose::async_read_verified(
+      c.reader,
+      boost::asio::buffer(&received[0], received.size()),
+      compose::crc32c(payload.data(), payload.size()),
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(ec == boost::asio::error::eof);
+          BOOST_TEST(n == payload.size());
+          ++invoked;
+      });
+
+    c.ctx.run();
+    BOOST_TEST(invoked == 1);
+}
+
+void
+test_empty()
+{
+    connection c;
+    int invoked = 0;
+    compose::async_read_verified(
+      c.reader,
+      boost::asio::mutable_buffer{},
+      0,
+      [&](boost::system::error_code ec, std::size_t n) {
+          BOOST_TEST(!ec);
+          BOOST_TEST(n == 0);
+          ++invoked;
+      });
+
+    c.ctx.run();
+    BOOST_TEST(invoked == 1);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_crc32c();
+    compose_tests::test_implementations();
+    compose_tests::test_verified();
+    compose_tests::test_mismatch();
+    compose_tests::test_eof();
+    compose_tests::test_empty();
+    return boost::report_errors();
+}
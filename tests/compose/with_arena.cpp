@@ -0,0 +1,339 @@
+//
+// Copyright (c) 2018 Damian Jarek (damian dot jarek93 at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/djarek/compose
+//
+
+#include <compose/with_arena.hpp>
+
+#include <compose/coroutine.hpp>
+#include <compose/stable_transform.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/core/lightweight_test.hpp>
+
+#include <array>
+
+namespace compose_tests
+{
+
+int allocations = 0;
+int deallocations = 0;
+
+template<typename T>
+struct counting_allocator : std::allocator<T>
+{
+    template<typename U>
+    struct rebind
+    {
+        using other = counting_allocator<U>;
+    };
+
+    counting_allocator() = default;
+
+    template<typename U>
+    counting_allocator(counting_allocator<U> const&)
+    {
+    }
+
+    T* allocate(std::size_t n)
+    {
+        ++allocations;
+        return std::allocator<T>::allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        ++deallocations;
+        std::allocator<T>::deallocate(p, n);
+    }
+};
+
+struct counting_handler
+{
+    using allocator_type = counting_allocator<char>;
+
+    allocator_type get_allocator() const
+    {
+        return {};
+    }
+
+    void operator()(boost::system::error_code ec)
+    {
+        ec_ = ec;
+        ++invoked_;
+    }
+
+    boost::system::error_code& ec_;
+    int& invoked_;
+};
+
+// Child operation, started by the top-level operation for each round.
+struct tick_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {})
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (; ticks_ > 0; --ticks_)
+            {
+                timer_.expires_after(std::chrono::microseconds{1});
+                COMPOSE_YIELD timer_.async_wait(yield);
+                if (ec)
+                    break;
+            }
+            return yield.direct_upcall(ec);
+        }
+    }
+
+    boost::asio::steady_timer& timer_;
+    int ticks_;
+    compose::coroutine coro_{};
+};
+
+template<class CompletionToken>
+auto
+async_tick(boost::asio::steady_timer& timer, int ticks, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code)>
+      init{tok};
+    compose::stable_transform<tick_op>(
+      timer.get_executor(), init, std::piecewise_construct, timer, ticks)
+      .run();
+    return init.result.get();
+}
+
+struct request_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code ec = {})
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (; rounds_ > 0; --rounds_)
+            {
+                COMPOSE_YIELD async_tick(timer_, 3, yield);
+                if (ec)
+                    break;
+            }
+            return yield.upcall(ec);
+        }
+    }
+
+    boost::asio::steady_timer& timer_;
+    int rounds_;
+    compose::coroutine coro_{};
+};
+
+template<std::size_t ArenaSize, class CompletionToken>
+auto
+async_request(boost::asio::steady_timer& timer,
+              int rounds,
+              CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken,
+                                   void(boost::system::error_code))
+{
+    boost::asio::async_completion<CompletionToken,
+                                  void(boost::system::error_code)>
+      init{tok};
+    compose::stable_transform<compose::with_arena<request_op, ArenaSize>>(
+      timer.get_executor(), init, std::piecewise_construct, timer, rounds)
+      .run();
+    return init.result.get();
+}
+
+using large_result = std::array<char, 2 * COMPOSE_INPLACE_UPCALL_THRESHOLD>;
+
+// Completes with a result which is upcalled in place. The child's frame, or
+// the node of a posted upcall, must be freed before the parent starts the next
+// child, or completes and frees the arena. The node is allocated above the
+// frame, which is freed first.
+struct large_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     boost::system::error_code = {})
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            timer_.expires_after(std::chrono::microseconds{1});
+            COMPOSE_YIELD timer_.async_wait(yield);
+            result_.fill('x');
+            if (post_)
+                return yield.post_upcall(result_);
+            return yield.direct_upcall(result_);
+        }
+    }
+
+    boost::asio::steady_timer& timer_;
+    bool post_;
+    large_result result_{};
+    compose::coroutine coro_{};
+};
+
+template<class CompletionToken>
+auto
+async_large(boost::asio::steady_timer& timer, bool post, CompletionToken&& tok)
+  -> BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(large_result))
+{
+    boost::asio::async_completion<CompletionToken, void(large_result)> init{
+      tok};
+    compose::stable_transform<large_op>(
+      timer.get_executor(), init, std::piecewise_construct, timer, post)
+      .run();
+    return init.result.get();
+}
+
+struct large_request_op
+{
+    template<class Self>
+    compose::upcall_guard operator()(compose::yield_token<Self> yield,
+                                     large_result const& r = {})
+    {
+        COMPOSE_REENTER(coro_)
+        {
+            for (; rounds_ > 0; --rounds_)
+            {
+                COMPOSE_YIELD async_large(timer_, post_, yield);
+                if (r[0] != 'x')
+                    return yield.upcall(boost::asio::error::invalid_argument);
+            }
+            return yield.upcall(boost::system::error_code{});
+        }
+    }
+
+    boost::asio::steady_timer& timer_;
+    bool post_;
+    int rounds_;
+    compose::coroutine coro_{};
+};
+
+void
+test_large_upcall()
+{
+    for (bool post : {false, true})
+    {
+        boost::asio::io_context ctx;
+        boost::asio::steady_timer timer{ctx};
+        boost::system::error_code ec = boost::asio::error::eof;
+        int invoked = 0;
+
+        // Room for a few children, but not for one per round.
+        allocations = deallocations = 0;
+        counting_handler handler{ec, invoked};
+        boost::asio::async_completion<counting_handler&,
+                                      void(boost::system::error_code)>
+          init{handler};
+        compose::stable_transform<compose::with_arena<large_request_op, 4096>>(
+          ctx.get_executor(),
+          init,
+          std::piecewise_construct,
+          timer,
+          post,
+          32)
+          .run();
+        ctx.run();
+
+        BOOST_TEST(invoked == 1);
+        BOOST_TEST(!ec);
+        BOOST_TEST(allocations == 1);
+        BOOST_TEST(deallocations == 1);
+    }
+}
+
+void
+test_arena()
+{
+    boost::asio::io_context ctx;
+    boost::asio::steady_timer timer{ctx};
+    boost::system::error_code ec = boost::asio::error::eof;
+    int invoked = 0;
+
+    allocations = deallocations = 0;
+    async_request<4096>(timer, 4, counting_handler{ec, invoked});
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(!ec);
+    BOOST_TEST(allocations == 1);
+    BOOST_TEST(deallocations == 1);
+}
+
+void
+test_exhausted_arena()
+{
+    boost::asio::io_context ctx;
+    boost::asio::steady_timer timer{ctx};
+    boost::system::error_code ec = boost::asio::error::eof;
+    int invoked = 0;
+
+    allocations = deallocations = 0;
+    async_request<16>(timer, 4, counting_handler{ec, invoked});
+    ctx.run();
+
+    BOOST_TEST(invoked == 1);
+    BOOST_TEST(!ec);
+    BOOST_TEST(allocations > 1);
+    BOOST_TEST(deallocations == allocations);
+}
+
+void
+test_arena_resource()
+{
+    compose::detail::monotonic_arena<64> arena;
+    auto const a = arena.allocate(8, 8);
+    auto const b = arena.allocate(16, 16);
+    BOOST_TEST(a != nullptr);
+    BOOST_TEST(b != nullptr);
+    BOOST_TEST(reinterpret_cast<std::uintptr_t>(b) % 16 == 0);
+    BOOST_TEST(arena.allocate(64, 1) == nullptr);
+
+    auto const used = arena.used();
+    BOOST_TEST(arena.deallocate(b, 16));
+    BOOST_TEST(arena.used() < used);
+    BOOST_TEST(arena.allocate(16, 16) == b);
+
+    int outside = 0;
+    BOOST_TEST(!arena.deallocate(&outside, sizeof(outside)));
+}
+
+void
+test_out_of_order()
+{
+    compose::detail::monotonic_arena<64> arena;
+    auto const a = arena.allocate(16, 16);
+    auto const b = arena.allocate(16, 16);
+    BOOST_TEST(arena.used() == 32u);
+
+    // Freed below the top, reused by the next allocation of the same size.
+    BOOST_TEST(arena.deallocate(a, 16));
+    BOOST_TEST(arena.used() == 32u);
+    BOOST_TEST(arena.allocate(16, 16) == a);
+
+    // Reclaimed once the blocks above it are freed.
+    BOOST_TEST(arena.deallocate(a, 16));
+    BOOST_TEST(arena.deallocate(b, 16));
+    BOOST_TEST(arena.used() == 0u);
+}
+
+} // namespace compose_tests
+
+int
+main()
+{
+    compose_tests::test_arena();
+    compose_tests::test_exhausted_arena();
+    compose_tests::test_large_upcall();
+    compose_tests::test_arena_resource();
+    compose_tests::test_out_of_order();
+    return boost::report_errors();
+}